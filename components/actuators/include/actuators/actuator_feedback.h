@@ -0,0 +1,43 @@
+#ifndef ACTUATOR_FEEDBACK_H
+#define ACTUATOR_FEEDBACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "actuators/actuator_manager.h"
+
+/*
+ * Closed-loop check of actuator outputs.
+ *
+ * An actuator may be given a feedback input: a current sensor on an ADC1
+ * channel (registered in the shared ADC sweep) or an auxiliary relay contact on
+ * a GPIO. A periodic verifier compares the measured state with the commanded
+ * output once the settle time after the last switch has passed; a current
+ * input is checked once per sweep, on the peak of a short conversion burst. A
+ * mismatch seen on several consecutive checks latches ACTUATOR_FAULT_STUCK_ON or
+ * ACTUATOR_FAULT_STUCK_OFF and the actuator reports ACTUATOR_STATE_ERROR. The
+ * fault clears on its own once the output is seen to follow the command again.
+ */
+
+typedef enum {
+    ACTUATOR_FEEDBACK_NONE,
+    ACTUATOR_FEEDBACK_CURRENT,      /* current sense on ADC1 */
+    ACTUATOR_FEEDBACK_CONTACT       /* auxiliary contact on GPIO */
+} actuator_feedback_type_t;
+
+typedef struct {
+    actuator_feedback_type_t type;
+    uint8_t channel;                /* ADC1 channel or GPIO number */
+    uint16_t on_threshold;          /* raw ADC counts at or above which the load is running */
+    bool active_low;                /* contact closes to ground when the load runs */
+    uint32_t settle_ms;             /* ignore the input this long after a switch */
+} actuator_feedback_config_t;
+
+esp_err_t actuator_feedback_init(void);
+esp_err_t actuator_feedback_deinit(void);
+esp_err_t actuator_feedback_configure(uint8_t actuator_id, const actuator_feedback_config_t *config);
+esp_err_t actuator_feedback_remove(uint8_t actuator_id);
+esp_err_t actuator_feedback_get_measured(uint8_t actuator_id, bool *running);
+esp_err_t actuator_feedback_clear_fault(uint8_t actuator_id);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <esp_err.h>
+#include "actuators/actuator_output.h"
 
 typedef enum {
     ACTUATOR_TYPE_FAN,
@@ -22,16 +23,26 @@ typedef enum {
     ACTUATOR_STATE_ERROR
 } actuator_state_t;
 
+typedef enum {
+    ACTUATOR_FAULT_NONE,
+    ACTUATOR_FAULT_STUCK_ON,        /* commanded OFF, load still running */
+    ACTUATOR_FAULT_STUCK_OFF        /* commanded ON, load not running */
+} actuator_fault_t;
+
 typedef struct {
     uint8_t id;
     char name[64];
     actuator_type_t type;
     actuator_state_t state;
-    uint8_t pin;
+    uint8_t pin;                    /* GPIO number or expander channel */
+    actuator_output_bus_t bus;
     uint8_t duty_cycle;
+    bool output_on;                 /* level last commanded on the output */
+    actuator_fault_t fault;         /* state reads ERROR while set */
     bool enabled;
     bool manual_override;
     uint32_t last_activation_time;
+    uint32_t last_change_time;      /* last output edge, used for feedback settle */
     uint32_t total_runtime;
     uint32_t activation_count;
 } actuator_data_t;
@@ -41,10 +52,17 @@ typedef void (*actuator_callback_t)(uint8_t actuator_id, actuator_state_t state)
 esp_err_t actuator_manager_init(void);
 esp_err_t actuator_manager_deinit(void);
 esp_err_t actuator_register(uint8_t id, const char *name, actuator_type_t type, uint8_t pin);
+esp_err_t actuator_register_output(uint8_t id, const char *name, actuator_type_t type,
+                                   actuator_output_bus_t bus, uint8_t channel);
 esp_err_t actuator_unregister(uint8_t id);
 esp_err_t actuator_set_state(uint8_t id, actuator_state_t state);
 esp_err_t actuator_set_duty_cycle(uint8_t id, uint8_t duty_cycle);
 esp_err_t actuator_get_state(uint8_t id, actuator_state_t *state);
+esp_err_t actuator_get_commanded_state(uint8_t id, actuator_state_t *state);
+/* Copy of one actuator's record, taken under the manager's lock */
+esp_err_t actuator_get_data(uint8_t id, actuator_data_t *data);
+esp_err_t actuator_set_fault(uint8_t id, actuator_fault_t fault);
+esp_err_t actuator_get_fault(uint8_t id, actuator_fault_t *fault);
 esp_err_t actuator_get_all(actuator_data_t **actuators, uint8_t *count);
 esp_err_t actuator_set_enabled(uint8_t id, bool enabled);
 esp_err_t actuator_set_manual_override(uint8_t id, bool override);
@@ -53,5 +71,6 @@ esp_err_t actuator_emergency_stop_all(void);
 void actuator_set_callback(actuator_callback_t callback);
 const char* actuator_type_to_string(actuator_type_t type);
 const char* actuator_state_to_string(actuator_state_t state);
+const char* actuator_fault_to_string(actuator_fault_t fault);
 
 #endif
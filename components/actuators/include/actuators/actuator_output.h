@@ -0,0 +1,41 @@
+#ifndef ACTUATOR_OUTPUT_H
+#define ACTUATOR_OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Output backends for actuators.
+ *
+ * Each actuator drives one channel on a bus: a native GPIO number, a bit in a
+ * 74HC595 shift-register chain (SPI) or a pin on an MCP23017 expander (I2C,
+ * 16 channels per chip, chip N at address 0x20 + N). Expander writes only
+ * update a shadow register; between actuator_output_begin_batch() and
+ * actuator_output_end_batch() the shadow is flushed once, so a whole chain is
+ * refreshed in a single bus transfer.
+ *
+ * actuator_output_set_duty() runs a native GPIO at 25 kHz PWM through LEDC;
+ * on expander channels any non-zero duty is simply ON.
+ *
+ * Native pins used by an enabled expander bus are refused as GPIO outputs
+ * (ESP_ERR_INVALID_STATE), so a clashing actuator cannot detach the bus.
+ */
+
+typedef enum {
+    ACTUATOR_OUTPUT_GPIO,
+    ACTUATOR_OUTPUT_HC595,
+    ACTUATOR_OUTPUT_MCP23017
+} actuator_output_bus_t;
+
+esp_err_t actuator_output_init(void);
+esp_err_t actuator_output_configure(actuator_output_bus_t bus, uint8_t channel);
+esp_err_t actuator_output_set(actuator_output_bus_t bus, uint8_t channel, bool level);
+esp_err_t actuator_output_set_duty(actuator_output_bus_t bus, uint8_t channel, uint8_t duty_percent);
+esp_err_t actuator_output_begin_batch(void);
+esp_err_t actuator_output_end_batch(void);
+esp_err_t actuator_output_flush(void);
+uint16_t actuator_output_channel_count(actuator_output_bus_t bus);
+const char* actuator_output_bus_to_string(actuator_output_bus_t bus);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ACTUATOR_SEQUENCER_H
+#define ACTUATOR_SEQUENCER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "actuators/actuator_manager.h"
+
+/*
+ * Staggered start sequencer.
+ *
+ * ON transitions requested through the sequencer are queued and released one
+ * at a time from an esp_timer, at least stagger_ms apart, so a group of motors
+ * or heaters never energises in the same instant. OFF transitions bypass the
+ * queue and are applied immediately; they also drop any pending ON for the
+ * same actuator. The caller never blocks.
+ */
+
+esp_err_t actuator_sequencer_init(uint32_t stagger_ms);
+esp_err_t actuator_sequencer_deinit(void);
+esp_err_t actuator_sequencer_set_stagger(uint32_t stagger_ms);
+uint32_t actuator_sequencer_get_stagger(void);
+esp_err_t actuator_sequencer_request(uint8_t id, actuator_state_t state);
+esp_err_t actuator_sequencer_set_group_state(const uint8_t *ids, uint8_t count, actuator_state_t state);
+esp_err_t actuator_sequencer_cancel(uint8_t id);
+void actuator_sequencer_cancel_all(void);
+uint8_t actuator_sequencer_pending_count(void);
+
+#endif
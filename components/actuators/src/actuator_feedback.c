@@ -0,0 +1,258 @@
+#include "actuators/actuator_feedback.h"
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#include "sensors/adc_sweep.h"
+#include "utils/config.h"
+
+static const char *TAG = "ACT_FEEDBACK";
+
+/* Consecutive checks that must agree before a fault is raised or cleared */
+#define FEEDBACK_CONFIRM_COUNT 3
+/* Conversions per current check; a burst spans several 25 kHz PWM periods */
+#define FEEDBACK_CURRENT_SAMPLES 8
+
+typedef enum {
+    FEEDBACK_SAMPLE_NONE,           /* nothing usable after the settle window: start counting again */
+    FEEDBACK_SAMPLE_STALE,          /* no new sweep since the last check */
+    FEEDBACK_SAMPLE_NEW
+} feedback_sample_t;
+
+typedef struct {
+    uint8_t actuator_id;
+    actuator_feedback_config_t config;
+    bool measured;
+    bool valid;
+    uint8_t mismatch_count;
+    uint8_t match_count;
+    uint32_t sweep_time;            /* sweep the last current check was counted on */
+} feedback_entry_t;
+
+static feedback_entry_t entries[CONFIG_MAX_ACTUATORS];
+static uint8_t entry_count = 0;
+static esp_timer_handle_t verify_timer = NULL;
+static volatile bool initialized = false;
+
+static feedback_entry_t *feedback_find(uint8_t actuator_id)
+{
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].actuator_id == actuator_id) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static feedback_sample_t feedback_sample(feedback_entry_t *entry, const actuator_data_t *actuator, uint32_t now)
+{
+    uint32_t settled_at = actuator->last_change_time + entry->config.settle_ms;
+    if ((int32_t)(now - settled_at) < 0) return FEEDBACK_SAMPLE_NONE;
+
+    if (entry->config.type == ACTUATOR_FEEDBACK_CONTACT) {
+        int level = gpio_get_level(entry->config.channel);
+        entry->measured = entry->config.active_low ? (level == 0) : (level != 0);
+        return FEEDBACK_SAMPLE_NEW;
+    }
+
+    /* Current sense: only trust a sweep that ran after the load settled, and
+     * count each sweep once, since the verifier runs faster than the sweep */
+    uint32_t sweep_time = adc_sweep_get_timestamp();
+    if ((int32_t)(sweep_time - settled_at) < 0) return FEEDBACK_SAMPLE_NONE;
+    if (sweep_time == entry->sweep_time) return FEEDBACK_SAMPLE_STALE;
+
+    /* A PWM load draws current only in the on part of each period, so one
+     * conversion can miss it; take a burst and use the highest reading */
+    int samples[FEEDBACK_CURRENT_SAMPLES];
+    if (adc_sweep_read((adc_channel_t)entry->config.channel, samples, FEEDBACK_CURRENT_SAMPLES) != ESP_OK) {
+        return FEEDBACK_SAMPLE_NONE;
+    }
+    int peak = 0;
+    for (int i = 0; i < FEEDBACK_CURRENT_SAMPLES; i++) {
+        if (samples[i] > peak) peak = samples[i];
+    }
+    entry->sweep_time = sweep_time;
+    entry->measured = peak >= entry->config.on_threshold;
+    return FEEDBACK_SAMPLE_NEW;
+}
+
+static void feedback_verify(feedback_entry_t *entry, uint32_t now)
+{
+    /* The table may be reshuffled by actuator_unregister(); work on a copy */
+    actuator_data_t actuator;
+    if (actuator_get_data(entry->actuator_id, &actuator) != ESP_OK || !actuator.enabled) return;
+
+    feedback_sample_t sample = feedback_sample(entry, &actuator, now);
+    if (sample == FEEDBACK_SAMPLE_STALE) return;
+    if (sample == FEEDBACK_SAMPLE_NONE) {
+        entry->mismatch_count = 0;
+        entry->match_count = 0;
+        return;
+    }
+    entry->valid = true;
+
+    bool commanded = actuator.output_on;
+    actuator_fault_t fault = actuator.fault;
+
+    if (entry->measured != commanded) {
+        entry->match_count = 0;
+        if (fault == ACTUATOR_FAULT_NONE && ++entry->mismatch_count >= FEEDBACK_CONFIRM_COUNT) {
+            actuator_set_fault(entry->actuator_id,
+                               commanded ? ACTUATOR_FAULT_STUCK_OFF : ACTUATOR_FAULT_STUCK_ON);
+            entry->mismatch_count = 0;
+        }
+        return;
+    }
+
+    entry->mismatch_count = 0;
+
+    /* Clear only once the output follows the command the fault was raised under */
+    bool recovered = (fault == ACTUATOR_FAULT_STUCK_ON && !commanded) ||
+                     (fault == ACTUATOR_FAULT_STUCK_OFF && commanded);
+    if (recovered && ++entry->match_count >= FEEDBACK_CONFIRM_COUNT) {
+        actuator_set_fault(entry->actuator_id, ACTUATOR_FAULT_NONE);
+        entry->match_count = 0;
+    }
+}
+
+static void feedback_timer_callback(void *arg)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+    for (int i = 0; i < entry_count; i++) {
+        feedback_verify(&entries[i], now);
+    }
+}
+
+esp_err_t actuator_feedback_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    memset(entries, 0, sizeof(entries));
+    entry_count = 0;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = feedback_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "act_feedback"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &verify_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create verifier timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t actuator_feedback_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    initialized = false;
+    esp_timer_stop(verify_timer);
+    esp_timer_delete(verify_timer);
+    verify_timer = NULL;
+    entry_count = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t actuator_feedback_configure(uint8_t actuator_id, const actuator_feedback_config_t *config)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (config == NULL) return ESP_ERR_INVALID_ARG;
+    if (config->type == ACTUATOR_FEEDBACK_NONE) return actuator_feedback_remove(actuator_id);
+    actuator_data_t actuator;
+    if (actuator_get_data(actuator_id, &actuator) != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+    esp_err_t err;
+    if (config->type == ACTUATOR_FEEDBACK_CURRENT) {
+        err = adc_sweep_add_channel((adc_channel_t)config->channel);
+    } else {
+        gpio_reset_pin(config->channel);
+        err = gpio_set_direction(config->channel, GPIO_MODE_INPUT);
+        if (err == ESP_OK && config->active_low) {
+            err = gpio_set_pull_mode(config->channel, GPIO_PULLUP_ONLY);
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot use channel %d as feedback for actuator %d", config->channel, actuator_id);
+        return err;
+    }
+
+    /* The verifier runs in the esp_timer task; stop it while the table changes */
+    esp_timer_stop(verify_timer);
+
+    feedback_entry_t *entry = feedback_find(actuator_id);
+    if (entry == NULL) {
+        if (entry_count >= CONFIG_MAX_ACTUATORS) {
+            esp_timer_start_periodic(verify_timer, (uint64_t)CONFIG_ACTUATOR_FEEDBACK_PERIOD_MS * 1000);
+            return ESP_ERR_NO_MEM;
+        }
+        entry = &entries[entry_count++];
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->actuator_id = actuator_id;
+    entry->config = *config;
+
+    esp_timer_start_periodic(verify_timer, (uint64_t)CONFIG_ACTUATOR_FEEDBACK_PERIOD_MS * 1000);
+
+    ESP_LOGI(TAG, "Actuator %d feedback: %s on channel %d, settle %lu ms", actuator_id,
+             config->type == ACTUATOR_FEEDBACK_CURRENT ? "current" : "contact",
+             config->channel, (unsigned long)config->settle_ms);
+
+    return ESP_OK;
+}
+
+esp_err_t actuator_feedback_remove(uint8_t actuator_id)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    esp_timer_stop(verify_timer);
+
+    esp_err_t result = ESP_ERR_NOT_FOUND;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].actuator_id == actuator_id) {
+            for (int j = i; j < entry_count - 1; j++) {
+                entries[j] = entries[j + 1];
+            }
+            entry_count--;
+            actuator_set_fault(actuator_id, ACTUATOR_FAULT_NONE);
+            result = ESP_OK;
+            break;
+        }
+    }
+
+    if (entry_count > 0) {
+        esp_timer_start_periodic(verify_timer, (uint64_t)CONFIG_ACTUATOR_FEEDBACK_PERIOD_MS * 1000);
+    }
+
+    return result;
+}
+
+esp_err_t actuator_feedback_get_measured(uint8_t actuator_id, bool *running)
+{
+    if (running == NULL) return ESP_ERR_INVALID_ARG;
+
+    feedback_entry_t *entry = feedback_find(actuator_id);
+    if (entry == NULL) return ESP_ERR_NOT_FOUND;
+    if (!entry->valid) return ESP_ERR_INVALID_STATE;
+
+    *running = entry->measured;
+    return ESP_OK;
+}
+
+esp_err_t actuator_feedback_clear_fault(uint8_t actuator_id)
+{
+    feedback_entry_t *entry = feedback_find(actuator_id);
+    if (entry != NULL) {
+        entry->mismatch_count = 0;
+        entry->match_count = 0;
+    }
+    return actuator_set_fault(actuator_id, ACTUATOR_FAULT_NONE);
+}
@@ -1,6 +1,7 @@
 #include "actuators/actuator_manager.h"
+#include "actuators/actuator_sequencer.h"
+#include "actuators/actuator_feedback.h"
 #include <driver/gpio.h>
-#include <driver/ledc.h>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -16,6 +17,16 @@ static actuator_callback_t user_callback = NULL;
 static volatile bool initialized = false;
 static SemaphoreHandle_t actuator_mutex = NULL;
 
+/* Must be called with actuator_mutex held */
+static void actuator_drive(actuator_data_t *actuator, bool on)
+{
+    actuator_output_set_duty(actuator->bus, actuator->pin, on ? actuator->duty_cycle : 0);
+    if (actuator->output_on != on) {
+        actuator->output_on = on;
+        actuator->last_change_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    }
+}
+
 esp_err_t actuator_manager_init(void)
 {
     if (initialized) {
@@ -34,6 +45,8 @@ esp_err_t actuator_manager_init(void)
     memset(actuators, 0, sizeof(actuators));
     actuator_count = 0;
     
+    actuator_output_init();
+    
     /* Fan actuators — pins chosen to avoid sensor GPIO conflicts */
     actuators[0].id = 0;
     strncpy(actuators[0].name, "Fan_1", sizeof(actuators[0].name) - 1);
@@ -113,18 +126,25 @@ esp_err_t actuator_manager_init(void)
     
     for (int i = 0; i < actuator_count; i++) {
         actuators[i].state = ACTUATOR_STATE_OFF;
-        actuators[i].duty_cycle = 0;
+        actuators[i].duty_cycle = 100;
         actuators[i].enabled = true;
         actuators[i].manual_override = false;
         actuators[i].last_activation_time = 0;
         actuators[i].total_runtime = 0;
         actuators[i].activation_count = 0;
         
-        gpio_reset_pin(actuators[i].pin);
-        gpio_set_direction(actuators[i].pin, GPIO_MODE_OUTPUT);
-        gpio_set_level(actuators[i].pin, 0);
+        actuators[i].bus = ACTUATOR_OUTPUT_GPIO;
+        
+        /* A built-in pin given to an expander bus stays unused until the actuator is moved */
+        if (actuator_output_configure(actuators[i].bus, actuators[i].pin) != ESP_OK) {
+            ESP_LOGW(TAG, "%s disabled: GPIO %d is not available", actuators[i].name, actuators[i].pin);
+            actuators[i].enabled = false;
+        }
     }
     
+    actuator_sequencer_init(CONFIG_ACTUATOR_START_STAGGER_MS);
+    actuator_feedback_init();
+    
     initialized = true;
     ESP_LOGI(TAG, "Actuator manager initialized with %d actuators", actuator_count);
     
@@ -136,6 +156,8 @@ esp_err_t actuator_manager_deinit(void)
     if (!initialized) return ESP_OK;
     
     actuator_emergency_stop_all();
+    actuator_feedback_deinit();
+    actuator_sequencer_deinit();
     initialized = false;
     actuator_count = 0;
     if (actuator_mutex) {
@@ -147,20 +169,36 @@ esp_err_t actuator_manager_deinit(void)
 }
 
 esp_err_t actuator_register(uint8_t id, const char *name, actuator_type_t type, uint8_t pin)
+{
+    return actuator_register_output(id, name, type, ACTUATOR_OUTPUT_GPIO, pin);
+}
+
+esp_err_t actuator_register_output(uint8_t id, const char *name, actuator_type_t type,
+                                   actuator_output_bus_t bus, uint8_t channel)
 {
     if (actuator_count >= CONFIG_MAX_ACTUATORS) {
         return ESP_ERR_NO_MEM;
     }
     
+    esp_err_t err = actuator_output_configure(bus, channel);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot register %s on %s channel %d", name,
+                 actuator_output_bus_to_string(bus), channel);
+        return err;
+    }
+    
     xSemaphoreTake(actuator_mutex, portMAX_DELAY);
     
     actuator_data_t *actuator = &actuators[actuator_count];
+    memset(actuator, 0, sizeof(*actuator));
     actuator->id = id;
     strncpy(actuator->name, name, sizeof(actuator->name) - 1);
     actuator->name[sizeof(actuator->name) - 1] = '\0';
     actuator->type = type;
-    actuator->pin = pin;
+    actuator->pin = channel;
+    actuator->bus = bus;
     actuator->state = ACTUATOR_STATE_OFF;
+    actuator->duty_cycle = 100;
     actuator->enabled = true;
     actuator->manual_override = false;
     
@@ -168,6 +206,9 @@ esp_err_t actuator_register(uint8_t id, const char *name, actuator_type_t type,
     
     xSemaphoreGive(actuator_mutex);
     
+    ESP_LOGI(TAG, "Registered actuator: %s (ID: %d, %s channel %d)", actuator->name, id,
+             actuator_output_bus_to_string(bus), channel);
+    
     return ESP_OK;
 }
 
@@ -177,7 +218,7 @@ esp_err_t actuator_unregister(uint8_t id)
     
     for (int i = 0; i < actuator_count; i++) {
         if (actuators[i].id == id) {
-            gpio_set_level(actuators[i].pin, 0);
+            actuator_output_set(actuators[i].bus, actuators[i].pin, false);
             for (int j = i; j < actuator_count - 1; j++) {
                 actuators[j] = actuators[j + 1];
             }
@@ -203,20 +244,21 @@ esp_err_t actuator_set_state(uint8_t id, actuator_state_t state)
                 return ESP_OK;
             }
             
-            actuators[i].state = state;
+            /* A latched fault keeps the state at ERROR; the output is still driven */
+            actuators[i].state = actuators[i].fault != ACTUATOR_FAULT_NONE ? ACTUATOR_STATE_ERROR : state;
             
             if (state == ACTUATOR_STATE_ON) {
-                gpio_set_level(actuators[i].pin, 1);
+                actuator_drive(&actuators[i], true);
                 actuators[i].last_activation_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
                 actuators[i].activation_count++;
             } else if (state == ACTUATOR_STATE_OFF) {
-                gpio_set_level(actuators[i].pin, 0);
+                actuator_drive(&actuators[i], false);
             } else if (state == ACTUATOR_STATE_AUTO) {
                 actuators[i].manual_override = false;
             }
             
             if (user_callback) {
-                user_callback(id, state);
+                user_callback(id, actuators[i].state);
             }
             
             xSemaphoreGive(actuator_mutex);
@@ -235,7 +277,13 @@ esp_err_t actuator_set_duty_cycle(uint8_t id, uint8_t duty_cycle)
     for (int i = 0; i < actuator_count; i++) {
         if (actuators[i].id == id) {
             if (duty_cycle > 100) duty_cycle = 100;
-            actuators[i].duty_cycle = duty_cycle;
+            if (actuators[i].duty_cycle != duty_cycle) {
+                actuators[i].duty_cycle = duty_cycle;
+                /* A running output picks up the new duty at once, otherwise on its next start */
+                if (actuators[i].output_on) {
+                    actuator_output_set_duty(actuators[i].bus, actuators[i].pin, duty_cycle);
+                }
+            }
             xSemaphoreGive(actuator_mutex);
             return ESP_OK;
         }
@@ -261,6 +309,87 @@ esp_err_t actuator_get_state(uint8_t id, actuator_state_t *state)
     return ESP_ERR_NOT_FOUND;
 }
 
+esp_err_t actuator_get_commanded_state(uint8_t id, actuator_state_t *state)
+{
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < actuator_count; i++) {
+        if (actuators[i].id == id) {
+            *state = actuators[i].output_on ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF;
+            xSemaphoreGive(actuator_mutex);
+            return ESP_OK;
+        }
+    }
+    
+    xSemaphoreGive(actuator_mutex);
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t actuator_get_data(uint8_t id, actuator_data_t *data)
+{
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < actuator_count; i++) {
+        if (actuators[i].id == id) {
+            *data = actuators[i];
+            xSemaphoreGive(actuator_mutex);
+            return ESP_OK;
+        }
+    }
+    
+    xSemaphoreGive(actuator_mutex);
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t actuator_set_fault(uint8_t id, actuator_fault_t fault)
+{
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < actuator_count; i++) {
+        if (actuators[i].id == id) {
+            if (actuators[i].fault == fault) {
+                xSemaphoreGive(actuator_mutex);
+                return ESP_OK;
+            }
+            
+            actuators[i].fault = fault;
+            if (fault != ACTUATOR_FAULT_NONE) {
+                actuators[i].state = ACTUATOR_STATE_ERROR;
+                ESP_LOGE(TAG, "%s fault: %s", actuators[i].name, actuator_fault_to_string(fault));
+            } else {
+                actuators[i].state = actuators[i].output_on ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF;
+                ESP_LOGI(TAG, "%s fault cleared", actuators[i].name);
+            }
+            
+            if (user_callback) {
+                user_callback(id, actuators[i].state);
+            }
+            
+            xSemaphoreGive(actuator_mutex);
+            return ESP_OK;
+        }
+    }
+    
+    xSemaphoreGive(actuator_mutex);
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t actuator_get_fault(uint8_t id, actuator_fault_t *fault)
+{
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < actuator_count; i++) {
+        if (actuators[i].id == id) {
+            *fault = actuators[i].fault;
+            xSemaphoreGive(actuator_mutex);
+            return ESP_OK;
+        }
+    }
+    
+    xSemaphoreGive(actuator_mutex);
+    return ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t actuator_get_all(actuator_data_t **out_actuators, uint8_t *out_count)
 {
     *out_actuators = actuators;
@@ -276,8 +405,10 @@ esp_err_t actuator_set_enabled(uint8_t id, bool enabled)
         if (actuators[i].id == id) {
             actuators[i].enabled = enabled;
             if (!enabled) {
-                gpio_set_level(actuators[i].pin, 0);
-                actuators[i].state = ACTUATOR_STATE_OFF;
+                actuator_drive(&actuators[i], false);
+                if (actuators[i].fault == ACTUATOR_FAULT_NONE) {
+                    actuators[i].state = ACTUATOR_STATE_OFF;
+                }
             }
             xSemaphoreGive(actuator_mutex);
             return ESP_OK;
@@ -321,12 +452,19 @@ esp_err_t actuator_emergency_stop_all(void)
 {
     ESP_LOGW(TAG, "Emergency stop all actuators!");
     
+    /* Drop queued starts first so nothing is switched on behind the stop */
+    actuator_sequencer_cancel_all();
+    
     if (actuator_mutex) xSemaphoreTake(actuator_mutex, portMAX_DELAY);
     
+    actuator_output_begin_batch();
     for (int i = 0; i < actuator_count; i++) {
-        gpio_set_level(actuators[i].pin, 0);
-        actuators[i].state = ACTUATOR_STATE_OFF;
+        actuator_drive(&actuators[i], false);
+        if (actuators[i].fault == ACTUATOR_FAULT_NONE) {
+            actuators[i].state = ACTUATOR_STATE_OFF;
+        }
     }
+    actuator_output_end_batch();
     
     if (actuator_mutex) xSemaphoreGive(actuator_mutex);
     
@@ -362,3 +500,13 @@ const char* actuator_state_to_string(actuator_state_t state)
         default: return "Unknown";
     }
 }
+
+const char* actuator_fault_to_string(actuator_fault_t fault)
+{
+    switch (fault) {
+        case ACTUATOR_FAULT_NONE: return "None";
+        case ACTUATOR_FAULT_STUCK_ON: return "Stuck ON";
+        case ACTUATOR_FAULT_STUCK_OFF: return "Stuck OFF";
+        default: return "Unknown";
+    }
+}
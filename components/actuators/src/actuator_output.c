@@ -0,0 +1,458 @@
+#include "actuators/actuator_output.h"
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include "utils/config.h"
+
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+#include <driver/spi_master.h>
+#endif
+
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+#include <driver/i2c.h>
+#include "sensors/bme280_sensor.h"
+#endif
+
+static const char *TAG = "ACTUATOR_OUT";
+
+static SemaphoreHandle_t output_mutex = NULL;
+static volatile bool initialized = false;
+static uint8_t batch_depth = 0;
+
+/* Native GPIO outputs move to an LEDC channel the first time a duty below 100% is set */
+#define PWM_FREQUENCY_HZ   25000
+#define PWM_RESOLUTION     LEDC_TIMER_10_BIT
+#define PWM_DUTY_MAX       ((1 << PWM_RESOLUTION) - 1)
+#define PWM_MAX_CHANNELS   LEDC_CHANNEL_MAX
+
+static int8_t pwm_pins[PWM_MAX_CHANNELS];
+static uint8_t pwm_channel_count = 0;
+static bool pwm_timer_ready = false;
+
+static int pwm_find_channel(uint8_t pin)
+{
+    for (int i = 0; i < pwm_channel_count; i++) {
+        if (pwm_pins[i] == pin) return i;
+    }
+    return -1;
+}
+
+static int pwm_attach(uint8_t pin)
+{
+    if (!pwm_timer_ready) {
+        ledc_timer_config_t timer_cfg = {
+            .speed_mode = LEDC_LOW_SPEED_MODE,
+            .duty_resolution = PWM_RESOLUTION,
+            .timer_num = LEDC_TIMER_0,
+            .freq_hz = PWM_FREQUENCY_HZ,
+            .clk_cfg = LEDC_AUTO_CLK
+        };
+        if (ledc_timer_config(&timer_cfg) != ESP_OK) return -1;
+        pwm_timer_ready = true;
+    }
+
+    if (pwm_channel_count >= PWM_MAX_CHANNELS) {
+        ESP_LOGW(TAG, "No LEDC channel left for GPIO %d, driving it on/off", pin);
+        return -1;
+    }
+
+    ledc_channel_config_t channel_cfg = {
+        .gpio_num = pin,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = (ledc_channel_t)pwm_channel_count,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = LEDC_TIMER_0,
+        .duty = 0,
+        .hpoint = 0
+    };
+    if (ledc_channel_config(&channel_cfg) != ESP_OK) return -1;
+
+    pwm_pins[pwm_channel_count] = pin;
+    return pwm_channel_count++;
+}
+
+static esp_err_t pwm_set(int channel, uint8_t duty_percent)
+{
+    uint32_t duty = (uint32_t)duty_percent * PWM_DUTY_MAX / 100;
+    esp_err_t err = ledc_set_duty(LEDC_LOW_SPEED_MODE, (ledc_channel_t)channel, duty);
+    if (err != ESP_OK) return err;
+    return ledc_update_duty(LEDC_LOW_SPEED_MODE, (ledc_channel_t)channel);
+}
+
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+#define HC595_CHAIN_LENGTH CONFIG_ACTUATOR_HC595_CHAIN_LENGTH
+#define HC595_SPI_HOST     SPI2_HOST
+
+static spi_device_handle_t hc595_dev = NULL;
+static uint8_t hc595_shadow[HC595_CHAIN_LENGTH];
+static bool hc595_dirty = false;
+
+static esp_err_t hc595_init(void)
+{
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = CONFIG_ACTUATOR_HC595_MOSI_GPIO,
+        .miso_io_num = -1,
+        .sclk_io_num = CONFIG_ACTUATOR_HC595_SCLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = HC595_CHAIN_LENGTH
+    };
+    esp_err_t err = spi_bus_initialize(HC595_SPI_HOST, &bus_cfg, SPI_DMA_DISABLED);
+    if (err != ESP_OK) return err;
+
+    /* CS doubles as the latch: it rises after the last bit, copying the chain to the outputs */
+    spi_device_interface_config_t dev_cfg = {
+        .mode = 0,
+        .clock_speed_hz = 1000000,
+        .spics_io_num = CONFIG_ACTUATOR_HC595_LATCH_GPIO,
+        .queue_size = 1
+    };
+    err = spi_bus_add_device(HC595_SPI_HOST, &dev_cfg, &hc595_dev);
+    if (err != ESP_OK) return err;
+
+    memset(hc595_shadow, 0, sizeof(hc595_shadow));
+    hc595_dirty = true;
+
+    ESP_LOGI(TAG, "74HC595 chain ready (%d outputs)", HC595_CHAIN_LENGTH * 8);
+    return ESP_OK;
+}
+
+static void hc595_set(uint8_t channel, bool level)
+{
+    uint8_t mask = (uint8_t)(1 << (channel % 8));
+    uint8_t *reg = &hc595_shadow[channel / 8];
+    uint8_t value = level ? (*reg | mask) : (*reg & ~mask);
+    if (value != *reg) {
+        *reg = value;
+        hc595_dirty = true;
+    }
+}
+
+static esp_err_t hc595_flush(void)
+{
+    if (!hc595_dirty || hc595_dev == NULL) return ESP_OK;
+
+    /* The first byte shifted in ends up in the last register of the chain */
+    uint8_t tx[HC595_CHAIN_LENGTH];
+    for (int i = 0; i < HC595_CHAIN_LENGTH; i++) {
+        tx[i] = hc595_shadow[HC595_CHAIN_LENGTH - 1 - i];
+    }
+
+    spi_transaction_t trans = {
+        .length = HC595_CHAIN_LENGTH * 8,
+        .tx_buffer = tx
+    };
+    esp_err_t err = spi_device_polling_transmit(hc595_dev, &trans);
+    if (err == ESP_OK) {
+        hc595_dirty = false;
+    } else {
+        ESP_LOGE(TAG, "74HC595 update failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+#endif
+
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+#define MCP23017_COUNT       CONFIG_ACTUATOR_MCP23017_COUNT
+#define MCP23017_I2C_PORT    CONFIG_ACTUATOR_MCP23017_I2C_PORT
+#define MCP23017_BASE_ADDR   0x20
+#define MCP23017_REG_IODIRA  0x00
+#define MCP23017_REG_OLATA   0x14
+#define MCP23017_TIMEOUT_MS  50
+
+/* Sharing the BME280 port means sharing its pins; a port of its own must keep off them */
+#if MCP23017_I2C_PORT == BME280_I2C_PORT
+#if CONFIG_ACTUATOR_MCP23017_SDA_GPIO != BME280_SDA_GPIO || CONFIG_ACTUATOR_MCP23017_SCL_GPIO != BME280_SCL_GPIO
+#error "MCP23017 on the BME280 I2C port must use the BME280 SDA/SCL pins"
+#endif
+#elif CONFIG_ACTUATOR_MCP23017_SDA_GPIO == BME280_SDA_GPIO || CONFIG_ACTUATOR_MCP23017_SDA_GPIO == BME280_SCL_GPIO || \
+      CONFIG_ACTUATOR_MCP23017_SCL_GPIO == BME280_SDA_GPIO || CONFIG_ACTUATOR_MCP23017_SCL_GPIO == BME280_SCL_GPIO
+#error "MCP23017 on its own I2C port must not use the BME280 SDA/SCL pins"
+#endif
+
+static uint16_t mcp_shadow[MCP23017_COUNT];
+static uint8_t mcp_dirty = 0;
+
+static esp_err_t mcp23017_write_pair(uint8_t chip, uint8_t reg, uint16_t value)
+{
+    /* IOCON.BANK=0: A/B registers are adjacent, one write covers both ports */
+    uint8_t buf[3] = { reg, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8) };
+    return i2c_master_write_to_device(MCP23017_I2C_PORT, MCP23017_BASE_ADDR + chip,
+                                      buf, sizeof(buf), pdMS_TO_TICKS(MCP23017_TIMEOUT_MS));
+}
+
+static esp_err_t mcp23017_init(void)
+{
+    /* The BME280 driver installs a shared port first; configure the port only
+     * if we install it, since i2c_param_config() would re-route a live bus */
+    esp_err_t err = i2c_driver_install(MCP23017_I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
+    if (err == ESP_OK) {
+        i2c_config_t conf = {
+            .mode = I2C_MODE_MASTER,
+            .sda_io_num = CONFIG_ACTUATOR_MCP23017_SDA_GPIO,
+            .scl_io_num = CONFIG_ACTUATOR_MCP23017_SCL_GPIO,
+            .sda_pullup_en = GPIO_PULLUP_ENABLE,
+            .scl_pullup_en = GPIO_PULLUP_ENABLE,
+            .master.clk_speed = 100000
+        };
+        err = i2c_param_config(MCP23017_I2C_PORT, &conf);
+        if (err != ESP_OK) {
+            i2c_driver_delete(MCP23017_I2C_PORT);
+            ESP_LOGE(TAG, "MCP23017 I2C port %d setup failed: %s", MCP23017_I2C_PORT, esp_err_to_name(err));
+            return err;
+        }
+    } else if (err == ESP_FAIL) {
+        /* Already installed: the BME280 bus, on the same pins (checked at build time) */
+        ESP_LOGI(TAG, "MCP23017 sharing I2C port %d", MCP23017_I2C_PORT);
+    } else {
+        ESP_LOGE(TAG, "MCP23017 I2C driver install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    esp_err_t result = ESP_OK;
+    for (int chip = 0; chip < MCP23017_COUNT; chip++) {
+        mcp_shadow[chip] = 0;
+        /* Latch low before switching the pins to outputs */
+        err = mcp23017_write_pair(chip, MCP23017_REG_OLATA, 0x0000);
+        if (err == ESP_OK) {
+            err = mcp23017_write_pair(chip, MCP23017_REG_IODIRA, 0x0000);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "MCP23017 at 0x%02X not responding: %s",
+                     MCP23017_BASE_ADDR + chip, esp_err_to_name(err));
+            result = err;
+        }
+    }
+
+    ESP_LOGI(TAG, "MCP23017 expanders ready (%d outputs)", MCP23017_COUNT * 16);
+    return result;
+}
+
+static void mcp23017_set(uint8_t channel, bool level)
+{
+    uint8_t chip = channel / 16;
+    uint16_t mask = (uint16_t)(1 << (channel % 16));
+    uint16_t value = level ? (mcp_shadow[chip] | mask) : (mcp_shadow[chip] & ~mask);
+    if (value != mcp_shadow[chip]) {
+        mcp_shadow[chip] = value;
+        mcp_dirty |= (uint8_t)(1 << chip);
+    }
+}
+
+static esp_err_t mcp23017_flush(void)
+{
+    esp_err_t result = ESP_OK;
+    for (int chip = 0; chip < MCP23017_COUNT && mcp_dirty; chip++) {
+        if (!(mcp_dirty & (1 << chip))) continue;
+
+        esp_err_t err = mcp23017_write_pair(chip, MCP23017_REG_OLATA, mcp_shadow[chip]);
+        if (err == ESP_OK) {
+            mcp_dirty &= (uint8_t)~(1 << chip);
+        } else {
+            ESP_LOGE(TAG, "MCP23017 0x%02X update failed: %s",
+                     MCP23017_BASE_ADDR + chip, esp_err_to_name(err));
+            result = err;
+        }
+    }
+    return result;
+}
+#endif
+
+/* Native pins an expander bus has taken; driving them as outputs would detach the bus */
+static bool output_pin_claimed(uint8_t pin)
+{
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+    if (pin == CONFIG_ACTUATOR_HC595_MOSI_GPIO || pin == CONFIG_ACTUATOR_HC595_SCLK_GPIO ||
+        pin == CONFIG_ACTUATOR_HC595_LATCH_GPIO) {
+        return true;
+    }
+#endif
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+    if (pin == CONFIG_ACTUATOR_MCP23017_SDA_GPIO || pin == CONFIG_ACTUATOR_MCP23017_SCL_GPIO) {
+        return true;
+    }
+#endif
+    (void)pin;
+    return false;
+}
+
+/* Must be called with output_mutex held */
+static esp_err_t output_flush_locked(void)
+{
+    esp_err_t result = ESP_OK;
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+    esp_err_t err = hc595_flush();
+    if (err != ESP_OK) result = err;
+#endif
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+    esp_err_t mcp_err = mcp23017_flush();
+    if (mcp_err != ESP_OK) result = mcp_err;
+#endif
+    return result;
+}
+
+esp_err_t actuator_output_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    output_mutex = xSemaphoreCreateMutex();
+    if (output_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create output mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    batch_depth = 0;
+
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+    esp_err_t err = hc595_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "74HC595 init failed: %s", esp_err_to_name(err));
+    }
+#endif
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+    mcp23017_init();
+#endif
+
+    initialized = true;
+    return actuator_output_flush();
+}
+
+esp_err_t actuator_output_configure(actuator_output_bus_t bus, uint8_t channel)
+{
+    if (channel >= actuator_output_channel_count(bus)) {
+        ESP_LOGE(TAG, "Channel %d out of range on %s", channel, actuator_output_bus_to_string(bus));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (bus == ACTUATOR_OUTPUT_GPIO) {
+        if (output_pin_claimed(channel)) {
+            ESP_LOGE(TAG, "GPIO %d is in use by an expander bus", channel);
+            return ESP_ERR_INVALID_STATE;
+        }
+        gpio_reset_pin(channel);
+        gpio_set_direction(channel, GPIO_MODE_OUTPUT);
+        gpio_set_level(channel, 0);
+        return ESP_OK;
+    }
+
+    /* Expander pins are all outputs from init; just make sure the channel starts low */
+    return actuator_output_set(bus, channel, false);
+}
+
+esp_err_t actuator_output_set(actuator_output_bus_t bus, uint8_t channel, bool level)
+{
+    switch (bus) {
+        case ACTUATOR_OUTPUT_GPIO: {
+            if (output_pin_claimed(channel)) return ESP_ERR_INVALID_STATE;
+            int pwm = pwm_find_channel(channel);
+            if (pwm >= 0) return pwm_set(pwm, level ? 100 : 0);
+            return gpio_set_level(channel, level ? 1 : 0);
+        }
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+        case ACTUATOR_OUTPUT_HC595: {
+            if (!initialized || channel >= HC595_CHAIN_LENGTH * 8) return ESP_ERR_INVALID_ARG;
+            xSemaphoreTake(output_mutex, portMAX_DELAY);
+            hc595_set(channel, level);
+            esp_err_t err = batch_depth == 0 ? output_flush_locked() : ESP_OK;
+            xSemaphoreGive(output_mutex);
+            return err;
+        }
+#endif
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+        case ACTUATOR_OUTPUT_MCP23017: {
+            if (!initialized || channel >= MCP23017_COUNT * 16) return ESP_ERR_INVALID_ARG;
+            xSemaphoreTake(output_mutex, portMAX_DELAY);
+            mcp23017_set(channel, level);
+            esp_err_t err = batch_depth == 0 ? output_flush_locked() : ESP_OK;
+            xSemaphoreGive(output_mutex);
+            return err;
+        }
+#endif
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+esp_err_t actuator_output_set_duty(actuator_output_bus_t bus, uint8_t channel, uint8_t duty_percent)
+{
+    if (duty_percent > 100) duty_percent = 100;
+
+    /* Expanders have no PWM: any duty above zero is full on */
+    if (bus != ACTUATOR_OUTPUT_GPIO) {
+        return actuator_output_set(bus, channel, duty_percent > 0);
+    }
+    if (output_pin_claimed(channel)) return ESP_ERR_INVALID_STATE;
+
+    int pwm = pwm_find_channel(channel);
+    if (pwm < 0 && duty_percent > 0 && duty_percent < 100) {
+        pwm = pwm_attach(channel);
+    }
+    if (pwm < 0) {
+        return gpio_set_level(channel, duty_percent > 0 ? 1 : 0);
+    }
+
+    return pwm_set(pwm, duty_percent);
+}
+
+esp_err_t actuator_output_begin_batch(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(output_mutex, portMAX_DELAY);
+    batch_depth++;
+    xSemaphoreGive(output_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t actuator_output_end_batch(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(output_mutex, portMAX_DELAY);
+    if (batch_depth > 0) batch_depth--;
+    if (batch_depth == 0) {
+        err = output_flush_locked();
+    }
+    xSemaphoreGive(output_mutex);
+
+    return err;
+}
+
+esp_err_t actuator_output_flush(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(output_mutex, portMAX_DELAY);
+    esp_err_t err = output_flush_locked();
+    xSemaphoreGive(output_mutex);
+
+    return err;
+}
+
+uint16_t actuator_output_channel_count(actuator_output_bus_t bus)
+{
+    switch (bus) {
+        case ACTUATOR_OUTPUT_GPIO: return GPIO_NUM_MAX;
+#ifdef CONFIG_ACTUATOR_HC595_ENABLED
+        case ACTUATOR_OUTPUT_HC595: return HC595_CHAIN_LENGTH * 8;
+#endif
+#ifdef CONFIG_ACTUATOR_MCP23017_ENABLED
+        case ACTUATOR_OUTPUT_MCP23017: return MCP23017_COUNT * 16;
+#endif
+        default: return 0;
+    }
+}
+
+const char* actuator_output_bus_to_string(actuator_output_bus_t bus)
+{
+    switch (bus) {
+        case ACTUATOR_OUTPUT_GPIO: return "GPIO";
+        case ACTUATOR_OUTPUT_HC595: return "74HC595";
+        case ACTUATOR_OUTPUT_MCP23017: return "MCP23017";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,243 @@
+#include "actuators/actuator_sequencer.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "ACT_SEQ";
+
+static SemaphoreHandle_t seq_mutex = NULL;
+static esp_timer_handle_t seq_timer = NULL;
+static volatile bool initialized = false;
+static uint32_t stagger_ms = CONFIG_ACTUATOR_START_STAGGER_MS;
+
+/* FIFO of actuator IDs waiting for their ON slot */
+static uint8_t pending[CONFIG_MAX_ACTUATORS];
+static uint8_t pending_head = 0;
+static uint8_t pending_count = 0;
+static int64_t last_start_us = 0;
+static bool have_started = false;
+
+/* Must be called with seq_mutex held */
+static bool seq_is_pending(uint8_t id)
+{
+    for (int i = 0; i < pending_count; i++) {
+        if (pending[(pending_head + i) % CONFIG_MAX_ACTUATORS] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Must be called with seq_mutex held */
+static void seq_remove(uint8_t id)
+{
+    uint8_t kept = 0;
+    for (int i = 0; i < pending_count; i++) {
+        uint8_t entry = pending[(pending_head + i) % CONFIG_MAX_ACTUATORS];
+        if (entry != id) {
+            pending[(pending_head + kept) % CONFIG_MAX_ACTUATORS] = entry;
+            kept++;
+        }
+    }
+    pending_count = kept;
+    if (pending_count == 0 && seq_timer) {
+        esp_timer_stop(seq_timer);
+    }
+}
+
+/* Must be called with seq_mutex held */
+static void seq_start_now(uint8_t id)
+{
+    actuator_set_state(id, ACTUATOR_STATE_ON);
+    last_start_us = esp_timer_get_time();
+    have_started = true;
+}
+
+/* Must be called with seq_mutex held */
+static void seq_arm_timer(void)
+{
+    if (pending_count == 0 || esp_timer_is_active(seq_timer)) return;
+
+    int64_t elapsed_us = esp_timer_get_time() - last_start_us;
+    int64_t wait_us = (int64_t)stagger_ms * 1000 - elapsed_us;
+    if (wait_us < 1000) wait_us = 1000;
+    esp_timer_start_once(seq_timer, (uint64_t)wait_us);
+}
+
+static void seq_timer_callback(void *arg)
+{
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+
+    if (pending_count > 0) {
+        uint8_t id = pending[pending_head];
+        pending_head = (pending_head + 1) % CONFIG_MAX_ACTUATORS;
+        pending_count--;
+        seq_start_now(id);
+        ESP_LOGD(TAG, "Started actuator %d (%d still pending)", id, pending_count);
+    }
+    seq_arm_timer();
+
+    xSemaphoreGive(seq_mutex);
+}
+
+esp_err_t actuator_sequencer_init(uint32_t stagger)
+{
+    if (initialized) return ESP_OK;
+
+    seq_mutex = xSemaphoreCreateMutex();
+    if (seq_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create sequencer mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = seq_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "act_seq"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &seq_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create sequencer timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(seq_mutex);
+        seq_mutex = NULL;
+        return err;
+    }
+
+    stagger_ms = stagger;
+    pending_head = 0;
+    pending_count = 0;
+    have_started = false;
+
+    initialized = true;
+    ESP_LOGI(TAG, "Start sequencer initialized (stagger %lu ms)", (unsigned long)stagger_ms);
+
+    return ESP_OK;
+}
+
+esp_err_t actuator_sequencer_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    actuator_sequencer_cancel_all();
+    initialized = false;
+
+    esp_timer_stop(seq_timer);
+    esp_timer_delete(seq_timer);
+    seq_timer = NULL;
+    vSemaphoreDelete(seq_mutex);
+    seq_mutex = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t actuator_sequencer_set_stagger(uint32_t stagger)
+{
+    if (!initialized) {
+        stagger_ms = stagger;
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+    stagger_ms = stagger;
+    xSemaphoreGive(seq_mutex);
+    return ESP_OK;
+}
+
+uint32_t actuator_sequencer_get_stagger(void)
+{
+    return stagger_ms;
+}
+
+esp_err_t actuator_sequencer_request(uint8_t id, actuator_state_t state)
+{
+    if (!initialized) {
+        return actuator_set_state(id, state);
+    }
+
+    /* Everything except ON goes straight through and cancels a queued start */
+    if (state != ACTUATOR_STATE_ON) {
+        xSemaphoreTake(seq_mutex, portMAX_DELAY);
+        seq_remove(id);
+        esp_err_t err = actuator_set_state(id, state);
+        xSemaphoreGive(seq_mutex);
+        return err;
+    }
+
+    /* Check the state under the lock so a start released by the timer in
+     * between is seen and not queued a second time */
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+
+    actuator_state_t current;
+    esp_err_t err = actuator_get_state(id, &current);
+    if (err == ESP_OK && current == ACTUATOR_STATE_ERROR) {
+        actuator_get_commanded_state(id, &current);
+    }
+    if (err != ESP_OK || current == ACTUATOR_STATE_ON || seq_is_pending(id)) {
+        xSemaphoreGive(seq_mutex);
+        return err;
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - last_start_us;
+    if (pending_count == 0 && (!have_started || elapsed_us >= (int64_t)stagger_ms * 1000)) {
+        seq_start_now(id);
+    } else if (pending_count < CONFIG_MAX_ACTUATORS) {
+        pending[(pending_head + pending_count) % CONFIG_MAX_ACTUATORS] = id;
+        pending_count++;
+        seq_arm_timer();
+    } else {
+        xSemaphoreGive(seq_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreGive(seq_mutex);
+    return ESP_OK;
+}
+
+esp_err_t actuator_sequencer_set_group_state(const uint8_t *ids, uint8_t count, actuator_state_t state)
+{
+    if (ids == NULL) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t result = ESP_OK;
+    for (int i = 0; i < count; i++) {
+        esp_err_t err = actuator_sequencer_request(ids[i], state);
+        if (err != ESP_OK) result = err;
+    }
+
+    return result;
+}
+
+esp_err_t actuator_sequencer_cancel(uint8_t id)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+    seq_remove(id);
+    xSemaphoreGive(seq_mutex);
+
+    return ESP_OK;
+}
+
+void actuator_sequencer_cancel_all(void)
+{
+    if (!initialized) return;
+
+    /* Waits for at most one in-flight start, then nothing further is released */
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+    pending_count = 0;
+    esp_timer_stop(seq_timer);
+    xSemaphoreGive(seq_mutex);
+}
+
+uint8_t actuator_sequencer_pending_count(void)
+{
+    if (!initialized) return 0;
+
+    xSemaphoreTake(seq_mutex, portMAX_DELAY);
+    uint8_t count = pending_count;
+    xSemaphoreGive(seq_mutex);
+    return count;
+}
@@ -43,6 +43,9 @@ esp_err_t communication_send_data(const char *topic, const char *data);
 esp_err_t communication_subscribe(const char *topic);
 esp_err_t communication_set_mqtt_config(const char *broker, uint16_t port, const char *topic);
 esp_err_t communication_publish_sensor_data(void);
+esp_err_t communication_publish_metrics(void);
+/* Closed hourly and daily sensor statistics not yet published */
+esp_err_t communication_publish_sensor_stats(void);
 esp_err_t communication_init_mesh(const char *mesh_ssid, const char *mesh_password, uint8_t max_layer);
 esp_err_t communication_mesh_send(uint8_t *data, uint16_t len);
 esp_err_t communication_mesh_broadcast(uint8_t *data, uint16_t len);
@@ -0,0 +1,60 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Streaming serializer for sensor telemetry.
+ *
+ * Sensor frames are written straight into the caller's chunk buffer, which
+ * is the payload handed to MQTT or the mesh; there is no intermediate
+ * buffer and no per-frame snprintf. When the next frame does not fit, the
+ * chunk is closed as a message of its own and passed to the sink, and the
+ * frame starts the next chunk. Any number of sensors goes out in as many
+ * chunks as it takes, each one a complete JSON document:
+ *
+ *   {"timestamp":123456,"node_id":"aa:bb:cc:dd:ee:ff","layer":1,"part":0,
+ *    "sensors":[{"name":"Temp 1","value":23.50},...],"last":false}
+ *
+ * Parts count up from 0 within one publish; "last" is true on the final one.
+ * Values are formatted in fixed point with integer arithmetic; a value that
+ * is not finite is sent as null.
+ */
+
+/* One mesh packet (MESH_MPS is 1472) with room to spare */
+#define TELEMETRY_CHUNK_SIZE    1400
+#define TELEMETRY_DECIMALS      2
+#define TELEMETRY_NUMBER_MAX    24      /* longest telemetry_format_fixed() output */
+
+/* Takes the closed chunk; the buffer is reused once it returns */
+typedef esp_err_t (*telemetry_sink_t)(const char *data, size_t length, void *context);
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t length;              /* bytes in the open chunk */
+    uint32_t timestamp;
+    const char *node_id;
+    uint8_t layer;
+    uint16_t part;
+    uint16_t frames;            /* frames in the open chunk */
+    uint32_t bytes;             /* handed to the sink so far */
+    telemetry_sink_t sink;
+    void *context;
+    esp_err_t error;            /* first sink failure; nothing is sent after it */
+} telemetry_writer_t;
+
+esp_err_t telemetry_begin(telemetry_writer_t *writer, char *buffer, size_t size,
+                          const char *node_id, uint8_t layer, uint32_t timestamp,
+                          telemetry_sink_t sink, void *context);
+esp_err_t telemetry_add_sensor(telemetry_writer_t *writer, const sensor_data_t *sensor);
+/* Sends the final chunk, even with no frames in it */
+esp_err_t telemetry_end(telemetry_writer_t *writer);
+
+/* Writes value with the given decimals (at most 6), no terminator; returns the length */
+size_t telemetry_format_fixed(char *out, float value, uint8_t decimals);
+
+#endif
@@ -11,9 +11,13 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include "communication/telemetry.h"
 #include "sensors/sensor_manager.h"
 #include "actuators/actuator_manager.h"
 #include "utils/config.h"
+#include "utils/metrics.h"
+#include "monitoring/sensor_stats.h"
 
 #ifdef CONFIG_ESP_MQTT_ENABLED
 #include <mqtt_client.h>
@@ -39,6 +43,13 @@ static volatile bool mesh_initialized = false;
 static char mqtt_broker[128] = "mqtt://localhost";
 static uint16_t mqtt_port = 1883;
 static char mqtt_topic[128] = "poultry/farm";
+static metric_t publish_failures;
+static metric_t mesh_send_failures;
+static uint32_t stats_published = 0;    /* sensor stats sequence sent up to */
+
+/* Sensor telemetry is serialized in place; MQTT and the mesh copy it out */
+static char telemetry_chunk[TELEMETRY_CHUNK_SIZE];
+static SemaphoreHandle_t telemetry_mutex = NULL;
 
 static EventGroupHandle_t wifi_event_group = NULL;
 static int wifi_retry_count = 0;
@@ -192,6 +203,14 @@ esp_err_t communication_init(void)
     sta_netif = esp_netif_create_default_wifi_sta();
     
     wifi_event_group = xEventGroupCreate();
+    telemetry_mutex = xSemaphoreCreateMutex();
+    if (telemetry_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create telemetry mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    metric_register(&publish_failures, "mqtt_publish_failures_total", "MQTT publishes the client rejected", METRIC_COUNTER);
+    metric_register(&mesh_send_failures, "mesh_send_failures_total", "Mesh sends and broadcasts that failed", METRIC_COUNTER);
     
     initialized = true;
     ESP_LOGI(TAG, "Communication system initialized");
@@ -317,7 +336,7 @@ esp_err_t communication_get_status(comm_info_t *info)
     return ESP_OK;
 }
 
-esp_err_t communication_send_data(const char *topic, const char *data)
+static esp_err_t send_payload(const char *topic, const char *data, size_t length)
 {
     if (!connected) {
         return ESP_ERR_INVALID_STATE;
@@ -325,23 +344,29 @@ esp_err_t communication_send_data(const char *topic, const char *data)
     
 #ifdef CONFIG_ESP_MQTT_ENABLED
     if (mqtt_client) {
-        int msg_id = esp_mqtt_client_publish(mqtt_client, topic, data, 0, 1, 0);
+        int msg_id = esp_mqtt_client_publish(mqtt_client, topic, data, length, 1, 0);
         if (msg_id < 0) {
+            metric_inc(&publish_failures);
             ESP_LOGE(TAG, "MQTT publish failed");
             return ESP_FAIL;
         }
         ESP_LOGI(TAG, "MQTT published to %s (msg_id=%d)", topic, msg_id);
-        comm_info.bytes_sent += strlen(data);
+        comm_info.bytes_sent += length;
         return ESP_OK;
     }
 #endif
     
-    ESP_LOGI(TAG, "Sending data to %s: %s", topic, data);
-    comm_info.bytes_sent += strlen(data);
+    ESP_LOGI(TAG, "Sending data to %s: %.*s", topic, (int)length, data);
+    comm_info.bytes_sent += length;
     
     return ESP_OK;
 }
 
+esp_err_t communication_send_data(const char *topic, const char *data)
+{
+    return send_payload(topic, data, strlen(data));
+}
+
 esp_err_t communication_subscribe(const char *topic)
 {
     if (!connected) {
@@ -391,6 +416,14 @@ esp_err_t communication_set_mqtt_config(const char *broker, uint16_t port, const
     return ESP_OK;
 }
 
+static esp_err_t telemetry_send(const char *data, size_t length, void *context)
+{
+    if (mesh_initialized) {
+        return communication_mesh_broadcast((uint8_t *)data, length);
+    }
+    return send_payload(mqtt_topic, data, length);
+}
+
 esp_err_t communication_publish_sensor_data(void)
 {
     if (!connected && !mesh_initialized) return ESP_ERR_INVALID_STATE;
@@ -399,31 +432,24 @@ esp_err_t communication_publish_sensor_data(void)
     sensor_data_t *sensors = NULL;
     sensor_read_all(&sensors, &sensor_count);
     
-    char json_buffer[1024];
-    int offset = 0;
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "{");
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "\"timestamp\":%lu,",
-                       (unsigned long)(xTaskGetTickCount() * portTICK_PERIOD_MS));
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "\"node_id\":\"");
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, MACSTR, MAC2STR(mesh_mac.addr));
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "\",");
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "\"layer\":%d,", mesh_layer);
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "\"sensors\":[");
-    
-    for (int i = 0; i < sensor_count && i < 20; i++) {
-        if ((size_t)offset >= sizeof(json_buffer) - 80) break; /* guard against overflow */
-        if (i > 0) offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, ",");
-        offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset,
-            "{\"name\":\"%s\",\"value\":%.2f}",
-            sensors[i].name, sensors[i].value);
+    char node_id[18];
+    snprintf(node_id, sizeof(node_id), MACSTR, MAC2STR(mesh_mac.addr));
+    
+    /* As many chunks as the sensors take; each one is a message of its own */
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    telemetry_writer_t writer;
+    esp_err_t ret = telemetry_begin(&writer, telemetry_chunk, sizeof(telemetry_chunk), node_id, mesh_layer,
+                                    xTaskGetTickCount() * portTICK_PERIOD_MS, telemetry_send, NULL);
+    for (int i = 0; i < sensor_count && ret == ESP_OK; i++) {
+        ret = telemetry_add_sensor(&writer, &sensors[i]);
+        if (ret == ESP_ERR_INVALID_SIZE) ret = ESP_OK;  /* that sensor alone is left out */
     }
+    if (ret == ESP_OK) ret = telemetry_end(&writer);
+    xSemaphoreGive(telemetry_mutex);
     
-    offset += snprintf(json_buffer + offset, sizeof(json_buffer) - offset, "]}");
-    
-    if (mesh_initialized) {
-        communication_mesh_broadcast((uint8_t *)json_buffer, strlen(json_buffer));
-    } else {
-        communication_send_data(mqtt_topic, json_buffer);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor data publish stopped at part %u: %s", writer.part, esp_err_to_name(ret));
+        return ret;
     }
     
     comm_info.last_update = xTaskGetTickCount() * portTICK_PERIOD_MS;
@@ -431,6 +457,63 @@ esp_err_t communication_publish_sensor_data(void)
     return ESP_OK;
 }
 
+esp_err_t communication_publish_metrics(void)
+{
+    if (!connected) return ESP_ERR_INVALID_STATE;
+    
+    /* Whole metrics only; the ones that do not fit are left out */
+    char payload[1024];
+    char topic[sizeof(mqtt_topic) + 8];
+    size_t length = 0;
+    if (metrics_export_compact(payload, sizeof(payload), &length) != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics payload truncated at %u bytes", (unsigned)length);
+    }
+    snprintf(topic, sizeof(topic), "%s/metrics", mqtt_topic);
+    return communication_send_data(topic, payload);
+}
+
+esp_err_t communication_publish_sensor_stats(void)
+{
+    if (!connected) return ESP_ERR_INVALID_STATE;
+    
+    char payload[1024];
+    char topic[sizeof(mqtt_topic) + 8];
+    snprintf(topic, sizeof(topic), "%s/stats", mqtt_topic);
+    
+    /* Batches of whole records; the cursor only moves past what was sent */
+    sensor_stats_record_t record;
+    uint32_t sequence = stats_published;
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && sensor_stats_read(&sequence, &record) == ESP_OK) {
+        int offset = snprintf(payload, sizeof(payload), "{\"node_id\":\"" MACSTR "\",\"stats\":[",
+                              MAC2STR(mesh_mac.addr));
+        int items = 0;
+        do {
+            char item[224];
+            int n = snprintf(item, sizeof(item),
+                "%s{\"id\":%u,\"period\":\"%s\",\"start\":%lu,\"count\":%lu,"
+                "\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"sd\":%.3f,"
+                "\"observed\":%lu,\"above\":%lu,\"below\":%lu}",
+                items > 0 ? "," : "", record.sensor_id,
+                sensor_stats_period_to_string(record.period), (unsigned long)record.start,
+                (unsigned long)record.count, record.min, record.max, record.mean, record.stddev,
+                (unsigned long)record.seconds_observed, (unsigned long)record.seconds_above,
+                (unsigned long)record.seconds_below);
+            if (offset + n + 3 > (int)sizeof(payload)) break;   /* next message */
+            memcpy(payload + offset, item, n + 1);
+            offset += n;
+            items++;
+            sequence++;
+        } while (sensor_stats_read(&sequence, &record) == ESP_OK);
+        snprintf(payload + offset, sizeof(payload) - offset, "]}");
+        
+        ret = communication_send_data(topic, payload);
+        if (ret == ESP_OK) stats_published = sequence;
+    }
+    
+    return ret;
+}
+
 esp_err_t communication_init_mesh(const char *mesh_ssid, const char *mesh_password, uint8_t max_layer)
 {
     if (!initialized) return ESP_ERR_INVALID_STATE;
@@ -494,6 +577,7 @@ esp_err_t communication_mesh_send(uint8_t *data, uint16_t len)
     if (err == ESP_OK) {
         comm_info.bytes_sent += len;
     } else {
+        metric_inc(&mesh_send_failures);
         ESP_LOGE(MESH_TAG, "Mesh send failed: %s", esp_err_to_name(err));
     }
     
@@ -517,6 +601,7 @@ esp_err_t communication_mesh_broadcast(uint8_t *data, uint16_t len)
     if (err == ESP_OK) {
         comm_info.bytes_sent += len;
     } else {
+        metric_inc(&mesh_send_failures);
         ESP_LOGE(MESH_TAG, "Mesh broadcast failed: %s", esp_err_to_name(err));
     }
     
@@ -0,0 +1,232 @@
+#include "communication/telemetry.h"
+#include <esp_log.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "TELEMETRY";
+
+/* Room kept at the end of every chunk to close it */
+static const char trailer_more[] = "],\"last\":false}";
+static const char trailer_last[] = "],\"last\":true}";
+#define TRAILER_RESERVE     (sizeof(trailer_more) - 1)
+
+static const uint32_t pow10_table[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+typedef struct {
+    char *p;
+    char *end;
+    bool full;
+} cursor_t;
+
+static void put_bytes(cursor_t *c, const char *s, size_t n)
+{
+    if (c->full || (size_t)(c->end - c->p) < n) {
+        c->full = true;
+        return;
+    }
+    memcpy(c->p, s, n);
+    c->p += n;
+}
+
+#define put_literal(c, s)   put_bytes((c), (s), sizeof(s) - 1)
+
+/* Digits of value, most significant first; returns the length */
+static size_t format_uint(char *out, uint64_t value)
+{
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    return n;
+}
+
+static void put_uint(cursor_t *c, uint64_t value)
+{
+    char digits[20];
+    put_bytes(c, digits, format_uint(digits, value));
+}
+
+static void put_string(cursor_t *c, const char *s)
+{
+    put_literal(c, "\"");
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch != '"' && ch != '\\' && ch >= 0x20) continue;
+        put_bytes(c, run, s - run);
+        if (ch == '"') {
+            put_literal(c, "\\\"");
+        } else if (ch == '\\') {
+            put_literal(c, "\\\\");
+        } else {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", ch);
+            put_bytes(c, escape, 6);
+        }
+        run = s + 1;
+    }
+    put_bytes(c, run, s - run);
+    put_literal(c, "\"");
+}
+
+size_t telemetry_format_fixed(char *out, float value, uint8_t decimals)
+{
+    if (!isfinite(value)) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+    if (decimals > 6) decimals = 6;
+
+    float magnitude = fabsf(value);
+    if (magnitude >= 1e15f) {
+        return snprintf(out, TELEMETRY_NUMBER_MAX, "%.*e", decimals, value);
+    }
+
+    /*
+     * The fraction of a float and its scaled value in a double are exact, so
+     * rounding it half to even gives the digits printf would.
+     */
+    uint32_t scale = pow10_table[decimals];
+    float whole = truncf(magnitude);
+    uint64_t integer = (uint64_t)whole;
+    uint32_t fraction = (uint32_t)rint((double)(magnitude - whole) * scale);
+    if (fraction >= scale) {
+        integer++;
+        fraction -= scale;
+    }
+
+    size_t n = 0;
+    if (value < 0.0f && (integer > 0 || fraction > 0)) out[n++] = '-';
+    n += format_uint(out + n, integer);
+    if (decimals > 0) {
+        out[n++] = '.';
+        for (int i = decimals - 1; i >= 0; i--) {
+            out[n + i] = '0' + (char)(fraction % 10);
+            fraction /= 10;
+        }
+        n += decimals;
+    }
+    return n;
+}
+
+static void put_fixed(cursor_t *c, float value, uint8_t decimals)
+{
+    char number[TELEMETRY_NUMBER_MAX];
+    put_bytes(c, number, telemetry_format_fixed(number, value, decimals));
+}
+
+static cursor_t writer_cursor(telemetry_writer_t *writer)
+{
+    cursor_t c = {
+        .p = writer->buffer + writer->length,
+        .end = writer->buffer + writer->size - TRAILER_RESERVE,
+        .full = false
+    };
+    return c;
+}
+
+static bool write_header(telemetry_writer_t *writer)
+{
+    writer->length = 0;
+    writer->frames = 0;
+
+    cursor_t c = writer_cursor(writer);
+    put_literal(&c, "{\"timestamp\":");
+    put_uint(&c, writer->timestamp);
+    put_literal(&c, ",\"node_id\":");
+    put_string(&c, writer->node_id);
+    put_literal(&c, ",\"layer\":");
+    put_uint(&c, writer->layer);
+    put_literal(&c, ",\"part\":");
+    put_uint(&c, writer->part);
+    put_literal(&c, ",\"sensors\":[");
+    if (c.full) return false;
+
+    writer->length = c.p - writer->buffer;
+    return true;
+}
+
+static esp_err_t writer_flush(telemetry_writer_t *writer, bool last)
+{
+    const char *trailer = last ? trailer_last : trailer_more;
+    size_t trailer_length = strlen(trailer);
+    memcpy(writer->buffer + writer->length, trailer, trailer_length);
+    writer->length += trailer_length;
+
+    esp_err_t ret = writer->sink(writer->buffer, writer->length, writer->context);
+    if (ret != ESP_OK) {
+        writer->error = ret;
+        return ret;
+    }
+    writer->bytes += writer->length;
+    writer->part++;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_begin(telemetry_writer_t *writer, char *buffer, size_t size,
+                          const char *node_id, uint8_t layer, uint32_t timestamp,
+                          telemetry_sink_t sink, void *context)
+{
+    if (writer == NULL || buffer == NULL || node_id == NULL || sink == NULL) return ESP_ERR_INVALID_ARG;
+
+    memset(writer, 0, sizeof(*writer));
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->node_id = node_id;
+    writer->layer = layer;
+    writer->timestamp = timestamp;
+    writer->sink = sink;
+    writer->context = context;
+
+    if (size <= TRAILER_RESERVE || !write_header(writer)) {
+        writer->error = ESP_ERR_INVALID_SIZE;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+static bool write_frame(telemetry_writer_t *writer, const sensor_data_t *sensor)
+{
+    cursor_t c = writer_cursor(writer);
+    if (writer->frames > 0) put_literal(&c, ",");
+    put_literal(&c, "{\"name\":");
+    put_string(&c, sensor->name);
+    put_literal(&c, ",\"value\":");
+    put_fixed(&c, sensor->value, TELEMETRY_DECIMALS);
+    put_literal(&c, "}");
+    if (c.full) return false;
+
+    writer->length = c.p - writer->buffer;
+    writer->frames++;
+    return true;
+}
+
+esp_err_t telemetry_add_sensor(telemetry_writer_t *writer, const sensor_data_t *sensor)
+{
+    if (writer == NULL || sensor == NULL) return ESP_ERR_INVALID_ARG;
+    if (writer->error != ESP_OK) return writer->error;
+
+    /* A frame that does not fit is dropped from the chunk and starts the next one */
+    if (write_frame(writer, sensor)) return ESP_OK;
+    if (writer->frames == 0) {
+        ESP_LOGW(TAG, "Sensor %u does not fit in a chunk of %u bytes", sensor->id, (unsigned)writer->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = writer_flush(writer, false);
+    if (ret != ESP_OK) return ret;
+    write_header(writer);
+    return write_frame(writer, sensor) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t telemetry_end(telemetry_writer_t *writer)
+{
+    if (writer == NULL) return ESP_ERR_INVALID_ARG;
+    if (writer->error != ESP_OK) return writer->error;
+
+    return writer_flush(writer, true);
+}
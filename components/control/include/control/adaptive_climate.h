@@ -0,0 +1,68 @@
+#ifndef ADAPTIVE_CLIMATE_H
+#define ADAPTIVE_CLIMATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Adaptive temperature control for CONTROL_MODE_ADAPTIVE.
+ *
+ * Every CONFIG_CONTROL_ADAPTIVE_PERIOD_S an esp_timer identifies a first-order
+ * barn model by recursive least squares,
+ *
+ *   T[k+1] = a*T[k] + b_heat*h[k] + b_fan*f[k]*(T[k] - Tout[k]) + b_out*Tout[k] + c
+ *
+ * from indoor and outdoor temperature and the heater and fan duty actually
+ * applied over the period (h, f in 0..1). The model is learnt in every mode
+ * except manual, so it is usually ready when adaptive mode is selected.
+ *
+ * When enabled and the model is valid, a receding-horizon planner then
+ * chooses a split-range demand (heating positive, fan cooling negative, as in
+ * the PID) for the next ADAPTIVE_HORIZON periods, held over ADAPTIVE_BLOCKS
+ * blocks, that keeps the predicted temperature inside the comfort band around
+ * temp_optimal while penalising demand changes and energy. The problem has a
+ * fixed ADAPTIVE_BLOCKS bounded variables and is solved by a fixed number of
+ * projected gradient steps, so its run time is bounded. Only the first block
+ * is applied; the plan is recomputed every period. Heater relays are
+ * time-proportioned in whole periods over one block, with the duty latched at
+ * the start of the block, so they switch at most twice per block.
+ *
+ * Until the model is valid the output is inactive and the caller falls back
+ * to the reactive controller.
+ */
+
+#define ADAPTIVE_HORIZON    20
+#define ADAPTIVE_BLOCKS     4
+
+typedef struct {
+    float a;
+    float b_heat;           /* degC per period at full heater duty */
+    float b_fan;            /* per period per degC indoor-outdoor difference at full fan duty */
+    float b_out;
+    float c;
+    float rms_error;        /* one-step prediction error, degC */
+    uint32_t samples;
+    bool valid;
+} adaptive_model_t;
+
+typedef struct {
+    float demand;           /* -100 (full cooling) .. +100 (full heating) */
+    uint8_t fan_duty;       /* 0 = fans not needed */
+    uint8_t heater_duty;    /* planned heater duty */
+    bool heater_on;         /* heater relay level for the current period */
+    float predicted_temp;   /* model prediction for the end of the period */
+    float predicted_min;    /* lowest temperature over the planned horizon */
+    float predicted_max;    /* highest temperature over the planned horizon */
+    bool active;            /* enabled, model valid and a plan is available */
+} adaptive_output_t;
+
+esp_err_t adaptive_climate_init(void);
+esp_err_t adaptive_climate_deinit(void);
+void adaptive_climate_set_measurement(float indoor, float outdoor, float heater_frac, float fan_frac);
+esp_err_t adaptive_climate_set_enabled(bool enabled);
+esp_err_t adaptive_climate_get_output(adaptive_output_t *output);
+esp_err_t adaptive_climate_get_model(adaptive_model_t *model);
+esp_err_t adaptive_climate_reset_model(void);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef CLIMATE_PID_H
+#define CLIMATE_PID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Split-range temperature PID around poultry_config.temp_optimal.
+ *
+ * The controller runs on its own esp_timer every CONFIG_CONTROL_PID_PERIOD_MS
+ * on the latest temperature handed in by the control loop. Its demand spans
+ * -100..+100 %: positive demand is heater duty, applied by time-proportioning
+ * the heater relays over CONFIG_CONTROL_HEATER_WINDOW_MS; negative demand is
+ * fan PWM duty through the shared fan stage (control/fan_stage.h).
+ */
+
+typedef struct {
+    float demand;           /* -100 (full cooling) .. +100 (full heating) */
+    uint8_t fan_duty;       /* 0 = fans not needed */
+    uint8_t heater_duty;    /* duty applied in the current heater window */
+    bool heater_on;         /* heater relay level for this point of the window */
+    bool automatic;
+} climate_pid_output_t;
+
+esp_err_t climate_pid_init(void);
+esp_err_t climate_pid_deinit(void);
+void climate_pid_set_measurement(float temperature);
+esp_err_t climate_pid_get_output(climate_pid_output_t *output);
+esp_err_t climate_pid_set_manual(bool manual);
+esp_err_t climate_pid_reset(void);
+esp_err_t climate_pid_set_tuning(float kp, float ki, float kd);
+
+/* Heater on-time per window for a heating duty, with pulses and gaps shorter
+ * than a fifth of the window dropped; shared with the zone loops */
+uint32_t climate_pid_heater_on_ms(uint8_t duty);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CLIMATE_ZONE_H
+#define CLIMATE_ZONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Climate zones for houses with a temperature gradient along their length.
+ *
+ * A zone maps a subset of the temperature sensors and of the fans and heaters
+ * (bit per actuator ID) to its own setpoints and its own split-range PID, so
+ * the front of a tunnel-ventilated house is not controlled on a reading from
+ * the back. All zone PIDs are stepped in one batched pass by a single
+ * esp_timer every CONFIG_CONTROL_PID_PERIOD_MS. Actuators not assigned to a
+ * zone stay on the house-wide PID (or the adaptive planner).
+ *
+ * Zones only own the temperature law. Humidity, gas and emergency stop remain
+ * house-wide and override every zone through the arbiter priorities. A zone
+ * with no healthy sensor falls back to the house temperature.
+ *
+ * The zone table is stored in NVS (namespace "zones"). An empty table means
+ * one house-wide zone, the behaviour without this module.
+ */
+
+#define CLIMATE_ZONES_MAX           4
+#define CLIMATE_ZONE_SENSORS_MAX    4
+
+typedef struct {
+    char name[16];
+    uint8_t sensor_ids[CLIMATE_ZONE_SENSORS_MAX];   /* temperature sensors, averaged */
+    uint8_t sensor_count;
+    uint32_t fan_mask;          /* bit per actuator ID */
+    uint32_t heater_mask;
+    float temp_min;
+    float temp_optimal;
+    float temp_max;
+} climate_zone_config_t;
+
+typedef struct {
+    float temperature;          /* zone reading the PID ran on */
+    float demand;               /* -100 (full cooling) .. +100 (full heating) */
+    uint8_t fan_duty;           /* 0 = fans not needed */
+    uint8_t heater_duty;
+    bool heater_on;
+    bool sensor_ok;             /* false: running on the house temperature */
+    bool automatic;
+} climate_zone_output_t;
+
+esp_err_t climate_zone_init(void);
+esp_err_t climate_zone_deinit(void);
+esp_err_t climate_zone_set(const climate_zone_config_t *zones, uint8_t count);
+esp_err_t climate_zone_get(climate_zone_config_t *zones, uint8_t max_count, uint8_t *count);
+esp_err_t climate_zone_clear(void);
+uint8_t climate_zone_count(void);
+uint32_t climate_zone_owned_mask(void);
+void climate_zone_set_measurements(const sensor_data_t *sensors, uint8_t sensor_count,
+                                   float house_temperature);
+esp_err_t climate_zone_get_output(uint8_t zone, climate_zone_output_t *output);
+esp_err_t climate_zone_set_manual(bool manual);
+esp_err_t climate_zone_reset(void);
+
+#endif
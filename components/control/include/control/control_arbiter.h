@@ -0,0 +1,49 @@
+#ifndef CONTROL_ARBITER_H
+#define CONTROL_ARBITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "actuators/actuator_manager.h"
+
+/*
+ * Per-cycle actuator arbitration.
+ *
+ * Control laws submit requests instead of writing actuators directly. Within
+ * one cycle the highest-priority request for each actuator wins (ties go to
+ * the first submitter), and control_arbiter_commit() writes only the
+ * actuators whose state actually changes. A duty request is an ON request
+ * with a PWM duty; a plain ON runs at 100 %. When several laws ask for ON,
+ * the winner runs at the highest duty any of them asked for. The reason
+ * string is kept by pointer and must have static storage.
+ */
+
+typedef enum {
+    CONTROL_PRIORITY_IDLE = 0,      /* no demand: resting state */
+    CONTROL_PRIORITY_SERVICE,       /* lighting, feeding, water */
+    CONTROL_PRIORITY_HUMIDITY,
+    CONTROL_PRIORITY_TEMPERATURE,
+    CONTROL_PRIORITY_GAS
+} control_priority_t;
+
+typedef struct {
+    uint8_t actuator_id;
+    actuator_state_t state;
+    uint8_t duty;
+    control_priority_t priority;
+    const char *reason;
+    uint32_t timestamp;
+    bool changed;
+} control_decision_t;
+
+esp_err_t control_arbiter_init(void);
+void control_arbiter_begin_cycle(void);
+esp_err_t control_arbiter_request(uint8_t actuator_id, actuator_state_t state,
+                                  control_priority_t priority, const char *reason);
+esp_err_t control_arbiter_request_duty(uint8_t actuator_id, uint8_t duty,
+                                       control_priority_t priority, const char *reason);
+esp_err_t control_arbiter_commit(void);
+esp_err_t control_arbiter_get_decision(uint8_t actuator_id, control_decision_t *decision);
+const char* control_priority_to_string(control_priority_t priority);
+
+#endif
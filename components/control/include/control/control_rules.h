@@ -0,0 +1,87 @@
+#ifndef CONTROL_RULES_H
+#define CONTROL_RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Runtime control rules.
+ *
+ * A rule reads one value - a sensor by ID, the minimum, maximum or average of
+ * all healthy sensors of a sensor_type_t, or the local time of day in hours -
+ * compares it, and when the condition holds requests an action on one
+ * actuator or, with RULE_FLAG_GROUP, every actuator of an actuator_type_t at
+ * the given arbiter priority. RULE_FLAG_AND joins a rule's condition to the
+ * next rule's (the joined rule's own action is unused); RULE_FLAG_ELSE
+ * requests OFF while the condition does not hold. GT/LT compares latch with
+ * the hysteresis in b. Actuators whose type is not set in the auto_types mask
+ * (bit per actuator_type_t) are left alone.
+ *
+ * The table is stored in NVS (namespace "rules") and compiled on load: value
+ * sources are deduplicated into slots, filled by one pass over the sensor
+ * list per cycle, and group targets are expanded into flat actuator lists, so
+ * evaluation is a straight walk over the compiled table. Rules run before the
+ * built-in laws, so a rule wins ties at its priority; gas priority is
+ * reserved for the built-in gas safety law. An empty table leaves only the
+ * built-in laws.
+ */
+
+#define CONTROL_RULES_MAX       128
+#define RULE_FLAG_GROUP         0x01
+#define RULE_FLAG_AND           0x02
+#define RULE_FLAG_ELSE          0x04
+
+typedef enum {
+    RULE_SOURCE_SENSOR,         /* source_arg: sensor ID */
+    RULE_SOURCE_MIN,            /* source_arg: sensor_type_t */
+    RULE_SOURCE_MAX,
+    RULE_SOURCE_AVG,
+    RULE_SOURCE_HOUR            /* local time of day, 0.0 .. 24.0 */
+} rule_source_t;
+
+typedef enum {
+    RULE_CMP_GT,                /* value > a, released below a - b */
+    RULE_CMP_LT,                /* value < a, released above a + b */
+    RULE_CMP_IN,                /* a <= value < b */
+    RULE_CMP_OUT                /* value < a or value >= b */
+} rule_compare_t;
+
+typedef enum {
+    RULE_ACTION_OFF,
+    RULE_ACTION_ON,
+    RULE_ACTION_DUTY
+} rule_action_t;
+
+typedef struct {
+    uint8_t source;             /* rule_source_t */
+    uint8_t source_arg;
+    uint8_t compare;            /* rule_compare_t */
+    uint8_t flags;
+    float a;
+    float b;
+    uint8_t target;             /* actuator ID, or actuator_type_t for a group */
+    uint8_t action;             /* rule_action_t */
+    uint8_t duty;               /* RULE_ACTION_DUTY: 1..100 % */
+    uint8_t priority;           /* control_priority_t, below CONTROL_PRIORITY_GAS */
+} control_rule_t;
+
+typedef struct {
+    uint8_t rule_count;
+    uint8_t slot_count;
+    uint16_t target_count;
+    uint8_t fired;              /* rules whose action was requested last cycle */
+    uint32_t last_eval_us;
+    uint32_t max_eval_us;
+} control_rules_stats_t;
+
+esp_err_t control_rules_init(void);
+esp_err_t control_rules_set(const control_rule_t *rules, uint8_t count);
+esp_err_t control_rules_get(control_rule_t *rules, uint8_t max_count, uint8_t *count);
+esp_err_t control_rules_clear(void);
+uint8_t control_rules_evaluate(const sensor_data_t *sensors, uint8_t sensor_count,
+                               float hour, uint32_t auto_types);
+esp_err_t control_rules_get_stats(control_rules_stats_t *stats);
+
+#endif
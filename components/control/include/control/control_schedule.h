@@ -0,0 +1,53 @@
+#ifndef CONTROL_SCHEDULE_H
+#define CONTROL_SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "actuators/actuator_manager.h"
+
+/*
+ * Time-of-day program.
+ *
+ * The user table (stored in NVS) lists events as time of day, target,
+ * action and optional duration. A target is one actuator ID, or with
+ * SCHEDULE_FLAG_GROUP set, every actuator of an actuator_type_t. On load the
+ * table is compiled into a flat list of single-actuator switch points sorted
+ * by time, with duration expanded into a matching OFF point. One esp_timer is
+ * armed for the next switch point (found by binary search); when it fires the
+ * latched state of each scheduled actuator is updated and the control task is
+ * notified with CONTROL_NOTIFY_SCHEDULE so the change is applied immediately.
+ */
+
+#define SCHEDULE_MAX_EVENTS         32
+#define SCHEDULE_MAX_COMPILED       96
+#define SCHEDULE_FLAG_GROUP         0x01
+#define CONTROL_NOTIFY_SCHEDULE     (1UL << 2)
+
+typedef enum {
+    SCHEDULE_ACTION_OFF,
+    SCHEDULE_ACTION_ON
+} schedule_action_t;
+
+typedef struct {
+    uint32_t time_of_day;       /* seconds after local midnight */
+    uint8_t target;             /* actuator ID, or actuator_type_t for a group */
+    uint8_t flags;
+    uint8_t action;             /* schedule_action_t */
+    uint8_t reserved;
+    uint16_t duration_s;        /* ON events: switch back OFF after this long, 0 = hold */
+    uint16_t reserved2;
+} schedule_event_t;
+
+esp_err_t control_schedule_init(void);
+esp_err_t control_schedule_set_notify_task(TaskHandle_t task);
+esp_err_t control_schedule_set_events(const schedule_event_t *events, uint8_t count);
+esp_err_t control_schedule_get_events(schedule_event_t *events, uint8_t max_count, uint8_t *count);
+esp_err_t control_schedule_reset_default(void);
+esp_err_t control_schedule_resync(void);
+bool control_schedule_get_state(uint8_t actuator_id, actuator_state_t *state);
+esp_err_t control_schedule_get_next(uint32_t *time_of_day, uint8_t *actuator_id, actuator_state_t *state);
+
+#endif
@@ -49,11 +49,15 @@ esp_err_t control_system_enable_auto_pump(bool enable);
 esp_err_t control_system_set_control_interval(uint32_t interval_ms);
 esp_err_t control_system_get_state(control_state_t *state);
 
-void control_temperature_logic(float temperature, float humidity);
+void control_temperature_logic(float temperature, float thi);
+void control_zone_logic(float humidity);
+void control_temperature_limits_logic(float temperature, float humidity, float thi);
 void control_humidity_logic(float humidity, float temperature);
 void control_gas_logic(float ammonia, float co2, float co);
 void control_light_logic(float light_level, uint8_t hour);
 void control_feeder_logic(void);
+void control_schedule_logic(void);
+void control_dispense_logic(void);
 void control_water_logic(float water_level);
 
 #endif
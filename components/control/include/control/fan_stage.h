@@ -0,0 +1,37 @@
+#ifndef FAN_STAGE_H
+#define FAN_STAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fan output stage shared by the temperature controllers (house PID, zone
+ * PIDs and the adaptive planner).
+ *
+ * Fans stall below FAN_MIN_DUTY, so a small cooling demand cannot be met
+ * proportionally. The stage starts the fans when the demand reaches
+ * FAN_START_DEMAND and stops them only when it falls to FAN_STOP_DEMAND;
+ * in between they hold their state. While running, the duty follows the
+ * demand but never drops below FAN_MIN_DUTY. Every start is held for at
+ * least CONFIG_CONTROL_FAN_MIN_RUN_S and every stop for at least
+ * CONFIG_CONTROL_FAN_MIN_OFF_S.
+ *
+ * A zeroed fan_stage_t is a stopped stage that may start at once. The stage
+ * has no locking; each instance belongs to its controller.
+ */
+
+#define FAN_MIN_DUTY            25      /* % */
+#define FAN_START_DEMAND        5       /* % cooling demand */
+#define FAN_STOP_DEMAND         0
+
+typedef struct {
+    bool running;
+    bool switched;              /* started at least once */
+    uint32_t changed_ms;        /* last start or stop */
+} fan_stage_t;
+
+void fan_stage_reset(fan_stage_t *stage);
+/* cooling is the demand in %, 0..100; returns the fan duty, 0 = stopped */
+uint8_t fan_stage_update(fan_stage_t *stage, int32_t cooling, uint32_t now_ms);
+
+#endif
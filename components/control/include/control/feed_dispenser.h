@@ -0,0 +1,63 @@
+#ifndef FEED_DISPENSER_H
+#define FEED_DISPENSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+ * Gravimetric feed dispensing.
+ *
+ * A dispense runs one feeder until a target mass has left the hopper, as
+ * measured by the Feeder_Weight scale (sensor 30). The scale is switched to
+ * fast filtered sampling for the duration and an esp_timer samples it every
+ * CONFIG_FEED_DISPENSE_SAMPLE_MS. Phases:
+ *
+ *   TARE    - the filter settles and the hopper baseline is taken, feeder off
+ *   RUN     - the control task is notified and the feeder is requested ON;
+ *             delivered mass and flow rate are tracked, and the feeder is
+ *             stopped as soon as delivered + flow * lag reaches the target
+ *   SETTLE  - feed still in the auger and the filter catch up; the actual
+ *             mass is then recorded and the feeder's lag estimate corrected
+ *
+ * The lag covers filter delay and auger coast, and is learnt per feeder from
+ * the overshoot of each dispense. Only one dispense runs at a time since all
+ * feeders share the hopper scale. Each completed dispense is kept in a small
+ * in-RAM log.
+ */
+
+#define FEED_DISPENSER_LOG_SIZE     16
+#define CONTROL_NOTIFY_DISPENSE     (1UL << 3)
+
+typedef enum {
+    FEED_DISPENSE_OK,
+    FEED_DISPENSE_TIMEOUT,          /* target not reached within the time limit */
+    FEED_DISPENSE_STALLED,          /* no flow: hopper empty or auger jammed */
+    FEED_DISPENSE_ABORTED
+} feed_dispense_result_t;
+
+typedef struct {
+    uint32_t timestamp;             /* unix time at start */
+    uint8_t feeder_id;
+    feed_dispense_result_t result;
+    float target_g;
+    float actual_g;
+    float flow_g_s;                 /* flow rate at the stop decision */
+    uint32_t duration_ms;           /* feeder run time */
+} feed_dispense_record_t;
+
+esp_err_t feed_dispenser_init(void);
+esp_err_t feed_dispenser_deinit(void);
+esp_err_t feed_dispenser_set_notify_task(TaskHandle_t task);
+esp_err_t feed_dispenser_set_target(uint8_t feeder_id, float grams);
+float feed_dispenser_get_target(uint8_t feeder_id);
+esp_err_t feed_dispenser_start(uint8_t feeder_id, float grams);
+esp_err_t feed_dispenser_abort(void);
+bool feed_dispenser_is_busy(void);
+bool feed_dispenser_is_running(uint8_t feeder_id);
+esp_err_t feed_dispenser_get_log(feed_dispense_record_t *records, uint8_t max_count, uint8_t *count);
+const char* feed_dispense_result_to_string(feed_dispense_result_t result);
+
+#endif
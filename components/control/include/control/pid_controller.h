@@ -0,0 +1,51 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/fixed_point.h"
+
+/*
+ * Fixed-point PID controller (Q16.16) for a fixed sample period.
+ *
+ * - Derivative acts on the measurement, not the error, so setpoint steps do
+ *   not kick the output, and is smoothed by a first-order filter.
+ * - Anti-windup: the integrator is clamped to the output range and frozen
+ *   while the output is saturated in the direction of the error.
+ * - The output slews by at most rate_limit per second.
+ * - In manual mode the output is held by the caller; switching back to
+ *   automatic preloads the integrator so the output does not jump.
+ *
+ * The controller has no locking; each instance belongs to one task.
+ */
+
+typedef struct {
+    fix16_t kp;                 /* output units per unit of error */
+    fix16_t ki;                 /* output units per unit of error per second */
+    fix16_t kd;                 /* output units per unit of error change per second */
+    fix16_t out_min;
+    fix16_t out_max;
+    fix16_t rate_limit;         /* max output change per second, 0 = unlimited */
+    fix16_t derivative_alpha;   /* filter weight of a new sample, 0..1; 1 = unfiltered */
+    uint32_t period_ms;         /* sample period the gains are scaled for */
+} pid_config_t;
+
+typedef struct {
+    pid_config_t config;
+    fix16_t dt;                 /* period in seconds */
+    fix16_t integral;
+    fix16_t derivative;
+    fix16_t last_measurement;
+    fix16_t output;
+    bool automatic;
+    bool primed;
+} pid_controller_t;
+
+void pid_init(pid_controller_t *pid, const pid_config_t *config);
+void pid_set_tuning(pid_controller_t *pid, fix16_t kp, fix16_t ki, fix16_t kd);
+fix16_t pid_update(pid_controller_t *pid, fix16_t setpoint, fix16_t measurement);
+void pid_set_manual(pid_controller_t *pid, fix16_t output);
+void pid_set_auto(pid_controller_t *pid, fix16_t setpoint, fix16_t measurement);
+void pid_reset(pid_controller_t *pid);
+
+#endif
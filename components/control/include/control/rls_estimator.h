@@ -0,0 +1,39 @@
+#ifndef RLS_ESTIMATOR_H
+#define RLS_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Recursive least squares estimator for a model linear in its parameters,
+ * y = theta' * phi, with exponential forgetting so slowly drifting plants are
+ * tracked.
+ *
+ * Matrices are fixed at RLS_MAX_PARAMS and nothing is allocated. Single
+ * precision float is used: the covariance spans too many decades for Q16.16,
+ * and the ESP32 has a hardware FPU. While the regressor is not exciting,
+ * forgetting inflates the covariance; once its trace exceeds trace_max the
+ * forgetting is suspended so a later burst of data does not swing the
+ * estimate (covariance wind-up).
+ *
+ * The estimator has no locking; each instance belongs to one task.
+ */
+
+#define RLS_MAX_PARAMS 6
+
+typedef struct {
+    uint8_t n;                      /* parameters in use, <= RLS_MAX_PARAMS */
+    float lambda;                   /* forgetting factor, 0.95..1 */
+    float trace_max;
+    float theta[RLS_MAX_PARAMS];
+    float P[RLS_MAX_PARAMS][RLS_MAX_PARAMS];
+    float error_ms;                 /* running mean square of the a-priori error */
+    uint32_t samples;
+} rls_estimator_t;
+
+void rls_init(rls_estimator_t *rls, uint8_t n, float lambda, float p0);
+void rls_reset(rls_estimator_t *rls, float p0);
+float rls_predict(const rls_estimator_t *rls, const float *phi);
+float rls_update(rls_estimator_t *rls, const float *phi, float y);
+
+#endif
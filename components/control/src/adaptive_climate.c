@@ -0,0 +1,405 @@
+#include "control/adaptive_climate.h"
+#include "control/rls_estimator.h"
+#include "control/fan_stage.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <string.h>
+#include "utils/config.h"
+#include "utils/task_timing.h"
+
+static const char *TAG = "ADAPTIVE";
+
+/* Regressor layout: [T, h, f * (T - Tout), Tout, 1] */
+#define MODEL_PARAMS            5
+#define RLS_LAMBDA              0.995f
+#define RLS_P0                  100.0f
+
+/* The model is used once it has seen enough periods and looks physical */
+#define MODEL_MIN_SAMPLES       30
+#define MODEL_A_MIN             0.5f
+#define MODEL_MAX_RMS           0.5f
+
+/* Planner cost weights: loose tracking inside the band, steep outside it */
+#define COMFORT_BAND            0.75f   /* degC either side of temp_optimal */
+#define W_TRACK                 0.1f
+#define W_BAND                  10.0f
+#define W_MOVE                  0.5f
+#define W_ENERGY                0.02f
+#define PLAN_ITERATIONS         60
+
+/* Outdoor trend, extrapolated over the horizon as the only weather forecast */
+#define OUTDOOR_TREND_ALPHA     0.2f
+#define OUTDOOR_TREND_MAX       0.2f    /* degC per period */
+
+#define BLOCK_LEN               (ADAPTIVE_HORIZON / ADAPTIVE_BLOCKS)
+
+static SemaphoreHandle_t adaptive_mutex = NULL;
+static esp_timer_handle_t adaptive_timer = NULL;
+static volatile bool initialized = false;
+static bool enabled = false;
+static task_timing_t adaptive_timing;
+
+static rls_estimator_t rls;
+static adaptive_model_t model;
+
+/* Inputs accumulated over the current period */
+static float indoor_last = 0.0f;
+static bool indoor_valid = false;
+static float outdoor_sum = 0.0f;
+static uint32_t outdoor_count = 0;
+static float heater_sum = 0.0f;
+static float fan_sum = 0.0f;
+static uint32_t input_count = 0;
+
+/* Previous period, the regressor of the next update */
+static float prev_indoor = 0.0f;
+static float prev_outdoor = 0.0f;
+static bool prev_valid = false;
+static float outdoor_last = 0.0f;
+static float outdoor_trend = 0.0f;
+static bool outdoor_known = false;
+
+/* Plan: split-range demand per block, -1 (full cooling) .. +1 (full heating) */
+static float plan[ADAPTIVE_BLOCKS];
+static float applied_demand = 0.0f;
+static uint8_t heater_period = 0;
+static uint8_t heater_on_periods = 0;
+static fan_stage_t fan_stage;
+static adaptive_output_t output = {0};
+
+/* Must be called with adaptive_mutex held */
+static void adaptive_check_model(void)
+{
+    model.a = rls.theta[0];
+    model.b_heat = rls.theta[1];
+    model.b_fan = rls.theta[2];
+    model.b_out = rls.theta[3];
+    model.c = rls.theta[4];
+    model.rms_error = sqrtf(rls.error_ms);
+    model.samples = rls.samples;
+
+    bool was_valid = model.valid;
+    model.valid = rls.samples >= MODEL_MIN_SAMPLES &&
+                  model.a > MODEL_A_MIN && model.a < 1.0f &&
+                  model.rms_error < MODEL_MAX_RMS &&
+                  (model.b_heat > 0.0f || model.b_fan < 0.0f);
+
+    if (model.valid != was_valid) {
+        ESP_LOGI(TAG, "Thermal model %s: a=%.3f b_heat=%.3f b_fan=%.4f b_out=%.3f c=%.3f rms=%.2f",
+                 model.valid ? "valid" : "no longer valid",
+                 model.a, model.b_heat, model.b_fan, model.b_out, model.c, model.rms_error);
+    }
+}
+
+/* Must be called with adaptive_mutex held */
+static void adaptive_plan(float t0, float t_out)
+{
+    const float a = model.a;
+    /* Gains of positive (heating) and negative (cooling) demand; each acts only in its own direction */
+    const float g_heat = model.b_heat > 0.0f ? model.b_heat : 0.0f;
+    float g_cool = -model.b_fan * (t0 - t_out);
+    if (g_cool < 0.0f) g_cool = 0.0f;
+    const float setpoint = poultry_config.temp_optimal;
+    const float band_lo = setpoint - COMFORT_BAND;
+    const float band_hi = setpoint + COMFORT_BAND;
+
+    /* Free response, and the response at step k to unit input held over block j */
+    float free_resp[ADAPTIVE_HORIZON];
+    float step_resp[ADAPTIVE_HORIZON][ADAPTIVE_BLOCKS];
+    float t = t0;
+    float resp_norm = 0.0f;
+    for (int k = 0; k < ADAPTIVE_HORIZON; k++) {
+        t = a * t + model.b_out * (t_out + outdoor_trend * k) + model.c;
+        free_resp[k] = t;
+        for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+            float prev = k > 0 ? step_resp[k - 1][j] : 0.0f;
+            step_resp[k][j] = a * prev + (k / BLOCK_LEN == j ? 1.0f : 0.0f);
+            resp_norm += step_resp[k][j] * step_resp[k][j];
+        }
+    }
+
+    /* Lipschitz bound of the gradient gives a step that never diverges */
+    float g_max = g_heat > g_cool ? g_heat : g_cool;
+    float lipschitz = 2.0f * (W_TRACK + W_BAND) * g_max * g_max * resp_norm + 8.0f * W_MOVE;
+    float step = 1.0f / lipschitz;
+
+    float temps[ADAPTIVE_HORIZON];
+    float gain[ADAPTIVE_BLOCKS];
+
+    for (int iter = 0; iter <= PLAN_ITERATIONS; iter++) {
+        for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+            gain[j] = plan[j] >= 0.0f ? g_heat : g_cool;
+        }
+        for (int k = 0; k < ADAPTIVE_HORIZON; k++) {
+            float temp = free_resp[k];
+            for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+                temp += step_resp[k][j] * gain[j] * plan[j];
+            }
+            temps[k] = temp;
+        }
+        /* Last pass only evaluates the final plan */
+        if (iter == PLAN_ITERATIONS) break;
+
+        float sens[ADAPTIVE_BLOCKS] = {0};
+        for (int k = 0; k < ADAPTIVE_HORIZON; k++) {
+            float e = W_TRACK * (temps[k] - setpoint);
+            if (temps[k] > band_hi) e += W_BAND * (temps[k] - band_hi);
+            if (temps[k] < band_lo) e -= W_BAND * (band_lo - temps[k]);
+            for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+                sens[j] += 2.0f * e * step_resp[k][j];
+            }
+        }
+
+        float prev = applied_demand;
+        for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+            float d = plan[j];
+            /* At zero, take the side the cost wants to move towards */
+            float g = d > 0.0f ? g_heat : (d < 0.0f ? g_cool : (sens[j] < 0.0f ? g_heat : g_cool));
+            float grad = g * sens[j];
+            if (d > 0.0f) grad += W_ENERGY;
+            if (d < 0.0f) grad -= W_ENERGY;
+            /* Move suppression against the demand applied now, then block to block */
+            grad += 2.0f * W_MOVE * (d - prev);
+            if (j + 1 < ADAPTIVE_BLOCKS) grad -= 2.0f * W_MOVE * (plan[j + 1] - d);
+            prev = d;
+
+            float z = d - step * grad;
+            /* Energy pulls towards zero but never across it */
+            if ((d > 0.0f && z < 0.0f) || (d < 0.0f && z > 0.0f)) {
+                if (fabsf(g * sens[j]) < W_ENERGY) z = 0.0f;
+            }
+            plan[j] = z < -1.0f ? -1.0f : (z > 1.0f ? 1.0f : z);
+        }
+    }
+
+    output.predicted_temp = temps[0];
+    output.predicted_min = temps[0];
+    output.predicted_max = temps[0];
+    for (int k = 1; k < ADAPTIVE_HORIZON; k++) {
+        if (temps[k] < output.predicted_min) output.predicted_min = temps[k];
+        if (temps[k] > output.predicted_max) output.predicted_max = temps[k];
+    }
+}
+
+/* Must be called with adaptive_mutex held */
+static void adaptive_apply_plan(void)
+{
+    applied_demand = plan[0];
+    output.demand = applied_demand * 100.0f;
+
+    float heat = applied_demand > 0.0f ? applied_demand : 0.0f;
+    float cool = applied_demand < 0.0f ? -applied_demand : 0.0f;
+
+    /* Fans go through the same stage as the PID path */
+    int32_t fan = (int32_t)(cool * 100.0f + 0.5f);
+    output.fan_duty = fan_stage_update(&fan_stage, fan, (uint32_t)(esp_timer_get_time() / 1000));
+
+    /* Heater relays are time-proportioned over one plan block of whole periods: the
+     * duty is latched at the start of the block, so they switch at most twice per block.
+     * No heat while the fans are held on for their minimum run time */
+    output.heater_duty = (uint8_t)(heat * 100.0f + 0.5f);
+    if (heater_period == 0) {
+        heater_on_periods = output.fan_duty == 0 ? (uint8_t)(heat * BLOCK_LEN + 0.5f) : 0;
+    }
+    output.heater_on = heater_period < heater_on_periods;
+    heater_period = (heater_period + 1) % BLOCK_LEN;
+}
+
+static void adaptive_tick(void *arg)
+{
+    task_timing_begin(&adaptive_timing);
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+
+    bool have_period = indoor_valid && input_count > 0;
+    float heat = have_period ? heater_sum / input_count : 0.0f;
+    float fan = have_period ? fan_sum / input_count : 0.0f;
+    if (outdoor_count > 0) {
+        float outdoor = outdoor_sum / outdoor_count;
+        if (outdoor_known) {
+            float delta = outdoor - outdoor_last;
+            if (delta > OUTDOOR_TREND_MAX) delta = OUTDOOR_TREND_MAX;
+            if (delta < -OUTDOOR_TREND_MAX) delta = -OUTDOOR_TREND_MAX;
+            outdoor_trend += OUTDOOR_TREND_ALPHA * (delta - outdoor_trend);
+        }
+        outdoor_last = outdoor;
+        outdoor_known = true;
+    }
+
+    /* Identify from the period that just ended, with the inputs actually applied */
+    if (have_period && prev_valid && outdoor_count > 0) {
+        float phi[MODEL_PARAMS] = {
+            prev_indoor,
+            heat,
+            fan * (prev_indoor - prev_outdoor),
+            prev_outdoor,
+            1.0f
+        };
+        rls_update(&rls, phi, indoor_last);
+        adaptive_check_model();
+    }
+
+    prev_valid = have_period && outdoor_count > 0;
+    prev_indoor = indoor_last;
+    prev_outdoor = outdoor_last;
+    heater_sum = 0.0f;
+    fan_sum = 0.0f;
+    input_count = 0;
+    outdoor_sum = 0.0f;
+    outdoor_count = 0;
+
+    if (enabled && model.valid && indoor_valid && outdoor_known) {
+        adaptive_plan(indoor_last, outdoor_last);
+        adaptive_apply_plan();
+        output.active = true;
+    } else {
+        output.active = false;
+        applied_demand = heat > fan ? heat : -fan;
+        heater_period = 0;
+        fan_stage_reset(&fan_stage);
+    }
+
+    xSemaphoreGive(adaptive_mutex);
+    task_timing_end(&adaptive_timing);
+}
+
+/* Must be called with adaptive_mutex held */
+static void adaptive_reset_locked(void)
+{
+    rls_reset(&rls, RLS_P0);
+    /* Start from persistence (T[k+1] = T[k]) rather than zero */
+    rls.theta[0] = 1.0f;
+    memset(&model, 0, sizeof(model));
+    memset(plan, 0, sizeof(plan));
+    heater_period = 0;
+    fan_stage_reset(&fan_stage);
+    prev_valid = false;
+    output.active = false;
+}
+
+esp_err_t adaptive_climate_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    adaptive_mutex = xSemaphoreCreateMutex();
+    if (adaptive_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create adaptive mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    rls_init(&rls, MODEL_PARAMS, RLS_LAMBDA, RLS_P0);
+    adaptive_reset_locked();
+
+    task_timing_register(&adaptive_timing, "adaptive", CONFIG_CONTROL_ADAPTIVE_PERIOD_S * 1000);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = adaptive_tick,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "adaptive"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &adaptive_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(adaptive_timer, (uint64_t)CONFIG_CONTROL_ADAPTIVE_PERIOD_S * 1000000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start adaptive timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(adaptive_mutex);
+        adaptive_mutex = NULL;
+        return err;
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "Adaptive control: %d s period, %d period horizon",
+             CONFIG_CONTROL_ADAPTIVE_PERIOD_S, ADAPTIVE_HORIZON);
+
+    return ESP_OK;
+}
+
+esp_err_t adaptive_climate_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    initialized = false;
+    esp_timer_stop(adaptive_timer);
+    esp_timer_delete(adaptive_timer);
+    adaptive_timer = NULL;
+    vSemaphoreDelete(adaptive_mutex);
+    adaptive_mutex = NULL;
+
+    return ESP_OK;
+}
+
+void adaptive_climate_set_measurement(float indoor, float outdoor, float heater_frac, float fan_frac)
+{
+    if (!initialized) return;
+
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+    indoor_last = indoor;
+    indoor_valid = true;
+    /* NAN when no outdoor reading is available; the period is then not used for identification */
+    if (!isnan(outdoor)) {
+        outdoor_sum += outdoor;
+        outdoor_count++;
+    }
+    heater_sum += heater_frac;
+    fan_sum += fan_frac;
+    input_count++;
+    xSemaphoreGive(adaptive_mutex);
+}
+
+esp_err_t adaptive_climate_set_enabled(bool enable)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+    if (enable && !enabled) {
+        /* Plan from what is running now so entering the mode does not jump */
+        for (int j = 0; j < ADAPTIVE_BLOCKS; j++) {
+            plan[j] = applied_demand;
+        }
+    }
+    enabled = enable;
+    if (!enable) output.active = false;
+    xSemaphoreGive(adaptive_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t adaptive_climate_get_output(adaptive_output_t *out)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+    *out = output;
+    xSemaphoreGive(adaptive_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t adaptive_climate_get_model(adaptive_model_t *out)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+    *out = model;
+    xSemaphoreGive(adaptive_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t adaptive_climate_reset_model(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(adaptive_mutex, portMAX_DELAY);
+    adaptive_reset_locked();
+    xSemaphoreGive(adaptive_mutex);
+
+    ESP_LOGI(TAG, "Thermal model reset");
+    return ESP_OK;
+}
@@ -0,0 +1,224 @@
+#include "control/climate_pid.h"
+#include "control/pid_controller.h"
+#include "control/fan_stage.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "utils/config.h"
+#include "utils/task_timing.h"
+
+static const char *TAG = "CLIMATE_PID";
+
+/* Default tuning for a naturally ventilated house: % demand per degree C */
+#define CLIMATE_PID_KP          25.0f
+#define CLIMATE_PID_KI          0.05f
+#define CLIMATE_PID_KD          60.0f
+#define CLIMATE_PID_RATE_LIMIT  10.0f   /* % per second */
+#define CLIMATE_PID_D_ALPHA     0.25f
+
+/* Shortest heater pulse (and gap within a window) worth switching a relay for:
+ * a fifth of the window, so duties under 20 % are dropped and over 80 % saturate
+ * whatever the window length */
+#define HEATER_MIN_ON_MS        (CONFIG_CONTROL_HEATER_WINDOW_MS / 5)
+
+static pid_controller_t pid;
+static SemaphoreHandle_t pid_mutex = NULL;
+static esp_timer_handle_t pid_timer = NULL;
+static volatile bool initialized = false;
+static task_timing_t pid_timing;
+
+static fix16_t measurement = 0;
+static bool measurement_valid = false;
+
+static uint32_t window_elapsed_ms = 0;
+static uint32_t heater_on_ms = 0;
+static fan_stage_t fan_stage;
+static climate_pid_output_t output = {0};
+
+uint32_t climate_pid_heater_on_ms(uint8_t duty)
+{
+    uint32_t on_ms = (uint32_t)duty * CONFIG_CONTROL_HEATER_WINDOW_MS / 100;
+
+    if (on_ms < HEATER_MIN_ON_MS) return 0;
+    if (CONFIG_CONTROL_HEATER_WINDOW_MS - on_ms < HEATER_MIN_ON_MS) return CONFIG_CONTROL_HEATER_WINDOW_MS;
+    return on_ms;
+}
+
+/* Must be called with pid_mutex held */
+static void climate_apply_demand(fix16_t demand)
+{
+    int32_t percent = FIX16_TO_INT(demand);
+
+    /* Fans: proportional PWM above the stall duty, with start/stop hysteresis */
+    output.fan_duty = fan_stage_update(&fan_stage, -percent, (uint32_t)(esp_timer_get_time() / 1000));
+
+    /* Heater: duty is latched at the start of each window so the relay switches at most
+     * twice; no heat while the fans are held on for their minimum run time */
+    if (window_elapsed_ms == 0) {
+        uint8_t duty = percent > 0 && output.fan_duty == 0 ? (uint8_t)percent : 0;
+        heater_on_ms = climate_pid_heater_on_ms(duty);
+        output.heater_duty = (uint8_t)(heater_on_ms * 100 / CONFIG_CONTROL_HEATER_WINDOW_MS);
+    }
+    output.heater_on = window_elapsed_ms < heater_on_ms;
+
+    window_elapsed_ms += CONFIG_CONTROL_PID_PERIOD_MS;
+    if (window_elapsed_ms >= CONFIG_CONTROL_HEATER_WINDOW_MS) {
+        window_elapsed_ms = 0;
+    }
+
+    output.demand = FIX16_TO_FLOAT(demand);
+    output.automatic = pid.automatic;
+}
+
+static void climate_pid_tick(void *arg)
+{
+    task_timing_begin(&pid_timing);
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+
+    if (measurement_valid) {
+        fix16_t setpoint = FIX16_FROM_FLOAT(poultry_config.temp_optimal);
+        fix16_t demand = pid_update(&pid, setpoint, measurement);
+        climate_apply_demand(demand);
+    }
+
+    xSemaphoreGive(pid_mutex);
+    task_timing_end(&pid_timing);
+}
+
+esp_err_t climate_pid_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    pid_mutex = xSemaphoreCreateMutex();
+    if (pid_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create PID mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    pid_config_t config = {
+        .kp = FIX16_FROM_FLOAT(CLIMATE_PID_KP),
+        .ki = FIX16_FROM_FLOAT(CLIMATE_PID_KI),
+        .kd = FIX16_FROM_FLOAT(CLIMATE_PID_KD),
+        .out_min = FIX16_FROM_INT(-100),
+        .out_max = FIX16_FROM_INT(100),
+        .rate_limit = FIX16_FROM_FLOAT(CLIMATE_PID_RATE_LIMIT),
+        .derivative_alpha = FIX16_FROM_FLOAT(CLIMATE_PID_D_ALPHA),
+        .period_ms = CONFIG_CONTROL_PID_PERIOD_MS
+    };
+    pid_init(&pid, &config);
+
+    measurement_valid = false;
+    window_elapsed_ms = 0;
+    heater_on_ms = 0;
+    fan_stage_reset(&fan_stage);
+
+    task_timing_register(&pid_timing, "climate_pid", CONFIG_CONTROL_PID_PERIOD_MS);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = climate_pid_tick,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "climate_pid"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &pid_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(pid_timer, (uint64_t)CONFIG_CONTROL_PID_PERIOD_MS * 1000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start PID timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(pid_mutex);
+        pid_mutex = NULL;
+        return err;
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "Climate PID running every %d ms, heater window %d ms",
+             CONFIG_CONTROL_PID_PERIOD_MS, CONFIG_CONTROL_HEATER_WINDOW_MS);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_pid_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    initialized = false;
+    esp_timer_stop(pid_timer);
+    esp_timer_delete(pid_timer);
+    pid_timer = NULL;
+    vSemaphoreDelete(pid_mutex);
+    pid_mutex = NULL;
+
+    return ESP_OK;
+}
+
+void climate_pid_set_measurement(float temperature)
+{
+    if (!initialized) return;
+
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+    measurement = FIX16_FROM_FLOAT(temperature);
+    measurement_valid = true;
+    xSemaphoreGive(pid_mutex);
+}
+
+esp_err_t climate_pid_get_output(climate_pid_output_t *out)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+    *out = output;
+    xSemaphoreGive(pid_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_pid_set_manual(bool manual)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+    if (manual) {
+        pid_set_manual(&pid, pid.output);
+    } else {
+        pid_set_auto(&pid, FIX16_FROM_FLOAT(poultry_config.temp_optimal), measurement);
+    }
+    output.automatic = pid.automatic;
+    xSemaphoreGive(pid_mutex);
+
+    ESP_LOGI(TAG, "PID %s", manual ? "holding output (manual)" : "automatic");
+    return ESP_OK;
+}
+
+esp_err_t climate_pid_reset(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+    pid_reset(&pid);
+    window_elapsed_ms = 0;
+    heater_on_ms = 0;
+    fan_stage_reset(&fan_stage);
+    output.fan_duty = 0;
+    output.heater_duty = 0;
+    output.heater_on = false;
+    output.demand = 0.0f;
+    xSemaphoreGive(pid_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_pid_set_tuning(float kp, float ki, float kd)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (kp < 0.0f || ki < 0.0f || kd < 0.0f) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(pid_mutex, portMAX_DELAY);
+    pid_set_tuning(&pid, FIX16_FROM_FLOAT(kp), FIX16_FROM_FLOAT(ki), FIX16_FROM_FLOAT(kd));
+    xSemaphoreGive(pid_mutex);
+
+    ESP_LOGI(TAG, "Tuning set: Kp=%.2f Ki=%.3f Kd=%.1f", kp, ki, kd);
+    return ESP_OK;
+}
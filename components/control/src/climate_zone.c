@@ -0,0 +1,385 @@
+#include "control/climate_zone.h"
+#include "control/climate_pid.h"
+#include "control/pid_controller.h"
+#include "control/fan_stage.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <nvs.h>
+#include <string.h>
+#include "actuators/actuator_manager.h"
+#include "utils/config.h"
+#include "utils/task_timing.h"
+
+static const char *TAG = "CLIMATE_ZONE";
+
+#define NVS_NAMESPACE       "zones"
+#define NVS_KEY_TABLE       "table"
+
+/* Same tuning and output stage as the house-wide PID (climate_pid.c) */
+#define ZONE_PID_KP             25.0f
+#define ZONE_PID_KI             0.05f
+#define ZONE_PID_KD             60.0f
+#define ZONE_PID_RATE_LIMIT     10.0f   /* % per second */
+#define ZONE_PID_D_ALPHA        0.25f
+
+typedef struct {
+    pid_controller_t pid;
+    fix16_t measurement;
+    bool measurement_valid;
+    uint32_t window_elapsed_ms;
+    uint32_t heater_on_ms;
+    fan_stage_t fan_stage;
+    climate_zone_output_t output;
+} zone_loop_t;
+
+static climate_zone_config_t zones[CLIMATE_ZONES_MAX];
+static zone_loop_t loops[CLIMATE_ZONES_MAX];
+static uint8_t zone_count = 0;
+static uint32_t owned_mask = 0;
+static bool manual = false;
+
+static SemaphoreHandle_t zone_mutex = NULL;
+static esp_timer_handle_t zone_timer = NULL;
+static volatile bool initialized = false;
+static task_timing_t zone_timing;
+
+/* Must be called with zone_mutex held */
+static void zone_apply_demand(zone_loop_t *loop, fix16_t demand)
+{
+    int32_t percent = FIX16_TO_INT(demand);
+    climate_zone_output_t *output = &loop->output;
+
+    output->fan_duty = fan_stage_update(&loop->fan_stage, -percent, (uint32_t)(esp_timer_get_time() / 1000));
+
+    /* Heater duty is latched at the start of each window so the relay switches at most
+     * twice; no heat while the zone fans are held on for their minimum run time */
+    if (loop->window_elapsed_ms == 0) {
+        uint8_t duty = percent > 0 && output->fan_duty == 0 ? (uint8_t)percent : 0;
+        loop->heater_on_ms = climate_pid_heater_on_ms(duty);
+        output->heater_duty = (uint8_t)(loop->heater_on_ms * 100 / CONFIG_CONTROL_HEATER_WINDOW_MS);
+    }
+    output->heater_on = loop->window_elapsed_ms < loop->heater_on_ms;
+
+    loop->window_elapsed_ms += CONFIG_CONTROL_PID_PERIOD_MS;
+    if (loop->window_elapsed_ms >= CONFIG_CONTROL_HEATER_WINDOW_MS) {
+        loop->window_elapsed_ms = 0;
+    }
+
+    output->demand = FIX16_TO_FLOAT(demand);
+    output->automatic = loop->pid.automatic;
+}
+
+/* Must be called with zone_mutex held */
+static void zone_reset_loops(void)
+{
+    pid_config_t config = {
+        .kp = FIX16_FROM_FLOAT(ZONE_PID_KP),
+        .ki = FIX16_FROM_FLOAT(ZONE_PID_KI),
+        .kd = FIX16_FROM_FLOAT(ZONE_PID_KD),
+        .out_min = FIX16_FROM_INT(-100),
+        .out_max = FIX16_FROM_INT(100),
+        .rate_limit = FIX16_FROM_FLOAT(ZONE_PID_RATE_LIMIT),
+        .derivative_alpha = FIX16_FROM_FLOAT(ZONE_PID_D_ALPHA),
+        .period_ms = CONFIG_CONTROL_PID_PERIOD_MS
+    };
+
+    owned_mask = 0;
+    for (int z = 0; z < CLIMATE_ZONES_MAX; z++) {
+        memset(&loops[z], 0, sizeof(loops[z]));
+        pid_init(&loops[z].pid, &config);
+        if (manual) pid_set_manual(&loops[z].pid, 0);
+        loops[z].output.temperature = NAN;
+        if (z < zone_count) owned_mask |= zones[z].fan_mask | zones[z].heater_mask;
+    }
+}
+
+/* All zones in one pass on the shared PID period */
+static void climate_zone_tick(void *arg)
+{
+    task_timing_begin(&zone_timing);
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+
+    for (int z = 0; z < zone_count; z++) {
+        zone_loop_t *loop = &loops[z];
+        if (!loop->measurement_valid) continue;
+        fix16_t setpoint = FIX16_FROM_FLOAT(zones[z].temp_optimal);
+        zone_apply_demand(loop, pid_update(&loop->pid, setpoint, loop->measurement));
+    }
+
+    xSemaphoreGive(zone_mutex);
+    task_timing_end(&zone_timing);
+}
+
+static esp_err_t zone_validate(const climate_zone_config_t *list, uint8_t count)
+{
+    if (count > CLIMATE_ZONES_MAX) return ESP_ERR_INVALID_SIZE;
+
+    actuator_data_t *actuators;
+    uint8_t actuator_count;
+    actuator_get_all(&actuators, &actuator_count);
+
+    uint32_t claimed = 0;
+    for (int z = 0; z < count; z++) {
+        const climate_zone_config_t *zone = &list[z];
+        if (zone->sensor_count == 0 || zone->sensor_count > CLIMATE_ZONE_SENSORS_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!(zone->temp_min < zone->temp_optimal && zone->temp_optimal < zone->temp_max)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        /* Each actuator belongs to at most one zone, as a fan or as a heater */
+        uint32_t mask = zone->fan_mask | zone->heater_mask;
+        if ((zone->fan_mask & zone->heater_mask) || (mask & claimed)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint32_t found = 0;
+        for (int a = 0; a < actuator_count; a++) {
+            uint8_t id = actuators[a].id;
+            if (id >= 32 || !(mask & (1u << id))) continue;
+            actuator_type_t expected = (zone->fan_mask & (1u << id)) ? ACTUATOR_TYPE_FAN : ACTUATOR_TYPE_HEATER;
+            if (actuators[a].type != expected) return ESP_ERR_INVALID_ARG;
+            found |= 1u << id;
+        }
+        if (found != mask) return ESP_ERR_NOT_FOUND;
+        claimed |= mask;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t zone_save(const climate_zone_config_t *list, uint8_t count)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+
+    if (count == 0) {
+        err = nvs_erase_key(handle, NVS_KEY_TABLE);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    } else {
+        err = nvs_set_blob(handle, NVS_KEY_TABLE, list, count * sizeof(climate_zone_config_t));
+    }
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t climate_zone_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    zone_mutex = xSemaphoreCreateMutex();
+    if (zone_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create zone mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t size = sizeof(zones);
+    uint8_t count = 0;
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        if (nvs_get_blob(handle, NVS_KEY_TABLE, zones, &size) == ESP_OK &&
+            size % sizeof(climate_zone_config_t) == 0) {
+            count = size / sizeof(climate_zone_config_t);
+        }
+        nvs_close(handle);
+    }
+    if (count > 0 && zone_validate(zones, count) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored zones invalid, ignored");
+        count = 0;
+    }
+    zone_count = count;
+    zone_reset_loops();
+
+    task_timing_register(&zone_timing, "climate_zone", CONFIG_CONTROL_PID_PERIOD_MS);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = climate_zone_tick,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "climate_zone"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &zone_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(zone_timer, (uint64_t)CONFIG_CONTROL_PID_PERIOD_MS * 1000);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start zone timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(zone_mutex);
+        zone_mutex = NULL;
+        return err;
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "Climate zones: %d configured", zone_count);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_zone_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    initialized = false;
+    esp_timer_stop(zone_timer);
+    esp_timer_delete(zone_timer);
+    zone_timer = NULL;
+    vSemaphoreDelete(zone_mutex);
+    zone_mutex = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t climate_zone_set(const climate_zone_config_t *list, uint8_t count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL && count > 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = zone_validate(list, count);
+    if (err != ESP_OK) return err;
+
+    err = zone_save(list, count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store zones: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    if (count > 0) {
+        memcpy(zones, list, count * sizeof(climate_zone_config_t));
+    }
+    zone_count = count;
+    zone_reset_loops();
+    xSemaphoreGive(zone_mutex);
+
+    ESP_LOGI(TAG, "Zones updated: %d zones", count);
+    return ESP_OK;
+}
+
+esp_err_t climate_zone_get(climate_zone_config_t *list, uint8_t max_count, uint8_t *count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    *count = zone_count < max_count ? zone_count : max_count;
+    memcpy(list, zones, *count * sizeof(climate_zone_config_t));
+    xSemaphoreGive(zone_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_zone_clear(void)
+{
+    return climate_zone_set(NULL, 0);
+}
+
+uint8_t climate_zone_count(void)
+{
+    return initialized ? zone_count : 0;
+}
+
+uint32_t climate_zone_owned_mask(void)
+{
+    return initialized ? owned_mask : 0;
+}
+
+void climate_zone_set_measurements(const sensor_data_t *sensors, uint8_t sensor_count,
+                                   float house_temperature)
+{
+    if (!initialized) return;
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    for (int z = 0; z < zone_count; z++) {
+        const climate_zone_config_t *zone = &zones[z];
+        zone_loop_t *loop = &loops[z];
+        float sum = 0.0f;
+        uint8_t healthy = 0;
+
+        for (int s = 0; s < zone->sensor_count; s++) {
+            for (int i = 0; i < sensor_count; i++) {
+                if (sensors[i].id != zone->sensor_ids[s]) continue;
+                if (sensors[i].enabled && sensors[i].status == SENSOR_STATUS_OK) {
+                    sum += sensors[i].value;
+                    healthy++;
+                }
+                break;
+            }
+        }
+
+        bool sensor_ok = healthy > 0;
+        if (sensor_ok != loop->output.sensor_ok && loop->measurement_valid) {
+            if (sensor_ok) {
+                ESP_LOGI(TAG, "Zone %s: sensors recovered", zone->name);
+            } else {
+                ESP_LOGW(TAG, "Zone %s: no healthy sensor, using house temperature", zone->name);
+            }
+        }
+        float temperature = sensor_ok ? sum / healthy : house_temperature;
+        loop->output.temperature = temperature;
+        loop->output.sensor_ok = sensor_ok;
+        loop->measurement = FIX16_FROM_FLOAT(temperature);
+        loop->measurement_valid = true;
+    }
+    xSemaphoreGive(zone_mutex);
+}
+
+esp_err_t climate_zone_get_output(uint8_t zone, climate_zone_output_t *out)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (zone < zone_count) {
+        *out = loops[zone].output;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(zone_mutex);
+
+    return err;
+}
+
+esp_err_t climate_zone_set_manual(bool set_manual)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    manual = set_manual;
+    for (int z = 0; z < zone_count; z++) {
+        zone_loop_t *loop = &loops[z];
+        if (manual) {
+            pid_set_manual(&loop->pid, loop->pid.output);
+        } else {
+            pid_set_auto(&loop->pid, FIX16_FROM_FLOAT(zones[z].temp_optimal), loop->measurement);
+        }
+        loop->output.automatic = loop->pid.automatic;
+    }
+    xSemaphoreGive(zone_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t climate_zone_reset(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(zone_mutex, portMAX_DELAY);
+    for (int z = 0; z < zone_count; z++) {
+        zone_loop_t *loop = &loops[z];
+        pid_reset(&loop->pid);
+        loop->window_elapsed_ms = 0;
+        loop->heater_on_ms = 0;
+        fan_stage_reset(&loop->fan_stage);
+        loop->output.fan_duty = 0;
+        loop->output.heater_duty = 0;
+        loop->output.heater_on = false;
+        loop->output.demand = 0.0f;
+    }
+    xSemaphoreGive(zone_mutex);
+
+    return ESP_OK;
+}
@@ -0,0 +1,190 @@
+#include "control/control_arbiter.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#include "actuators/actuator_sequencer.h"
+#include "utils/config.h"
+
+static const char *TAG = "CONTROL_ARB";
+
+typedef struct {
+    uint8_t actuator_id;
+    actuator_state_t state;
+    uint8_t duty;
+    control_priority_t priority;
+    const char *reason;
+} control_request_t;
+
+/* Winning request per actuator for the cycle in progress */
+static control_request_t requests[CONFIG_MAX_ACTUATORS];
+static uint8_t request_count = 0;
+
+/* Last committed decision per actuator, kept across cycles */
+static control_decision_t decisions[CONFIG_MAX_ACTUATORS];
+static uint8_t decision_count = 0;
+
+static control_decision_t *arbiter_find_decision(uint8_t actuator_id, bool create)
+{
+    for (int i = 0; i < decision_count; i++) {
+        if (decisions[i].actuator_id == actuator_id) {
+            return &decisions[i];
+        }
+    }
+    if (!create || decision_count >= CONFIG_MAX_ACTUATORS) return NULL;
+
+    control_decision_t *decision = &decisions[decision_count++];
+    memset(decision, 0, sizeof(*decision));
+    decision->actuator_id = actuator_id;
+    return decision;
+}
+
+esp_err_t control_arbiter_init(void)
+{
+    memset(requests, 0, sizeof(requests));
+    memset(decisions, 0, sizeof(decisions));
+    request_count = 0;
+    decision_count = 0;
+    return ESP_OK;
+}
+
+void control_arbiter_begin_cycle(void)
+{
+    request_count = 0;
+}
+
+esp_err_t control_arbiter_request(uint8_t actuator_id, actuator_state_t state,
+                                  control_priority_t priority, const char *reason)
+{
+    return control_arbiter_request_duty(actuator_id, state == ACTUATOR_STATE_ON ? 100 : 0,
+                                        priority, reason);
+}
+
+esp_err_t control_arbiter_request_duty(uint8_t actuator_id, uint8_t duty,
+                                       control_priority_t priority, const char *reason)
+{
+    if (duty > 100) duty = 100;
+    actuator_state_t state = duty > 0 ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF;
+
+    for (int i = 0; i < request_count; i++) {
+        if (requests[i].actuator_id == actuator_id) {
+            /* Two ON requests never slow each other down: the winner runs at the higher duty */
+            bool both_on = state == ACTUATOR_STATE_ON && requests[i].state == ACTUATOR_STATE_ON;
+            uint8_t top_duty = both_on && requests[i].duty > duty ? requests[i].duty : duty;
+            if (priority > requests[i].priority) {
+                requests[i].state = state;
+                requests[i].duty = top_duty;
+                requests[i].priority = priority;
+                requests[i].reason = reason;
+            } else if (both_on) {
+                requests[i].duty = top_duty;
+            }
+            return ESP_OK;
+        }
+    }
+
+    if (request_count >= CONFIG_MAX_ACTUATORS) {
+        ESP_LOGW(TAG, "Request table full, dropping request for actuator %d", actuator_id);
+        return ESP_ERR_NO_MEM;
+    }
+
+    control_request_t *request = &requests[request_count++];
+    request->actuator_id = actuator_id;
+    request->state = state;
+    request->duty = duty;
+    request->priority = priority;
+    request->reason = reason;
+
+    return ESP_OK;
+}
+
+static bool arbiter_apply(const control_request_t *request, uint32_t now)
+{
+    actuator_state_t current;
+    if (actuator_get_state(request->actuator_id, &current) != ESP_OK) {
+        return false;
+    }
+    /* A faulted actuator reads ERROR; compare against what its output is driven to */
+    if (current == ACTUATOR_STATE_ERROR) {
+        actuator_get_commanded_state(request->actuator_id, &current);
+    }
+
+    /* Duty is applied first so a start through the sequencer ramps straight to it */
+    if (request->state == ACTUATOR_STATE_ON) {
+        actuator_set_duty_cycle(request->actuator_id, request->duty);
+    }
+
+    bool changed = (current != request->state);
+    if (changed) {
+        actuator_sequencer_request(request->actuator_id, request->state);
+    } else if (request->state != ACTUATOR_STATE_ON) {
+        /* Still off, but a start may be queued from an earlier cycle */
+        actuator_sequencer_cancel(request->actuator_id);
+    }
+
+    control_decision_t *decision = arbiter_find_decision(request->actuator_id, true);
+    if (decision == NULL) return changed;
+
+    if (changed || decision->reason != request->reason) {
+        ESP_LOGD(TAG, "Actuator %d -> %s (%s: %s)", request->actuator_id,
+                 actuator_state_to_string(request->state),
+                 control_priority_to_string(request->priority),
+                 request->reason ? request->reason : "-");
+    }
+    decision->state = request->state;
+    decision->duty = request->duty;
+    decision->priority = request->priority;
+    decision->reason = request->reason;
+    decision->timestamp = now;
+    decision->changed = changed;
+
+    return changed;
+}
+
+esp_err_t control_arbiter_commit(void)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint8_t writes = 0;
+
+    /* One expander transfer for the whole cycle; shed loads first, then stage new ones on */
+    actuator_output_begin_batch();
+    for (int i = 0; i < request_count; i++) {
+        if (requests[i].state != ACTUATOR_STATE_ON && arbiter_apply(&requests[i], now)) {
+            writes++;
+        }
+    }
+    for (int i = 0; i < request_count; i++) {
+        if (requests[i].state == ACTUATOR_STATE_ON && arbiter_apply(&requests[i], now)) {
+            writes++;
+        }
+    }
+    actuator_output_end_batch();
+
+    ESP_LOGD(TAG, "Cycle committed: %d requests, %d writes", request_count, writes);
+    request_count = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t control_arbiter_get_decision(uint8_t actuator_id, control_decision_t *decision)
+{
+    if (decision == NULL) return ESP_ERR_INVALID_ARG;
+
+    control_decision_t *found = arbiter_find_decision(actuator_id, false);
+    if (found == NULL) return ESP_ERR_NOT_FOUND;
+
+    memcpy(decision, found, sizeof(control_decision_t));
+    return ESP_OK;
+}
+
+const char* control_priority_to_string(control_priority_t priority)
+{
+    switch (priority) {
+        case CONTROL_PRIORITY_IDLE: return "Idle";
+        case CONTROL_PRIORITY_SERVICE: return "Service";
+        case CONTROL_PRIORITY_HUMIDITY: return "Humidity";
+        case CONTROL_PRIORITY_TEMPERATURE: return "Temperature";
+        case CONTROL_PRIORITY_GAS: return "Gas";
+        default: return "Unknown";
+    }
+}
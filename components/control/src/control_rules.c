@@ -0,0 +1,416 @@
+#include "control/control_rules.h"
+#include "control/control_arbiter.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <nvs.h>
+#include <stdio.h>
+#include <string.h>
+#include "actuators/actuator_manager.h"
+#include "utils/config.h"
+
+static const char *TAG = "CONTROL_RULES";
+
+#define NVS_NAMESPACE       "rules"
+#define NVS_KEY_TABLE       "table"
+
+#define RULES_MAX_SLOTS     32
+#define RULES_MAX_TARGETS   512
+#define RULES_SENSOR_TYPES  16
+
+/* Distinct value source; rules refer to it by slot index */
+typedef struct {
+    uint8_t source;
+    uint8_t arg;
+    uint8_t sensor_index;       /* RULE_SOURCE_SENSOR: cached position in the sensor list */
+} rule_slot_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t type;
+} rule_target_t;
+
+typedef struct {
+    float a;
+    float b;
+    uint16_t target_start;
+    uint8_t target_count;
+    uint8_t slot;
+    uint8_t compare;
+    uint8_t flags;
+    uint8_t duty;               /* 0 = OFF request */
+    uint8_t priority;
+    bool latched;               /* GT/LT hysteresis state */
+    char reason[12];            /* "rule N", referenced by the arbiter */
+} compiled_rule_t;
+
+static control_rule_t rules[CONTROL_RULES_MAX];
+static uint8_t rule_count = 0;
+
+static compiled_rule_t compiled[CONTROL_RULES_MAX];
+static rule_slot_t slots[RULES_MAX_SLOTS];
+static uint8_t slot_count = 0;
+static rule_target_t targets[RULES_MAX_TARGETS];
+static uint16_t target_count = 0;
+static uint16_t aggregate_types = 0;    /* bit per sensor_type_t needed by MIN/MAX/AVG slots */
+
+static control_rules_stats_t stats = {0};
+static SemaphoreHandle_t rules_mutex = NULL;
+static volatile bool initialized = false;
+
+static uint8_t rules_slot_for(const control_rule_t *rule)
+{
+    uint8_t arg = rule->source == RULE_SOURCE_HOUR ? 0 : rule->source_arg;
+    for (uint8_t i = 0; i < slot_count; i++) {
+        if (slots[i].source == rule->source && slots[i].arg == arg) {
+            return i;
+        }
+    }
+    if (slot_count >= RULES_MAX_SLOTS) return UINT8_MAX;
+
+    slots[slot_count].source = rule->source;
+    slots[slot_count].arg = arg;
+    slots[slot_count].sensor_index = 0;
+    if (rule->source >= RULE_SOURCE_MIN && rule->source <= RULE_SOURCE_AVG) {
+        aggregate_types |= 1u << arg;
+    }
+    return slot_count++;
+}
+
+/* Must be called with rules_mutex held */
+static void rules_compile(void)
+{
+    actuator_data_t *actuators;
+    uint8_t actuator_count;
+    actuator_get_all(&actuators, &actuator_count);
+
+    slot_count = 0;
+    target_count = 0;
+    aggregate_types = 0;
+
+    for (int r = 0; r < rule_count; r++) {
+        const control_rule_t *rule = &rules[r];
+        compiled_rule_t *out = &compiled[r];
+
+        memset(out, 0, sizeof(*out));
+        out->a = rule->a;
+        out->b = rule->b;
+        out->compare = rule->compare;
+        out->flags = rule->flags;
+        out->priority = rule->priority;
+        out->duty = rule->action == RULE_ACTION_DUTY ? rule->duty :
+                    (rule->action == RULE_ACTION_ON ? 100 : 0);
+        snprintf(out->reason, sizeof(out->reason), "rule %d", r);
+
+        out->slot = rules_slot_for(rule);
+        if (out->slot == UINT8_MAX) {
+            ESP_LOGW(TAG, "Rule %d: too many distinct sources, rule disabled", r);
+            continue;
+        }
+
+        /* Actions of AND-joined rules are never taken */
+        if (rule->flags & RULE_FLAG_AND) continue;
+
+        out->target_start = target_count;
+        for (int a = 0; a < actuator_count; a++) {
+            bool match = (rule->flags & RULE_FLAG_GROUP) ? actuators[a].type == rule->target
+                                                         : actuators[a].id == rule->target;
+            if (!match) continue;
+            if (target_count >= RULES_MAX_TARGETS) {
+                ESP_LOGW(TAG, "Rule %d: target table full, targets truncated", r);
+                break;
+            }
+            targets[target_count].id = actuators[a].id;
+            targets[target_count].type = actuators[a].type;
+            target_count++;
+        }
+        out->target_count = target_count - out->target_start;
+    }
+
+    stats.rule_count = rule_count;
+    stats.slot_count = slot_count;
+    stats.target_count = target_count;
+}
+
+static esp_err_t rules_validate(const control_rule_t *list, uint8_t count)
+{
+    if (count > CONTROL_RULES_MAX) return ESP_ERR_INVALID_SIZE;
+    for (int i = 0; i < count; i++) {
+        const control_rule_t *rule = &list[i];
+        if (rule->source > RULE_SOURCE_HOUR || rule->compare > RULE_CMP_OUT ||
+            rule->action > RULE_ACTION_DUTY || rule->priority >= CONTROL_PRIORITY_GAS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (rule->source >= RULE_SOURCE_MIN && rule->source <= RULE_SOURCE_AVG &&
+            rule->source_arg >= RULES_SENSOR_TYPES) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (rule->action == RULE_ACTION_DUTY && (rule->duty == 0 || rule->duty > 100)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!(rule->flags & RULE_FLAG_GROUP) && rule->target >= CONFIG_MAX_ACTUATORS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    /* An AND must have a rule to join */
+    if (count > 0 && (list[count - 1].flags & RULE_FLAG_AND)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t rules_save(const control_rule_t *list, uint8_t count)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+
+    if (count == 0) {
+        err = nvs_erase_key(handle, NVS_KEY_TABLE);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    } else {
+        err = nvs_set_blob(handle, NVS_KEY_TABLE, list, count * sizeof(control_rule_t));
+    }
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t control_rules_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    rules_mutex = xSemaphoreCreateMutex();
+    if (rules_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create rules mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Load straight into the table; a blob that fails validation is dropped */
+    size_t size = sizeof(rules);
+    uint8_t count = 0;
+    nvs_handle_t handle;
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        if (nvs_get_blob(handle, NVS_KEY_TABLE, rules, &size) == ESP_OK &&
+            size % sizeof(control_rule_t) == 0) {
+            count = size / sizeof(control_rule_t);
+        }
+        nvs_close(handle);
+    }
+    if (count > 0 && rules_validate(rules, count) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored rules invalid, ignored");
+        count = 0;
+    }
+    rule_count = count;
+    rules_compile();
+    xSemaphoreGive(rules_mutex);
+
+    initialized = true;
+    ESP_LOGI(TAG, "Rules loaded: %d rules, %d sources, %d targets", rule_count, slot_count, target_count);
+
+    return ESP_OK;
+}
+
+esp_err_t control_rules_set(const control_rule_t *list, uint8_t count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL && count > 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = rules_validate(list, count);
+    if (err != ESP_OK) return err;
+
+    err = rules_save(list, count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store rules: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    if (count > 0) {
+        memcpy(rules, list, count * sizeof(control_rule_t));
+    }
+    rule_count = count;
+    rules_compile();
+    stats.max_eval_us = 0;
+    xSemaphoreGive(rules_mutex);
+
+    ESP_LOGI(TAG, "Rules updated: %d rules, %d sources, %d targets", rule_count, slot_count, target_count);
+    return ESP_OK;
+}
+
+esp_err_t control_rules_get(control_rule_t *list, uint8_t max_count, uint8_t *count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    *count = rule_count < max_count ? rule_count : max_count;
+    memcpy(list, rules, *count * sizeof(control_rule_t));
+    xSemaphoreGive(rules_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t control_rules_clear(void)
+{
+    return control_rules_set(NULL, 0);
+}
+
+/* Must be called with rules_mutex held */
+static void rules_fill_slots(const sensor_data_t *sensors, uint8_t sensor_count, float hour,
+                             float *values, bool *valid)
+{
+    float min[RULES_SENSOR_TYPES];
+    float max[RULES_SENSOR_TYPES];
+    float sum[RULES_SENSOR_TYPES];
+    uint8_t count[RULES_SENSOR_TYPES] = {0};
+
+    /* One pass for every aggregate in use */
+    if (aggregate_types != 0) {
+        for (int i = 0; i < sensor_count; i++) {
+            const sensor_data_t *sensor = &sensors[i];
+            uint8_t type = sensor->type;
+            if (type >= RULES_SENSOR_TYPES || !(aggregate_types & (1u << type)) ||
+                !sensor->enabled || sensor->status != SENSOR_STATUS_OK) {
+                continue;
+            }
+            if (count[type] == 0) {
+                min[type] = max[type] = sum[type] = sensor->value;
+            } else {
+                if (sensor->value < min[type]) min[type] = sensor->value;
+                if (sensor->value > max[type]) max[type] = sensor->value;
+                sum[type] += sensor->value;
+            }
+            count[type]++;
+        }
+    }
+
+    for (uint8_t s = 0; s < slot_count; s++) {
+        rule_slot_t *slot = &slots[s];
+        uint8_t arg = slot->arg;
+        valid[s] = true;
+
+        switch (slot->source) {
+            case RULE_SOURCE_SENSOR:
+                /* The sensor list is stable after init; re-find only if it moved */
+                if (slot->sensor_index >= sensor_count || sensors[slot->sensor_index].id != arg) {
+                    valid[s] = false;
+                    for (int i = 0; i < sensor_count; i++) {
+                        if (sensors[i].id == arg) {
+                            slot->sensor_index = i;
+                            valid[s] = true;
+                            break;
+                        }
+                    }
+                }
+                if (valid[s]) {
+                    const sensor_data_t *sensor = &sensors[slot->sensor_index];
+                    valid[s] = sensor->enabled && sensor->status == SENSOR_STATUS_OK;
+                    values[s] = sensor->value;
+                }
+                break;
+            case RULE_SOURCE_MIN:
+                valid[s] = count[arg] > 0;
+                if (valid[s]) values[s] = min[arg];
+                break;
+            case RULE_SOURCE_MAX:
+                valid[s] = count[arg] > 0;
+                if (valid[s]) values[s] = max[arg];
+                break;
+            case RULE_SOURCE_AVG:
+                valid[s] = count[arg] > 0;
+                if (valid[s]) values[s] = sum[arg] / count[arg];
+                break;
+            case RULE_SOURCE_HOUR:
+                values[s] = hour;
+                break;
+            default:
+                valid[s] = false;
+                break;
+        }
+    }
+}
+
+uint8_t control_rules_evaluate(const sensor_data_t *sensors, uint8_t sensor_count,
+                               float hour, uint32_t auto_types)
+{
+    if (!initialized || rule_count == 0) return 0;
+
+    int64_t start = esp_timer_get_time();
+    float values[RULES_MAX_SLOTS];
+    bool valid[RULES_MAX_SLOTS];
+    uint8_t fired = 0;
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+
+    rules_fill_slots(sensors, sensor_count, hour, values, valid);
+
+    bool chain = true;
+    for (int r = 0; r < rule_count; r++) {
+        compiled_rule_t *rule = &compiled[r];
+        bool cond = false;
+
+        /* A missing or faulty source never satisfies a condition */
+        if (rule->slot < slot_count && valid[rule->slot]) {
+            float v = values[rule->slot];
+            switch (rule->compare) {
+                case RULE_CMP_GT:
+                    rule->latched = rule->latched ? v > rule->a - rule->b : v > rule->a;
+                    cond = rule->latched;
+                    break;
+                case RULE_CMP_LT:
+                    rule->latched = rule->latched ? v < rule->a + rule->b : v < rule->a;
+                    cond = rule->latched;
+                    break;
+                case RULE_CMP_IN:
+                    cond = v >= rule->a && v < rule->b;
+                    break;
+                case RULE_CMP_OUT:
+                    cond = v < rule->a || v >= rule->b;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        chain = chain && cond;
+        if (rule->flags & RULE_FLAG_AND) continue;
+
+        bool hit = chain;
+        chain = true;
+        if (!hit && !(rule->flags & RULE_FLAG_ELSE)) continue;
+
+        uint8_t duty = hit ? rule->duty : 0;
+        for (uint16_t t = rule->target_start; t < rule->target_start + rule->target_count; t++) {
+            if (auto_types & (1u << targets[t].type)) {
+                control_arbiter_request_duty(targets[t].id, duty, (control_priority_t)rule->priority,
+                                             rule->reason);
+            }
+        }
+        if (hit) fired++;
+    }
+
+    xSemaphoreGive(rules_mutex);
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    stats.fired = fired;
+    stats.last_eval_us = elapsed;
+    if (elapsed > stats.max_eval_us) stats.max_eval_us = elapsed;
+
+    return fired;
+}
+
+esp_err_t control_rules_get_stats(control_rules_stats_t *out)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(rules_mutex);
+
+    return ESP_OK;
+}
@@ -0,0 +1,367 @@
+#include "control/control_schedule.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#include <nvs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "utils/config.h"
+
+static const char *TAG = "CONTROL_SCHED";
+
+#define SECONDS_PER_DAY     86400
+#define NVS_NAMESPACE       "schedule"
+#define NVS_KEY_EVENTS      "events"
+
+/* The timer is re-armed at least this often so clock adjustments are picked up */
+#define MAX_ARM_INTERVAL_S  3600
+
+typedef struct {
+    uint32_t time_of_day;
+    uint8_t actuator_id;
+    bool on;
+} schedule_point_t;
+
+static schedule_event_t events[SCHEDULE_MAX_EVENTS];
+static uint8_t event_count = 0;
+
+static schedule_point_t points[SCHEDULE_MAX_COMPILED];
+static uint16_t point_count = 0;
+
+/* Latched state per actuator ID, valid where owned[] is set */
+static bool owned[CONFIG_MAX_ACTUATORS];
+static bool latched_on[CONFIG_MAX_ACTUATORS];
+
+static SemaphoreHandle_t schedule_mutex = NULL;
+static esp_timer_handle_t schedule_timer = NULL;
+static TaskHandle_t notify_task = NULL;
+static volatile bool initialized = false;
+
+static const schedule_event_t default_events[] = {
+    /* Feeders: 06:00, 12:00 and 18:00 for 30 s */
+    { .time_of_day = 6 * 3600,  .target = ACTUATOR_TYPE_FEEDER, .flags = SCHEDULE_FLAG_GROUP,
+      .action = SCHEDULE_ACTION_ON, .duration_s = 30 },
+    { .time_of_day = 12 * 3600, .target = ACTUATOR_TYPE_FEEDER, .flags = SCHEDULE_FLAG_GROUP,
+      .action = SCHEDULE_ACTION_ON, .duration_s = 30 },
+    { .time_of_day = 18 * 3600, .target = ACTUATOR_TYPE_FEEDER, .flags = SCHEDULE_FLAG_GROUP,
+      .action = SCHEDULE_ACTION_ON, .duration_s = 30 },
+};
+
+static int point_compare(const void *a, const void *b)
+{
+    const schedule_point_t *pa = a;
+    const schedule_point_t *pb = b;
+    if (pa->time_of_day != pb->time_of_day) {
+        return pa->time_of_day < pb->time_of_day ? -1 : 1;
+    }
+    /* OFF before ON at the same instant, matching the arbiter's commit order */
+    return (int)pa->on - (int)pb->on;
+}
+
+static uint32_t schedule_now(int64_t *usec_into_second)
+{
+    struct timeval tv;
+    struct tm timeinfo;
+    gettimeofday(&tv, NULL);
+    time_t now = tv.tv_sec;
+    localtime_r(&now, &timeinfo);
+    if (usec_into_second) *usec_into_second = tv.tv_usec;
+    return (uint32_t)(timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec);
+}
+
+/* First compiled point strictly after time_of_day; point_count if none today */
+static uint16_t schedule_upper_bound(uint32_t time_of_day)
+{
+    uint16_t low = 0;
+    uint16_t high = point_count;
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+        if (points[mid].time_of_day <= time_of_day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool schedule_add_point(uint32_t time_of_day, uint8_t actuator_id, bool on)
+{
+    if (point_count >= SCHEDULE_MAX_COMPILED) return false;
+    points[point_count].time_of_day = time_of_day % SECONDS_PER_DAY;
+    points[point_count].actuator_id = actuator_id;
+    points[point_count].on = on;
+    point_count++;
+    return true;
+}
+
+/* Must be called with schedule_mutex held */
+static void schedule_compile(void)
+{
+    actuator_data_t *actuators;
+    uint8_t actuator_count;
+    actuator_get_all(&actuators, &actuator_count);
+
+    point_count = 0;
+    memset(owned, 0, sizeof(owned));
+    memset(latched_on, 0, sizeof(latched_on));
+
+    for (int e = 0; e < event_count; e++) {
+        const schedule_event_t *event = &events[e];
+        bool on = event->action == SCHEDULE_ACTION_ON;
+
+        for (int a = 0; a < actuator_count; a++) {
+            bool match = (event->flags & SCHEDULE_FLAG_GROUP) ? actuators[a].type == event->target
+                                                              : actuators[a].id == event->target;
+            if (!match || actuators[a].id >= CONFIG_MAX_ACTUATORS) continue;
+
+            bool ok = schedule_add_point(event->time_of_day, actuators[a].id, on);
+            if (ok && on && event->duration_s > 0) {
+                ok = schedule_add_point(event->time_of_day + event->duration_s, actuators[a].id, false);
+            }
+            if (!ok) {
+                ESP_LOGW(TAG, "Compiled table full, schedule truncated");
+                break;
+            }
+            owned[actuators[a].id] = true;
+        }
+    }
+
+    qsort(points, point_count, sizeof(schedule_point_t), point_compare);
+}
+
+/* Must be called with schedule_mutex held */
+static void schedule_latch_at(uint32_t time_of_day)
+{
+    /* The day wraps: start from the state left by yesterday's last points */
+    for (uint16_t i = 0; i < point_count; i++) {
+        latched_on[points[i].actuator_id] = points[i].on;
+    }
+    uint16_t end = schedule_upper_bound(time_of_day);
+    for (uint16_t i = 0; i < end; i++) {
+        latched_on[points[i].actuator_id] = points[i].on;
+    }
+}
+
+/* Must be called with schedule_mutex held */
+static void schedule_arm(void)
+{
+    esp_timer_stop(schedule_timer);
+    if (point_count == 0) return;
+
+    int64_t usec = 0;
+    uint32_t now = schedule_now(&usec);
+    uint16_t next = schedule_upper_bound(now);
+    uint32_t next_time = next < point_count ? points[next].time_of_day
+                                            : points[0].time_of_day + SECONDS_PER_DAY;
+
+    uint32_t wait_s = next_time - now;
+    if (wait_s > MAX_ARM_INTERVAL_S) wait_s = MAX_ARM_INTERVAL_S;
+
+    int64_t wait_us = (int64_t)wait_s * 1000000 - usec;
+    if (wait_us < 1000) wait_us = 1000;
+    esp_timer_start_once(schedule_timer, (uint64_t)wait_us);
+}
+
+static void schedule_timer_callback(void *arg)
+{
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+
+    /* Re-latch from the table rather than stepping one point: correct even after a clock jump */
+    bool previous[CONFIG_MAX_ACTUATORS];
+    memcpy(previous, latched_on, sizeof(previous));
+    schedule_latch_at(schedule_now(NULL));
+    bool changed = memcmp(previous, latched_on, sizeof(previous)) != 0;
+
+    schedule_arm();
+    TaskHandle_t task = notify_task;
+
+    xSemaphoreGive(schedule_mutex);
+
+    if (changed && task != NULL) {
+        xTaskNotify(task, CONTROL_NOTIFY_SCHEDULE, eSetBits);
+    }
+}
+
+static esp_err_t schedule_validate(const schedule_event_t *list, uint8_t count)
+{
+    if (count > SCHEDULE_MAX_EVENTS) return ESP_ERR_INVALID_SIZE;
+    for (int i = 0; i < count; i++) {
+        if (list[i].time_of_day >= SECONDS_PER_DAY || list[i].action > SCHEDULE_ACTION_ON) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!(list[i].flags & SCHEDULE_FLAG_GROUP) && list[i].target >= CONFIG_MAX_ACTUATORS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Must be called with schedule_mutex held */
+static void schedule_load_table(const schedule_event_t *list, uint8_t count)
+{
+    memcpy(events, list, count * sizeof(schedule_event_t));
+    event_count = count;
+    schedule_compile();
+    schedule_latch_at(schedule_now(NULL));
+    schedule_arm();
+}
+
+static esp_err_t schedule_save(const schedule_event_t *list, uint8_t count)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_blob(handle, NVS_KEY_EVENTS, list, count * sizeof(schedule_event_t));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t control_schedule_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    schedule_mutex = xSemaphoreCreateMutex();
+    if (schedule_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create schedule mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = schedule_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "schedule"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &schedule_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create schedule timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(schedule_mutex);
+        schedule_mutex = NULL;
+        return err;
+    }
+
+    /* Load the stored table, falling back to the built-in feeding times */
+    schedule_event_t stored[SCHEDULE_MAX_EVENTS];
+    size_t size = sizeof(stored);
+    uint8_t count = 0;
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        if (nvs_get_blob(handle, NVS_KEY_EVENTS, stored, &size) == ESP_OK &&
+            size % sizeof(schedule_event_t) == 0) {
+            count = size / sizeof(schedule_event_t);
+        }
+        nvs_close(handle);
+    }
+
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+    if (count > 0 && schedule_validate(stored, count) == ESP_OK) {
+        schedule_load_table(stored, count);
+    } else {
+        schedule_load_table(default_events, sizeof(default_events) / sizeof(default_events[0]));
+    }
+    xSemaphoreGive(schedule_mutex);
+
+    initialized = true;
+    ESP_LOGI(TAG, "Schedule loaded: %d events, %d switch points", event_count, point_count);
+
+    return ESP_OK;
+}
+
+esp_err_t control_schedule_set_notify_task(TaskHandle_t task)
+{
+    notify_task = task;
+    return ESP_OK;
+}
+
+esp_err_t control_schedule_set_events(const schedule_event_t *list, uint8_t count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL && count > 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = schedule_validate(list, count);
+    if (err != ESP_OK) return err;
+
+    err = schedule_save(list, count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store schedule: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+    schedule_load_table(list, count);
+    TaskHandle_t task = notify_task;
+    xSemaphoreGive(schedule_mutex);
+
+    if (task != NULL) {
+        xTaskNotify(task, CONTROL_NOTIFY_SCHEDULE, eSetBits);
+    }
+
+    ESP_LOGI(TAG, "Schedule updated: %d events, %d switch points", count, point_count);
+    return ESP_OK;
+}
+
+esp_err_t control_schedule_get_events(schedule_event_t *list, uint8_t max_count, uint8_t *count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (list == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+    *count = event_count < max_count ? event_count : max_count;
+    memcpy(list, events, *count * sizeof(schedule_event_t));
+    xSemaphoreGive(schedule_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t control_schedule_reset_default(void)
+{
+    return control_schedule_set_events(default_events, sizeof(default_events) / sizeof(default_events[0]));
+}
+
+esp_err_t control_schedule_resync(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    /* Call after the wall clock was set or the actuator set changed */
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+    schedule_compile();
+    schedule_latch_at(schedule_now(NULL));
+    schedule_arm();
+    xSemaphoreGive(schedule_mutex);
+
+    return ESP_OK;
+}
+
+bool control_schedule_get_state(uint8_t actuator_id, actuator_state_t *state)
+{
+    if (!initialized || actuator_id >= CONFIG_MAX_ACTUATORS || !owned[actuator_id]) {
+        return false;
+    }
+    *state = latched_on[actuator_id] ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF;
+    return true;
+}
+
+esp_err_t control_schedule_get_next(uint32_t *time_of_day, uint8_t *actuator_id, actuator_state_t *state)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(schedule_mutex, portMAX_DELAY);
+    if (point_count == 0) {
+        xSemaphoreGive(schedule_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint16_t next = schedule_upper_bound(schedule_now(NULL));
+    if (next >= point_count) next = 0;
+    if (time_of_day) *time_of_day = points[next].time_of_day;
+    if (actuator_id) *actuator_id = points[next].actuator_id;
+    if (state) *state = points[next].on ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF;
+    xSemaphoreGive(schedule_mutex);
+
+    return ESP_OK;
+}
@@ -1,12 +1,24 @@
 #include "control/control_system.h"
+#include "control/control_arbiter.h"
+#include "control/climate_pid.h"
+#include "control/adaptive_climate.h"
+#include "control/climate_zone.h"
+#include "control/control_schedule.h"
+#include "control/feed_dispenser.h"
+#include "control/control_rules.h"
+#include "control/fan_stage.h"
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <math.h>
 #include <string.h>
 #include <time.h>
 #include "sensors/sensor_manager.h"
+#include "sensors/heat_index.h"
 #include "actuators/actuator_manager.h"
 #include "utils/config.h"
+#include "utils/task_timing.h"
+#include "utils/metrics.h"
 
 static const char *TAG = "CONTROL_SYS";
 
@@ -14,18 +26,84 @@ static control_state_t control_state = {0};
 static volatile bool initialized = false;
 static volatile bool running = false;
 static TaskHandle_t control_task_handle = NULL;
+static task_timing_t control_timing;
+static metric_t loop_time;
+static metric_t sample_timeouts;
+static const uint32_t loop_bounds_us[] = { 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+
+/* Heat stress stage of the house and of each climate zone, held with hysteresis */
+static heat_stage_t house_heat_stage = HEAT_STAGE_NORMAL;
+static heat_stage_t zone_heat_stage[CLIMATE_ZONES_MAX];
+
+/* Scheduled mode: a temperature limit, once crossed, holds until the reading is
+ * LIMIT_HYSTERESIS_C back inside it; index 0 is the house, 1.. the climate zones */
+#define LIMIT_HYSTERESIS_C      1.0f
+static bool limit_heating[CLIMATE_ZONES_MAX + 1];
+static bool limit_cooling[CLIMATE_ZONES_MAX + 1];
+static fan_stage_t limit_fans[CLIMATE_ZONES_MAX + 1];
+
+/* Ventilation demand ramps from 0 % at the clear level to 100 % at the limit: gas
+ * from GAS_CLEAR_RATIO of its limit, humidity from HUMIDITY_CLEAR_BAND below
+ * humidity_max. Below the limit one fan ventilates; once the limit is crossed all
+ * four run until the reading has cleared. Each law has its own fan stage, so the
+ * fans keep their minimum run and off times. */
+#define GAS_CLEAR_RATIO         0.9f
+#define HUMIDITY_CLEAR_BAND     5.0f    /* %RH */
+#define VENT_FANS               4
+
+typedef struct {
+    fan_stage_t stage;
+    bool all_fans;              /* limit crossed since the fans last stopped */
+} vent_stage_t;
+
+static bool gas_venting;
+static vent_stage_t gas_vent;
+static vent_stage_t humidity_vent;
+
+/* Feeders with a gram target: a scheduled ON edge queues one dispense */
+static bool dispense_window[CONFIG_MAX_ACTUATORS];
+static bool dispense_pending[CONFIG_MAX_ACTUATORS];
 
 static void control_task(void *parameter)
 {
     ESP_LOGI(TAG, "Control task started");
     
+    /* Woken by the sensor layer for each new sample set, by the schedule at switch points
+     * and by the feed dispenser when a feeder must start or has stopped */
+    sensor_subscribe(xTaskGetCurrentTaskHandle());
+    control_schedule_set_notify_task(xTaskGetCurrentTaskHandle());
+    feed_dispenser_set_notify_task(xTaskGetCurrentTaskHandle());
+    
     while (running) {
-        if (!control_state.emergency_stop) {
+        uint32_t bits = 0;
+        TickType_t timeout = pdMS_TO_TICKS(control_state.control_interval_ms + CONFIG_SENSOR_READ_INTERVAL_MS);
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, timeout) != pdTRUE) {
+            metric_inc(&sample_timeouts);
+            ESP_LOGW(TAG, "No sensor data for %lu ms, running on last values",
+                     (unsigned long)(control_state.control_interval_ms + CONFIG_SENSOR_READ_INTERVAL_MS));
+        } else if (bits & SENSOR_NOTIFY_URGENT) {
+            ESP_LOGD(TAG, "Urgent sample set");
+        } else if (bits & CONTROL_NOTIFY_SCHEDULE) {
+            ESP_LOGD(TAG, "Schedule switch point");
+        } else if (bits & CONTROL_NOTIFY_DISPENSE) {
+            ESP_LOGD(TAG, "Feed dispense phase change");
+        }
+        
+        if (running && !control_state.emergency_stop) {
+            /* Sample sets pace the task, so only their passes are timed against the
+             * sampling interval; schedule, dispense and timeout wakes run untimed */
+            bool sampled = (bits & SENSOR_NOTIFY_SAMPLE) != 0;
+            if (sampled) task_timing_begin(&control_timing);
+            uint32_t start = metric_timer_start();
             control_system_update();
+            metric_observe_since(&loop_time, start);
+            if (sampled) task_timing_end(&control_timing);
         }
-        vTaskDelay(pdMS_TO_TICKS(control_state.control_interval_ms));
     }
     
+    feed_dispenser_set_notify_task(NULL);
+    control_schedule_set_notify_task(NULL);
+    sensor_unsubscribe(xTaskGetCurrentTaskHandle());
     ESP_LOGI(TAG, "Control task stopped");
     vTaskDelete(NULL);
 }
@@ -46,6 +124,14 @@ esp_err_t control_system_init(void)
     control_state.last_control_time = 0;
     control_state.control_interval_ms = CONFIG_CONTROL_LOOP_INTERVAL_MS;
     
+    control_arbiter_init();
+    climate_pid_init();
+    adaptive_climate_init();
+    climate_zone_init();
+    control_schedule_init();
+    control_rules_init();
+    feed_dispenser_init();
+    
     initialized = true;
     ESP_LOGI(TAG, "Control system initialized");
     
@@ -56,6 +142,11 @@ esp_err_t control_system_start(void)
 {
     if (!initialized || running) return ESP_ERR_INVALID_STATE;
     
+    task_timing_register(&control_timing, "control_task", CONFIG_SENSOR_READ_INTERVAL_MS);
+    metric_register_histogram(&loop_time, "control_loop_us", "One control pass over a sample set",
+                              loop_bounds_us, sizeof(loop_bounds_us) / sizeof(loop_bounds_us[0]));
+    metric_register(&sample_timeouts, "control_sample_timeouts_total", "Control passes run without a new sample set",
+                    METRIC_COUNTER);
     running = true;
     xTaskCreate(control_task, "control_task", 4096, NULL, 5, &control_task_handle);
     
@@ -78,6 +169,11 @@ esp_err_t control_system_stop(void)
 esp_err_t control_system_set_mode(control_mode_t mode)
 {
     control_state.mode = mode;
+    /* Outside AUTO the PID holds its output so returning to AUTO is bumpless;
+     * ADAPTIVE keeps it running as the fallback until the thermal model is valid */
+    climate_pid_set_manual(mode != CONTROL_MODE_AUTO && mode != CONTROL_MODE_ADAPTIVE);
+    climate_zone_set_manual(mode != CONTROL_MODE_AUTO && mode != CONTROL_MODE_ADAPTIVE);
+    adaptive_climate_set_enabled(mode == CONTROL_MODE_ADAPTIVE);
     ESP_LOGI(TAG, "Control mode set to: %d", mode);
     return ESP_OK;
 }
@@ -88,14 +184,44 @@ esp_err_t control_system_get_mode(control_mode_t *mode)
     return ESP_OK;
 }
 
+static uint32_t control_auto_types(void);
+
+/* Hand the adaptive model the temperatures and the heater/fan duty actually applied */
+static void control_feed_thermal_model(float temperature, float outdoor)
+{
+    actuator_data_t *actuators;
+    uint8_t count;
+    float heat = 0.0f;
+    float fan = 0.0f;
+    uint8_t heaters = 0;
+    uint8_t fans = 0;
+    
+    /* Zoned actuators act on their own zone, not on the house-wide reading */
+    uint32_t zoned = climate_zone_owned_mask();
+    
+    actuator_get_all(&actuators, &count);
+    for (int i = 0; i < count; i++) {
+        if (actuators[i].id < 32 && (zoned & (1u << actuators[i].id))) continue;
+        if (actuators[i].type == ACTUATOR_TYPE_HEATER) {
+            heat += actuators[i].output_on ? 1.0f : 0.0f;
+            heaters++;
+        } else if (actuators[i].type == ACTUATOR_TYPE_FAN) {
+            fan += actuators[i].output_on ? actuators[i].duty_cycle / 100.0f : 0.0f;
+            fans++;
+        }
+    }
+    
+    adaptive_climate_set_measurement(temperature, outdoor,
+                                     heaters > 0 ? heat / heaters : 0.0f,
+                                     fans > 0 ? fan / fans : 0.0f);
+}
+
 esp_err_t control_system_update(void)
 {
-    if (control_state.mode != CONTROL_MODE_AUTO) {
+    if (control_state.mode == CONTROL_MODE_MANUAL) {
         return ESP_OK;
     }
     
-    sensor_trigger_read_all();
-    
     uint8_t sensor_count = 0;
     sensor_data_t *sensors = NULL;
     sensor_read_all(&sensors, &sensor_count);
@@ -107,6 +233,8 @@ esp_err_t control_system_update(void)
     float co = 0.0f;
     float light = 500.0f;
     float water_level = 50.0f;
+    float outdoor = NAN;
+    float thi = NAN;
     
     for (int i = 0; i < sensor_count; i++) {
         if (strcmp(sensors[i].name, "Temperature_1") == 0) {
@@ -122,6 +250,12 @@ esp_err_t control_system_update(void)
         } else if (sensors[i].type == SENSOR_TYPE_WATER_LEVEL) {
             water_level = sensors[i].value;
         }
+        if (sensors[i].id == CONFIG_CONTROL_OUTDOOR_SENSOR_ID && sensors[i].status == SENSOR_STATUS_OK) {
+            outdoor = sensors[i].value;
+        }
+        if (sensors[i].id == HEAT_INDEX_SENSOR_ID && sensors[i].status == SENSOR_STATUS_OK) {
+            thi = sensors[i].value;
+        }
     }
     
     /* Get current hour from system time */
@@ -131,9 +265,38 @@ esp_err_t control_system_update(void)
     localtime_r(&now, &timeinfo);
     uint8_t current_hour = (uint8_t)timeinfo.tm_hour;
     
+    climate_pid_set_measurement(temperature);
+    climate_zone_set_measurements(sensors, sensor_count, temperature);
+    control_feed_thermal_model(temperature, outdoor);
+    
+    /* Laws below submit requests; actuators are written once in the commit */
+    control_arbiter_begin_cycle();
+    
+    /* Time-of-day program, and gravimetric dispenses it has triggered */
+    control_schedule_logic();
+    control_dispense_logic();
+    
+    if (control_state.mode == CONTROL_MODE_SCHEDULED) {
+        /* Only the program and the safety laws run in scheduled mode: the temperature
+         * limits override the program, and fans and heaters it does not hold go off */
+        if (control_state.auto_fan_enabled || control_state.auto_heater_enabled) {
+            control_temperature_limits_logic(temperature, isnan(thi) ? NAN : humidity, thi);
+        }
+        control_gas_logic(ammonia, co2, co);
+        control_arbiter_commit();
+        control_state.last_control_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        return ESP_OK;
+    }
+    
+    /* Site rules from NVS go first so they win ties with the built-in laws below */
+    control_rules_evaluate(sensors, sensor_count,
+                           timeinfo.tm_hour + timeinfo.tm_min / 60.0f, control_auto_types());
+    
     /* Temperature control: fans for cooling, heaters for heating */
     if (control_state.auto_fan_enabled || control_state.auto_heater_enabled) {
-        control_temperature_logic(temperature, humidity);
+        /* A valid index means the humidity reading is good enough for the zones too */
+        control_zone_logic(isnan(thi) ? NAN : humidity);
+        control_temperature_logic(temperature, thi);
     }
     
     /* Gas ventilation */
@@ -154,11 +317,13 @@ esp_err_t control_system_update(void)
         control_water_logic(water_level);
     }
     
-    /* Feeding schedule */
+    /* Feeders not covered by the program stay off */
     if (control_state.auto_feeder_enabled) {
         control_feeder_logic();
     }
     
+    control_arbiter_commit();
+    
     control_state.last_control_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
     
     return ESP_OK;
@@ -169,7 +334,10 @@ esp_err_t control_system_emergency_stop(void)
     ESP_LOGW(TAG, "EMERGENCY STOP ACTIVATED");
     
     control_state.emergency_stop = true;
+    feed_dispenser_abort();
     actuator_emergency_stop_all();
+    climate_pid_reset();
+    climate_zone_reset();
     
     return ESP_OK;
 }
@@ -223,49 +391,199 @@ esp_err_t control_system_get_state(control_state_t *state)
     return ESP_OK;
 }
 
-void control_temperature_logic(float temperature, float humidity)
+static const char *const heat_stage_reasons[] = {
+    "temperature in range", "heat stress alert", "heat stress danger", "heat stress emergency"
+};
+
+/* Track the heat stress stage and log its transitions */
+static heat_stage_t control_heat_stage(const char *where, float thi, heat_stage_t previous)
 {
-    if (temperature > poultry_config.temp_max) {
-        /* Too hot: turn on fans for cooling */
-        for (int i = 0; i < 4; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_ON);
-        }
-        /* Turn off heaters */
-        for (int i = 4; i < 6; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_OFF);
-        }
-    } else if (temperature < poultry_config.temp_min) {
-        /* Too cold: turn on heaters */
-        for (int i = 4; i < 6; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_ON);
-        }
-        /* Turn off fans */
-        for (int i = 0; i < 4; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_OFF);
+    heat_stage_t stage = heat_index_stage(thi, previous);
+    if (stage > previous) {
+        ESP_LOGW(TAG, "%s: heat stress %s (THI %.1f)", where, heat_stage_to_string(stage), thi);
+    } else if (stage < previous) {
+        ESP_LOGI(TAG, "%s: heat stress %s (THI %.1f)", where, heat_stage_to_string(stage), thi);
+    }
+    return stage;
+}
+
+/* Temperature law for one set of fans and heaters (bit per actuator ID). With a valid
+ * temperature-humidity index, heat stress stages 1-3 run a third, two thirds and then all of the
+ * fans at full speed in ID order instead of the temp_max limit; without it, temp_max applies */
+static void control_climate_apply(uint32_t fans, uint32_t heaters, float temperature,
+                                  float thi, heat_stage_t stage, float temp_min, float temp_max,
+                                  bool demand_ready, uint8_t fan_duty, bool heater_on,
+                                  const char *cooling_reason, const char *heating_reason)
+{
+    bool staged = !isnan(thi);
+    int staged_fans = staged ? (__builtin_popcount(fans) * (int)stage + 2) / 3 : 0;
+    int fan_index = 0;
+    
+    for (int i = 0; i < 32; i++) {
+        bool fan = fans & (1u << i);
+        bool heater = heaters & (1u << i);
+        if (!fan && !heater) continue;
+        
+        if (staged && stage > HEAT_STAGE_NORMAL) {
+            /* Heat stress: heaters off, the first fans of the stage at full speed, the rest on demand */
+            if (heater) {
+                control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_TEMPERATURE, heat_stage_reasons[stage]);
+            } else if (fan_index++ < staged_fans) {
+                control_arbiter_request(i, ACTUATOR_STATE_ON, CONTROL_PRIORITY_TEMPERATURE, heat_stage_reasons[stage]);
+            } else if (demand_ready && fan_duty > 0) {
+                control_arbiter_request_duty(i, fan_duty, CONTROL_PRIORITY_TEMPERATURE, cooling_reason);
+            } else {
+                control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_IDLE, heat_stage_reasons[stage]);
+            }
+        } else if (!staged && temperature > temp_max) {
+            /* Too hot: fans on for cooling, heaters off */
+            control_arbiter_request(i, fan ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF,
+                                    CONTROL_PRIORITY_TEMPERATURE, "temperature above max");
+        } else if (temperature < temp_min) {
+            /* Too cold: heaters on, fans off */
+            control_arbiter_request(i, heater ? ACTUATOR_STATE_ON : ACTUATOR_STATE_OFF,
+                                    CONTROL_PRIORITY_TEMPERATURE, "temperature below min");
+        } else if (demand_ready && fan && fan_duty > 0) {
+            control_arbiter_request_duty(i, fan_duty, CONTROL_PRIORITY_TEMPERATURE, cooling_reason);
+        } else if (demand_ready && heater && heater_on) {
+            control_arbiter_request(i, ACTUATOR_STATE_ON, CONTROL_PRIORITY_TEMPERATURE, heating_reason);
+        } else {
+            /* No demand: lower priorities may override */
+            control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_IDLE, "temperature in range");
         }
+    }
+}
+
+void control_temperature_logic(float temperature, float thi)
+{
+    climate_pid_output_t pid;
+    bool pid_ready = climate_pid_get_output(&pid) == ESP_OK;
+    adaptive_output_t plan;
+    bool plan_ready = control_state.mode == CONTROL_MODE_ADAPTIVE &&
+                      adaptive_climate_get_output(&plan) == ESP_OK && plan.active;
+    
+    house_heat_stage = control_heat_stage("House", thi, house_heat_stage);
+    
+    /* Fans 0-3 and heaters 4-5, less those run by a climate zone */
+    uint32_t zoned = climate_zone_owned_mask();
+    uint32_t fans = 0x0Fu & ~zoned;
+    uint32_t heaters = 0x30u & ~zoned;
+    
+    if (plan_ready) {
+        /* Adaptive mode: follow the predictive plan once the model is identified */
+        control_climate_apply(fans, heaters, temperature, thi, house_heat_stage,
+                              poultry_config.temp_min, poultry_config.temp_max,
+                              true, plan.fan_duty, plan.heater_on, "predictive cooling", "predictive heating");
     } else {
-        /* Temperature in acceptable range: turn off both */
-        for (int i = 0; i < 4; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_OFF);
-        }
-        for (int i = 4; i < 6; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_OFF);
+        /* PID tracks temp_optimal with fan PWM and time-proportioned heaters */
+        control_climate_apply(fans, heaters, temperature, thi, house_heat_stage,
+                              poultry_config.temp_min, poultry_config.temp_max,
+                              pid_ready, pid.fan_duty, pid.heater_on, "PID cooling", "PID heating");
+    }
+}
+
+/* Scheduled mode's stand-in for the PID: full cooling or heating while a limit is latched,
+ * and cooling through heat stress. The fan stage keeps the fans' minimum run and off times,
+ * so a heat stress alert waits for it; the higher stages do not. */
+static void control_latched_limits(int index, float temperature, float temp_min, float temp_max,
+                                   heat_stage_t *stage, uint8_t *fan_duty, bool *heater_on)
+{
+    float heat_until = temp_min + (limit_heating[index] ? LIMIT_HYSTERESIS_C : 0.0f);
+    float cool_until = temp_max - (limit_cooling[index] ? LIMIT_HYSTERESIS_C : 0.0f);
+    limit_heating[index] = temperature < heat_until;
+    limit_cooling[index] = temperature > cool_until;
+    
+    int32_t cooling = limit_cooling[index] || *stage > HEAT_STAGE_NORMAL ? 100 : 0;
+    *fan_duty = fan_stage_update(&limit_fans[index], cooling, xTaskGetTickCount() * portTICK_PERIOD_MS);
+    *heater_on = limit_heating[index] && *fan_duty == 0;
+    if (*stage == HEAT_STAGE_ALERT && *fan_duty == 0) *stage = HEAT_STAGE_NORMAL;
+}
+
+/* Each zone runs the same law on its own reading, index, limits and, when regulating, PID */
+static void control_zones_apply(float humidity, bool regulate)
+{
+    climate_zone_config_t zones[CLIMATE_ZONES_MAX];
+    climate_zone_output_t output;
+    uint8_t count = 0;
+    
+    if (climate_zone_get(zones, CLIMATE_ZONES_MAX, &count) != ESP_OK) return;
+    
+    for (int z = 0; z < count; z++) {
+        if (climate_zone_get_output(z, &output) != ESP_OK || isnan(output.temperature)) continue;
+        float thi = heat_index_thi(output.temperature, humidity);
+        zone_heat_stage[z] = control_heat_stage(zones[z].name, thi, zone_heat_stage[z]);
+        heat_stage_t stage = zone_heat_stage[z];
+        if (!regulate) {
+            control_latched_limits(z + 1, output.temperature, zones[z].temp_min, zones[z].temp_max,
+                                   &stage, &output.fan_duty, &output.heater_on);
         }
+        control_climate_apply(zones[z].fan_mask, zones[z].heater_mask, output.temperature,
+                              thi, stage, zones[z].temp_min, zones[z].temp_max, true,
+                              output.fan_duty, output.heater_on,
+                              regulate ? "zone PID cooling" : "temperature above max",
+                              regulate ? "zone PID heating" : "temperature below min");
     }
 }
 
+void control_zone_logic(float humidity)
+{
+    control_zones_apply(humidity, true);
+}
+
+void control_temperature_limits_logic(float temperature, float humidity, float thi)
+{
+    house_heat_stage = control_heat_stage("House", thi, house_heat_stage);
+    
+    /* The limits and heat stress staging without the PID: in range, fans and heaters
+     * are requested off at idle priority, so only the program can hold them on */
+    heat_stage_t stage = house_heat_stage;
+    uint8_t fan_duty;
+    bool heater_on;
+    control_latched_limits(0, temperature, poultry_config.temp_min, poultry_config.temp_max,
+                           &stage, &fan_duty, &heater_on);
+    
+    uint32_t zoned = climate_zone_owned_mask();
+    control_climate_apply(0x0Fu & ~zoned, 0x30u & ~zoned, temperature, thi, stage,
+                          poultry_config.temp_min, poultry_config.temp_max, true, fan_duty, heater_on,
+                          "temperature above max", "temperature below min");
+    control_zones_apply(humidity, false);
+}
+
+/* 0..100 % of the way from the clear level to the limit */
+static int32_t control_vent_demand(float value, float clear, float limit)
+{
+    if (isnan(value) || value <= clear) return 0;
+    if (value >= limit) return 100;
+    return (int32_t)((value - clear) / (limit - clear) * 100.0f + 0.5f);
+}
+
+/* Returns how many fans to run at *duty */
+static int control_vent_update(vent_stage_t *vent, int32_t demand, bool over_limit, uint8_t *duty)
+{
+    *duty = fan_stage_update(&vent->stage, demand, xTaskGetTickCount() * portTICK_PERIOD_MS);
+    if (over_limit) vent->all_fans = true;
+    if (*duty == 0) vent->all_fans = false;
+    if (*duty == 0) return 0;
+    return vent->all_fans ? VENT_FANS : 1;
+}
+
 void control_humidity_logic(float humidity, float temperature)
 {
-    if (humidity > poultry_config.humidity_max) {
+    int32_t demand = control_vent_demand(humidity, poultry_config.humidity_max - HUMIDITY_CLEAR_BAND,
+                                         poultry_config.humidity_max);
+    uint8_t duty;
+    int fans = control_vent_update(&humidity_vent, demand, humidity > poultry_config.humidity_max, &duty);
+    
+    if (fans > 0) {
         /* Too humid: activate ventilation fans */
-        for (int i = 0; i < 4; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_ON);
+        for (int i = 0; i < fans; i++) {
+            control_arbiter_request_duty(i, duty, CONTROL_PRIORITY_HUMIDITY, "humidity above max");
         }
     } else if (humidity < poultry_config.humidity_min) {
         /* Too dry: reduce ventilation (if not needed for temp) */
         if (temperature >= poultry_config.temp_min && temperature <= poultry_config.temp_max) {
-            for (int i = 0; i < 4; i++) {
-                actuator_set_state(i, ACTUATOR_STATE_OFF);
+            for (int i = 0; i < VENT_FANS; i++) {
+                control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_HUMIDITY, "humidity below min");
             }
         }
     }
@@ -273,63 +591,151 @@ void control_humidity_logic(float humidity, float temperature)
 
 void control_gas_logic(float ammonia, float co2, float co)
 {
-    if (ammonia > poultry_config.ammonia_max || co2 > poultry_config.co2_max || co > poultry_config.co_max) {
-        /* Dangerous gas levels: maximum ventilation */
+    bool alarm = ammonia > poultry_config.ammonia_max || co2 > poultry_config.co2_max ||
+                 co > poultry_config.co_max;
+    if (alarm && !gas_venting) {
         ESP_LOGW(TAG, "High gas levels! NH3=%.1f CO2=%.1f CO=%.1f - activating ventilation",
                  ammonia, co2, co);
-        for (int i = 0; i < 4; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_ON);
-        }
+    }
+    gas_venting = alarm;
+    
+    int32_t demand = 0;
+    const float values[] = { ammonia, co2, co };
+    const float limits[] = { poultry_config.ammonia_max, poultry_config.co2_max, poultry_config.co_max };
+    for (int g = 0; g < 3; g++) {
+        int32_t d = control_vent_demand(values[g], limits[g] * GAS_CLEAR_RATIO, limits[g]);
+        if (d > demand) demand = d;
+    }
+    
+    /* Dangerous gas levels do not wait out the fans' minimum off time */
+    if (alarm && !gas_vent.stage.running) fan_stage_reset(&gas_vent.stage);
+    
+    uint8_t duty;
+    int fans = control_vent_update(&gas_vent, demand, alarm, &duty);
+    for (int i = 0; i < fans; i++) {
+        control_arbiter_request_duty(i, duty, CONTROL_PRIORITY_GAS,
+                                     alarm ? "gas level above limit" : "gas level rising");
     }
 }
 
 void control_light_logic(float light_level, uint8_t hour)
 {
-    if (hour >= 6 && hour <= 18) {
-        if (light_level < 300.0f) {
-            for (int i = 6; i < 8; i++) {
-                actuator_set_state(i, ACTUATOR_STATE_ON);
+    actuator_state_t scheduled;
+    
+    for (int i = 6; i < 8; i++) {
+        /* Lights in the time-of-day program follow it instead */
+        if (control_schedule_get_state(i, &scheduled)) continue;
+        
+        if (hour >= 6 && hour <= 18) {
+            if (light_level < 300.0f) {
+                control_arbiter_request(i, ACTUATOR_STATE_ON, CONTROL_PRIORITY_SERVICE, "daytime, low light");
+            } else {
+                control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "daytime, enough light");
             }
         } else {
-            for (int i = 6; i < 8; i++) {
-                actuator_set_state(i, ACTUATOR_STATE_OFF);
-            }
-        }
-    } else {
-        for (int i = 6; i < 8; i++) {
-            actuator_set_state(i, ACTUATOR_STATE_OFF);
+            control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "night");
         }
     }
 }
 
 void control_feeder_logic(void)
 {
-    /* Get current time for feeding schedule */
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
+    /* Feeding times come from the time-of-day program (control_schedule_logic) */
+    actuator_state_t scheduled;
+    
+    for (int i = 8; i < 10; i++) {
+        if (feed_dispenser_is_running(i)) continue;
+        if (!control_schedule_get_state(i, &scheduled)) {
+            control_arbiter_request(i, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "not scheduled");
+        }
+    }
+}
+
+static bool control_auto_enabled_for(actuator_type_t type)
+{
+    switch (type) {
+        case ACTUATOR_TYPE_FAN: return control_state.auto_fan_enabled;
+        case ACTUATOR_TYPE_HEATER: return control_state.auto_heater_enabled;
+        case ACTUATOR_TYPE_LIGHT: return control_state.auto_light_enabled;
+        case ACTUATOR_TYPE_FEEDER: return control_state.auto_feeder_enabled;
+        case ACTUATOR_TYPE_PUMP: return control_state.auto_pump_enabled;
+        default: return true;
+    }
+}
+
+/* Bit per actuator_type_t under automatic control */
+static uint32_t control_auto_types(void)
+{
+    uint32_t mask = 0;
+    for (int type = ACTUATOR_TYPE_FAN; type <= ACTUATOR_TYPE_VALVE; type++) {
+        if (control_auto_enabled_for((actuator_type_t)type)) {
+            mask |= 1u << type;
+        }
+    }
+    return mask;
+}
+
+void control_schedule_logic(void)
+{
+    actuator_data_t *actuators;
+    uint8_t count;
+    actuator_state_t scheduled;
     
-    /* Feed at 6:00, 12:00, and 18:00 for 30 seconds */
-    bool feeding_time = (timeinfo.tm_min == 0 && timeinfo.tm_sec < 30) &&
-                        (timeinfo.tm_hour == 6 || timeinfo.tm_hour == 12 || timeinfo.tm_hour == 18);
+    actuator_get_all(&actuators, &count);
+    for (int i = 0; i < count; i++) {
+        uint8_t id = actuators[i].id;
+        if (!control_auto_enabled_for(actuators[i].type) ||
+            !control_schedule_get_state(id, &scheduled)) {
+            continue;
+        }
+        
+        /* With a gram target the ON point only triggers a dispense; the scale decides when to stop */
+        if (actuators[i].type == ACTUATOR_TYPE_FEEDER && id < CONFIG_MAX_ACTUATORS &&
+            feed_dispenser_get_target(id) > 0.0f) {
+            if (scheduled == ACTUATOR_STATE_ON && !dispense_window[id]) {
+                dispense_pending[id] = true;
+            }
+            dispense_window[id] = (scheduled == ACTUATOR_STATE_ON);
+            continue;
+        }
+        
+        control_arbiter_request(id, scheduled, CONTROL_PRIORITY_SERVICE,
+                                scheduled == ACTUATOR_STATE_ON ? "scheduled on" : "scheduled off");
+    }
+}
+
+void control_dispense_logic(void)
+{
+    actuator_data_t *actuators;
+    uint8_t count;
     
-    if (feeding_time) {
-        actuator_set_state(8, ACTUATOR_STATE_ON);
-        actuator_set_state(9, ACTUATOR_STATE_ON);
-    } else {
-        actuator_set_state(8, ACTUATOR_STATE_OFF);
-        actuator_set_state(9, ACTUATOR_STATE_OFF);
+    actuator_get_all(&actuators, &count);
+    for (int i = 0; i < count; i++) {
+        uint8_t id = actuators[i].id;
+        if (actuators[i].type != ACTUATOR_TYPE_FEEDER || id >= CONFIG_MAX_ACTUATORS) continue;
+        
+        /* Feeders share the hopper scale; a queued dispense waits for the current one */
+        if (dispense_pending[id] && !feed_dispenser_is_busy()) {
+            if (feed_dispenser_start(id, feed_dispenser_get_target(id)) == ESP_OK) {
+                dispense_pending[id] = false;
+            }
+        }
+        
+        if (feed_dispenser_is_running(id)) {
+            control_arbiter_request(id, ACTUATOR_STATE_ON, CONTROL_PRIORITY_SERVICE, "dispensing");
+        } else if (control_state.auto_feeder_enabled && feed_dispenser_get_target(id) > 0.0f) {
+            control_arbiter_request(id, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "dispense complete");
+        }
     }
 }
 
 void control_water_logic(float water_level)
 {
     if (water_level < 30.0f) {
-        actuator_set_state(10, ACTUATOR_STATE_ON);
-        actuator_set_state(11, ACTUATOR_STATE_ON);
+        control_arbiter_request(10, ACTUATOR_STATE_ON, CONTROL_PRIORITY_SERVICE, "water level low");
+        control_arbiter_request(11, ACTUATOR_STATE_ON, CONTROL_PRIORITY_SERVICE, "water level low");
     } else if (water_level > 80.0f) {
-        actuator_set_state(10, ACTUATOR_STATE_OFF);
-        actuator_set_state(11, ACTUATOR_STATE_OFF);
+        control_arbiter_request(10, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "water level high");
+        control_arbiter_request(11, ACTUATOR_STATE_OFF, CONTROL_PRIORITY_SERVICE, "water level high");
     }
 }
@@ -0,0 +1,29 @@
+#include "control/fan_stage.h"
+#include <string.h>
+#include "utils/config.h"
+
+void fan_stage_reset(fan_stage_t *stage)
+{
+    memset(stage, 0, sizeof(*stage));
+}
+
+uint8_t fan_stage_update(fan_stage_t *stage, int32_t cooling, uint32_t now_ms)
+{
+    uint32_t held_ms = now_ms - stage->changed_ms;
+
+    if (!stage->running) {
+        bool rested = !stage->switched || held_ms >= (uint32_t)CONFIG_CONTROL_FAN_MIN_OFF_S * 1000;
+        if (cooling >= FAN_START_DEMAND && rested) {
+            stage->running = true;
+            stage->switched = true;
+            stage->changed_ms = now_ms;
+        }
+    } else if (cooling <= FAN_STOP_DEMAND && held_ms >= (uint32_t)CONFIG_CONTROL_FAN_MIN_RUN_S * 1000) {
+        stage->running = false;
+        stage->changed_ms = now_ms;
+    }
+
+    if (!stage->running) return 0;
+    if (cooling < FAN_MIN_DUTY) return FAN_MIN_DUTY;
+    return cooling > 100 ? 100 : (uint8_t)cooling;
+}
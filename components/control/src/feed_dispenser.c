@@ -0,0 +1,373 @@
+#include "control/feed_dispenser.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include <time.h>
+#include "sensors/weight_sensor.h"
+#include "actuators/actuator_manager.h"
+#include "actuators/actuator_sequencer.h"
+#include "utils/config.h"
+
+static const char *TAG = "FEED_DISP";
+
+/* Samples averaged into the hopper baseline before the feeder starts */
+#define FEED_TARE_SAMPLES       10
+/* Time after the stop for feed in flight to land and the filter to settle */
+#define FEED_SETTLE_MS          3000
+/* Flow is the delivered-mass slope over this many samples, then smoothed */
+#define FEED_FLOW_WINDOW        10
+#define FEED_FLOW_ALPHA         0.3f
+/* Less than this delivered after FEED_STALL_MS means nothing is flowing */
+#define FEED_STALL_MS           10000
+#define FEED_STALL_MIN_G        20.0f
+/* Stop lag (filter delay + auger coast) and its per-dispense correction */
+#define FEED_LAG_DEFAULT_S      0.6f
+#define FEED_LAG_MAX_S          5.0f
+#define FEED_LAG_GAIN           0.5f
+#define FEED_LAG_MIN_FLOW_G_S   1.0f
+
+typedef enum {
+    DISPENSE_IDLE,
+    DISPENSE_TARE,
+    DISPENSE_RUN,
+    DISPENSE_SETTLE
+} dispense_phase_t;
+
+static SemaphoreHandle_t dispenser_mutex = NULL;
+static esp_timer_handle_t dispenser_timer = NULL;
+static TaskHandle_t notify_task = NULL;
+static volatile bool initialized = false;
+
+/* Per-feeder settings, indexed by actuator ID */
+static float target_g[CONFIG_MAX_ACTUATORS];
+static float lag_s[CONFIG_MAX_ACTUATORS];
+
+/* Dispense in progress */
+static volatile dispense_phase_t phase = DISPENSE_IDLE;
+static uint8_t active_id = 0;
+static feed_dispense_record_t current;
+static uint32_t phase_samples = 0;
+static float baseline_g = 0.0f;
+static float tare_sum_g = 0.0f;
+static float flow_g_s = 0.0f;
+static float history_g[FEED_FLOW_WINDOW];
+static uint8_t history_pos = 0;
+static uint8_t history_count = 0;
+static int64_t run_start_us = 0;
+
+static feed_dispense_record_t dispense_log[FEED_DISPENSER_LOG_SIZE];
+static uint8_t log_head = 0;
+static uint8_t log_count = 0;
+
+static void dispenser_notify(void)
+{
+    TaskHandle_t task = notify_task;
+    if (task != NULL) {
+        xTaskNotify(task, CONTROL_NOTIFY_DISPENSE, eSetBits);
+    }
+}
+
+/* Must be called with dispenser_mutex held */
+static void dispenser_stop_feeder(feed_dispense_result_t result)
+{
+    /* Straight to the output; the control loop follows up with OFF on its next cycle */
+    actuator_sequencer_request(active_id, ACTUATOR_STATE_OFF);
+
+    current.result = result;
+    current.flow_g_s = flow_g_s;
+    current.duration_ms = (uint32_t)((esp_timer_get_time() - run_start_us) / 1000);
+    phase = DISPENSE_SETTLE;
+    phase_samples = 0;
+    dispenser_notify();
+}
+
+/* Must be called with dispenser_mutex held */
+static void dispenser_finish(float hopper_g)
+{
+    current.actual_g = baseline_g - hopper_g;
+    if (current.actual_g < 0.0f) current.actual_g = 0.0f;
+
+    /* Overshoot is what left the hopper after the stop decision: flow * (true lag - estimate) */
+    if (current.result == FEED_DISPENSE_OK && current.flow_g_s >= FEED_LAG_MIN_FLOW_G_S) {
+        float lag = lag_s[active_id] +
+                    FEED_LAG_GAIN * (current.actual_g - current.target_g) / current.flow_g_s;
+        if (lag < 0.0f) lag = 0.0f;
+        if (lag > FEED_LAG_MAX_S) lag = FEED_LAG_MAX_S;
+        lag_s[active_id] = lag;
+    }
+
+    dispense_log[log_head] = current;
+    log_head = (log_head + 1) % FEED_DISPENSER_LOG_SIZE;
+    if (log_count < FEED_DISPENSER_LOG_SIZE) log_count++;
+
+    ESP_LOGI(TAG, "Feeder %d: %s, target %.0f g, actual %.0f g (%+.1f%%), %.1f g/s, %lu ms",
+             current.feeder_id, feed_dispense_result_to_string(current.result),
+             current.target_g, current.actual_g,
+             current.target_g > 0.0f ? (current.actual_g - current.target_g) * 100.0f / current.target_g : 0.0f,
+             current.flow_g_s, (unsigned long)current.duration_ms);
+
+    esp_timer_stop(dispenser_timer);
+    weight_sensor_set_fast_mode(false);
+    phase = DISPENSE_IDLE;
+    dispenser_notify();
+}
+
+/* Must be called with dispenser_mutex held */
+static void dispenser_run_step(float hopper_g)
+{
+    float delivered = baseline_g - hopper_g;
+    if (delivered < 0.0f) delivered = 0.0f;
+
+    /* Slope over the window, smoothed; filter noise alone never reads as flow */
+    if (history_count == FEED_FLOW_WINDOW) {
+        float oldest = history_g[history_pos];
+        float slope = (delivered - oldest) * 1000.0f /
+                      (float)(FEED_FLOW_WINDOW * CONFIG_FEED_DISPENSE_SAMPLE_MS);
+        if (slope < 0.0f) slope = 0.0f;
+        flow_g_s += FEED_FLOW_ALPHA * (slope - flow_g_s);
+    } else {
+        history_count++;
+    }
+    history_g[history_pos] = delivered;
+    history_pos = (history_pos + 1) % FEED_FLOW_WINDOW;
+
+    int64_t elapsed_ms = (esp_timer_get_time() - run_start_us) / 1000;
+
+    if (delivered + flow_g_s * lag_s[active_id] >= current.target_g) {
+        dispenser_stop_feeder(FEED_DISPENSE_OK);
+    } else if (elapsed_ms >= (int64_t)CONFIG_FEED_DISPENSE_TIMEOUT_S * 1000) {
+        ESP_LOGW(TAG, "Feeder %d: %.0f of %.0f g after %d s", active_id,
+                 delivered, current.target_g, CONFIG_FEED_DISPENSE_TIMEOUT_S);
+        dispenser_stop_feeder(FEED_DISPENSE_TIMEOUT);
+    } else if (elapsed_ms >= FEED_STALL_MS && delivered < FEED_STALL_MIN_G) {
+        ESP_LOGW(TAG, "Feeder %d: no flow, hopper empty or auger jammed", active_id);
+        dispenser_stop_feeder(FEED_DISPENSE_STALLED);
+    }
+}
+
+static void dispenser_tick(void *arg)
+{
+    float hopper_kg = 0.0f;
+    esp_err_t err = weight_sensor_sample_fast(&hopper_kg);
+    float hopper_g = hopper_kg * 1000.0f;
+
+    xSemaphoreTake(dispenser_mutex, portMAX_DELAY);
+
+    if (err != ESP_OK && phase != DISPENSE_IDLE) {
+        ESP_LOGE(TAG, "Scale read failed: %s", esp_err_to_name(err));
+        if (phase == DISPENSE_TARE) {
+            esp_timer_stop(dispenser_timer);
+            weight_sensor_set_fast_mode(false);
+            phase = DISPENSE_IDLE;
+        } else {
+            if (phase == DISPENSE_RUN) {
+                dispenser_stop_feeder(FEED_DISPENSE_ABORTED);
+            }
+            /* Without a reading the delivered mass is unknown; log the attempt as nothing */
+            current.result = FEED_DISPENSE_ABORTED;
+            dispenser_finish(baseline_g);
+        }
+        xSemaphoreGive(dispenser_mutex);
+        return;
+    }
+
+    switch (phase) {
+        case DISPENSE_TARE:
+            tare_sum_g += hopper_g;
+            if (++phase_samples >= FEED_TARE_SAMPLES) {
+                baseline_g = tare_sum_g / FEED_TARE_SAMPLES;
+                phase = DISPENSE_RUN;
+                run_start_us = esp_timer_get_time();
+                ESP_LOGI(TAG, "Feeder %d: dispensing %.0f g from %.0f g hopper",
+                         active_id, current.target_g, baseline_g);
+                dispenser_notify();
+            }
+            break;
+        case DISPENSE_RUN:
+            dispenser_run_step(hopper_g);
+            break;
+        case DISPENSE_SETTLE:
+            if (++phase_samples * CONFIG_FEED_DISPENSE_SAMPLE_MS >= FEED_SETTLE_MS) {
+                dispenser_finish(hopper_g);
+            }
+            break;
+        default:
+            break;
+    }
+
+    xSemaphoreGive(dispenser_mutex);
+}
+
+esp_err_t feed_dispenser_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    dispenser_mutex = xSemaphoreCreateMutex();
+    if (dispenser_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create dispenser mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = dispenser_tick,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "feed_disp"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &dispenser_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create dispenser timer: %s", esp_err_to_name(err));
+        vSemaphoreDelete(dispenser_mutex);
+        dispenser_mutex = NULL;
+        return err;
+    }
+
+    for (int i = 0; i < CONFIG_MAX_ACTUATORS; i++) {
+        target_g[i] = (float)CONFIG_FEED_DISPENSE_DEFAULT_G;
+        lag_s[i] = FEED_LAG_DEFAULT_S;
+    }
+    phase = DISPENSE_IDLE;
+    log_head = 0;
+    log_count = 0;
+
+    initialized = true;
+    ESP_LOGI(TAG, "Feed dispenser initialized, sampling every %d ms", CONFIG_FEED_DISPENSE_SAMPLE_MS);
+
+    return ESP_OK;
+}
+
+esp_err_t feed_dispenser_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    feed_dispenser_abort();
+    initialized = false;
+    esp_timer_stop(dispenser_timer);
+    esp_timer_delete(dispenser_timer);
+    dispenser_timer = NULL;
+    weight_sensor_set_fast_mode(false);
+    vSemaphoreDelete(dispenser_mutex);
+    dispenser_mutex = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t feed_dispenser_set_notify_task(TaskHandle_t task)
+{
+    notify_task = task;
+    return ESP_OK;
+}
+
+esp_err_t feed_dispenser_set_target(uint8_t feeder_id, float grams)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (feeder_id >= CONFIG_MAX_ACTUATORS || grams < 0.0f) return ESP_ERR_INVALID_ARG;
+
+    target_g[feeder_id] = grams;
+    ESP_LOGI(TAG, "Feeder %d target %.0f g%s", feeder_id, grams, grams > 0.0f ? "" : " (timed)");
+    return ESP_OK;
+}
+
+float feed_dispenser_get_target(uint8_t feeder_id)
+{
+    if (!initialized || feeder_id >= CONFIG_MAX_ACTUATORS) return 0.0f;
+    return target_g[feeder_id];
+}
+
+esp_err_t feed_dispenser_start(uint8_t feeder_id, float grams)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (feeder_id >= CONFIG_MAX_ACTUATORS || grams <= 0.0f) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(dispenser_mutex, portMAX_DELAY);
+
+    if (phase != DISPENSE_IDLE) {
+        xSemaphoreGive(dispenser_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = weight_sensor_set_fast_mode(true);
+    if (err != ESP_OK) {
+        xSemaphoreGive(dispenser_mutex);
+        return err;
+    }
+
+    memset(&current, 0, sizeof(current));
+    current.timestamp = (uint32_t)time(NULL);
+    current.feeder_id = feeder_id;
+    current.target_g = grams;
+    active_id = feeder_id;
+    phase_samples = 0;
+    tare_sum_g = 0.0f;
+    flow_g_s = 0.0f;
+    history_pos = 0;
+    history_count = 0;
+    phase = DISPENSE_TARE;
+
+    err = esp_timer_start_periodic(dispenser_timer, (uint64_t)CONFIG_FEED_DISPENSE_SAMPLE_MS * 1000);
+    if (err != ESP_OK) {
+        phase = DISPENSE_IDLE;
+        weight_sensor_set_fast_mode(false);
+    }
+
+    xSemaphoreGive(dispenser_mutex);
+    return err;
+}
+
+esp_err_t feed_dispenser_abort(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(dispenser_mutex, portMAX_DELAY);
+    if (phase == DISPENSE_TARE) {
+        /* Feeder never started, nothing to record */
+        esp_timer_stop(dispenser_timer);
+        weight_sensor_set_fast_mode(false);
+        phase = DISPENSE_IDLE;
+    } else if (phase == DISPENSE_RUN) {
+        /* Settles and logs like any other stop */
+        dispenser_stop_feeder(FEED_DISPENSE_ABORTED);
+    }
+    xSemaphoreGive(dispenser_mutex);
+
+    return ESP_OK;
+}
+
+bool feed_dispenser_is_busy(void)
+{
+    return phase != DISPENSE_IDLE;
+}
+
+bool feed_dispenser_is_running(uint8_t feeder_id)
+{
+    return phase == DISPENSE_RUN && active_id == feeder_id;
+}
+
+esp_err_t feed_dispenser_get_log(feed_dispense_record_t *records, uint8_t max_count, uint8_t *count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (records == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(dispenser_mutex, portMAX_DELAY);
+    uint8_t n = log_count < max_count ? log_count : max_count;
+    /* Newest first */
+    for (uint8_t i = 0; i < n; i++) {
+        records[i] = dispense_log[(log_head + FEED_DISPENSER_LOG_SIZE - 1 - i) % FEED_DISPENSER_LOG_SIZE];
+    }
+    *count = n;
+    xSemaphoreGive(dispenser_mutex);
+
+    return ESP_OK;
+}
+
+const char* feed_dispense_result_to_string(feed_dispense_result_t result)
+{
+    switch (result) {
+        case FEED_DISPENSE_OK: return "OK";
+        case FEED_DISPENSE_TIMEOUT: return "Timeout";
+        case FEED_DISPENSE_STALLED: return "Stalled";
+        case FEED_DISPENSE_ABORTED: return "Aborted";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,91 @@
+#include "control/pid_controller.h"
+#include <string.h>
+
+void pid_init(pid_controller_t *pid, const pid_config_t *config)
+{
+    memset(pid, 0, sizeof(*pid));
+    pid->config = *config;
+    pid->dt = fix16_div(FIX16_FROM_INT(config->period_ms), FIX16_FROM_INT(1000));
+    pid->automatic = true;
+    pid->output = fix16_clamp(0, config->out_min, config->out_max);
+}
+
+void pid_set_tuning(pid_controller_t *pid, fix16_t kp, fix16_t ki, fix16_t kd)
+{
+    pid->config.kp = kp;
+    pid->config.ki = ki;
+    pid->config.kd = kd;
+}
+
+void pid_reset(pid_controller_t *pid)
+{
+    pid->integral = 0;
+    pid->derivative = 0;
+    pid->primed = false;
+    pid->output = fix16_clamp(0, pid->config.out_min, pid->config.out_max);
+}
+
+fix16_t pid_update(pid_controller_t *pid, fix16_t setpoint, fix16_t measurement)
+{
+    const pid_config_t *cfg = &pid->config;
+
+    if (!pid->automatic) {
+        pid->last_measurement = measurement;
+        return pid->output;
+    }
+
+    if (!pid->primed) {
+        pid->last_measurement = measurement;
+        pid->derivative = 0;
+        pid->primed = true;
+    }
+
+    fix16_t error = fix16_sub(setpoint, measurement);
+    fix16_t proportional = fix16_mul(cfg->kp, error);
+
+    /* Derivative on measurement, first-order low-pass */
+    fix16_t slope = fix16_div(fix16_sub(measurement, pid->last_measurement), pid->dt);
+    fix16_t d_sample = -fix16_mul(cfg->kd, slope);
+    pid->derivative = fix16_add(pid->derivative,
+                                fix16_mul(cfg->derivative_alpha, fix16_sub(d_sample, pid->derivative)));
+    pid->last_measurement = measurement;
+
+    /* Integrate unless the output is already pinned in the direction the error pushes */
+    fix16_t step = fix16_mul(fix16_mul(cfg->ki, error), pid->dt);
+    bool pinned_high = pid->output >= cfg->out_max && step > 0;
+    bool pinned_low = pid->output <= cfg->out_min && step < 0;
+    if (!pinned_high && !pinned_low) {
+        pid->integral = fix16_clamp(fix16_add(pid->integral, step), cfg->out_min, cfg->out_max);
+    }
+
+    fix16_t output = fix16_add(fix16_add(proportional, pid->integral), pid->derivative);
+    output = fix16_clamp(output, cfg->out_min, cfg->out_max);
+
+    if (cfg->rate_limit > 0) {
+        fix16_t max_step = fix16_mul(cfg->rate_limit, pid->dt);
+        output = fix16_clamp(output, fix16_sub(pid->output, max_step), fix16_add(pid->output, max_step));
+    }
+
+    pid->output = output;
+    return output;
+}
+
+void pid_set_manual(pid_controller_t *pid, fix16_t output)
+{
+    pid->automatic = false;
+    pid->output = fix16_clamp(output, pid->config.out_min, pid->config.out_max);
+}
+
+void pid_set_auto(pid_controller_t *pid, fix16_t setpoint, fix16_t measurement)
+{
+    if (pid->automatic) return;
+
+    /* Bumpless transfer: first automatic output equals the held manual output */
+    fix16_t proportional = fix16_mul(pid->config.kp, fix16_sub(setpoint, measurement));
+    pid->integral = fix16_clamp(fix16_sub(pid->output, proportional),
+                                pid->config.out_min, pid->config.out_max);
+    pid->derivative = 0;
+    pid->last_measurement = measurement;
+    pid->primed = true;
+    pid->automatic = true;
+}
@@ -0,0 +1,81 @@
+#include "control/rls_estimator.h"
+#include <string.h>
+
+/* Weight of a new sample in the running mean square error */
+#define RLS_ERROR_ALPHA 0.05f
+
+void rls_reset(rls_estimator_t *rls, float p0)
+{
+    memset(rls->theta, 0, sizeof(rls->theta));
+    memset(rls->P, 0, sizeof(rls->P));
+    for (int i = 0; i < rls->n; i++) {
+        rls->P[i][i] = p0;
+    }
+    rls->error_ms = 0.0f;
+    rls->samples = 0;
+}
+
+void rls_init(rls_estimator_t *rls, uint8_t n, float lambda, float p0)
+{
+    memset(rls, 0, sizeof(*rls));
+    rls->n = n > RLS_MAX_PARAMS ? RLS_MAX_PARAMS : n;
+    rls->lambda = lambda;
+    rls->trace_max = p0 * rls->n * 10.0f;
+    rls_reset(rls, p0);
+}
+
+float rls_predict(const rls_estimator_t *rls, const float *phi)
+{
+    float y = 0.0f;
+    for (int i = 0; i < rls->n; i++) {
+        y += rls->theta[i] * phi[i];
+    }
+    return y;
+}
+
+float rls_update(rls_estimator_t *rls, const float *phi, float y)
+{
+    const int n = rls->n;
+    float p_phi[RLS_MAX_PARAMS];
+    float gain[RLS_MAX_PARAMS];
+
+    /* p_phi = P * phi, denom = lambda + phi' * P * phi */
+    float trace = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float sum = 0.0f;
+        for (int j = 0; j < n; j++) {
+            sum += rls->P[i][j] * phi[j];
+        }
+        p_phi[i] = sum;
+        trace += rls->P[i][i];
+    }
+    float lambda = trace > rls->trace_max ? 1.0f : rls->lambda;
+    float denom = lambda;
+    for (int i = 0; i < n; i++) {
+        denom += phi[i] * p_phi[i];
+    }
+
+    float error = y - rls_predict(rls, phi);
+    for (int i = 0; i < n; i++) {
+        gain[i] = p_phi[i] / denom;
+        rls->theta[i] += gain[i] * error;
+    }
+
+    /* P = (P - gain * p_phi') / lambda, kept symmetric against rounding drift */
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            float value = (rls->P[i][j] - gain[i] * p_phi[j]) / lambda;
+            rls->P[i][j] = value;
+            rls->P[j][i] = value;
+        }
+    }
+
+    if (rls->samples == 0) {
+        rls->error_ms = error * error;
+    } else {
+        rls->error_ms += RLS_ERROR_ALPHA * (error * error - rls->error_ms);
+    }
+    rls->samples++;
+
+    return error;
+}
@@ -0,0 +1,88 @@
+#ifndef ALARM_ENGINE_H
+#define ALARM_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Per-sensor alarm state machine.
+ *
+ *   NORMAL --out of band--> PENDING --held for on_delay--> ACTIVE
+ *   PENDING --back in band--> NORMAL            (debounced, no event)
+ *   ACTIVE --acknowledge--> ACKNOWLEDGED --clear for off_delay--> NORMAL
+ *   ACTIVE --clear for off_delay--> CLEARED --acknowledge--> NORMAL
+ *   CLEARED --out of band for on_delay--> ACTIVE (raised again)
+ *
+ * A sensor is out of band above threshold_max or below threshold_min, and
+ * only counts as clear once it is back inside by the hysteresis of its type.
+ * Sensors that are not reporting OK hold their state; disabling a sensor or
+ * its alarm returns it to NORMAL.
+ *
+ * alarm_engine_process() runs all sensors in one pass and reports each
+ * transition into ACTIVE, ACKNOWLEDGED, CLEARED or back to NORMAL once,
+ * through the callback, at the end of the pass. The callback runs with the
+ * engine locked and must not call back into it.
+ */
+
+typedef enum {
+    ALARM_STATE_NORMAL,
+    ALARM_STATE_PENDING,        /* out of band, on-delay running */
+    ALARM_STATE_ACTIVE,         /* raised, not acknowledged */
+    ALARM_STATE_ACKNOWLEDGED,   /* raised and acknowledged, condition present */
+    ALARM_STATE_CLEARED         /* condition gone, not yet acknowledged */
+} alarm_state_t;
+
+typedef enum {
+    ALARM_LIMIT_NONE,
+    ALARM_LIMIT_LOW,
+    ALARM_LIMIT_HIGH
+} alarm_limit_t;
+
+typedef struct {
+    float hysteresis;           /* sensor units; 0 = 2 % of the sensor span */
+    uint32_t on_delay_ms;
+    uint32_t off_delay_ms;
+} alarm_profile_t;
+
+typedef struct {
+    uint32_t timestamp;
+    uint8_t sensor_id;
+    char sensor_name[64];
+    float value;
+    float threshold_min;
+    float threshold_max;
+    bool alarm_triggered;       /* true while the alarm is raised (ACTIVE or ACKNOWLEDGED) */
+    alarm_state_t state;
+    alarm_state_t previous_state;
+    alarm_limit_t limit;
+} alarm_event_t;
+
+typedef struct {
+    uint8_t sensor_id;
+    alarm_state_t state;
+    alarm_limit_t limit;
+    float peak;                 /* worst reading since raised */
+    uint32_t raised_time;
+    uint32_t cleared_time;
+    uint16_t raise_count;
+} alarm_status_t;
+
+typedef void (*alarm_callback_t)(const alarm_event_t *event);
+
+esp_err_t alarm_engine_init(void);
+esp_err_t alarm_engine_deinit(void);
+esp_err_t alarm_engine_process(const sensor_data_t *sensors, uint8_t sensor_count, uint32_t now_ms);
+esp_err_t alarm_engine_acknowledge(uint8_t sensor_id);
+esp_err_t alarm_engine_acknowledge_all(void);
+esp_err_t alarm_engine_get_status(uint8_t sensor_id, alarm_status_t *status);
+esp_err_t alarm_engine_get_standing(alarm_status_t *alarms, uint8_t max_count, uint8_t *count);
+void alarm_engine_get_summary(uint8_t *raised, uint8_t *unacknowledged);
+esp_err_t alarm_engine_set_profile(sensor_type_t type, const alarm_profile_t *profile);
+esp_err_t alarm_engine_get_profile(sensor_type_t type, alarm_profile_t *profile);
+void alarm_engine_set_callback(alarm_callback_t callback);
+const char* alarm_state_to_string(alarm_state_t state);
+const char* alarm_limit_to_string(alarm_limit_t limit);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Per-sensor streaming change detection, ahead of the static thresholds.
+ *
+ * Readings are averaged over CHANGE_WINDOW_MS; the detectors see one mean
+ * per window, which keeps their false alarms to weeks apart at any sampling
+ * rate. Each sensor keeps a slowly adapting baseline: an exponentially
+ * weighted mean and variance of those means with a time constant of
+ * CONFIG_CHANGE_BASELINE_MIN. Every window mean is standardised against it,
+ * z = (x - mean) / sigma, and fed to two detectors:
+ *
+ *   EWMA chart   e = lambda z + (1 - lambda) e, signals when |e| exceeds
+ *                L sqrt(lambda / (2 - lambda)); catches sustained shifts.
+ *   CUSUM        S+ = max(0, S+ + z - k), S- = max(0, S- - z - k), signals
+ *                when either exceeds h; catches slow drifts.
+ *
+ * sigma is never below the noise floor of the sensor type, so a quiet sensor
+ * does not signal on its last digit. A glitch counts as at most 4 sigma.
+ * While a change is raised the baseline follows four times slower: a drift
+ * that keeps going stays raised, a lasting new level is accepted in the end.
+ * A change clears once both statistics are back under half their limits.
+ * The first CONFIG_CHANGE_WARMUP_MIN only build the baseline.
+ *
+ * The state is a handful of floats per sensor and an update is O(1).
+ * change_detector_process() reports raises and clears through the callback,
+ * with the detector locked; the callback must not call back into it.
+ */
+
+#define CHANGE_WINDOW_MS        60000
+#define CHANGE_EWMA_LAMBDA      0.1f
+#define CHANGE_EWMA_L           4.0f
+#define CHANGE_CUSUM_K          0.5f
+#define CHANGE_CUSUM_H          10.0f
+
+typedef enum {
+    CHANGE_DIRECTION_NONE,
+    CHANGE_DIRECTION_RISING,
+    CHANGE_DIRECTION_FALLING
+} change_direction_t;
+
+typedef enum {
+    CHANGE_DETECTOR_EWMA = 1 << 0,
+    CHANGE_DETECTOR_CUSUM = 1 << 1
+} change_detector_kind_t;
+
+typedef struct {
+    float noise_floor;          /* smallest sigma, sensor units; 0 = not monitored */
+} change_profile_t;
+
+typedef struct {
+    uint32_t timestamp;
+    uint8_t sensor_id;
+    char sensor_name[64];
+    float value;                /* window mean */
+    float baseline;
+    float sigma;
+    bool raised;                /* false when the change has cleared */
+    change_direction_t direction;
+    uint8_t detectors;          /* change_detector_kind_t that signalled */
+} change_event_t;
+
+typedef struct {
+    uint8_t sensor_id;
+    float baseline;
+    float sigma;
+    float ewma;                 /* in sigmas */
+    float cusum_high;
+    float cusum_low;
+    uint32_t samples;           /* windows seen */
+    change_direction_t direction;   /* NONE unless raised */
+    uint8_t detectors;
+} change_status_t;
+
+typedef void (*change_callback_t)(const change_event_t *event);
+
+esp_err_t change_detector_init(void);
+esp_err_t change_detector_process(const sensor_data_t *sensors, uint8_t sensor_count, uint32_t now_ms);
+/* Forgets the baseline; it is learnt again from the next readings */
+esp_err_t change_detector_reset(uint8_t sensor_id);
+esp_err_t change_detector_get_status(uint8_t sensor_id, change_status_t *status);
+uint8_t change_detector_get_raised_count(void);
+esp_err_t change_detector_set_profile(sensor_type_t type, const change_profile_t *profile);
+esp_err_t change_detector_get_profile(sensor_type_t type, change_profile_t *profile);
+void change_detector_set_callback(change_callback_t callback);
+const char* change_direction_to_string(change_direction_t direction);
+
+#endif
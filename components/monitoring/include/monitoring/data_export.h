@@ -0,0 +1,82 @@
+#ifndef DATA_EXPORT_H
+#define DATA_EXPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/*
+ * Streaming export of sensor history, alarms and journal events.
+ *
+ * The export walks the selected sections in order (history sensor by sensor,
+ * then the alarm history, then the event journal) and hands the output to a
+ * sink in chunks of at most DATA_EXPORT_CHUNK_SIZE bytes. Chunks hold whole
+ * records, so each one can be sent as a message of its own. All state lives
+ * in data_export_t, which the caller owns; memory use does not depend on how
+ * much is exported. No store is locked while the sink runs.
+ *
+ * The cursor only moves once the sink has accepted a chunk. After a failed
+ * send, data_export_run() continues with the same records; a cursor saved
+ * from a finished chunk can also be passed to data_export_begin() to pick up
+ * an interrupted export later.
+ *
+ * Formats, one record per line for the text formats:
+ *   CSV         a header row at the start of each section
+ *   JSON lines  one object per record with a "type" of point, alarm or event
+ *   binary      type (1) | length (1) | body, little-endian, see below
+ *
+ * Binary bodies:
+ *   section (0) version (1), section (1)
+ *   point (1)   timestamp (4), sensor id (1), value (float, 4)
+ *   alarm (2)   uptime ms (4), sensor id (1), state (1), limit (1),
+ *               value, threshold min, threshold max (float, 4 each), name
+ *   event (3)   timestamp (4), severity (1), text
+ *
+ * History and event timestamps are in seconds and filtered by from/to.
+ * Alarm timestamps are milliseconds since boot and are not filtered.
+ */
+
+#define DATA_EXPORT_CHUNK_SIZE      1024
+
+#define DATA_EXPORT_HISTORY         0x01
+#define DATA_EXPORT_ALARMS          0x02
+#define DATA_EXPORT_EVENTS          0x04
+#define DATA_EXPORT_ALL             (DATA_EXPORT_HISTORY | DATA_EXPORT_ALARMS | DATA_EXPORT_EVENTS)
+
+typedef enum {
+    DATA_EXPORT_CSV,
+    DATA_EXPORT_JSON_LINES,
+    DATA_EXPORT_BINARY
+} data_export_format_t;
+
+typedef struct {
+    uint8_t section;            /* DATA_EXPORT_HISTORY, ...; 0 = finished */
+    uint8_t sensor_id;          /* history: sensor being exported */
+    bool section_open;          /* section header written */
+    uint64_t position;          /* next timestamp, alarm sequence or journal position */
+} data_export_cursor_t;
+
+typedef struct {
+    data_export_format_t format;
+    uint8_t sections;
+    uint32_t from;
+    uint32_t to;
+    data_export_cursor_t cursor;    /* after the last chunk the sink accepted */
+    uint32_t chunks;
+    uint32_t bytes;
+    uint16_t length;
+    uint8_t chunk[DATA_EXPORT_CHUNK_SIZE];
+} data_export_t;
+
+/* Sends one chunk; any error stops the export without moving the cursor */
+typedef esp_err_t (*data_export_sink_t)(const uint8_t *data, size_t length, void *context);
+
+/* to = 0 exports up to now; resume = NULL starts from the beginning */
+esp_err_t data_export_begin(data_export_t *job, data_export_format_t format, uint8_t sections,
+                            uint32_t from, uint32_t to, const data_export_cursor_t *resume);
+/* Sends up to max_chunks chunks (0 = until finished), yielding between them */
+esp_err_t data_export_run(data_export_t *job, data_export_sink_t sink, void *context, uint16_t max_chunks);
+bool data_export_finished(const data_export_t *job);
+
+#endif
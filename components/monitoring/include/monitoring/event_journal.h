@@ -0,0 +1,75 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/*
+ * Append-only event journal on the "journal" flash partition.
+ *
+ * The partition is a ring of 4 KB sectors. Each sector starts with a header
+ * carrying a sequence number and holds records of
+ *
+ *   length (2) | type (2) | timestamp (4) | crc32 (4) | payload, padded to 4
+ *
+ * where the CRC covers the first 8 bytes and the payload. Sectors are filled
+ * in order and the oldest one is erased when the ring wraps, so every sector
+ * sees the same number of erase cycles. At boot only the sector headers are
+ * read to find the newest sector; that one is then scanned for the append
+ * point. A record torn by power loss fails its CRC and ends its sector.
+ *
+ * Appends are copied into a RAM buffer; a low-priority task writes it out
+ * page by page, at once for urgent records and otherwise when a page has
+ * filled or CONFIG_JOURNAL_FLUSH_INTERVAL_MS has passed.
+ */
+
+#define EVENT_JOURNAL_MAX_PAYLOAD   240
+
+typedef enum {
+    JOURNAL_RECORD_BOOT = 1,    /* payload: journal_boot_t */
+    JOURNAL_RECORD_EVENT = 2    /* payload: severity, then text without NUL */
+} journal_record_type_t;
+
+typedef struct {
+    uint32_t reset_reason;      /* esp_reset_reason_t */
+    uint32_t sequence;          /* sector sequence at boot */
+} journal_boot_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t length;
+    uint32_t timestamp;         /* seconds, wall clock once set, else since boot */
+} journal_record_t;
+
+typedef struct {
+    uint32_t records_written;
+    uint32_t bytes_written;
+    uint32_t records_dropped;   /* buffer full or payload too long */
+    uint32_t flushes;
+    uint32_t sector_erases;
+    uint32_t crc_errors;        /* torn or corrupt records found while reading */
+    uint32_t sequence;          /* of the sector being written */
+    uint16_t sector_count;
+    uint16_t active_sector;
+    uint16_t write_offset;
+} event_journal_stats_t;
+
+/* Called oldest first; return false to stop */
+typedef bool (*event_journal_visitor_t)(const journal_record_t *record, const void *payload, void *context);
+
+esp_err_t event_journal_init(void);
+esp_err_t event_journal_append(journal_record_type_t type, const void *payload, uint16_t length, bool urgent);
+esp_err_t event_journal_flush(void);
+esp_err_t event_journal_read(event_journal_visitor_t visitor, void *context);
+/*
+ * Visits records after *position (0 = the oldest held) and advances it past
+ * each one the visitor accepts; a record the visitor returns false for is
+ * visited again on the next call
+ */
+esp_err_t event_journal_read_from(uint64_t *position, event_journal_visitor_t visitor, void *context);
+esp_err_t event_journal_erase(void);
+void event_journal_get_stats(event_journal_stats_t *stats);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/*
+ * Binary event log.
+ *
+ * Each record is a format-string ID, a severity, a millisecond timestamp and
+ * the printf arguments varint-encoded; text is only produced when the log is
+ * rendered. Format strings are interned once per call site by EVENT_LOG(), so
+ * the write path is a reservation in the ring, a few stores and no locks.
+ * Writers reserve their space with an atomic add on the head and may run
+ * concurrently from any task on either core (not from ISRs: interning and
+ * the console echo may block).
+ *
+ * Supported conversions are d i u x X o c (with h, l, ll or z), e f g
+ * (stored as float) and s (copied, at most EVENT_LOG_MAX_STRING bytes).
+ * Formats must have static storage; at most EVENT_LOG_MAX_ARGS conversions.
+ */
+
+#define EVENT_LOG_MAX_FORMATS   128
+#define EVENT_LOG_MAX_ARGS      8
+#define EVENT_LOG_MAX_STRING    63
+#define EVENT_LOG_MAX_RECORD    128     /* bytes, header included */
+
+#define EVENT_LOG(severity, format, ...) do {                               \
+    static uint16_t event_format_id_ = 0;                                   \
+    if (event_format_id_ == 0) event_format_id_ = event_log_intern(format); \
+    event_log_write(event_format_id_, (severity), ##__VA_ARGS__);           \
+} while (0)
+
+typedef struct {
+    uint32_t written;           /* records committed since init */
+    uint32_t dropped;           /* not interned or too many arguments */
+    uint32_t truncated;         /* strings or arguments cut to fit a record */
+    uint32_t bytes_used;        /* ring bytes holding records */
+    uint16_t formats;           /* interned format strings */
+} event_log_stats_t;
+
+/* Called oldest first with each rendered record */
+typedef void (*event_log_visitor_t)(uint32_t timestamp, uint8_t severity, const char *text, void *context);
+
+esp_err_t event_log_init(void);
+uint16_t event_log_intern(const char *format);
+esp_err_t event_log_write(uint16_t format_id, uint8_t severity, ...);
+esp_err_t event_log_for_each(event_log_visitor_t visitor, void *context);
+/* Visits records from *cursor on (0 = from boot) and advances it past them */
+esp_err_t event_log_read_from(uint32_t *cursor, event_log_visitor_t visitor, void *context);
+size_t event_log_render(char *buffer, size_t buffer_size);
+esp_err_t event_log_clear(void);
+void event_log_get_stats(event_log_stats_t *stats);
+
+#endif
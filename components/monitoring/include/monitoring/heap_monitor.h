@@ -0,0 +1,76 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Heap health: free memory, fragmentation and leak trend.
+ *
+ * Every CONFIG_HEAP_MONITOR_INTERVAL_MS the monitor reads the free bytes, the
+ * lowest free bytes since boot and the largest free block of each region.
+ * Fragmentation is the share of free memory outside the largest block.
+ *
+ * For the leak trend, the lowest free heap seen in each 1/HEAP_TREND_POINTS
+ * of CONFIG_HEAP_LEAK_WINDOW_H is kept. Allocation bursts come and go, but a
+ * leak lowers that floor. The least-squares slope through the points is the
+ * leak rate.
+ *
+ * Three conditions are raised in the event log and cleared with hysteresis:
+ * - a leak rate above CONFIG_HEAP_LEAK_ALERT_BYTES_PER_H, once the window is full;
+ * - fragmentation above CONFIG_HEAP_FRAG_ALERT_PERCENT;
+ * - an internal largest block below CONFIG_HEAP_LOW_BLOCK_BYTES.
+ *
+ * Failed allocations are counted. With CONFIG_HEAP_TASK_TRACKING, the bytes
+ * and blocks each task holds are exported too.
+ */
+
+#define HEAP_TREND_POINTS           24
+#define HEAP_MONITOR_MAX_TASKS      16
+
+typedef enum {
+    HEAP_REGION_DEFAULT,        /* everything malloc() can return */
+    HEAP_REGION_INTERNAL,       /* internal RAM, needed by WiFi and TLS */
+    HEAP_REGION_DMA,
+    HEAP_REGION_COUNT
+} heap_region_t;
+
+typedef struct {
+    uint32_t free_bytes;
+    uint32_t min_free_bytes;    /* since boot */
+    uint32_t largest_block;
+    uint32_t total_bytes;
+    uint16_t allocated_blocks;
+    uint8_t fragmentation;      /* percent of free memory outside the largest block */
+} heap_region_stats_t;
+
+typedef struct {
+    heap_region_stats_t region[HEAP_REGION_COUNT];
+    float leak_rate;            /* bytes per hour lost from the free heap floor; negative when it grows */
+    uint8_t trend_points;       /* of HEAP_TREND_POINTS collected */
+    uint32_t alloc_failures;
+    uint32_t last_failed_size;
+    uint32_t last_failed_caps;
+    bool leak_alert;
+    bool fragmentation_alert;
+    bool low_memory_alert;
+} heap_monitor_stats_t;
+
+typedef struct {
+    char name[16];
+    uint32_t bytes;             /* held now */
+    uint32_t blocks;
+} heap_task_usage_t;
+
+esp_err_t heap_monitor_init(void);
+/* Samples when the interval has passed since the last sample */
+esp_err_t heap_monitor_process(uint32_t now_ms);
+esp_err_t heap_monitor_sample(uint32_t now_ms);
+void heap_monitor_get_stats(heap_monitor_stats_t *stats);
+/* Largest holders first; ESP_ERR_NOT_SUPPORTED without CONFIG_HEAP_TASK_TRACKING */
+esp_err_t heap_monitor_get_task_usage(heap_task_usage_t *usage, uint8_t max_count, uint8_t *count);
+void heap_monitor_log(void);
+const char *heap_region_to_string(heap_region_t region);
+
+#endif
@@ -3,7 +3,15 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <esp_err.h>
+#include "monitoring/alarm_engine.h"
+#include "monitoring/change_detector.h"
+#include "monitoring/event_log.h"
+#include "monitoring/tsdb.h"
+#include "monitoring/sensor_stats.h"
+#include "monitoring/data_export.h"
+#include "monitoring/heap_monitor.h"
 
 typedef struct {
     uint32_t timestamp;
@@ -11,26 +19,15 @@ typedef struct {
     float humidity_avg;
     float ammonia_max;
     float co2_max;
-    uint16_t alarm_count;
+    float thi_max;
+    uint16_t alarm_count;           /* alarms raised since the last clear */
+    uint8_t active_alarms;          /* raised now, acknowledged or not */
+    uint8_t unacknowledged_alarms;  /* raised or cleared, awaiting acknowledgement */
+    uint8_t drifting_sensors;       /* early warnings from the change detector */
     uint16_t actuator_activations;
     uint8_t system_status;
 } system_status_t;
 
-typedef struct {
-    uint32_t timestamp;
-    char sensor_name[64];
-    float value;
-    float threshold_min;
-    float threshold_max;
-    bool alarm_triggered;
-} alarm_event_t;
-
-typedef struct {
-    char message[256];
-    uint32_t timestamp;
-    uint8_t severity;
-} log_event_t;
-
 esp_err_t monitoring_init(void);
 esp_err_t monitoring_start(void);
 esp_err_t monitoring_stop(void);
@@ -40,7 +37,12 @@ esp_err_t monitoring_log_event(const char *message, uint8_t severity);
 esp_err_t monitoring_check_alarms(void);
 esp_err_t monitoring_get_alarm_count(uint16_t *count);
 esp_err_t monitoring_clear_alarms(void);
+esp_err_t monitoring_acknowledge_alarm(uint8_t sensor_id);
+esp_err_t monitoring_get_alarm_history(alarm_event_t *events, uint8_t max_count, uint8_t *count);
+/* Reads the entry at *sequence, or the oldest one kept after it; ESP_ERR_NOT_FOUND past the newest */
+esp_err_t monitoring_read_alarm(uint32_t *sequence, alarm_event_t *event);
 esp_err_t monitoring_set_log_level(uint8_t level);
-esp_err_t monitoring_export_data(char *buffer, uint16_t buffer_size);
+esp_err_t monitoring_export_log(char *buffer, size_t buffer_size, size_t *length);
+esp_err_t monitoring_export_journal(char *buffer, size_t buffer_size, size_t *length);
 
 #endif
@@ -0,0 +1,57 @@
+#ifndef SENSOR_STATS_H
+#define SENSOR_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Hourly and daily statistics per sensor, kept incrementally.
+ *
+ * Every reading updates the open hour of its sensor: count, min, max, and
+ * mean and variance by Welford's method. The time between readings is
+ * integrated into seconds observed, above threshold_max and below
+ * threshold_min. It counts for the side of the earlier reading, and a gap
+ * longer than SENSOR_STATS_MAX_GAP_S counts for nothing. A closing hour is
+ * merged into the open day (Chan's parallel combination), so readings are
+ * touched once.
+ *
+ * Hours and days follow the local wall clock; nothing is kept until it is
+ * set. Closed periods go into a RAM ring of CONFIG_SENSOR_STATS_RECORDS and
+ * are read with a sequence cursor, as with the alarm history.
+ */
+
+#define SENSOR_STATS_MAX_GAP_S  300
+
+typedef enum {
+    SENSOR_STATS_HOUR,
+    SENSOR_STATS_DAY
+} sensor_stats_period_t;
+
+typedef struct {
+    uint32_t start;             /* period start, seconds, wall clock */
+    uint8_t sensor_id;
+    uint8_t period;             /* sensor_stats_period_t */
+    uint16_t reserved;
+    uint32_t count;             /* readings */
+    float min;
+    float max;
+    float mean;
+    float stddev;               /* sample standard deviation; 0 below two readings */
+    uint32_t seconds_observed;
+    uint32_t seconds_above;     /* above threshold_max */
+    uint32_t seconds_below;     /* below threshold_min */
+} sensor_stats_record_t;
+
+esp_err_t sensor_stats_init(void);
+esp_err_t sensor_stats_record(const sensor_data_t *sensors, uint8_t sensor_count, time_t now);
+/* Reads the record at *sequence, or the oldest one kept after it; ESP_ERR_NOT_FOUND past the newest */
+esp_err_t sensor_stats_read(uint32_t *sequence, sensor_stats_record_t *record);
+uint32_t sensor_stats_get_sequence(void);
+/* The period still open, as if it closed now */
+esp_err_t sensor_stats_get_current(uint8_t sensor_id, sensor_stats_period_t period, sensor_stats_record_t *record);
+const char* sensor_stats_period_to_string(sensor_stats_period_t period);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Compressed sensor history on the "tsdb" flash partition.
+ *
+ * Readings are averaged over CONFIG_TSDB_INTERVAL_S and stored per sensor
+ * in chunks, Gorilla-style: timestamps as delta-of-delta (one bit for an
+ * on-time sample) and values as the XOR with the previous value. Values
+ * are first rounded to a power-of-two step per sensor type (1/16 degC,
+ * 1/4 %RH, 4 ppm CO2, ...), which leaves trailing zero bits for the XOR
+ * to drop.
+ *
+ * The partition is a ring of 4 KB sectors. A chunk is written when its
+ * 256-byte buffer is full or CONFIG_TSDB_FLUSH_INTERVAL_MIN has passed,
+ * and a sector is sealed with its time range and the sensors it holds when
+ * it fills. That per-sector index is kept in RAM, so a query for one sensor
+ * reads only the chunk headers of the sectors that can match and decodes
+ * only that sensor's chunks. Points not yet on flash are included.
+ */
+
+#define TSDB_CHUNK_BYTES        256
+
+typedef struct {
+    uint32_t timestamp;         /* seconds, wall clock */
+    float value;
+} tsdb_point_t;
+
+typedef struct {
+    uint32_t start;             /* bucket start, seconds */
+    uint16_t count;             /* points in the bucket; 0 = no data */
+    float min;
+    float mean;
+    float max;
+} tsdb_bucket_t;
+
+typedef struct {
+    uint32_t points_written;    /* points handed to flash */
+    uint32_t bytes_written;     /* chunk bytes, headers included */
+    uint32_t chunks_written;
+    uint32_t sector_erases;
+    uint32_t oldest;            /* timestamp of the oldest point on flash */
+    uint32_t newest;
+    uint16_t sector_count;
+    uint16_t sectors_used;
+    uint8_t series;             /* sensors with history in RAM */
+} tsdb_stats_t;
+
+/* Called oldest first; return false to stop */
+typedef bool (*tsdb_visitor_t)(const tsdb_point_t *point, void *context);
+
+esp_err_t tsdb_init(void);
+esp_err_t tsdb_record(const sensor_data_t *sensors, uint8_t sensor_count, time_t now);
+esp_err_t tsdb_flush(void);
+esp_err_t tsdb_query(uint8_t sensor_id, uint32_t from, uint32_t to, tsdb_visitor_t visitor, void *context);
+esp_err_t tsdb_query_points(uint8_t sensor_id, uint32_t from, uint32_t to,
+                            tsdb_point_t *points, size_t max_points, size_t *count);
+esp_err_t tsdb_query_buckets(uint8_t sensor_id, uint32_t from, uint32_t bucket_s,
+                             tsdb_bucket_t *buckets, size_t bucket_count);
+esp_err_t tsdb_erase(void);
+void tsdb_get_stats(tsdb_stats_t *stats);
+
+#endif
@@ -0,0 +1,376 @@
+#include "monitoring/alarm_engine.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "ALARM";
+
+#define ALARM_SLOT_NONE         0xFF
+#define ALARM_PROFILE_COUNT     (SENSOR_TYPE_HEAT_INDEX + 1)
+
+/* Fallback hysteresis as a share of the sensor span */
+#define ALARM_SPAN_HYSTERESIS   0.02f
+
+typedef struct {
+    alarm_status_t status;
+    bool outside;               /* beyond a threshold */
+    bool inside;                /* inside the band by the hysteresis */
+    uint32_t outside_since;
+    uint32_t inside_since;
+    float value;
+    float threshold_min;
+    float threshold_max;
+} alarm_record_t;
+
+static alarm_record_t records[CONFIG_MAX_SENSORS];
+static uint8_t record_count = 0;
+static uint8_t slot_of[256];
+static alarm_profile_t profiles[ALARM_PROFILE_COUNT];
+
+/* Transitions of one pass, delivered together at its end */
+static alarm_event_t pending_events[CONFIG_MAX_SENSORS];
+static uint8_t pending_count = 0;
+
+static alarm_callback_t user_callback = NULL;
+static SemaphoreHandle_t alarm_mutex = NULL;
+static volatile bool initialized = false;
+
+static void alarm_default_profiles(void)
+{
+    for (int t = 0; t < ALARM_PROFILE_COUNT; t++) {
+        profiles[t].hysteresis = 0.0f;
+        profiles[t].on_delay_ms = CONFIG_ALARM_ON_DELAY_MS;
+        profiles[t].off_delay_ms = CONFIG_ALARM_OFF_DELAY_MS;
+    }
+    profiles[SENSOR_TYPE_TEMPERATURE].hysteresis = 0.5f;
+    profiles[SENSOR_TYPE_HUMIDITY].hysteresis = 3.0f;
+    profiles[SENSOR_TYPE_PRESSURE].hysteresis = 2.0f;
+    profiles[SENSOR_TYPE_AMMONIA].hysteresis = 2.0f;
+    profiles[SENSOR_TYPE_CO2].hysteresis = 200.0f;
+    profiles[SENSOR_TYPE_CO].hysteresis = 5.0f;
+    profiles[SENSOR_TYPE_METHANE].hysteresis = 2.0f;
+    profiles[SENSOR_TYPE_WATER_LEVEL].hysteresis = 5.0f;
+    profiles[SENSOR_TYPE_HEAT_INDEX].hysteresis = 0.3f;
+    /* CO is acutely toxic: raise on the first confirmed sample */
+    profiles[SENSOR_TYPE_CO].on_delay_ms = 0;
+}
+
+esp_err_t alarm_engine_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    alarm_mutex = xSemaphoreCreateMutex();
+    if (alarm_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create alarm mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(records, 0, sizeof(records));
+    memset(slot_of, ALARM_SLOT_NONE, sizeof(slot_of));
+    record_count = 0;
+    pending_count = 0;
+    alarm_default_profiles();
+
+    initialized = true;
+    ESP_LOGI(TAG, "Alarm engine initialized: on-delay %d ms, off-delay %d ms",
+             CONFIG_ALARM_ON_DELAY_MS, CONFIG_ALARM_OFF_DELAY_MS);
+    return ESP_OK;
+}
+
+esp_err_t alarm_engine_deinit(void)
+{
+    if (!initialized) return ESP_OK;
+
+    initialized = false;
+    user_callback = NULL;
+    record_count = 0;
+    if (alarm_mutex) {
+        vSemaphoreDelete(alarm_mutex);
+        alarm_mutex = NULL;
+    }
+    return ESP_OK;
+}
+
+/* Must be called with alarm_mutex held */
+static alarm_record_t *alarm_record(uint8_t sensor_id, bool create)
+{
+    if (slot_of[sensor_id] != ALARM_SLOT_NONE) return &records[slot_of[sensor_id]];
+    if (!create || record_count >= CONFIG_MAX_SENSORS) return NULL;
+
+    alarm_record_t *record = &records[record_count];
+    memset(record, 0, sizeof(*record));
+    record->status.sensor_id = sensor_id;
+    slot_of[sensor_id] = record_count++;
+    return record;
+}
+
+/* Must be called with alarm_mutex held */
+static void alarm_transition(alarm_record_t *record, alarm_state_t state, const char *name, uint32_t now_ms)
+{
+    alarm_state_t previous = record->status.state;
+    record->status.state = state;
+    if (state == ALARM_STATE_PENDING || (previous == ALARM_STATE_PENDING && state == ALARM_STATE_NORMAL)) {
+        /* Debounce only: nothing to report */
+        return;
+    }
+    if (pending_count >= CONFIG_MAX_SENSORS) return;
+
+    alarm_event_t *event = &pending_events[pending_count++];
+    memset(event, 0, sizeof(*event));
+    event->timestamp = now_ms;
+    event->sensor_id = record->status.sensor_id;
+    if (name) strncpy(event->sensor_name, name, sizeof(event->sensor_name) - 1);
+    event->value = state == ALARM_STATE_ACTIVE ? record->status.peak : record->value;
+    event->threshold_min = record->threshold_min;
+    event->threshold_max = record->threshold_max;
+    event->alarm_triggered = state == ALARM_STATE_ACTIVE || state == ALARM_STATE_ACKNOWLEDGED;
+    event->state = state;
+    event->previous_state = previous;
+    event->limit = record->status.limit;
+}
+
+/* Must be called with alarm_mutex held; the callback must not call back into the engine */
+static void alarm_deliver(void)
+{
+    if (user_callback) {
+        for (int i = 0; i < pending_count; i++) {
+            user_callback(&pending_events[i]);
+        }
+    }
+    pending_count = 0;
+}
+
+/* Must be called with alarm_mutex held */
+static void alarm_evaluate(alarm_record_t *record, const sensor_data_t *sensor, uint32_t now_ms)
+{
+    alarm_status_t *status = &record->status;
+
+    if (!sensor->enabled || !sensor->alarm_enabled) {
+        if (status->state != ALARM_STATE_NORMAL) {
+            alarm_transition(record, ALARM_STATE_NORMAL, sensor->name, now_ms);
+        }
+        record->outside = false;
+        record->inside = false;
+        return;
+    }
+    /* No judgement on a reading the sensor itself does not vouch for */
+    if (sensor->status != SENSOR_STATUS_OK) return;
+
+    const alarm_profile_t *profile = &profiles[sensor->type < ALARM_PROFILE_COUNT ? sensor->type : 0];
+    float span = sensor->threshold_max - sensor->threshold_min;
+    float hysteresis = profile->hysteresis > 0.0f ? profile->hysteresis
+                                                  : ALARM_SPAN_HYSTERESIS * (sensor->max_value - sensor->min_value);
+    if (hysteresis > span / 4.0f) hysteresis = span / 4.0f;
+
+    float value = sensor->value;
+    bool high = value > sensor->threshold_max;
+    bool low = value < sensor->threshold_min;
+    bool inside = value <= sensor->threshold_max - hysteresis && value >= sensor->threshold_min + hysteresis;
+
+    record->value = value;
+    record->threshold_min = sensor->threshold_min;
+    record->threshold_max = sensor->threshold_max;
+    if ((high || low) && !record->outside) record->outside_since = now_ms;
+    if (inside && !record->inside) record->inside_since = now_ms;
+    record->outside = high || low;
+    record->inside = inside;
+
+    bool raise = record->outside && now_ms - record->outside_since >= profile->on_delay_ms;
+    bool clear = record->inside && now_ms - record->inside_since >= profile->off_delay_ms;
+
+    switch (status->state) {
+        case ALARM_STATE_NORMAL:
+            if (!record->outside) break;
+            alarm_transition(record, ALARM_STATE_PENDING, sensor->name, now_ms);
+            /* A zero on-delay raises in the same pass */
+            /* fall through */
+        case ALARM_STATE_PENDING:
+        case ALARM_STATE_CLEARED:
+            if (raise) {
+                status->limit = high ? ALARM_LIMIT_HIGH : ALARM_LIMIT_LOW;
+                status->peak = value;
+                status->raised_time = now_ms;
+                status->raise_count++;
+                alarm_transition(record, ALARM_STATE_ACTIVE, sensor->name, now_ms);
+            } else if (status->state == ALARM_STATE_PENDING && !record->outside) {
+                alarm_transition(record, ALARM_STATE_NORMAL, sensor->name, now_ms);
+            }
+            break;
+        case ALARM_STATE_ACTIVE:
+        case ALARM_STATE_ACKNOWLEDGED:
+            if (status->limit == ALARM_LIMIT_HIGH ? value > status->peak : value < status->peak) {
+                status->peak = value;
+            }
+            if (clear) {
+                status->cleared_time = now_ms;
+                alarm_transition(record, status->state == ALARM_STATE_ACTIVE ? ALARM_STATE_CLEARED
+                                                                              : ALARM_STATE_NORMAL,
+                                 sensor->name, now_ms);
+            }
+            break;
+    }
+}
+
+esp_err_t alarm_engine_process(const sensor_data_t *sensors, uint8_t sensor_count, uint32_t now_ms)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    for (int i = 0; i < sensor_count; i++) {
+        alarm_record_t *record = alarm_record(sensors[i].id, true);
+        if (record) alarm_evaluate(record, &sensors[i], now_ms);
+    }
+    alarm_deliver();
+    xSemaphoreGive(alarm_mutex);
+
+    return ESP_OK;
+}
+
+/* Must be called with alarm_mutex held */
+static esp_err_t alarm_acknowledge_record(alarm_record_t *record, uint32_t now_ms)
+{
+    const char *name = NULL;
+    sensor_data_t *sensors = NULL;
+    uint8_t count = 0;
+    sensor_read_all(&sensors, &count);
+    for (int i = 0; i < count; i++) {
+        if (sensors[i].id == record->status.sensor_id) name = sensors[i].name;
+    }
+
+    if (record->status.state == ALARM_STATE_ACTIVE) {
+        alarm_transition(record, ALARM_STATE_ACKNOWLEDGED, name, now_ms);
+    } else if (record->status.state == ALARM_STATE_CLEARED) {
+        alarm_transition(record, ALARM_STATE_NORMAL, name, now_ms);
+    } else {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t alarm_engine_acknowledge(uint8_t sensor_id)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    alarm_record_t *record = alarm_record(sensor_id, false);
+    esp_err_t err = record ? alarm_acknowledge_record(record, xTaskGetTickCount() * portTICK_PERIOD_MS)
+                           : ESP_ERR_NOT_FOUND;
+    alarm_deliver();
+    xSemaphoreGive(alarm_mutex);
+
+    return err;
+}
+
+esp_err_t alarm_engine_acknowledge_all(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    for (int i = 0; i < record_count; i++) {
+        alarm_acknowledge_record(&records[i], now_ms);
+    }
+    alarm_deliver();
+    xSemaphoreGive(alarm_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t alarm_engine_get_status(uint8_t sensor_id, alarm_status_t *status)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    alarm_record_t *record = alarm_record(sensor_id, false);
+    if (record) *status = record->status;
+    xSemaphoreGive(alarm_mutex);
+
+    return record ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t alarm_engine_get_standing(alarm_status_t *alarms, uint8_t max_count, uint8_t *count)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    *count = 0;
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    for (int i = 0; i < record_count && *count < max_count; i++) {
+        alarm_state_t state = records[i].status.state;
+        if (state != ALARM_STATE_NORMAL && state != ALARM_STATE_PENDING) {
+            alarms[(*count)++] = records[i].status;
+        }
+    }
+    xSemaphoreGive(alarm_mutex);
+    return ESP_OK;
+}
+
+void alarm_engine_get_summary(uint8_t *raised, uint8_t *unacknowledged)
+{
+    uint8_t r = 0, u = 0;
+    if (initialized) {
+        xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+        for (int i = 0; i < record_count; i++) {
+            alarm_state_t state = records[i].status.state;
+            if (state == ALARM_STATE_ACTIVE || state == ALARM_STATE_ACKNOWLEDGED) r++;
+            if (state == ALARM_STATE_ACTIVE || state == ALARM_STATE_CLEARED) u++;
+        }
+        xSemaphoreGive(alarm_mutex);
+    }
+    if (raised) *raised = r;
+    if (unacknowledged) *unacknowledged = u;
+}
+
+esp_err_t alarm_engine_set_profile(sensor_type_t type, const alarm_profile_t *profile)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (type >= ALARM_PROFILE_COUNT || profile == NULL || profile->hysteresis < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    profiles[type] = *profile;
+    xSemaphoreGive(alarm_mutex);
+
+    ESP_LOGI(TAG, "%s alarms: hysteresis %.2f, on %lu ms, off %lu ms", sensor_type_to_string(type),
+             profile->hysteresis, (unsigned long)profile->on_delay_ms, (unsigned long)profile->off_delay_ms);
+    return ESP_OK;
+}
+
+esp_err_t alarm_engine_get_profile(sensor_type_t type, alarm_profile_t *profile)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (type >= ALARM_PROFILE_COUNT || profile == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    *profile = profiles[type];
+    xSemaphoreGive(alarm_mutex);
+    return ESP_OK;
+}
+
+void alarm_engine_set_callback(alarm_callback_t callback)
+{
+    user_callback = callback;
+}
+
+const char* alarm_state_to_string(alarm_state_t state)
+{
+    switch (state) {
+        case ALARM_STATE_NORMAL: return "Normal";
+        case ALARM_STATE_PENDING: return "Pending";
+        case ALARM_STATE_ACTIVE: return "Active";
+        case ALARM_STATE_ACKNOWLEDGED: return "Acknowledged";
+        case ALARM_STATE_CLEARED: return "Cleared";
+        default: return "Unknown";
+    }
+}
+
+const char* alarm_limit_to_string(alarm_limit_t limit)
+{
+    switch (limit) {
+        case ALARM_LIMIT_LOW: return "low";
+        case ALARM_LIMIT_HIGH: return "high";
+        default: return "none";
+    }
+}
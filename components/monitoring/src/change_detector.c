@@ -0,0 +1,311 @@
+#include "monitoring/change_detector.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <string.h>
+#include "utils/config.h"
+#include "utils/metrics.h"
+
+static const char *TAG = "CHANGE";
+
+#define CHANGE_SLOT_NONE        0xFF
+#define CHANGE_PROFILE_COUNT    (SENSOR_TYPE_HEAT_INDEX + 1)
+
+/* A single glitch moves the statistics by at most this many sigmas */
+#define CHANGE_Z_CLAMP          4.0f
+
+/* While raised the baseline follows this many times slower */
+#define CHANGE_RAISED_SLOWDOWN  4.0f
+
+/* Sums stop growing here so a long excursion can still clear */
+#define CHANGE_CUSUM_CAP        (2.0f * CHANGE_CUSUM_H)
+
+typedef struct {
+    change_status_t status;
+    float variance;
+    float window_sum;
+    uint16_t window_count;
+    uint32_t window_start;
+    uint32_t last_time;         /* end of the last window */
+} change_record_t;
+
+static change_record_t records[CONFIG_MAX_SENSORS];
+static uint8_t record_count = 0;
+static uint8_t slot_of[256];
+static change_profile_t profiles[CHANGE_PROFILE_COUNT];
+
+static change_event_t pending_events[CONFIG_MAX_SENSORS];
+static uint8_t pending_count = 0;
+
+static change_callback_t user_callback = NULL;
+static SemaphoreHandle_t change_mutex = NULL;
+static volatile bool initialized = false;
+static metric_t detections;
+
+static void change_default_profiles(void)
+{
+    /* Sensors that step on purpose (lights, refills, doors) are left out */
+    memset(profiles, 0, sizeof(profiles));
+    profiles[SENSOR_TYPE_TEMPERATURE].noise_floor = 0.2f;
+    profiles[SENSOR_TYPE_HUMIDITY].noise_floor = 1.0f;
+    profiles[SENSOR_TYPE_PRESSURE].noise_floor = 0.5f;
+    profiles[SENSOR_TYPE_AMMONIA].noise_floor = 1.0f;
+    profiles[SENSOR_TYPE_CO2].noise_floor = 25.0f;
+    profiles[SENSOR_TYPE_CO].noise_floor = 2.0f;
+    profiles[SENSOR_TYPE_METHANE].noise_floor = 2.0f;
+    profiles[SENSOR_TYPE_HEAT_INDEX].noise_floor = 0.3f;
+}
+
+esp_err_t change_detector_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    change_mutex = xSemaphoreCreateMutex();
+    if (change_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create change detector mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(records, 0, sizeof(records));
+    memset(slot_of, CHANGE_SLOT_NONE, sizeof(slot_of));
+    record_count = 0;
+    pending_count = 0;
+    change_default_profiles();
+    metric_register(&detections, "sensor_changes_total", "Drifts and shifts raised by the change detector",
+                    METRIC_COUNTER);
+
+    initialized = true;
+    ESP_LOGI(TAG, "Change detector initialized: baseline %d min, warm-up %d min",
+             CONFIG_CHANGE_BASELINE_MIN, CONFIG_CHANGE_WARMUP_MIN);
+    return ESP_OK;
+}
+
+/* Must be called with change_mutex held */
+static change_record_t *change_record(uint8_t sensor_id, bool create)
+{
+    if (slot_of[sensor_id] != CHANGE_SLOT_NONE) return &records[slot_of[sensor_id]];
+    if (!create || record_count >= CONFIG_MAX_SENSORS) return NULL;
+
+    change_record_t *record = &records[record_count];
+    memset(record, 0, sizeof(*record));
+    record->status.sensor_id = sensor_id;
+    slot_of[sensor_id] = record_count++;
+    return record;
+}
+
+/* Exponentially weighted mean and variance; alpha 1 restarts them at x */
+static void change_update_baseline(change_record_t *record, float x, float alpha)
+{
+    float diff = x - record->status.baseline;
+    float increment = alpha * diff;
+    record->status.baseline += increment;
+    record->variance = (1.0f - alpha) * (record->variance + diff * increment);
+}
+
+/* Must be called with change_mutex held */
+static void change_report(const change_record_t *record, const sensor_data_t *sensor, float value, bool raised,
+                          change_direction_t direction, uint8_t detectors, uint32_t now_ms)
+{
+    if (pending_count >= CONFIG_MAX_SENSORS) return;
+
+    change_event_t *event = &pending_events[pending_count++];
+    memset(event, 0, sizeof(*event));
+    event->timestamp = now_ms;
+    event->sensor_id = sensor->id;
+    strncpy(event->sensor_name, sensor->name, sizeof(event->sensor_name) - 1);
+    event->value = value;
+    event->baseline = record->status.baseline;
+    event->sigma = record->status.sigma;
+    event->raised = raised;
+    event->direction = direction;
+    event->detectors = detectors;
+}
+
+/* Must be called with change_mutex held */
+static void change_update(change_record_t *record, const sensor_data_t *sensor, float noise_floor, uint32_t now_ms)
+{
+    change_status_t *status = &record->status;
+
+    if (record->window_count == 0) record->window_start = now_ms;
+    record->window_sum += sensor->value;
+    record->window_count++;
+    if (now_ms - record->window_start < CHANGE_WINDOW_MS) return;
+
+    /* The detectors see one mean per window */
+    float x = record->window_sum / record->window_count;
+    record->window_sum = 0.0f;
+    record->window_count = 0;
+
+    float tau = CONFIG_CHANGE_BASELINE_MIN * 60000.0f;
+    float dt = status->samples > 0 ? (float)(now_ms - record->last_time) : 0.0f;
+    float alpha = dt / (tau + dt);
+
+    record->last_time = now_ms;
+    status->samples++;
+
+    if (status->samples <= CONFIG_CHANGE_WARMUP_MIN * 60000 / CHANGE_WINDOW_MS) {
+        /* Plain running mean until the exponential weights take over */
+        float warmup = 1.0f / status->samples;
+        change_update_baseline(record, x, warmup > alpha ? warmup : alpha);
+        status->sigma = fmaxf(sqrtf(record->variance), noise_floor);
+        return;
+    }
+
+    float z = (x - status->baseline) / status->sigma;
+    z = fminf(fmaxf(z, -CHANGE_Z_CLAMP), CHANGE_Z_CLAMP);
+
+    status->ewma = CHANGE_EWMA_LAMBDA * z + (1.0f - CHANGE_EWMA_LAMBDA) * status->ewma;
+    status->cusum_high = fminf(fmaxf(0.0f, status->cusum_high + z - CHANGE_CUSUM_K), CHANGE_CUSUM_CAP);
+    status->cusum_low = fminf(fmaxf(0.0f, status->cusum_low - z - CHANGE_CUSUM_K), CHANGE_CUSUM_CAP);
+
+    /* Asymptotic EWMA control limit */
+    float limit = CHANGE_EWMA_L * sqrtf(CHANGE_EWMA_LAMBDA / (2.0f - CHANGE_EWMA_LAMBDA));
+    uint8_t detectors = 0;
+    change_direction_t direction = CHANGE_DIRECTION_NONE;
+    if (fabsf(status->ewma) > limit) {
+        detectors |= CHANGE_DETECTOR_EWMA;
+        direction = status->ewma > 0 ? CHANGE_DIRECTION_RISING : CHANGE_DIRECTION_FALLING;
+    }
+    if (status->cusum_high > CHANGE_CUSUM_H || status->cusum_low > CHANGE_CUSUM_H) {
+        detectors |= CHANGE_DETECTOR_CUSUM;
+        if (direction == CHANGE_DIRECTION_NONE) {
+            direction = status->cusum_high > status->cusum_low ? CHANGE_DIRECTION_RISING : CHANGE_DIRECTION_FALLING;
+        }
+    }
+
+    if (status->direction == CHANGE_DIRECTION_NONE && detectors != 0) {
+        status->direction = direction;
+        status->detectors = detectors;
+        metric_inc(&detections);
+        change_report(record, sensor, x, true, direction, detectors, now_ms);
+    } else if (status->direction != CHANGE_DIRECTION_NONE) {
+        status->detectors |= detectors;
+        bool settled = fabsf(status->ewma) < limit / 2 &&
+                       status->cusum_high < CHANGE_CUSUM_H / 2 && status->cusum_low < CHANGE_CUSUM_H / 2;
+        if (settled) {
+            change_report(record, sensor, x, false, status->direction, status->detectors, now_ms);
+            status->direction = CHANGE_DIRECTION_NONE;
+            status->detectors = 0;
+        }
+    }
+
+    /* Held back while raised so a continuing drift is not learnt as normal */
+    if (status->direction != CHANGE_DIRECTION_NONE) alpha /= CHANGE_RAISED_SLOWDOWN;
+    change_update_baseline(record, x, alpha);
+    status->sigma = fmaxf(sqrtf(record->variance), noise_floor);
+}
+
+/* Must be called with change_mutex held; the callback must not call back into the detector */
+static void change_deliver(void)
+{
+    if (user_callback) {
+        for (int i = 0; i < pending_count; i++) {
+            user_callback(&pending_events[i]);
+        }
+    }
+    pending_count = 0;
+}
+
+esp_err_t change_detector_process(const sensor_data_t *sensors, uint8_t sensor_count, uint32_t now_ms)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (sensors == NULL && sensor_count > 0) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    for (int i = 0; i < sensor_count; i++) {
+        const sensor_data_t *sensor = &sensors[i];
+        if (sensor->type >= CHANGE_PROFILE_COUNT) continue;
+
+        float noise_floor = profiles[sensor->type].noise_floor;
+        if (!sensor->enabled || noise_floor <= 0.0f) continue;
+        /* Faulted sensors hold their statistics */
+        if (sensor->status != SENSOR_STATUS_OK) continue;
+
+        change_record_t *record = change_record(sensor->id, true);
+        if (record == NULL) continue;
+        change_update(record, sensor, noise_floor, now_ms);
+    }
+    change_deliver();
+    xSemaphoreGive(change_mutex);
+    return ESP_OK;
+}
+
+esp_err_t change_detector_reset(uint8_t sensor_id)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    change_record_t *record = change_record(sensor_id, false);
+    if (record != NULL) {
+        memset(record, 0, sizeof(*record));
+        record->status.sensor_id = sensor_id;
+    }
+    xSemaphoreGive(change_mutex);
+    return record != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t change_detector_get_status(uint8_t sensor_id, change_status_t *status)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (status == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    change_record_t *record = change_record(sensor_id, false);
+    if (record != NULL) *status = record->status;
+    xSemaphoreGive(change_mutex);
+    return record != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+uint8_t change_detector_get_raised_count(void)
+{
+    if (!initialized) return 0;
+
+    uint8_t raised = 0;
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    for (int i = 0; i < record_count; i++) {
+        if (records[i].status.direction != CHANGE_DIRECTION_NONE) raised++;
+    }
+    xSemaphoreGive(change_mutex);
+    return raised;
+}
+
+esp_err_t change_detector_set_profile(sensor_type_t type, const change_profile_t *profile)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (type >= CHANGE_PROFILE_COUNT || profile == NULL || profile->noise_floor < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    profiles[type] = *profile;
+    xSemaphoreGive(change_mutex);
+
+    ESP_LOGI(TAG, "%s change detection: noise floor %.2f", sensor_type_to_string(type), profile->noise_floor);
+    return ESP_OK;
+}
+
+esp_err_t change_detector_get_profile(sensor_type_t type, change_profile_t *profile)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (type >= CHANGE_PROFILE_COUNT || profile == NULL) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(change_mutex, portMAX_DELAY);
+    *profile = profiles[type];
+    xSemaphoreGive(change_mutex);
+    return ESP_OK;
+}
+
+void change_detector_set_callback(change_callback_t callback)
+{
+    user_callback = callback;
+}
+
+const char* change_direction_to_string(change_direction_t direction)
+{
+    switch (direction) {
+        case CHANGE_DIRECTION_RISING: return "rising";
+        case CHANGE_DIRECTION_FALLING: return "falling";
+        default: return "steady";
+    }
+}
@@ -0,0 +1,439 @@
+#include "monitoring/data_export.h"
+#include "monitoring/monitoring.h"
+#include "monitoring/event_journal.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sensors/sensor_manager.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "EXPORT";
+
+#define DATA_EXPORT_VERSION     1
+
+/* Longest record in any format: a JSON event with every character escaped */
+#define DATA_EXPORT_MAX_RECORD  600
+
+_Static_assert(DATA_EXPORT_CHUNK_SIZE >= DATA_EXPORT_MAX_RECORD, "every record must fit an empty chunk");
+
+enum {
+    RECORD_SECTION = 0,
+    RECORD_POINT = 1,
+    RECORD_ALARM = 2,
+    RECORD_EVENT = 3
+};
+
+/* Room left in the chunk for the record being built */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t length;
+    bool overflow;
+} writer_t;
+
+typedef struct {
+    data_export_t *job;
+    data_export_cursor_t *cursor;   /* working copy, moved past each record written */
+    bool full;
+} fill_t;
+
+static writer_t writer_open(data_export_t *job)
+{
+    writer_t w = {
+        .data = job->chunk + job->length,
+        .size = DATA_EXPORT_CHUNK_SIZE - job->length,
+    };
+    return w;
+}
+
+/* Keeps the record if it fitted; otherwise the chunk is full */
+static bool writer_close(fill_t *f, const writer_t *w)
+{
+    if (w->overflow) {
+        f->full = true;
+        return false;
+    }
+    f->job->length += w->length;
+    return true;
+}
+
+static void put_bytes(writer_t *w, const void *data, size_t length)
+{
+    if (w->overflow || w->length + length > w->size) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->data + w->length, data, length);
+    w->length += length;
+}
+
+static void put_u8(writer_t *w, uint8_t value)
+{
+    put_bytes(w, &value, 1);
+}
+
+/* The ESP32 is little-endian, as is the binary format */
+static void put_u32(writer_t *w, uint32_t value)
+{
+    put_bytes(w, &value, 4);
+}
+
+static void put_f32(writer_t *w, float value)
+{
+    put_bytes(w, &value, 4);
+}
+
+static void put_format(writer_t *w, const char *format, ...)
+{
+    if (w->overflow) return;
+
+    va_list args;
+    va_start(args, format);
+    size_t room = w->size - w->length;
+    int n = vsnprintf((char *)w->data + w->length, room, format, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= room) {
+        w->overflow = true;
+        return;
+    }
+    w->length += n;
+}
+
+/* Empty in CSV and null in JSON when not a number */
+static void put_float(writer_t *w, data_export_format_t format, float value)
+{
+    if (isfinite(value)) {
+        put_format(w, "%.7g", value);
+    } else if (format == DATA_EXPORT_JSON_LINES) {
+        put_format(w, "null");
+    }
+}
+
+/* Quoted text; control characters become spaces so a record stays on one line */
+static void put_text(writer_t *w, data_export_format_t format, const char *text, size_t length)
+{
+    put_u8(w, '"');
+    for (size_t i = 0; i < length && text[i] != '\0'; i++) {
+        char c = text[i];
+        if ((unsigned char)c < 0x20) c = ' ';
+        if (c == '"') {
+            put_u8(w, format == DATA_EXPORT_CSV ? '"' : '\\');
+        } else if (c == '\\' && format == DATA_EXPORT_JSON_LINES) {
+            put_u8(w, '\\');
+        }
+        put_u8(w, c);
+    }
+    put_u8(w, '"');
+}
+
+static bool write_section(fill_t *f)
+{
+    writer_t w = writer_open(f->job);
+
+    switch (f->job->format) {
+        case DATA_EXPORT_CSV:
+            if (f->cursor->section == DATA_EXPORT_HISTORY) {
+                put_format(&w, "timestamp,sensor_id,value\n");
+            } else if (f->cursor->section == DATA_EXPORT_ALARMS) {
+                put_format(&w, "uptime_ms,sensor_id,sensor,state,limit,value,threshold_min,threshold_max\n");
+            } else {
+                put_format(&w, "timestamp,severity,text\n");
+            }
+            break;
+        case DATA_EXPORT_BINARY:
+            put_u8(&w, RECORD_SECTION);
+            put_u8(&w, 2);
+            put_u8(&w, DATA_EXPORT_VERSION);
+            put_u8(&w, f->cursor->section);
+            break;
+        default:
+            /* JSON records carry their own type */
+            break;
+    }
+    return writer_close(f, &w);
+}
+
+static bool write_point(fill_t *f, uint8_t sensor_id, const tsdb_point_t *point)
+{
+    writer_t w = writer_open(f->job);
+
+    switch (f->job->format) {
+        case DATA_EXPORT_CSV:
+            put_format(&w, "%lu,%u,", (unsigned long)point->timestamp, sensor_id);
+            put_float(&w, DATA_EXPORT_CSV, point->value);
+            put_u8(&w, '\n');
+            break;
+        case DATA_EXPORT_JSON_LINES:
+            put_format(&w, "{\"type\":\"point\",\"timestamp\":%lu,\"sensor_id\":%u,\"value\":",
+                       (unsigned long)point->timestamp, sensor_id);
+            put_float(&w, DATA_EXPORT_JSON_LINES, point->value);
+            put_format(&w, "}\n");
+            break;
+        default:
+            put_u8(&w, RECORD_POINT);
+            put_u8(&w, 9);
+            put_u32(&w, point->timestamp);
+            put_u8(&w, sensor_id);
+            put_f32(&w, point->value);
+            break;
+    }
+    return writer_close(f, &w);
+}
+
+static bool write_alarm(fill_t *f, const alarm_event_t *event)
+{
+    writer_t w = writer_open(f->job);
+    data_export_format_t format = f->job->format;
+    size_t name_length = strnlen(event->sensor_name, sizeof(event->sensor_name) - 1);
+
+    if (format == DATA_EXPORT_BINARY) {
+        put_u8(&w, RECORD_ALARM);
+        put_u8(&w, 19 + name_length);
+        put_u32(&w, event->timestamp);
+        put_u8(&w, event->sensor_id);
+        put_u8(&w, event->state);
+        put_u8(&w, event->limit);
+        put_f32(&w, event->value);
+        put_f32(&w, event->threshold_min);
+        put_f32(&w, event->threshold_max);
+        put_bytes(&w, event->sensor_name, name_length);
+        return writer_close(f, &w);
+    }
+
+    if (format == DATA_EXPORT_CSV) {
+        put_format(&w, "%lu,%u,", (unsigned long)event->timestamp, event->sensor_id);
+        put_text(&w, format, event->sensor_name, name_length);
+        put_format(&w, ",%s,%s,", alarm_state_to_string(event->state), alarm_limit_to_string(event->limit));
+        put_float(&w, format, event->value);
+        put_u8(&w, ',');
+        put_float(&w, format, event->threshold_min);
+        put_u8(&w, ',');
+        put_float(&w, format, event->threshold_max);
+        put_u8(&w, '\n');
+    } else {
+        put_format(&w, "{\"type\":\"alarm\",\"uptime_ms\":%lu,\"sensor_id\":%u,\"sensor\":",
+                   (unsigned long)event->timestamp, event->sensor_id);
+        put_text(&w, format, event->sensor_name, name_length);
+        put_format(&w, ",\"state\":\"%s\",\"limit\":\"%s\",\"value\":",
+                   alarm_state_to_string(event->state), alarm_limit_to_string(event->limit));
+        put_float(&w, format, event->value);
+        put_format(&w, ",\"threshold_min\":");
+        put_float(&w, format, event->threshold_min);
+        put_format(&w, ",\"threshold_max\":");
+        put_float(&w, format, event->threshold_max);
+        put_format(&w, "}\n");
+    }
+    return writer_close(f, &w);
+}
+
+static bool write_event(fill_t *f, uint32_t timestamp, uint8_t severity, const char *text, size_t length)
+{
+    writer_t w = writer_open(f->job);
+
+    switch (f->job->format) {
+        case DATA_EXPORT_CSV:
+            put_format(&w, "%lu,%u,", (unsigned long)timestamp, severity);
+            put_text(&w, DATA_EXPORT_CSV, text, length);
+            put_u8(&w, '\n');
+            break;
+        case DATA_EXPORT_JSON_LINES:
+            put_format(&w, "{\"type\":\"event\",\"timestamp\":%lu,\"severity\":%u,\"text\":",
+                       (unsigned long)timestamp, severity);
+            put_text(&w, DATA_EXPORT_JSON_LINES, text, length);
+            put_format(&w, "}\n");
+            break;
+        default:
+            put_u8(&w, RECORD_EVENT);
+            put_u8(&w, 5 + length);
+            put_u32(&w, timestamp);
+            put_u8(&w, severity);
+            put_bytes(&w, text, length);
+            break;
+    }
+    return writer_close(f, &w);
+}
+
+static bool history_visitor(const tsdb_point_t *point, void *context)
+{
+    fill_t *f = context;
+    if (!write_point(f, f->cursor->sensor_id, point)) return false;
+    f->cursor->position = (uint64_t)point->timestamp + 1;
+    return true;
+}
+
+/* Lowest registered sensor id at or above from, or -1 */
+static int next_sensor(const sensor_data_t *sensors, uint8_t count, uint8_t from)
+{
+    int id = -1;
+    for (int i = 0; i < count; i++) {
+        if (sensors[i].id >= from && (id < 0 || sensors[i].id < id)) id = sensors[i].id;
+    }
+    return id;
+}
+
+/* Returns true when the section is done, false when the chunk is full */
+static bool fill_history(fill_t *f)
+{
+    data_export_cursor_t *cursor = f->cursor;
+    sensor_data_t *sensors = NULL;
+    uint8_t count = 0;
+
+    if (sensor_read_all(&sensors, &count) != ESP_OK) return true;
+
+    for (;;) {
+        int id = next_sensor(sensors, count, cursor->sensor_id);
+        if (id < 0) return true;
+        if (id != cursor->sensor_id) {
+            cursor->sensor_id = id;
+            cursor->position = f->job->from;
+        }
+        if (cursor->position <= f->job->to) {
+            /* The store is only locked while the chunk fills */
+            if (tsdb_query(id, (uint32_t)cursor->position, f->job->to, history_visitor, f) != ESP_OK) return true;
+            if (f->full) return false;
+        }
+        if (id == UINT8_MAX) return true;
+        cursor->sensor_id = id + 1;
+        cursor->position = f->job->from;
+    }
+}
+
+static bool fill_alarms(fill_t *f)
+{
+    uint32_t sequence = (uint32_t)f->cursor->position;
+    alarm_event_t event;
+
+    while (monitoring_read_alarm(&sequence, &event) == ESP_OK) {
+        if (!write_alarm(f, &event)) return false;
+        f->cursor->position = ++sequence;
+    }
+    return true;
+}
+
+static bool event_visitor(const journal_record_t *record, const void *payload, void *context)
+{
+    fill_t *f = context;
+    const uint8_t *bytes = payload;
+
+    if (record->timestamp < f->job->from || record->timestamp > f->job->to) return true;
+
+    if (record->type == JOURNAL_RECORD_EVENT && record->length > 0) {
+        return write_event(f, record->timestamp, bytes[0], (const char *)bytes + 1, record->length - 1);
+    }
+    if (record->type == JOURNAL_RECORD_BOOT && record->length >= sizeof(journal_boot_t)) {
+        journal_boot_t boot;
+        char text[32];
+        memcpy(&boot, payload, sizeof(boot));
+        int n = snprintf(text, sizeof(text), "Boot, reset reason %lu", (unsigned long)boot.reset_reason);
+        return write_event(f, record->timestamp, 3, text, n);
+    }
+    return true;
+}
+
+static bool fill_events(fill_t *f)
+{
+    /* Without a journal there is nothing to export */
+    if (event_journal_read_from(&f->cursor->position, event_visitor, f) != ESP_OK) return true;
+    return !f->full;
+}
+
+static void next_section(const data_export_t *job, data_export_cursor_t *cursor)
+{
+    uint8_t section = cursor->section ? cursor->section << 1 : DATA_EXPORT_HISTORY;
+    while (section <= DATA_EXPORT_EVENTS && !(job->sections & section)) section <<= 1;
+
+    cursor->section = section <= DATA_EXPORT_EVENTS ? section : 0;
+    cursor->sensor_id = 0;
+    cursor->section_open = false;
+    cursor->position = cursor->section == DATA_EXPORT_HISTORY ? job->from : 0;
+}
+
+/* Fills the chunk with whole records from cursor on, moving it past them */
+static void fill_chunk(data_export_t *job, data_export_cursor_t *cursor)
+{
+    fill_t f = { .job = job, .cursor = cursor, .full = false };
+
+    job->length = 0;
+    while (cursor->section != 0) {
+        if (!cursor->section_open) {
+            if (!write_section(&f)) return;
+            cursor->section_open = true;
+        }
+
+        bool done;
+        if (cursor->section == DATA_EXPORT_HISTORY) {
+            done = fill_history(&f);
+        } else if (cursor->section == DATA_EXPORT_ALARMS) {
+            done = fill_alarms(&f);
+        } else {
+            done = fill_events(&f);
+        }
+        if (!done) return;
+        next_section(job, cursor);
+    }
+}
+
+esp_err_t data_export_begin(data_export_t *job, data_export_format_t format, uint8_t sections,
+                            uint32_t from, uint32_t to, const data_export_cursor_t *resume)
+{
+    if (job == NULL || format > DATA_EXPORT_BINARY || (sections & DATA_EXPORT_ALL) == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    job->format = format;
+    job->sections = sections & DATA_EXPORT_ALL;
+    job->from = from;
+    job->to = to != 0 ? to : UINT32_MAX;
+    job->chunks = 0;
+    job->bytes = 0;
+    job->length = 0;
+
+    if (resume != NULL) {
+        job->cursor = *resume;
+    } else {
+        memset(&job->cursor, 0, sizeof(job->cursor));
+        next_section(job, &job->cursor);
+    }
+
+    /* Staged journal records become readable once written */
+    if (job->sections & DATA_EXPORT_EVENTS) event_journal_flush();
+    return ESP_OK;
+}
+
+esp_err_t data_export_run(data_export_t *job, data_export_sink_t sink, void *context, uint16_t max_chunks)
+{
+    if (job == NULL || sink == NULL) return ESP_ERR_INVALID_ARG;
+
+    for (uint16_t n = 0; job->cursor.section != 0 && (max_chunks == 0 || n < max_chunks); n++) {
+        /* Let lower-priority tasks in between chunks */
+        if (n > 0) vTaskDelay(1);
+
+        data_export_cursor_t next = job->cursor;
+        fill_chunk(job, &next);
+        if (job->length > 0) {
+            esp_err_t ret = sink(job->chunk, job->length, context);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Sink failed after %lu chunks: %s", (unsigned long)job->chunks, esp_err_to_name(ret));
+                return ret;
+            }
+            job->chunks++;
+            job->bytes += job->length;
+        }
+        job->cursor = next;
+
+        if (job->cursor.section == 0) {
+            ESP_LOGI(TAG, "Export finished: %lu chunks, %lu bytes",
+                     (unsigned long)job->chunks, (unsigned long)job->bytes);
+        }
+    }
+    return ESP_OK;
+}
+
+bool data_export_finished(const data_export_t *job)
+{
+    return job->cursor.section == 0;
+}
@@ -0,0 +1,452 @@
+#include "monitoring/event_journal.h"
+#include "monitoring/event_log.h"
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string.h>
+#include <time.h>
+#include "utils/config.h"
+
+static const char *TAG = "JOURNAL";
+
+#define JOURNAL_PARTITION       "journal"
+#define JOURNAL_SECTOR_SIZE     4096
+#define JOURNAL_PAGE_SIZE       256
+#define JOURNAL_BUFFER_SIZE     1024
+#define JOURNAL_POLL_MS         500
+#define JOURNAL_MAGIC           0x4C4E524A      /* "JRNL" */
+#define JOURNAL_VERSION         1
+#define JOURNAL_ERASED16        0xFFFF
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t crc;               /* over the fields above */
+} journal_sector_header_t;
+
+typedef struct {
+    uint16_t length;            /* payload bytes */
+    uint16_t type;
+    uint32_t timestamp;
+    uint32_t crc;               /* over length, type, timestamp and payload */
+} journal_record_header_t;
+
+#define JOURNAL_FIRST_RECORD    sizeof(journal_sector_header_t)
+#define JOURNAL_RECORD_SIZE(n)  ((sizeof(journal_record_header_t) + (n) + 3) & ~3u)
+
+_Static_assert(JOURNAL_RECORD_SIZE(EVENT_JOURNAL_MAX_PAYLOAD) <= JOURNAL_BUFFER_SIZE,
+               "a record must fit the staging buffer");
+
+static const esp_partition_t *partition = NULL;
+static uint16_t sector_count = 0;
+static uint16_t active_sector = 0;
+static uint32_t write_offset = 0;      /* in the active sector */
+static uint32_t sequence = 0;
+
+/* Records waiting for the flash, already in their on-flash layout */
+static uint8_t staging[JOURNAL_BUFFER_SIZE];
+static uint16_t staging_len = 0;
+static uint32_t staging_since = 0;
+static bool staging_urgent = false;
+static uint8_t flush_buffer[JOURNAL_BUFFER_SIZE];
+
+static event_journal_stats_t stats = {0};
+static uint32_t event_cursor = 0;
+
+static SemaphoreHandle_t staging_mutex = NULL;
+static SemaphoreHandle_t flash_mutex = NULL;
+static TaskHandle_t journal_task_handle = NULL;
+static volatile bool initialized = false;
+
+static uint32_t now_ms(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static uint32_t sector_crc(const journal_sector_header_t *header)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(journal_sector_header_t, crc));
+}
+
+static uint32_t record_crc(const journal_record_header_t *header, const void *payload)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(journal_record_header_t, crc));
+    return esp_rom_crc32_le(crc, payload, header->length);
+}
+
+static bool read_sector_header(uint16_t sector, journal_sector_header_t *header)
+{
+    if (esp_partition_read(partition, (size_t)sector * JOURNAL_SECTOR_SIZE, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == JOURNAL_MAGIC && header->version == JOURNAL_VERSION &&
+           header->crc == sector_crc(header);
+}
+
+/*
+ * Reads the record at offset in sector. Returns 1 for a good record, 0 at
+ * the end of the written area and -1 for a torn or corrupt record.
+ */
+static int read_record(uint16_t sector, uint32_t offset, journal_record_header_t *header, uint8_t *payload)
+{
+    size_t base = (size_t)sector * JOURNAL_SECTOR_SIZE;
+
+    if (offset + sizeof(*header) > JOURNAL_SECTOR_SIZE) return 0;
+    if (esp_partition_read(partition, base + offset, header, sizeof(*header)) != ESP_OK) return -1;
+    if (header->length == JOURNAL_ERASED16 && header->type == JOURNAL_ERASED16) return 0;
+    if (header->length > EVENT_JOURNAL_MAX_PAYLOAD ||
+        offset + JOURNAL_RECORD_SIZE(header->length) > JOURNAL_SECTOR_SIZE) return -1;
+    if (esp_partition_read(partition, base + offset + sizeof(*header), payload, header->length) != ESP_OK) {
+        return -1;
+    }
+    return header->crc == record_crc(header, payload) ? 1 : -1;
+}
+
+/* Erases the next sector in the ring and opens it; the oldest data goes */
+static esp_err_t open_next_sector(void)
+{
+    uint16_t next = (active_sector + 1) % sector_count;
+    esp_err_t ret = esp_partition_erase_range(partition, (size_t)next * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE);
+    stats.sector_erases++;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %d: %s", next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    journal_sector_header_t header = {
+        .magic = JOURNAL_MAGIC,
+        .sequence = sequence + 1,
+        .version = JOURNAL_VERSION,
+        .reserved = JOURNAL_ERASED16,
+    };
+    header.crc = sector_crc(&header);
+    ret = esp_partition_write(partition, (size_t)next * JOURNAL_SECTOR_SIZE, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open sector %d: %s", next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    active_sector = next;
+    sequence = header.sequence;
+    write_offset = JOURNAL_FIRST_RECORD;
+    return ESP_OK;
+}
+
+/* Programs data at the append point, one flash page per call */
+static esp_err_t write_run(const uint8_t *data, uint32_t length)
+{
+    size_t address = (size_t)active_sector * JOURNAL_SECTOR_SIZE + write_offset;
+
+    while (length > 0) {
+        uint32_t chunk = JOURNAL_PAGE_SIZE - (address % JOURNAL_PAGE_SIZE);
+        if (chunk > length) chunk = length;
+
+        esp_err_t ret = esp_partition_write(partition, address, data, chunk);
+        if (ret != ESP_OK) {
+            /* Whatever was half-programmed fails its CRC; continue in a fresh sector */
+            ESP_LOGE(TAG, "Write failed at 0x%x: %s", (unsigned)address, esp_err_to_name(ret));
+            write_offset = JOURNAL_SECTOR_SIZE;
+            return ret;
+        }
+        address += chunk;
+        data += chunk;
+        length -= chunk;
+        write_offset += chunk;
+        stats.bytes_written += chunk;
+    }
+    return ESP_OK;
+}
+
+/* Moves the staging buffer to flash; the caller holds flash_mutex */
+static esp_err_t flush_locked(void)
+{
+    xSemaphoreTake(staging_mutex, portMAX_DELAY);
+    uint16_t length = staging_len;
+    memcpy(flush_buffer, staging, length);
+    staging_len = 0;
+    staging_urgent = false;
+    xSemaphoreGive(staging_mutex);
+
+    if (length == 0) return ESP_OK;
+
+    /* Records never straddle sectors: write runs up to each sector end */
+    esp_err_t ret = ESP_OK;
+    uint32_t run_start = 0;
+    uint32_t offset = 0;
+    uint32_t room = JOURNAL_SECTOR_SIZE - write_offset;
+    while (offset < length) {
+        const journal_record_header_t *header = (const journal_record_header_t *)(flush_buffer + offset);
+        uint32_t size = JOURNAL_RECORD_SIZE(header->length);
+
+        if (offset + size - run_start > room) {
+            if (offset > run_start) {
+                ret = write_run(flush_buffer + run_start, offset - run_start);
+                if (ret != ESP_OK) break;
+            }
+            ret = open_next_sector();
+            if (ret != ESP_OK) break;
+            run_start = offset;
+            room = JOURNAL_SECTOR_SIZE - write_offset;
+        }
+        offset += size;
+    }
+    if (ret == ESP_OK && offset > run_start) {
+        ret = write_run(flush_buffer + run_start, offset - run_start);
+    }
+
+    if (ret == ESP_OK) {
+        stats.flushes++;
+    } else {
+        stats.records_dropped++;
+    }
+    return ret;
+}
+
+static void journal_collect_event(uint32_t timestamp, uint8_t severity, const char *text, void *context)
+{
+    if (severity > CONFIG_JOURNAL_SEVERITY) return;
+
+    uint8_t payload[EVENT_JOURNAL_MAX_PAYLOAD];
+    size_t text_len = strnlen(text, sizeof(payload) - 1);
+    payload[0] = severity;
+    memcpy(payload + 1, text, text_len);
+
+    event_journal_append(JOURNAL_RECORD_EVENT, payload, text_len + 1, severity <= 1);
+}
+
+static void journal_task(void *parameter)
+{
+    ESP_LOGI(TAG, "Journal task started");
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOURNAL_POLL_MS));
+
+        /* Events are copied out of the RAM event log, never pushed by it */
+        event_log_read_from(&event_cursor, journal_collect_event, NULL);
+
+        xSemaphoreTake(staging_mutex, portMAX_DELAY);
+        bool due = staging_len > 0 &&
+                   (staging_urgent || staging_len >= JOURNAL_PAGE_SIZE ||
+                    now_ms() - staging_since >= CONFIG_JOURNAL_FLUSH_INTERVAL_MS);
+        xSemaphoreGive(staging_mutex);
+
+        if (due) {
+            xSemaphoreTake(flash_mutex, portMAX_DELAY);
+            flush_locked();
+            xSemaphoreGive(flash_mutex);
+        }
+    }
+}
+
+/* Finds the newest sector from the headers alone, then its append point */
+static void journal_recover(void)
+{
+    journal_sector_header_t header;
+    bool found = false;
+
+    for (uint16_t s = 0; s < sector_count; s++) {
+        if (!read_sector_header(s, &header)) continue;
+        if (!found || (int32_t)(header.sequence - sequence) > 0) {
+            found = true;
+            sequence = header.sequence;
+            active_sector = s;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "No journal found, formatting");
+        sequence = 0;
+        active_sector = sector_count - 1;
+        write_offset = JOURNAL_SECTOR_SIZE;
+        return;
+    }
+
+    journal_record_header_t record;
+    uint8_t payload[EVENT_JOURNAL_MAX_PAYLOAD];
+    uint32_t offset = JOURNAL_FIRST_RECORD;
+    int result;
+    while ((result = read_record(active_sector, offset, &record, payload)) > 0) {
+        offset += JOURNAL_RECORD_SIZE(record.length);
+    }
+
+    /* Bytes after a torn record are not erased; leave the sector as it is */
+    write_offset = result < 0 ? JOURNAL_SECTOR_SIZE : offset;
+    if (result < 0) {
+        stats.crc_errors++;
+        ESP_LOGW(TAG, "Torn record in sector %d at %lu, closing it", active_sector, (unsigned long)offset);
+    }
+    ESP_LOGI(TAG, "Journal recovered: sector %d, sequence %lu, offset %lu",
+             active_sector, (unsigned long)sequence, (unsigned long)offset);
+}
+
+esp_err_t event_journal_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, JOURNAL_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No \"%s\" partition, events will not persist", JOURNAL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_count = partition->size / JOURNAL_SECTOR_SIZE;
+    if (sector_count < 2) {
+        ESP_LOGE(TAG, "Journal partition too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    staging_mutex = xSemaphoreCreateMutex();
+    flash_mutex = xSemaphoreCreateMutex();
+    if (staging_mutex == NULL || flash_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    journal_recover();
+    initialized = true;
+
+    journal_boot_t boot = {
+        .reset_reason = esp_reset_reason(),
+        .sequence = sequence,
+    };
+    event_journal_append(JOURNAL_RECORD_BOOT, &boot, sizeof(boot), true);
+
+    xTaskCreate(journal_task, "journal_task", 3072, NULL, 2, &journal_task_handle);
+
+    ESP_LOGI(TAG, "Journal initialized: %d sectors", sector_count);
+    return ESP_OK;
+}
+
+esp_err_t event_journal_append(journal_record_type_t type, const void *payload, uint16_t length, bool urgent)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (length > EVENT_JOURNAL_MAX_PAYLOAD) {
+        stats.records_dropped++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    journal_record_header_t header = {
+        .length = length,
+        .type = type,
+        .timestamp = (uint32_t)time(NULL),
+    };
+    header.crc = record_crc(&header, payload);
+    uint32_t size = JOURNAL_RECORD_SIZE(length);
+
+    xSemaphoreTake(staging_mutex, portMAX_DELAY);
+    if (staging_len + size > JOURNAL_BUFFER_SIZE) {
+        xSemaphoreGive(staging_mutex);
+        stats.records_dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+    if (staging_len == 0) staging_since = now_ms();
+
+    uint8_t *record = staging + staging_len;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), payload, length);
+    memset(record + sizeof(header) + length, 0xFF, size - sizeof(header) - length);
+    staging_len += size;
+    staging_urgent |= urgent;
+    stats.records_written++;
+    xSemaphoreGive(staging_mutex);
+
+    if (urgent && journal_task_handle != NULL) xTaskNotifyGive(journal_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t event_journal_flush(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    esp_err_t ret = flush_locked();
+    xSemaphoreGive(flash_mutex);
+    return ret;
+}
+
+esp_err_t event_journal_read(event_journal_visitor_t visitor, void *context)
+{
+    uint64_t position = 0;
+    return event_journal_read_from(&position, visitor, context);
+}
+
+esp_err_t event_journal_read_from(uint64_t *position, event_journal_visitor_t visitor, void *context)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (position == NULL || visitor == NULL) return ESP_ERR_INVALID_ARG;
+
+    journal_sector_header_t sector_header;
+    journal_record_header_t header;
+    uint8_t payload[EVENT_JOURNAL_MAX_PAYLOAD];
+    bool more = true;
+    /* Sector sequence in the upper half, record offset in the lower */
+    uint32_t from_sequence = (uint32_t)(*position >> 32);
+    uint32_t from_offset = (uint32_t)*position;
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+
+    /* Oldest sector first: the one after the active sector in the ring */
+    for (uint16_t i = 1; i <= sector_count && more; i++) {
+        uint16_t s = (active_sector + i) % sector_count;
+        if (!read_sector_header(s, &sector_header)) continue;
+        uint32_t age = sequence - sector_header.sequence;
+        if (age >= sector_count) continue;
+        /* Sectors before the position; 0 reads everything still held */
+        if (*position != 0 && age > (uint32_t)(sequence - from_sequence)) continue;
+
+        uint32_t offset = JOURNAL_FIRST_RECORD;
+        if (*position != 0 && sector_header.sequence == from_sequence && from_offset > offset) {
+            offset = from_offset;
+        }
+        int result;
+        while (more && (result = read_record(s, offset, &header, payload)) > 0) {
+            journal_record_t record = {
+                .type = header.type,
+                .length = header.length,
+                .timestamp = header.timestamp,
+            };
+            more = visitor(&record, payload, context);
+            if (more) {
+                offset += JOURNAL_RECORD_SIZE(header.length);
+                *position = ((uint64_t)sector_header.sequence << 32) | offset;
+            }
+        }
+        if (more && result < 0) stats.crc_errors++;
+    }
+
+    xSemaphoreGive(flash_mutex);
+    return ESP_OK;
+}
+
+esp_err_t event_journal_erase(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    xSemaphoreTake(staging_mutex, portMAX_DELAY);
+    staging_len = 0;
+    staging_urgent = false;
+    xSemaphoreGive(staging_mutex);
+
+    esp_err_t ret = esp_partition_erase_range(partition, 0, (size_t)sector_count * JOURNAL_SECTOR_SIZE);
+    stats.sector_erases += sector_count;
+    if (ret == ESP_OK) {
+        active_sector = sector_count - 1;
+        write_offset = JOURNAL_SECTOR_SIZE;
+    }
+    xSemaphoreGive(flash_mutex);
+
+    ESP_LOGI(TAG, "Journal erased");
+    return ret;
+}
+
+void event_journal_get_stats(event_journal_stats_t *out)
+{
+    *out = stats;
+    out->sequence = sequence;
+    out->sector_count = sector_count;
+    out->active_sector = active_sector;
+    out->write_offset = write_offset;
+}
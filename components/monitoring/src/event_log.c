@@ -0,0 +1,559 @@
+#include "monitoring/event_log.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "EVENT_LOG";
+
+#define EVENT_LOG_WORDS         (CONFIG_EVENT_LOG_SIZE / 4)
+#define EVENT_LOG_WORD_MASK     (EVENT_LOG_WORDS - 1)
+#define EVENT_LOG_HEADER_BYTES  8       /* header word + timestamp */
+
+_Static_assert((CONFIG_EVENT_LOG_SIZE & (CONFIG_EVENT_LOG_SIZE - 1)) == 0,
+               "CONFIG_EVENT_LOG_SIZE must be a power of two");
+_Static_assert(EVENT_LOG_WORDS >= 32, "CONFIG_EVENT_LOG_SIZE too small");
+_Static_assert(EVENT_LOG_MAX_RECORD <= 128 && EVENT_LOG_MAX_RECORD % 4 == 0,
+               "record length must fit the header");
+_Static_assert(EVENT_LOG_MAX_FORMATS < 0x8000, "format id must fit the header");
+
+/*
+ * Header word, stored last as the record's commit:
+ *   bits  0-7   lap, the ring pass the record was written in
+ *   bits  8-12  words - 1
+ *   bits 13-14  padding bytes after the last argument
+ *   bits 15-16  severity (clamped to 3)
+ *   bits 17-31  format id
+ * followed by a timestamp word and the encoded arguments.
+ */
+#define HDR_LAP(h)              ((h) & 0xFF)
+#define HDR_WORDS(h)            ((((h) >> 8) & 0x1F) + 1)
+#define HDR_PAD(h)              (((h) >> 13) & 0x03)
+#define HDR_SEVERITY(h)         (((h) >> 15) & 0x03)
+#define HDR_FORMAT(h)           ((h) >> 17)
+
+typedef enum {
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_UINT,
+    ARG_ULONG,
+    ARG_ULLONG,
+    ARG_SIZE,
+    ARG_DOUBLE,
+    ARG_STRING
+} arg_kind_t;
+
+typedef struct {
+    const char *format;
+    uint8_t arg_count;
+    uint8_t kinds[EVENT_LOG_MAX_ARGS];
+} event_format_t;
+
+/* One conversion, with its length modifier stripped for rendering */
+typedef struct {
+    char text[16];
+    char conversion;
+    arg_kind_t kind;
+} format_spec_t;
+
+static _Atomic uint32_t ring[EVENT_LOG_WORDS];
+static _Atomic uint32_t start_bits[EVENT_LOG_WORDS / 32];
+static _Atomic uint32_t head = 0;       /* bytes reserved since boot */
+static _Atomic uint32_t floor_pos = 0;  /* records before this were cleared */
+
+static event_format_t formats[EVENT_LOG_MAX_FORMATS];
+static _Atomic uint16_t format_count = 0;
+
+static _Atomic uint32_t written_count = 0;
+static _Atomic uint32_t dropped_count = 0;
+static _Atomic uint32_t truncated_count = 0;
+
+static SemaphoreHandle_t intern_mutex = NULL;
+static volatile bool initialized = false;
+
+static uint32_t lap_of(uint32_t pos)
+{
+    return (pos / CONFIG_EVENT_LOG_SIZE) & 0xFF;
+}
+
+/* Oldest position still in the ring and not cleared */
+static uint32_t window_start(uint32_t end)
+{
+    uint32_t start = end - CONFIG_EVENT_LOG_SIZE;
+    uint32_t floor = atomic_load(&floor_pos);
+    if (end < CONFIG_EVENT_LOG_SIZE && floor == 0) return 0;
+    if ((int32_t)(floor - start) > 0 && (int32_t)(end - floor) >= 0) return floor;
+    return start;
+}
+
+/* Parses the conversion at *p (just past '%'); NULL if it is not supported */
+static const char* parse_spec(const char *p, format_spec_t *spec)
+{
+    size_t n = 0;
+    spec->text[n++] = '%';
+    while (*p && strchr("-+ #0123456789.", *p)) {
+        if (n >= sizeof(spec->text) - 4) return NULL;
+        spec->text[n++] = *p++;
+    }
+
+    int longs = 0;
+    bool size = false;
+    while (*p == 'h' || *p == 'l' || *p == 'z') {
+        if (*p == 'l') longs++;
+        if (*p == 'z') size = true;
+        p++;
+    }
+
+    spec->conversion = *p;
+    switch (*p) {
+        case 'd': case 'i':
+            spec->kind = size ? ARG_SIZE : longs >= 2 ? ARG_LLONG : longs ? ARG_LONG : ARG_INT;
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec->kind = size ? ARG_SIZE : longs >= 2 ? ARG_ULLONG : longs ? ARG_ULONG : ARG_UINT;
+            break;
+        case 'c':
+            spec->kind = ARG_INT;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+            spec->kind = ARG_DOUBLE;
+            break;
+        case 's':
+            spec->kind = ARG_STRING;
+            break;
+        default:
+            return NULL;
+    }
+
+    /* Integers are stored widened and rendered as long long */
+    if (spec->kind != ARG_DOUBLE && spec->kind != ARG_STRING && *p != 'c') {
+        spec->text[n++] = 'l';
+        spec->text[n++] = 'l';
+    }
+    spec->text[n++] = *p;
+    spec->text[n] = '\0';
+    return p + 1;
+}
+
+esp_err_t event_log_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    intern_mutex = xSemaphoreCreateMutex();
+    if (intern_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    initialized = true;
+    ESP_LOGI(TAG, "Event log initialized: %d bytes", CONFIG_EVENT_LOG_SIZE);
+    return ESP_OK;
+}
+
+uint16_t event_log_intern(const char *format)
+{
+    if (!initialized || format == NULL) return 0;
+
+    uint16_t id = 0;
+    xSemaphoreTake(intern_mutex, portMAX_DELAY);
+
+    uint16_t count = atomic_load(&format_count);
+    for (int i = 0; i < count; i++) {
+        if (formats[i].format == format || strcmp(formats[i].format, format) == 0) {
+            id = i + 1;
+            break;
+        }
+    }
+
+    if (id == 0 && count < EVENT_LOG_MAX_FORMATS) {
+        event_format_t *entry = &formats[count];
+        format_spec_t spec;
+        bool valid = true;
+
+        entry->format = format;
+        entry->arg_count = 0;
+        for (const char *p = format; *p && valid; ) {
+            if (*p++ != '%') continue;
+            if (*p == '%') {
+                p++;
+                continue;
+            }
+            p = parse_spec(p, &spec);
+            if (p == NULL || entry->arg_count >= EVENT_LOG_MAX_ARGS) {
+                valid = false;
+            } else {
+                entry->kinds[entry->arg_count++] = spec.kind;
+            }
+        }
+
+        if (valid) {
+            id = count + 1;
+            atomic_store(&format_count, count + 1);
+        } else {
+            ESP_LOGE(TAG, "Unsupported event format: %s", format);
+        }
+    } else if (id == 0) {
+        ESP_LOGE(TAG, "Format table full, dropping: %s", format);
+    }
+
+    xSemaphoreGive(intern_mutex);
+    return id;
+}
+
+static size_t put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static size_t get_varint(const uint8_t *in, size_t len, uint64_t *value)
+{
+    uint64_t v = 0;
+    for (size_t n = 0; n < len && n < 10; n++) {
+        v |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = v;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+/* Renders the arguments in args against format; missing ones print as '?' */
+static size_t render_args(const char *format, const uint8_t *args, size_t len, char *out, size_t out_size)
+{
+    size_t n = 0;
+    size_t offset = 0;
+    format_spec_t spec;
+
+    if (out_size == 0) return 0;
+    out[0] = '\0';
+
+    for (const char *p = format; *p && n < out_size - 1; ) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        p = parse_spec(p, &spec);
+        if (p == NULL) break;
+
+        int written = -1;
+        uint64_t raw;
+        size_t used;
+        switch (spec.kind) {
+            case ARG_DOUBLE:
+                if (offset + sizeof(float) <= len) {
+                    float f;
+                    memcpy(&f, args + offset, sizeof(f));
+                    offset += sizeof(f);
+                    written = snprintf(out + n, out_size - n, spec.text, (double)f);
+                }
+                break;
+            case ARG_STRING:
+                if (offset < len && offset + 1 + args[offset] <= len) {
+                    char text[EVENT_LOG_MAX_STRING + 1];
+                    uint8_t text_len = args[offset];
+                    memcpy(text, args + offset + 1, text_len);
+                    text[text_len] = '\0';
+                    offset += 1 + text_len;
+                    written = snprintf(out + n, out_size - n, spec.text, text);
+                }
+                break;
+            default:
+                used = get_varint(args + offset, len - offset, &raw);
+                if (used == 0) break;
+                offset += used;
+                if (spec.kind == ARG_INT || spec.kind == ARG_LONG || spec.kind == ARG_LLONG) {
+                    long long v = (long long)((raw >> 1) ^ (~(raw & 1) + 1));
+                    if (spec.conversion == 'c') {
+                        written = snprintf(out + n, out_size - n, spec.text, (int)v);
+                    } else {
+                        written = snprintf(out + n, out_size - n, spec.text, v);
+                    }
+                } else {
+                    written = snprintf(out + n, out_size - n, spec.text, (unsigned long long)raw);
+                }
+                break;
+        }
+
+        if (written < 0) {
+            out[n++] = '?';
+        } else {
+            n += (size_t)written < out_size - n ? (size_t)written : out_size - n - 1;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+esp_err_t event_log_write(uint16_t format_id, uint8_t severity, ...)
+{
+    if (format_id == 0 || format_id > atomic_load_explicit(&format_count, memory_order_acquire)) {
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        return ESP_ERR_INVALID_ARG;
+    }
+    const event_format_t *entry = &formats[format_id - 1];
+
+    /* Encode on the stack first, then copy into the reserved words */
+    uint32_t record[EVENT_LOG_MAX_RECORD / 4];
+    uint8_t *bytes = (uint8_t *)record;
+    size_t len = EVENT_LOG_HEADER_BYTES;
+    bool truncated = false;
+
+    va_list args;
+    va_start(args, severity);
+    for (int i = 0; i < entry->arg_count && !truncated; i++) {
+        int64_t s = 0;
+        uint64_t u = 0;
+        bool is_signed = false;
+
+        switch (entry->kinds[i]) {
+            case ARG_INT:    s = va_arg(args, int); is_signed = true; break;
+            case ARG_LONG:   s = va_arg(args, long); is_signed = true; break;
+            case ARG_LLONG:  s = va_arg(args, long long); is_signed = true; break;
+            case ARG_UINT:   u = va_arg(args, unsigned int); break;
+            case ARG_ULONG:  u = va_arg(args, unsigned long); break;
+            case ARG_ULLONG: u = va_arg(args, unsigned long long); break;
+            case ARG_SIZE:   u = va_arg(args, size_t); break;
+            case ARG_DOUBLE: {
+                float f = (float)va_arg(args, double);
+                if (len + sizeof(f) > EVENT_LOG_MAX_RECORD) {
+                    truncated = true;
+                    break;
+                }
+                memcpy(bytes + len, &f, sizeof(f));
+                len += sizeof(f);
+                continue;
+            }
+            case ARG_STRING: {
+                const char *text = va_arg(args, const char *);
+                if (text == NULL) text = "(null)";
+                size_t text_len = strnlen(text, EVENT_LOG_MAX_STRING);
+                if (len + 1 >= EVENT_LOG_MAX_RECORD) {
+                    truncated = true;
+                    break;
+                }
+                if (len + 1 + text_len > EVENT_LOG_MAX_RECORD) {
+                    text_len = EVENT_LOG_MAX_RECORD - len - 1;
+                    truncated = true;
+                } else if (text[text_len] != '\0') {
+                    truncated = true;
+                }
+                bytes[len++] = (uint8_t)text_len;
+                memcpy(bytes + len, text, text_len);
+                len += text_len;
+                continue;
+            }
+        }
+
+        if (truncated) break;
+        if (is_signed) u = ((uint64_t)s << 1) ^ (uint64_t)(s >> 63);  /* zigzag */
+        if (len + 10 > EVENT_LOG_MAX_RECORD) {
+            truncated = true;
+            break;
+        }
+        len += put_varint(bytes + len, u);
+    }
+    va_end(args);
+
+    uint32_t words = (len + 3) / 4;
+    uint32_t pad = words * 4 - len;
+    memset(bytes + len, 0, pad);
+    if (severity > 3) severity = 3;
+    record[1] = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+    /* Reserve: concurrent writers get disjoint spans and never wait */
+    uint32_t pos = atomic_fetch_add_explicit(&head, words * 4, memory_order_relaxed);
+    uint32_t first = pos / 4;
+
+    /* Retire stale start marks in the span before overwriting it */
+    for (uint32_t i = 0; i < words; ) {
+        uint32_t w = (first + i) & EVENT_LOG_WORD_MASK;
+        uint32_t mask = 0;
+        uint32_t group = w / 32;
+        for (; i < words && ((first + i) & EVENT_LOG_WORD_MASK) / 32 == group; i++) {
+            mask |= 1u << (((first + i) & EVENT_LOG_WORD_MASK) % 32);
+        }
+        atomic_fetch_and_explicit(&start_bits[group], ~mask, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    for (uint32_t i = 1; i < words; i++) {
+        atomic_store_explicit(&ring[(first + i) & EVENT_LOG_WORD_MASK], record[i], memory_order_relaxed);
+    }
+    uint32_t header = lap_of(pos) | ((words - 1) << 8) | (pad << 13) |
+                      ((uint32_t)severity << 15) | ((uint32_t)format_id << 17);
+    atomic_store_explicit(&ring[first & EVENT_LOG_WORD_MASK], header, memory_order_relaxed);
+
+    /* Commit: readers only look at marked words */
+    uint32_t w = first & EVENT_LOG_WORD_MASK;
+    atomic_fetch_or_explicit(&start_bits[w / 32], 1u << (w % 32), memory_order_release);
+
+    atomic_fetch_add_explicit(&written_count, 1, memory_order_relaxed);
+    if (truncated) atomic_fetch_add_explicit(&truncated_count, 1, memory_order_relaxed);
+
+#if CONFIG_EVENT_LOG_ECHO_SEVERITY > 0
+    if (severity <= CONFIG_EVENT_LOG_ECHO_SEVERITY) {
+        char text[160];
+        render_args(entry->format, bytes + EVENT_LOG_HEADER_BYTES, len - EVENT_LOG_HEADER_BYTES,
+                    text, sizeof(text));
+        ESP_LOGI(TAG, "[%d] %s", severity, text);
+    }
+#endif
+
+    return truncated ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+/*
+ * Visits committed records from pos on and returns where it stopped. Once
+ * in step with record boundaries (synced), an unmarked word is a record
+ * still being written, so the scan stops there instead of skipping it.
+ */
+static uint32_t event_log_scan(uint32_t pos, bool synced, event_log_visitor_t visitor, void *context)
+{
+    uint32_t end = atomic_load_explicit(&head, memory_order_acquire);
+    uint32_t start = window_start(end);
+    if ((int32_t)(pos - start) < 0 || (int32_t)(end - pos) < 0) {
+        pos = start;
+        synced = false;
+    }
+
+    uint32_t record[EVENT_LOG_MAX_RECORD / 4];
+    char text[256];
+
+    while ((int32_t)(end - pos) > 0) {
+        uint32_t w = (pos / 4) & EVENT_LOG_WORD_MASK;
+        uint32_t bit = 1u << (w % 32);
+        uint32_t header = 0;
+        uint32_t words = 0;
+        bool valid = atomic_load_explicit(&start_bits[w / 32], memory_order_acquire) & bit;
+        if (valid) {
+            header = atomic_load_explicit(&ring[w], memory_order_relaxed);
+            words = HDR_WORDS(header);
+            valid = HDR_LAP(header) == lap_of(pos) && (int32_t)(end - pos) >= (int32_t)(words * 4) &&
+                    HDR_FORMAT(header) != 0 && HDR_FORMAT(header) <= atomic_load(&format_count);
+        }
+        if (!valid) {
+            if (synced) break;
+            pos += 4;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < words; i++) {
+            record[i] = atomic_load_explicit(&ring[(w + i) & EVENT_LOG_WORD_MASK], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+
+        /* Discard what a writer started overwriting while it was copied */
+        bool still_marked = atomic_load_explicit(&start_bits[w / 32], memory_order_relaxed) & bit;
+        uint32_t now = atomic_load_explicit(&head, memory_order_relaxed);
+        if ((int32_t)(pos - (now - CONFIG_EVENT_LOG_SIZE)) < 0) {
+            pos = window_start(now);
+            synced = false;
+            continue;
+        }
+        if (!still_marked) {
+            if (synced) break;
+            pos += 4;
+            continue;
+        }
+
+        size_t len = words * 4 - HDR_PAD(header) - EVENT_LOG_HEADER_BYTES;
+        render_args(formats[HDR_FORMAT(header) - 1].format,
+                    (const uint8_t *)record + EVENT_LOG_HEADER_BYTES, len, text, sizeof(text));
+        visitor(record[1], HDR_SEVERITY(header), text, context);
+        pos += words * 4;
+        synced = true;
+    }
+
+    return pos;
+}
+
+esp_err_t event_log_for_each(event_log_visitor_t visitor, void *context)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (visitor == NULL) return ESP_ERR_INVALID_ARG;
+
+    event_log_scan(window_start(atomic_load(&head)), false, visitor, context);
+    return ESP_OK;
+}
+
+esp_err_t event_log_read_from(uint32_t *cursor, event_log_visitor_t visitor, void *context)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (cursor == NULL || visitor == NULL) return ESP_ERR_INVALID_ARG;
+
+    /* A cursor from a previous call sits on a record boundary */
+    *cursor = event_log_scan(*cursor, true, visitor, context);
+    return ESP_OK;
+}
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+} render_context_t;
+
+/* Appends one line, dropping the oldest lines when the buffer is full */
+static void render_line(uint32_t timestamp, uint8_t severity, const char *text, void *context)
+{
+    render_context_t *ctx = context;
+    char line[288];
+    int len = snprintf(line, sizeof(line), "%lu [%d] %s\n", (unsigned long)timestamp, severity, text);
+    if (len <= 0) return;
+    if ((size_t)len >= sizeof(line)) len = sizeof(line) - 1;
+    if ((size_t)len >= ctx->size) return;
+
+    while (ctx->used + len >= ctx->size) {
+        char *next = memchr(ctx->buffer, '\n', ctx->used);
+        size_t drop = next ? (size_t)(next - ctx->buffer) + 1 : ctx->used;
+        memmove(ctx->buffer, ctx->buffer + drop, ctx->used - drop);
+        ctx->used -= drop;
+    }
+    memcpy(ctx->buffer + ctx->used, line, len);
+    ctx->used += len;
+    ctx->buffer[ctx->used] = '\0';
+}
+
+size_t event_log_render(char *buffer, size_t buffer_size)
+{
+    if (buffer == NULL || buffer_size == 0) return 0;
+
+    render_context_t ctx = { .buffer = buffer, .size = buffer_size, .used = 0 };
+    buffer[0] = '\0';
+    event_log_for_each(render_line, &ctx);
+    return ctx.used;
+}
+
+esp_err_t event_log_clear(void)
+{
+    /* Writers keep going; readers just start from here */
+    atomic_store(&floor_pos, atomic_load(&head));
+    return ESP_OK;
+}
+
+void event_log_get_stats(event_log_stats_t *stats)
+{
+    uint32_t end = atomic_load(&head);
+    uint32_t start = window_start(end);
+
+    stats->written = atomic_load(&written_count);
+    stats->dropped = atomic_load(&dropped_count);
+    stats->truncated = atomic_load(&truncated_count);
+    stats->bytes_used = end - start;
+    stats->formats = atomic_load(&format_count);
+}
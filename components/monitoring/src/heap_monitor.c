@@ -0,0 +1,415 @@
+#include "monitoring/heap_monitor.h"
+#include "monitoring/event_log.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <utils/config.h>
+#include <utils/metrics.h>
+#ifdef CONFIG_HEAP_TASK_TRACKING
+#include <stdlib.h>
+#include <esp_heap_task_info.h>
+#endif
+
+static const char *TAG = "HEAP";
+
+#define TREND_PERIOD_MS     ((uint32_t)CONFIG_HEAP_LEAK_WINDOW_H * 3600000UL / HEAP_TREND_POINTS)
+
+static const uint32_t region_caps[HEAP_REGION_COUNT] = {
+    MALLOC_CAP_DEFAULT,
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    MALLOC_CAP_DMA
+};
+
+typedef struct {
+    uint32_t time_ms;
+    uint32_t floor;             /* lowest free heap over the point's period */
+} trend_point_t;
+
+static SemaphoreHandle_t heap_mutex = NULL;
+static heap_monitor_stats_t stats = {0};
+static bool sampled = false;
+static uint32_t last_sample_ms = 0;
+
+static trend_point_t trend[HEAP_TREND_POINTS];
+static uint8_t trend_head = 0;
+static uint32_t point_start_ms = 0;
+static uint32_t point_floor = UINT32_MAX;
+
+static heap_task_usage_t task_usage[HEAP_MONITOR_MAX_TASKS];
+static uint8_t task_usage_count = 0;
+
+static _Atomic uint32_t failure_count = 0;
+static volatile uint32_t failed_size = 0;
+static volatile uint32_t failed_caps = 0;
+
+static metric_t alloc_failures;
+static metric_t leak_rate;
+
+/* Runs in the failing caller's context, possibly with the heap locked: counters only */
+static void heap_alloc_failed(size_t size, uint32_t caps, const char *function_name)
+{
+    atomic_fetch_add_explicit(&failure_count, 1, memory_order_relaxed);
+    metric_inc(&alloc_failures);
+    failed_size = size;
+    failed_caps = caps;
+}
+
+static void read_region(heap_region_t region, heap_region_stats_t *out)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, region_caps[region]);
+
+    out->free_bytes = info.total_free_bytes;
+    out->min_free_bytes = info.minimum_free_bytes;
+    out->largest_block = info.largest_free_block;
+    out->total_bytes = info.total_free_bytes + info.total_allocated_bytes;
+    out->allocated_blocks = info.allocated_blocks > UINT16_MAX ? UINT16_MAX : info.allocated_blocks;
+    out->fragmentation = info.total_free_bytes > 0 ?
+        100 - (uint8_t)((uint64_t)info.largest_free_block * 100 / info.total_free_bytes) : 0;
+}
+
+/* Least-squares slope through the trend points, in bytes per hour */
+static float trend_slope(void)
+{
+    uint8_t n = stats.trend_points;
+    if (n < 2) return 0;
+
+    uint8_t first = (trend_head + HEAP_TREND_POINTS - n) % HEAP_TREND_POINTS;
+    uint32_t origin = trend[first].time_ms;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        const trend_point_t *point = &trend[(first + i) % HEAP_TREND_POINTS];
+        double x = (point->time_ms - origin) / 3600000.0;
+        double y = point->floor;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    return denominator > 0 ? (float)((n * sxy - sx * sy) / denominator) : 0;
+}
+
+static void update_trend(uint32_t now_ms, uint32_t free_bytes)
+{
+    if (free_bytes < point_floor) point_floor = free_bytes;
+    if (now_ms - point_start_ms < TREND_PERIOD_MS) return;
+
+    trend[trend_head].time_ms = now_ms;
+    trend[trend_head].floor = point_floor;
+    trend_head = (trend_head + 1) % HEAP_TREND_POINTS;
+    if (stats.trend_points < HEAP_TREND_POINTS) stats.trend_points++;
+
+    point_start_ms = now_ms;
+    point_floor = UINT32_MAX;
+    stats.leak_rate = -trend_slope();
+}
+
+static void update_alerts(void)
+{
+    const heap_region_stats_t *heap = &stats.region[HEAP_REGION_DEFAULT];
+    const heap_region_stats_t *internal = &stats.region[HEAP_REGION_INTERNAL];
+
+    /* A partial window says little about weeks-long leaks */
+    bool window_full = stats.trend_points == HEAP_TREND_POINTS;
+    if (!stats.leak_alert && window_full && stats.leak_rate > CONFIG_HEAP_LEAK_ALERT_BYTES_PER_H) {
+        stats.leak_alert = true;
+        EVENT_LOG(1, "Heap leak suspected: free heap floor falling %.0f bytes/h, %lu free",
+                  stats.leak_rate, (unsigned long)heap->free_bytes);
+    } else if (stats.leak_alert && stats.leak_rate < CONFIG_HEAP_LEAK_ALERT_BYTES_PER_H / 2) {
+        stats.leak_alert = false;
+        EVENT_LOG(2, "Heap leak cleared: free heap floor trend %.0f bytes/h", -stats.leak_rate);
+    }
+
+    if (!stats.fragmentation_alert && heap->fragmentation > CONFIG_HEAP_FRAG_ALERT_PERCENT) {
+        stats.fragmentation_alert = true;
+        EVENT_LOG(1, "Heap fragmented: %u%%, largest block %lu of %lu free", heap->fragmentation,
+                  (unsigned long)heap->largest_block, (unsigned long)heap->free_bytes);
+    } else if (stats.fragmentation_alert && heap->fragmentation + 10 < CONFIG_HEAP_FRAG_ALERT_PERCENT) {
+        stats.fragmentation_alert = false;
+        EVENT_LOG(2, "Heap fragmentation back to %u%%", heap->fragmentation);
+    }
+
+    if (!stats.low_memory_alert && internal->largest_block < CONFIG_HEAP_LOW_BLOCK_BYTES) {
+        stats.low_memory_alert = true;
+        EVENT_LOG(1, "Internal RAM low: largest block %lu, %lu free",
+                  (unsigned long)internal->largest_block, (unsigned long)internal->free_bytes);
+    } else if (stats.low_memory_alert && internal->largest_block > CONFIG_HEAP_LOW_BLOCK_BYTES + CONFIG_HEAP_LOW_BLOCK_BYTES / 4) {
+        stats.low_memory_alert = false;
+        EVENT_LOG(2, "Internal RAM recovered: largest block %lu", (unsigned long)internal->largest_block);
+    }
+}
+
+#ifdef CONFIG_HEAP_TASK_TRACKING
+
+static void insert_task_usage(const char *name, uint32_t bytes, uint32_t blocks)
+{
+    /* Largest holders first; the smallest drop off the end */
+    int at = task_usage_count;
+    while (at > 0 && task_usage[at - 1].bytes < bytes) at--;
+    if (at >= HEAP_MONITOR_MAX_TASKS) return;
+
+    int last = task_usage_count < HEAP_MONITOR_MAX_TASKS ? task_usage_count : HEAP_MONITOR_MAX_TASKS - 1;
+    memmove(&task_usage[at + 1], &task_usage[at], (last - at) * sizeof(*task_usage));
+    memset(&task_usage[at], 0, sizeof(task_usage[at]));
+    strncpy(task_usage[at].name, name, sizeof(task_usage[at].name) - 1);
+    task_usage[at].bytes = bytes;
+    task_usage[at].blocks = blocks;
+    if (task_usage_count < HEAP_MONITOR_MAX_TASKS) task_usage_count++;
+}
+
+/* Walks every heap block with the heap locked; debug builds only */
+static void update_task_usage(void)
+{
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+    heap_task_totals_t *totals = calloc(HEAP_MONITOR_MAX_TASKS * 2, sizeof(heap_task_totals_t));
+    TaskStatus_t *status = malloc(capacity * sizeof(TaskStatus_t));
+    if (totals == NULL || status == NULL) {
+        free(totals);
+        free(status);
+        return;
+    }
+
+    size_t total_count = 0;
+    heap_task_info_params_t params = {
+        .totals = totals,
+        .num_totals = &total_count,
+        .max_totals = HEAP_MONITOR_MAX_TASKS * 2,
+    };
+    /* caps and mask 0: every region counts into slot 0 */
+    heap_caps_get_per_task_info(&params);
+    UBaseType_t task_count = uxTaskGetSystemState(status, capacity, NULL);
+
+    task_usage_count = 0;
+    for (size_t i = 0; i < total_count; i++) {
+        /* Memory can outlive its task; a deleted task's handle must not be dereferenced */
+        const char *name = totals[i].task == NULL ? "(startup)" : "(deleted)";
+        for (UBaseType_t t = 0; t < task_count; t++) {
+            if (status[t].xHandle == totals[i].task) {
+                name = status[t].pcTaskName;
+                break;
+            }
+        }
+        insert_task_usage(name, totals[i].size[0], totals[i].count[0]);
+    }
+
+    free(status);
+    free(totals);
+}
+
+#endif
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+    bool overflow;
+} text_t;
+
+static void append(text_t *text, const char *format, ...)
+{
+    if (text->overflow) return;
+
+    va_list args;
+    va_start(args, format);
+    size_t room = text->size - text->used;
+    int n = vsnprintf(text->buffer + text->used, room, format, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= room) {
+        text->overflow = true;
+        return;
+    }
+    text->used += n;
+}
+
+/* Per-region gauges: name, help */
+static const char *const region_gauges[][2] = {
+    { "heap_free_bytes", "Free heap" },
+    { "heap_min_free_bytes", "Lowest free heap since boot" },
+    { "heap_largest_free_block_bytes", "Largest allocatable block" },
+    { "heap_fragmentation_percent", "Free heap outside the largest block" },
+};
+
+static uint32_t region_gauge_value(const heap_region_stats_t *region, int gauge)
+{
+    switch (gauge) {
+        case 0: return region->free_bytes;
+        case 1: return region->min_free_bytes;
+        case 2: return region->largest_block;
+        default: return region->fragmentation;
+    }
+}
+
+static size_t heap_collector(metrics_format_t format, char *buffer, size_t buffer_size)
+{
+    text_t text = { .buffer = buffer, .size = buffer_size };
+
+    if (buffer_size == 0 || !sampled) return 0;
+
+    xSemaphoreTake(heap_mutex, portMAX_DELAY);
+    if (format == METRICS_FORMAT_PROMETHEUS) {
+        for (int g = 0; g < 4; g++) {
+            const char *name = region_gauges[g][0];
+            append(&text, "# HELP %s %s\n# TYPE %s gauge\n", name, region_gauges[g][1], name);
+            for (int r = 0; r < HEAP_REGION_COUNT; r++) {
+                append(&text, "%s{region=\"%s\"} %lu\n", name, heap_region_to_string(r),
+                       (unsigned long)region_gauge_value(&stats.region[r], g));
+            }
+        }
+        if (task_usage_count > 0) {
+            append(&text, "# HELP heap_task_bytes Heap held by each task\n# TYPE heap_task_bytes gauge\n");
+            for (int i = 0; i < task_usage_count; i++) {
+                append(&text, "heap_task_bytes{task=\"%s\"} %lu\n", task_usage[i].name,
+                       (unsigned long)task_usage[i].bytes);
+            }
+            append(&text, "# HELP heap_task_blocks Heap blocks held by each task\n# TYPE heap_task_blocks gauge\n");
+            for (int i = 0; i < task_usage_count; i++) {
+                append(&text, "heap_task_blocks{task=\"%s\"} %lu\n", task_usage[i].name,
+                       (unsigned long)task_usage[i].blocks);
+            }
+        }
+    } else {
+        /* "heap":{"region":[free, min free, largest block, fragmentation], ...} */
+        append(&text, ",\"heap\":{");
+        for (int r = 0; r < HEAP_REGION_COUNT; r++) {
+            const heap_region_stats_t *region = &stats.region[r];
+            append(&text, "%s\"%s\":[%lu,%lu,%lu,%u]", r > 0 ? "," : "", heap_region_to_string(r),
+                   (unsigned long)region->free_bytes, (unsigned long)region->min_free_bytes,
+                   (unsigned long)region->largest_block, region->fragmentation);
+        }
+        append(&text, "}");
+        if (task_usage_count > 0) {
+            /* "heap_tasks":{"name":[bytes, blocks], ...} */
+            append(&text, ",\"heap_tasks\":{");
+            for (int i = 0; i < task_usage_count; i++) {
+                append(&text, "%s\"%s\":[%lu,%lu]", i > 0 ? "," : "", task_usage[i].name,
+                       (unsigned long)task_usage[i].bytes, (unsigned long)task_usage[i].blocks);
+            }
+            append(&text, "}");
+        }
+    }
+    xSemaphoreGive(heap_mutex);
+
+    return text.overflow ? 0 : text.used;
+}
+
+esp_err_t heap_monitor_init(void)
+{
+    if (heap_mutex != NULL) return ESP_OK;
+
+    heap_mutex = xSemaphoreCreateMutex();
+    if (heap_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    metric_register(&alloc_failures, "heap_alloc_failures_total", "Allocations the heap could not satisfy",
+                    METRIC_COUNTER);
+    metric_register(&leak_rate, "heap_leak_bytes_per_hour", "Fall of the free heap floor over the leak window",
+                    METRIC_GAUGE);
+    metrics_register_collector(heap_collector);
+    heap_caps_register_failed_alloc_callback(heap_alloc_failed);
+
+    return ESP_OK;
+}
+
+esp_err_t heap_monitor_process(uint32_t now_ms)
+{
+    if (sampled && now_ms - last_sample_ms < CONFIG_HEAP_MONITOR_INTERVAL_MS) return ESP_OK;
+    return heap_monitor_sample(now_ms);
+}
+
+esp_err_t heap_monitor_sample(uint32_t now_ms)
+{
+    if (heap_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    heap_region_stats_t regions[HEAP_REGION_COUNT];
+    for (int r = 0; r < HEAP_REGION_COUNT; r++) read_region(r, &regions[r]);
+
+    xSemaphoreTake(heap_mutex, portMAX_DELAY);
+    memcpy(stats.region, regions, sizeof(regions));
+    if (!sampled) point_start_ms = now_ms;
+    update_trend(now_ms, regions[HEAP_REGION_DEFAULT].free_bytes);
+    update_alerts();
+#ifdef CONFIG_HEAP_TASK_TRACKING
+    update_task_usage();
+#endif
+    last_sample_ms = now_ms;
+    sampled = true;
+    float rate = stats.leak_rate;
+    xSemaphoreGive(heap_mutex);
+
+    metric_set(&leak_rate, rate);
+    return ESP_OK;
+}
+
+void heap_monitor_get_stats(heap_monitor_stats_t *out)
+{
+    if (heap_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(heap_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(heap_mutex);
+    out->alloc_failures = atomic_load_explicit(&failure_count, memory_order_relaxed);
+    out->last_failed_size = failed_size;
+    out->last_failed_caps = failed_caps;
+}
+
+esp_err_t heap_monitor_get_task_usage(heap_task_usage_t *usage, uint8_t max_count, uint8_t *count)
+{
+#ifndef CONFIG_HEAP_TASK_TRACKING
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (usage == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+    if (heap_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(heap_mutex, portMAX_DELAY);
+    uint8_t n = task_usage_count < max_count ? task_usage_count : max_count;
+    memcpy(usage, task_usage, n * sizeof(*usage));
+    xSemaphoreGive(heap_mutex);
+
+    *count = n;
+    return ESP_OK;
+#endif
+}
+
+void heap_monitor_log(void)
+{
+    heap_monitor_stats_t current;
+    heap_monitor_get_stats(&current);
+
+    for (int r = 0; r < HEAP_REGION_COUNT; r++) {
+        const heap_region_stats_t *region = &current.region[r];
+        ESP_LOGI(TAG, "%-8s free %6lu  min %6lu  largest %6lu  fragmented %3u%%  blocks %u",
+                 heap_region_to_string(r), (unsigned long)region->free_bytes,
+                 (unsigned long)region->min_free_bytes, (unsigned long)region->largest_block,
+                 region->fragmentation, region->allocated_blocks);
+    }
+    ESP_LOGI(TAG, "Leak trend %.0f bytes/h over %u/%u points, %lu failed allocations",
+             current.leak_rate, current.trend_points, HEAP_TREND_POINTS,
+             (unsigned long)current.alloc_failures);
+
+    heap_task_usage_t usage[HEAP_MONITOR_MAX_TASKS];
+    uint8_t count = 0;
+    if (heap_monitor_get_task_usage(usage, HEAP_MONITOR_MAX_TASKS, &count) != ESP_OK) return;
+    for (int i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "%-16s %6lu bytes in %lu blocks", usage[i].name,
+                 (unsigned long)usage[i].bytes, (unsigned long)usage[i].blocks);
+    }
+}
+
+const char *heap_region_to_string(heap_region_t region)
+{
+    switch (region) {
+        case HEAP_REGION_DEFAULT: return "default";
+        case HEAP_REGION_INTERNAL: return "internal";
+        case HEAP_REGION_DMA: return "dma";
+        default: return "unknown";
+    }
+}
@@ -1,15 +1,23 @@
 #include "monitoring/monitoring.h"
+#include "monitoring/event_log.h"
+#include "monitoring/event_journal.h"
+#include "monitoring/heap_monitor.h"
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <sensors/sensor_manager.h>
 #include <actuators/actuator_manager.h>
 #include <utils/config.h>
+#include <utils/task_timing.h>
+#include <utils/metrics.h>
+#include <utils/task_profiler.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 static const char *TAG = "MONITORING";
 
-#define MAX_LOG_ENTRIES 100
 #define MAX_ALARM_ENTRIES 50
 
 static volatile bool initialized = false;
@@ -18,31 +26,133 @@ static TaskHandle_t monitoring_task_handle = NULL;
 static uint16_t alarm_count = 0;
 static uint8_t log_level = 3;
 static system_status_t current_status = {0};
-static log_event_t log_entries[MAX_LOG_ENTRIES];
-static uint8_t log_index = 0;
+static alarm_event_t alarm_entries[MAX_ALARM_ENTRIES];
+static uint8_t alarm_index = 0;
+static uint8_t alarm_entry_count = 0;
+static uint32_t alarm_sequence = 0;     /* entries recorded since boot */
+static SemaphoreHandle_t alarm_mutex = NULL;    /* guards the alarm history ring */
+static uint32_t processed_sample_sequence = 0;
+static task_timing_t monitoring_timing;
+static metric_t sensors_faulted;
 
 static void monitoring_task(void *parameter)
 {
     ESP_LOGI(TAG, "Monitoring task started");
     
+    /* Sample sets wake this task too, but only an urgent one cuts the interval short */
+    sensor_subscribe(xTaskGetCurrentTaskHandle());
+    
+    /* Fixed deadlines; an urgent update in between does not shift them */
+    TickType_t interval = pdMS_TO_TICKS(CONFIG_MONITORING_INTERVAL_MS);
+    TickType_t deadline = xTaskGetTickCount();
     while (running) {
+        task_timing_begin(&monitoring_timing);
         monitoring_update();
-        vTaskDelay(pdMS_TO_TICKS(CONFIG_MONITORING_INTERVAL_MS));
+        heap_monitor_process(xTaskGetTickCount() * portTICK_PERIOD_MS);
+        task_timing_end(&monitoring_timing);
+        
+        deadline += interval;
+        if ((int32_t)(xTaskGetTickCount() - deadline) >= (int32_t)interval) {
+            /* Overran by a whole interval: restart the schedule instead of bursting */
+            deadline = xTaskGetTickCount();
+        }
+        while (running) {
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0) break;
+            
+            uint32_t bits = 0;
+            if (xTaskNotifyWait(0, UINT32_MAX, &bits, deadline - now) == pdTRUE &&
+                (bits & SENSOR_NOTIFY_URGENT)) {
+                monitoring_update();
+            }
+        }
     }
     
+    sensor_unsubscribe(xTaskGetCurrentTaskHandle());
     ESP_LOGI(TAG, "Monitoring task stopped");
     vTaskDelete(NULL);
 }
 
+/* Called by the alarm engine once per state transition */
+static void monitoring_alarm_event(const alarm_event_t *event)
+{
+    /* Arguments go into the event log as-is; text is built only on export */
+    switch (event->state) {
+        case ALARM_STATE_ACTIVE:
+            alarm_count++;
+            if (log_level >= 1) {
+                EVENT_LOG(1, "%s %s alarm: %.2f (limit %.2f)",
+                          event->sensor_name, alarm_limit_to_string(event->limit), event->value,
+                          event->limit == ALARM_LIMIT_HIGH ? event->threshold_max : event->threshold_min);
+            }
+            break;
+        case ALARM_STATE_ACKNOWLEDGED:
+            if (log_level >= 2) EVENT_LOG(2, "%s alarm acknowledged", event->sensor_name);
+            break;
+        case ALARM_STATE_CLEARED:
+            if (log_level >= 2) {
+                EVENT_LOG(2, "%s alarm cleared at %.2f, awaiting acknowledgement",
+                          event->sensor_name, event->value);
+            }
+            break;
+        default:
+            if (log_level >= 2) EVENT_LOG(2, "%s back to normal", event->sensor_name);
+            break;
+    }
+    
+    /* Runs in the monitoring task or in a task acknowledging an alarm */
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    alarm_entries[alarm_index] = *event;
+    alarm_index = (alarm_index + 1) % MAX_ALARM_ENTRIES;
+    if (alarm_entry_count < MAX_ALARM_ENTRIES) alarm_entry_count++;
+    alarm_sequence++;
+    xSemaphoreGive(alarm_mutex);
+}
+
+/* Called by the change detector when a sensor starts or stops drifting */
+static void monitoring_change_event(const change_event_t *event)
+{
+    if (event->raised) {
+        if (log_level >= 1) {
+            EVENT_LOG(1, "%s %s: %.2f against a baseline of %.2f (%s%s)",
+                      event->sensor_name, change_direction_to_string(event->direction),
+                      event->value, event->baseline,
+                      event->detectors & CHANGE_DETECTOR_EWMA ? "EWMA " : "",
+                      event->detectors & CHANGE_DETECTOR_CUSUM ? "CUSUM" : "");
+        }
+    } else if (log_level >= 2) {
+        EVENT_LOG(2, "%s steady again at %.2f", event->sensor_name, event->value);
+    }
+}
+
 esp_err_t monitoring_init(void)
 {
     if (initialized) return ESP_OK;
     
     ESP_LOGI(TAG, "Initializing monitoring system");
     
-    memset(log_entries, 0, sizeof(log_entries));
-    log_index = 0;
+    alarm_mutex = xSemaphoreCreateMutex();
+    if (alarm_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create alarm mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    event_log_init();
+    /* Without the partition events still go to the RAM log */
+    event_journal_init();
+    tsdb_init();
+    sensor_stats_init();
+    heap_monitor_init();
     alarm_count = 0;
+    alarm_index = 0;
+    alarm_entry_count = 0;
+    alarm_sequence = 0;
+    
+    alarm_engine_init();
+    alarm_engine_set_callback(monitoring_alarm_event);
+    change_detector_init();
+    change_detector_set_callback(monitoring_change_event);
+    metric_register(&sensors_faulted, "sensors_faulted", "Enabled sensors not reporting OK", METRIC_GAUGE);
     
     monitoring_log_event("System initialized", 3);
     
@@ -56,8 +166,10 @@ esp_err_t monitoring_start(void)
 {
     if (!initialized || running) return ESP_ERR_INVALID_STATE;
     
+    task_timing_register(&monitoring_timing, "monitoring_task", CONFIG_MONITORING_INTERVAL_MS);
     running = true;
     xTaskCreate(monitoring_task, "monitoring_task", 4096, NULL, 4, &monitoring_task_handle);
+    if (CONFIG_PROFILER_INTERVAL_MS > 0) task_profiler_start(CONFIG_PROFILER_INTERVAL_MS);
     
     ESP_LOGI(TAG, "Monitoring system started");
     return ESP_OK;
@@ -70,6 +182,7 @@ esp_err_t monitoring_stop(void)
     /* Signal the task to stop; it will self-delete via vTaskDelete(NULL) */
     running = false;
     monitoring_task_handle = NULL;
+    task_profiler_stop();
     
     ESP_LOGI(TAG, "Monitoring system stopped");
     return ESP_OK;
@@ -77,17 +190,18 @@ esp_err_t monitoring_stop(void)
 
 esp_err_t monitoring_update(void)
 {
-    sensor_trigger_read_all();
-    
+    /* Values are kept fresh by the sensor task */
     uint8_t sensor_count = 0;
     sensor_data_t *sensors = NULL;
     sensor_read_all(&sensors, &sensor_count);
     
+    uint8_t faulted = 0;
     float temp_sum = 0, hum_sum = 0;
-    float ammonia_max = 0, co2_max = 0;
+    float ammonia_max = 0, co2_max = 0, thi_max = 0;
     uint8_t temp_count = 0, hum_count = 0;
     
     for (int i = 0; i < sensor_count; i++) {
+        if (sensors[i].enabled && sensors[i].status != SENSOR_STATUS_OK) faulted++;
         if (sensors[i].type == SENSOR_TYPE_TEMPERATURE) {
             temp_sum += sensors[i].value;
             temp_count++;
@@ -102,6 +216,10 @@ esp_err_t monitoring_update(void)
             if (sensors[i].value > co2_max) {
                 co2_max = sensors[i].value;
             }
+        } else if (sensors[i].type == SENSOR_TYPE_HEAT_INDEX && sensors[i].status == SENSOR_STATUS_OK) {
+            if (sensors[i].value > thi_max) {
+                thi_max = sensors[i].value;
+            }
         }
     }
     
@@ -110,10 +228,23 @@ esp_err_t monitoring_update(void)
     current_status.humidity_avg = hum_count > 0 ? hum_sum / hum_count : 0;
     current_status.ammonia_max = ammonia_max;
     current_status.co2_max = co2_max;
-    current_status.alarm_count = alarm_count;
+    current_status.thi_max = thi_max;
     current_status.system_status = running ? 1 : 0;
+    metric_set(&sensors_faulted, faulted);
     
     monitoring_check_alarms();
+    /* Once per sample set: urgent wake-ups would otherwise count a reading twice */
+    uint32_t sequence = sensor_get_sample_sequence();
+    if (sequence != processed_sample_sequence) {
+        processed_sample_sequence = sequence;
+        change_detector_process(sensors, sensor_count, xTaskGetTickCount() * portTICK_PERIOD_MS);
+        sensor_stats_record(sensors, sensor_count, time(NULL));
+    }
+    current_status.drifting_sensors = change_detector_get_raised_count();
+    /* Averaged per CONFIG_TSDB_INTERVAL_S; nothing is stored until the clock is set */
+    tsdb_record(sensors, sensor_count, time(NULL));
+    current_status.alarm_count = alarm_count;
+    alarm_engine_get_summary(&current_status.active_alarms, &current_status.unacknowledged_alarms);
     
     return ESP_OK;
 }
@@ -128,27 +259,20 @@ esp_err_t monitoring_log_event(const char *message, uint8_t severity)
 {
     if (severity > log_level) return ESP_OK;
     
-    log_entries[log_index].timestamp = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    log_entries[log_index].severity = severity;
-    strncpy(log_entries[log_index].message, message, sizeof(log_entries[log_index].message) - 1);
-    
-    log_index = (log_index + 1) % MAX_LOG_ENTRIES;
-    
-    ESP_LOGI(TAG, "[%d] %s", severity, message);
+    /* Free text is copied; fixed messages are better logged with EVENT_LOG() */
+    EVENT_LOG(severity, "%s", message);
     
     return ESP_OK;
 }
 
 esp_err_t monitoring_check_alarms(void)
 {
-    bool alarm_triggered = sensor_check_all_alarms();
-    
-    if (alarm_triggered) {
-        alarm_count++;
-        monitoring_log_event("Alarm triggered - check sensors", 1);
-    }
+    /* Every sensor in one pass; only state transitions produce events */
+    uint8_t sensor_count = 0;
+    sensor_data_t *sensors = NULL;
+    sensor_read_all(&sensors, &sensor_count);
     
-    return ESP_OK;
+    return alarm_engine_process(sensors, sensor_count, xTaskGetTickCount() * portTICK_PERIOD_MS);
 }
 
 esp_err_t monitoring_get_alarm_count(uint16_t *count)
@@ -159,26 +283,120 @@ esp_err_t monitoring_get_alarm_count(uint16_t *count)
 
 esp_err_t monitoring_clear_alarms(void)
 {
+    /* Acknowledges every standing alarm; conditions still present stay raised */
+    alarm_engine_acknowledge_all();
     alarm_count = 0;
     monitoring_log_event("Alarms cleared", 2);
     return ESP_OK;
 }
 
+esp_err_t monitoring_acknowledge_alarm(uint8_t sensor_id)
+{
+    return alarm_engine_acknowledge(sensor_id);
+}
+
+esp_err_t monitoring_get_alarm_history(alarm_event_t *events, uint8_t max_count, uint8_t *count)
+{
+    if (events == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    
+    /* Oldest first */
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    uint8_t n = alarm_entry_count < max_count ? alarm_entry_count : max_count;
+    uint8_t start = (alarm_index + MAX_ALARM_ENTRIES - n) % MAX_ALARM_ENTRIES;
+    
+    for (int i = 0; i < n; i++) {
+        events[i] = alarm_entries[(start + i) % MAX_ALARM_ENTRIES];
+    }
+    xSemaphoreGive(alarm_mutex);
+    *count = n;
+    return ESP_OK;
+}
+
+esp_err_t monitoring_read_alarm(uint32_t *sequence, alarm_event_t *event)
+{
+    if (sequence == NULL || event == NULL) return ESP_ERR_INVALID_ARG;
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(alarm_mutex, portMAX_DELAY);
+    /* Entries older than the history are gone; continue with the oldest */
+    uint32_t oldest = alarm_sequence - alarm_entry_count;
+    if ((int32_t)(*sequence - oldest) < 0) *sequence = oldest;
+    if (*sequence == alarm_sequence) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else {
+        uint32_t back = alarm_sequence - *sequence;
+        *event = alarm_entries[(alarm_index + MAX_ALARM_ENTRIES - back) % MAX_ALARM_ENTRIES];
+    }
+    xSemaphoreGive(alarm_mutex);
+    return ret;
+}
+
 esp_err_t monitoring_set_log_level(uint8_t level)
 {
     log_level = level;
     return ESP_OK;
 }
 
-esp_err_t monitoring_export_data(char *buffer, uint16_t buffer_size)
+esp_err_t monitoring_export_log(char *buffer, size_t buffer_size, size_t *length)
 {
-    snprintf(buffer, buffer_size,
-        "Status: Temp=%.2f, Humidity=%.2f, Ammonia=%.2f, CO2=%.2f, Alarms=%d",
-        current_status.temperature_avg,
-        current_status.humidity_avg,
-        current_status.ammonia_max,
-        current_status.co2_max,
-        current_status.alarm_count);
+    if (buffer == NULL || buffer_size == 0) return ESP_ERR_INVALID_ARG;
     
+    /* Newest events that fit, one line each: "<ms> [<severity>] <text>" */
+    size_t n = event_log_render(buffer, buffer_size);
+    if (length) *length = n;
     return ESP_OK;
 }
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+} journal_export_t;
+
+/* Appends one line, dropping the oldest lines when the buffer is full */
+static bool monitoring_export_record(const journal_record_t *record, const void *payload, void *context)
+{
+    journal_export_t *ctx = context;
+    char line[EVENT_JOURNAL_MAX_PAYLOAD + 32];
+    int len;
+    
+    if (record->type == JOURNAL_RECORD_EVENT && record->length > 0) {
+        const uint8_t *bytes = payload;
+        len = snprintf(line, sizeof(line), "%lu [%d] %.*s\n", (unsigned long)record->timestamp,
+                       bytes[0], record->length - 1, (const char *)bytes + 1);
+    } else if (record->type == JOURNAL_RECORD_BOOT && record->length >= sizeof(journal_boot_t)) {
+        journal_boot_t boot;
+        memcpy(&boot, payload, sizeof(boot));
+        len = snprintf(line, sizeof(line), "%lu [3] Boot, reset reason %lu\n",
+                       (unsigned long)record->timestamp, (unsigned long)boot.reset_reason);
+    } else {
+        return true;
+    }
+    if (len <= 0 || (size_t)len >= ctx->size) return true;
+    if ((size_t)len >= sizeof(line)) len = sizeof(line) - 1;
+    
+    while (ctx->used + len >= ctx->size) {
+        char *next = memchr(ctx->buffer, '\n', ctx->used);
+        size_t drop = next ? (size_t)(next - ctx->buffer) + 1 : ctx->used;
+        memmove(ctx->buffer, ctx->buffer + drop, ctx->used - drop);
+        ctx->used -= drop;
+    }
+    memcpy(ctx->buffer + ctx->used, line, len);
+    ctx->used += len;
+    ctx->buffer[ctx->used] = '\0';
+    return true;
+}
+
+esp_err_t monitoring_export_journal(char *buffer, size_t buffer_size, size_t *length)
+{
+    if (buffer == NULL || buffer_size == 0) return ESP_ERR_INVALID_ARG;
+    
+    /* Newest persisted records that fit, across reboots: "<s> [<severity>] <text>" */
+    journal_export_t ctx = { .buffer = buffer, .size = buffer_size, .used = 0 };
+    buffer[0] = '\0';
+    esp_err_t ret = event_journal_read(monitoring_export_record, &ctx);
+    if (length) *length = ctx.used;
+    return ret;
+}
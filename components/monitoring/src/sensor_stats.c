@@ -0,0 +1,286 @@
+#include "monitoring/sensor_stats.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "STATS";
+
+#define STATS_SLOT_NONE         0xFF
+
+/* Before this (2024-01-01) the wall clock has not been set */
+#define STATS_MIN_VALID_TIME    1704067200
+
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+    float mean;
+    float m2;                   /* sum of squared deviations from the mean */
+    float min;
+    float max;
+    uint32_t seconds_observed;
+    uint32_t seconds_above;
+    uint32_t seconds_below;
+} stats_accumulator_t;
+
+typedef struct {
+    uint8_t sensor_id;
+    int8_t last_side;           /* -1 below threshold_min, 1 above threshold_max */
+    bool has_last;
+    uint32_t last_time;
+    stats_accumulator_t hour;
+    stats_accumulator_t day;
+} stats_series_t;
+
+static stats_series_t series[CONFIG_MAX_SENSORS];
+static uint8_t series_count = 0;
+static uint8_t slot_of[256];
+
+static sensor_stats_record_t records[CONFIG_SENSOR_STATS_RECORDS];
+static uint16_t record_index = 0;
+static uint16_t record_count = 0;
+static uint32_t record_sequence = 0;    /* records closed since boot */
+
+static SemaphoreHandle_t stats_mutex = NULL;
+static volatile bool initialized = false;
+
+esp_err_t sensor_stats_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    stats_mutex = xSemaphoreCreateMutex();
+    if (stats_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create stats mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(series, 0, sizeof(series));
+    memset(slot_of, STATS_SLOT_NONE, sizeof(slot_of));
+    series_count = 0;
+    record_index = 0;
+    record_count = 0;
+    record_sequence = 0;
+
+    initialized = true;
+    ESP_LOGI(TAG, "Sensor statistics initialized: %d closed periods kept", CONFIG_SENSOR_STATS_RECORDS);
+    return ESP_OK;
+}
+
+static uint32_t period_start(time_t now, sensor_stats_period_t period)
+{
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    uint32_t into = timeinfo.tm_min * 60 + timeinfo.tm_sec;
+    if (period == SENSOR_STATS_DAY) into += timeinfo.tm_hour * 3600;
+    return (uint32_t)now - into;
+}
+
+static void accumulator_reset(stats_accumulator_t *acc, uint32_t start)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->start = start;
+}
+
+/* Welford's update */
+static void accumulator_add(stats_accumulator_t *acc, float x)
+{
+    if (acc->count == 0 || x < acc->min) acc->min = x;
+    if (acc->count == 0 || x > acc->max) acc->max = x;
+    acc->count++;
+    float delta = x - acc->mean;
+    acc->mean += delta / acc->count;
+    acc->m2 += delta * (x - acc->mean);
+}
+
+/* Chan's parallel combination of two sets of readings */
+static void accumulator_merge(stats_accumulator_t *into, const stats_accumulator_t *from)
+{
+    if (from->count > 0) {
+        if (into->count == 0) {
+            into->mean = from->mean;
+            into->m2 = from->m2;
+            into->min = from->min;
+            into->max = from->max;
+            into->count = from->count;
+        } else {
+            uint32_t n = into->count + from->count;
+            float delta = from->mean - into->mean;
+            into->mean += delta * from->count / n;
+            into->m2 += from->m2 + delta * delta * ((float)into->count * from->count / n);
+            if (from->min < into->min) into->min = from->min;
+            if (from->max > into->max) into->max = from->max;
+            into->count = n;
+        }
+    }
+    into->seconds_observed += from->seconds_observed;
+    into->seconds_above += from->seconds_above;
+    into->seconds_below += from->seconds_below;
+}
+
+static void accumulator_to_record(const stats_accumulator_t *acc, uint8_t sensor_id,
+                                  sensor_stats_period_t period, sensor_stats_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->start = acc->start;
+    record->sensor_id = sensor_id;
+    record->period = period;
+    record->count = acc->count;
+    record->min = acc->min;
+    record->max = acc->max;
+    record->mean = acc->mean;
+    record->stddev = acc->count > 1 ? sqrtf(fmaxf(acc->m2, 0.0f) / (acc->count - 1)) : 0.0f;
+    record->seconds_observed = acc->seconds_observed;
+    record->seconds_above = acc->seconds_above;
+    record->seconds_below = acc->seconds_below;
+}
+
+/* Must be called with stats_mutex held */
+static void stats_close(const stats_accumulator_t *acc, uint8_t sensor_id, sensor_stats_period_t period)
+{
+    if (acc->count == 0) return;
+
+    accumulator_to_record(acc, sensor_id, period, &records[record_index]);
+    record_index = (record_index + 1) % CONFIG_SENSOR_STATS_RECORDS;
+    if (record_count < CONFIG_SENSOR_STATS_RECORDS) record_count++;
+    record_sequence++;
+}
+
+/* Time from the previous reading counts for its side of the thresholds */
+static void stats_integrate(stats_series_t *s, uint32_t from, uint32_t to)
+{
+    if (to <= from) return;
+
+    uint32_t seconds = to - from;
+    s->hour.seconds_observed += seconds;
+    if (s->last_side > 0) s->hour.seconds_above += seconds;
+    if (s->last_side < 0) s->hour.seconds_below += seconds;
+}
+
+/* Must be called with stats_mutex held */
+static void stats_update(stats_series_t *s, const sensor_data_t *sensor, uint32_t now)
+{
+    uint32_t hour = period_start(now, SENSOR_STATS_HOUR);
+    bool bridged = s->has_last && now >= s->last_time && now - s->last_time <= SENSOR_STATS_MAX_GAP_S;
+
+    if (s->hour.start != hour) {
+        /* The part of the interval before the boundary belongs to the closing hour */
+        if (bridged) stats_integrate(s, s->last_time, hour);
+        stats_close(&s->hour, s->sensor_id, SENSOR_STATS_HOUR);
+        accumulator_merge(&s->day, &s->hour);
+
+        uint32_t day = period_start(now, SENSOR_STATS_DAY);
+        if (s->day.start != day) {
+            stats_close(&s->day, s->sensor_id, SENSOR_STATS_DAY);
+            accumulator_reset(&s->day, day);
+        }
+        accumulator_reset(&s->hour, hour);
+    }
+    if (bridged) stats_integrate(s, s->last_time > hour ? s->last_time : hour, now);
+
+    accumulator_add(&s->hour, sensor->value);
+
+    s->last_side = 0;
+    if (sensor->threshold_max > sensor->threshold_min) {
+        if (sensor->value > sensor->threshold_max) s->last_side = 1;
+        if (sensor->value < sensor->threshold_min) s->last_side = -1;
+    }
+    s->last_time = now;
+    s->has_last = true;
+}
+
+/* Must be called with stats_mutex held */
+static stats_series_t *stats_series(uint8_t sensor_id, bool create)
+{
+    if (slot_of[sensor_id] != STATS_SLOT_NONE) return &series[slot_of[sensor_id]];
+    if (!create || series_count >= CONFIG_MAX_SENSORS) return NULL;
+
+    stats_series_t *s = &series[series_count];
+    memset(s, 0, sizeof(*s));
+    s->sensor_id = sensor_id;
+    slot_of[sensor_id] = series_count++;
+    return s;
+}
+
+esp_err_t sensor_stats_record(const sensor_data_t *sensors, uint8_t sensor_count, time_t now)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (sensors == NULL && sensor_count > 0) return ESP_ERR_INVALID_ARG;
+    if (now < STATS_MIN_VALID_TIME) return ESP_OK;  /* no wall clock yet */
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    for (int i = 0; i < sensor_count; i++) {
+        const sensor_data_t *sensor = &sensors[i];
+        if (!sensor->enabled) continue;
+
+        stats_series_t *s = stats_series(sensor->id, true);
+        if (s == NULL) continue;
+        if (sensor->status != SENSOR_STATUS_OK) {
+            /* Not observed until the next good reading */
+            s->has_last = false;
+            continue;
+        }
+        if (s->hour.start == 0) {
+            accumulator_reset(&s->hour, period_start(now, SENSOR_STATS_HOUR));
+            accumulator_reset(&s->day, period_start(now, SENSOR_STATS_DAY));
+        }
+        stats_update(s, sensor, (uint32_t)now);
+    }
+    xSemaphoreGive(stats_mutex);
+    return ESP_OK;
+}
+
+esp_err_t sensor_stats_read(uint32_t *sequence, sensor_stats_record_t *record)
+{
+    if (sequence == NULL || record == NULL) return ESP_ERR_INVALID_ARG;
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    /* Records older than the ring are gone; continue with the oldest */
+    uint32_t oldest = record_sequence - record_count;
+    if ((int32_t)(*sequence - oldest) < 0) *sequence = oldest;
+    if (*sequence == record_sequence) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else {
+        uint32_t back = record_sequence - *sequence;
+        *record = records[(record_index + CONFIG_SENSOR_STATS_RECORDS - back) % CONFIG_SENSOR_STATS_RECORDS];
+    }
+    xSemaphoreGive(stats_mutex);
+    return ret;
+}
+
+uint32_t sensor_stats_get_sequence(void)
+{
+    return record_sequence;
+}
+
+esp_err_t sensor_stats_get_current(uint8_t sensor_id, sensor_stats_period_t period, sensor_stats_record_t *record)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (record == NULL || period > SENSOR_STATS_DAY) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats_series_t *s = stats_series(sensor_id, false);
+    if (s != NULL) {
+        stats_accumulator_t acc = s->hour;
+        if (period == SENSOR_STATS_DAY) {
+            /* The open hour has not been merged yet */
+            acc = s->day;
+            accumulator_merge(&acc, &s->hour);
+        }
+        accumulator_to_record(&acc, sensor_id, period, record);
+    }
+    xSemaphoreGive(stats_mutex);
+    return s != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+const char* sensor_stats_period_to_string(sensor_stats_period_t period)
+{
+    switch (period) {
+        case SENSOR_STATS_HOUR: return "hour";
+        case SENSOR_STATS_DAY: return "day";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,747 @@
+#include "monitoring/tsdb.h"
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "TSDB";
+
+#define TSDB_PARTITION          "tsdb"
+#define TSDB_SECTOR_SIZE        4096
+#define TSDB_MAGIC              0x42445354      /* "TSDB" */
+#define TSDB_VERSION            1
+#define TSDB_ERASED16           0xFFFF
+#define TSDB_NO_SLOT            0xFF
+
+/* Before this (2024-01-01) the wall clock has not been set */
+#define TSDB_MIN_VALID_TIME     1704067200
+
+/* Largest encoding of one point: '1111' + 32-bit dod, '11' + 5 + 5 + 32 */
+#define TSDB_WORST_POINT_BITS   (4 + 32 + 2 + 5 + 5 + 32)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t crc;               /* over the fields above */
+    /* Seal, programmed once the sector is full */
+    uint32_t t_min;
+    uint32_t t_max;
+    uint32_t id_mask[2];        /* bit (sensor_id % 64) */
+    uint32_t seal_crc;          /* over the seal fields above */
+} tsdb_sector_header_t;
+
+typedef struct {
+    uint8_t sensor_id;
+    uint8_t reserved;
+    uint16_t length;            /* payload bytes */
+    uint16_t count;             /* points */
+    uint16_t reserved2;
+    uint32_t t_first;
+    uint32_t t_last;
+    uint32_t crc;               /* over the fields above and the payload */
+} tsdb_chunk_header_t;
+
+#define TSDB_FIRST_CHUNK        sizeof(tsdb_sector_header_t)
+#define TSDB_SEAL_OFFSET        offsetof(tsdb_sector_header_t, t_min)
+#define TSDB_CHUNK_SIZE(n)      ((sizeof(tsdb_chunk_header_t) + (n) + 3) & ~3u)
+
+/* What a sector holds, from its seal or from scanning it */
+typedef struct {
+    uint32_t t_min;             /* UINT32_MAX when empty */
+    uint32_t t_max;
+    uint32_t id_mask[2];
+} tsdb_sector_index_t;
+
+typedef struct {
+    uint8_t sensor_id;
+    float step;
+    /* Interval being averaged */
+    uint32_t bucket;
+    float sum;
+    uint16_t samples;
+    /* Open chunk */
+    uint8_t data[TSDB_CHUNK_BYTES];
+    uint16_t bits;
+    uint16_t count;
+    uint32_t t_first;
+    uint32_t t_last;
+    int32_t prev_delta;
+    uint32_t prev_value;
+    uint8_t prev_leading;       /* 0xFF until the first full XOR window */
+    uint8_t prev_trailing;
+} tsdb_series_t;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t bits;
+    uint32_t pos;
+} bit_reader_t;
+
+static const esp_partition_t *partition = NULL;
+static uint16_t sector_count = 0;
+static uint16_t active_sector = 0;
+static uint32_t write_offset = 0;
+static uint32_t sequence = 0;
+static bool active_sealed = false;
+static tsdb_sector_index_t *sector_index = NULL;
+
+static tsdb_series_t series[CONFIG_MAX_SENSORS];
+static uint8_t series_count = 0;
+static uint8_t slot_of[256];
+
+static uint8_t chunk_buffer[sizeof(tsdb_chunk_header_t) + TSDB_CHUNK_BYTES];
+static tsdb_stats_t stats = {0};
+
+static SemaphoreHandle_t tsdb_mutex = NULL;
+static volatile bool initialized = false;
+
+/* Power-of-two steps keep the low mantissa bits zero */
+static float tsdb_step(sensor_type_t type)
+{
+    switch (type) {
+        case SENSOR_TYPE_TEMPERATURE:   return 1.0f / 16;
+        case SENSOR_TYPE_HEAT_INDEX:    return 1.0f / 16;
+        case SENSOR_TYPE_PRESSURE:      return 1.0f / 16;
+        case SENSOR_TYPE_CO:            return 1.0f / 8;
+        case SENSOR_TYPE_WATER_LEVEL:   return 1.0f / 8;
+        case SENSOR_TYPE_WEIGHT:        return 1.0f / 64;
+        case SENSOR_TYPE_HUMIDITY:      return 1.0f / 4;
+        case SENSOR_TYPE_AMMONIA:       return 1.0f / 4;
+        case SENSOR_TYPE_METHANE:       return 1.0f / 4;
+        case SENSOR_TYPE_SOUND:         return 1.0f / 4;
+        case SENSOR_TYPE_CO2:           return 4.0f;
+        default:                        return 1.0f;
+    }
+}
+
+static void index_reset(tsdb_sector_index_t *index)
+{
+    index->t_min = UINT32_MAX;
+    index->t_max = 0;
+    index->id_mask[0] = 0;
+    index->id_mask[1] = 0;
+}
+
+static void index_add(tsdb_sector_index_t *index, uint8_t sensor_id, uint32_t t_first, uint32_t t_last)
+{
+    if (t_first < index->t_min) index->t_min = t_first;
+    if (t_last > index->t_max) index->t_max = t_last;
+    index->id_mask[(sensor_id / 32) & 1] |= 1u << (sensor_id % 32);
+}
+
+static bool index_matches(const tsdb_sector_index_t *index, uint8_t sensor_id, uint32_t from, uint32_t to)
+{
+    return index->t_min <= index->t_max && index->t_min <= to && index->t_max >= from &&
+           (index->id_mask[(sensor_id / 32) & 1] & (1u << (sensor_id % 32)));
+}
+
+static uint32_t chunk_crc(const tsdb_chunk_header_t *header, const uint8_t *payload)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(tsdb_chunk_header_t, crc));
+    return esp_rom_crc32_le(crc, payload, header->length);
+}
+
+/* Bits are packed most significant first */
+static void put_bits(tsdb_series_t *s, uint32_t value, uint8_t count)
+{
+    while (count-- > 0) {
+        uint8_t *byte = &s->data[s->bits / 8];
+        if (s->bits % 8 == 0) *byte = 0;
+        if ((value >> count) & 1) *byte |= 0x80 >> (s->bits % 8);
+        s->bits++;
+    }
+}
+
+static uint32_t get_bits(bit_reader_t *r, uint8_t count)
+{
+    uint32_t value = 0;
+    while (count-- > 0) {
+        uint32_t bit = 0;
+        if (r->pos < r->bits) bit = (r->data[r->pos / 8] >> (7 - r->pos % 8)) & 1;
+        value = (value << 1) | bit;
+        r->pos++;
+    }
+    return value;
+}
+
+static void encode_point(tsdb_series_t *s, uint32_t timestamp, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (s->count == 0) {
+        s->t_first = timestamp;
+        s->prev_delta = CONFIG_TSDB_INTERVAL_S;
+        s->prev_leading = 0xFF;
+        s->prev_trailing = 0;
+        put_bits(s, bits, 32);
+    } else {
+        /* Timestamp: delta-of-delta, one bit when on schedule */
+        int32_t delta = (int32_t)(timestamp - s->t_last);
+        int32_t dod = delta - s->prev_delta;
+        if (dod == 0) {
+            put_bits(s, 0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            put_bits(s, 0x2, 2);
+            put_bits(s, dod + 63, 7);
+        } else if (dod >= -255 && dod <= 256) {
+            put_bits(s, 0x6, 3);
+            put_bits(s, dod + 255, 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            put_bits(s, 0xE, 4);
+            put_bits(s, dod + 2047, 12);
+        } else {
+            put_bits(s, 0xF, 4);
+            put_bits(s, (uint32_t)dod, 32);
+        }
+        s->prev_delta = delta;
+
+        /* Value: XOR with the previous one, reusing its bit window when it fits */
+        uint32_t diff = bits ^ s->prev_value;
+        if (diff == 0) {
+            put_bits(s, 0, 1);
+        } else {
+            uint8_t leading = __builtin_clz(diff);
+            uint8_t trailing = __builtin_ctz(diff);
+            if (s->prev_leading != 0xFF && leading >= s->prev_leading && trailing >= s->prev_trailing) {
+                put_bits(s, 0x2, 2);
+                put_bits(s, diff >> s->prev_trailing, 32 - s->prev_leading - s->prev_trailing);
+            } else {
+                uint8_t length = 32 - leading - trailing;
+                put_bits(s, 0x3, 2);
+                put_bits(s, leading, 5);
+                put_bits(s, length - 1, 5);
+                put_bits(s, diff >> trailing, length);
+                s->prev_leading = leading;
+                s->prev_trailing = trailing;
+            }
+        }
+    }
+
+    s->prev_value = bits;
+    s->t_last = timestamp;
+    s->count++;
+}
+
+/* Decodes a chunk and passes the points in [from, to] on; false if stopped */
+static bool decode_chunk(const uint8_t *data, uint16_t length, uint16_t count, uint32_t t_first,
+                         uint32_t from, uint32_t to, tsdb_visitor_t visitor, void *context)
+{
+    bit_reader_t r = { .data = data, .bits = (uint32_t)length * 8, .pos = 0 };
+    tsdb_point_t point;
+    uint32_t timestamp = t_first;
+    int32_t delta = CONFIG_TSDB_INTERVAL_S;
+    uint32_t value = get_bits(&r, 32);
+    uint8_t leading = 0;
+    uint8_t trailing = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) {
+            int32_t dod;
+            if (get_bits(&r, 1) == 0) {
+                dod = 0;
+            } else if (get_bits(&r, 1) == 0) {
+                dod = (int32_t)get_bits(&r, 7) - 63;
+            } else if (get_bits(&r, 1) == 0) {
+                dod = (int32_t)get_bits(&r, 9) - 255;
+            } else if (get_bits(&r, 1) == 0) {
+                dod = (int32_t)get_bits(&r, 12) - 2047;
+            } else {
+                dod = (int32_t)get_bits(&r, 32);
+            }
+            delta += dod;
+            timestamp += delta;
+
+            if (get_bits(&r, 1) == 1) {
+                if (get_bits(&r, 1) == 1) {
+                    leading = get_bits(&r, 5);
+                    trailing = 32 - leading - (get_bits(&r, 5) + 1);
+                }
+                value ^= get_bits(&r, 32 - leading - trailing) << trailing;
+            }
+        }
+        if (r.pos > r.bits) break;      /* corrupt: ran past the payload */
+        if (timestamp > to) return true;
+        if (timestamp >= from) {
+            point.timestamp = timestamp;
+            memcpy(&point.value, &value, sizeof(point.value));
+            if (!visitor(&point, context)) return false;
+        }
+    }
+    return true;
+}
+
+static bool read_sector_header(uint16_t sector, tsdb_sector_header_t *header)
+{
+    if (esp_partition_read(partition, (size_t)sector * TSDB_SECTOR_SIZE, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == TSDB_MAGIC && header->version == TSDB_VERSION &&
+           header->crc == esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(tsdb_sector_header_t, crc));
+}
+
+static bool seal_valid(const tsdb_sector_header_t *header)
+{
+    return header->seal_crc == esp_rom_crc32_le(0, (const uint8_t *)&header->t_min,
+                                                offsetof(tsdb_sector_header_t, seal_crc) - TSDB_SEAL_OFFSET);
+}
+
+/*
+ * Reads the chunk at offset. Returns 1 for a good chunk, 0 at the end of
+ * the written area and -1 for a torn or corrupt one. payload may be NULL to
+ * read the header only.
+ */
+static int read_chunk(uint16_t sector, uint32_t offset, tsdb_chunk_header_t *header, uint8_t *payload)
+{
+    size_t base = (size_t)sector * TSDB_SECTOR_SIZE;
+
+    if (offset + sizeof(*header) > TSDB_SECTOR_SIZE) return 0;
+    if (esp_partition_read(partition, base + offset, header, sizeof(*header)) != ESP_OK) return -1;
+    if (header->length == TSDB_ERASED16 && header->count == TSDB_ERASED16) return 0;
+    if (header->length > TSDB_CHUNK_BYTES || header->count == 0 ||
+        offset + TSDB_CHUNK_SIZE(header->length) > TSDB_SECTOR_SIZE) return -1;
+    if (payload == NULL) return 1;
+    if (esp_partition_read(partition, base + offset + sizeof(*header), payload, header->length) != ESP_OK) {
+        return -1;
+    }
+    return header->crc == chunk_crc(header, payload) ? 1 : -1;
+}
+
+/* Rebuilds the index of an unsealed sector; returns the end of its data */
+static uint32_t scan_sector(uint16_t sector, bool *torn)
+{
+    tsdb_chunk_header_t header;
+    uint8_t payload[TSDB_CHUNK_BYTES];
+    uint32_t offset = TSDB_FIRST_CHUNK;
+    int result;
+
+    index_reset(&sector_index[sector]);
+    while ((result = read_chunk(sector, offset, &header, payload)) > 0) {
+        index_add(&sector_index[sector], header.sensor_id, header.t_first, header.t_last);
+        offset += TSDB_CHUNK_SIZE(header.length);
+    }
+    *torn = result < 0;
+    return offset;
+}
+
+/* Writes the active sector's time range and sensors into its header */
+static void seal_sector(void)
+{
+    tsdb_sector_index_t *index = &sector_index[active_sector];
+    uint32_t seal[5] = { index->t_min, index->t_max, index->id_mask[0], index->id_mask[1], 0 };
+    seal[4] = esp_rom_crc32_le(0, (const uint8_t *)seal, sizeof(uint32_t) * 4);
+
+    esp_err_t ret = esp_partition_write(partition, (size_t)active_sector * TSDB_SECTOR_SIZE + TSDB_SEAL_OFFSET,
+                                        seal, sizeof(seal));
+    if (ret != ESP_OK) {
+        /* Still readable: an unsealed sector is scanned at boot instead */
+        ESP_LOGW(TAG, "Failed to seal sector %d: %s", active_sector, esp_err_to_name(ret));
+    }
+    active_sealed = true;
+}
+
+/* Erases the next sector, the oldest, and opens it */
+static esp_err_t open_next_sector(void)
+{
+    uint16_t next = (active_sector + 1) % sector_count;
+    esp_err_t ret = esp_partition_erase_range(partition, (size_t)next * TSDB_SECTOR_SIZE, TSDB_SECTOR_SIZE);
+    stats.sector_erases++;
+    index_reset(&sector_index[next]);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %d: %s", next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    tsdb_sector_header_t header = {
+        .magic = TSDB_MAGIC,
+        .sequence = sequence + 1,
+        .version = TSDB_VERSION,
+        .reserved = TSDB_ERASED16,
+    };
+    header.crc = esp_rom_crc32_le(0, (const uint8_t *)&header, offsetof(tsdb_sector_header_t, crc));
+    ret = esp_partition_write(partition, (size_t)next * TSDB_SECTOR_SIZE, &header, TSDB_SEAL_OFFSET);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open sector %d: %s", next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    active_sector = next;
+    sequence = header.sequence;
+    write_offset = TSDB_FIRST_CHUNK;
+    active_sealed = false;
+    return ESP_OK;
+}
+
+/* Moves a series' open chunk to flash and starts a new one */
+static esp_err_t write_chunk(tsdb_series_t *s)
+{
+    if (s->count == 0) return ESP_OK;
+
+    tsdb_chunk_header_t header = {
+        .sensor_id = s->sensor_id,
+        .reserved = 0xFF,
+        .length = (s->bits + 7) / 8,
+        .count = s->count,
+        .reserved2 = TSDB_ERASED16,
+        .t_first = s->t_first,
+        .t_last = s->t_last,
+    };
+    header.crc = chunk_crc(&header, s->data);
+    uint32_t size = TSDB_CHUNK_SIZE(header.length);
+
+    esp_err_t ret = ESP_OK;
+    if (write_offset + size > TSDB_SECTOR_SIZE) {
+        if (!active_sealed && sector_index[active_sector].t_min != UINT32_MAX) {
+            seal_sector();
+        }
+        ret = open_next_sector();
+    }
+
+    if (ret == ESP_OK) {
+        memcpy(chunk_buffer, &header, sizeof(header));
+        memcpy(chunk_buffer + sizeof(header), s->data, header.length);
+        memset(chunk_buffer + sizeof(header) + header.length, 0xFF, size - sizeof(header) - header.length);
+        ret = esp_partition_write(partition, (size_t)active_sector * TSDB_SECTOR_SIZE + write_offset,
+                                  chunk_buffer, size);
+    }
+
+    if (ret == ESP_OK) {
+        index_add(&sector_index[active_sector], s->sensor_id, s->t_first, s->t_last);
+        write_offset += size;
+        stats.points_written += s->count;
+        stats.bytes_written += size;
+        stats.chunks_written++;
+    } else {
+        /* A half-written chunk fails its CRC; move on to a fresh sector */
+        ESP_LOGE(TAG, "Failed to write chunk of sensor %d: %s", s->sensor_id, esp_err_to_name(ret));
+        write_offset = TSDB_SECTOR_SIZE;
+    }
+
+    s->bits = 0;
+    s->count = 0;
+    return ret;
+}
+
+static void append_point(tsdb_series_t *s, uint32_t timestamp, float value)
+{
+    if (s->count > 0 && s->bits + TSDB_WORST_POINT_BITS > TSDB_CHUNK_BYTES * 8) {
+        write_chunk(s);
+    }
+    encode_point(s, timestamp, value);
+}
+
+/* Stores the mean of the interval that just ended */
+static void close_interval(tsdb_series_t *s)
+{
+    float mean = s->sum / s->samples;
+    float value = roundf(mean / s->step) * s->step;
+
+    append_point(s, s->bucket * CONFIG_TSDB_INTERVAL_S, value);
+    s->sum = 0.0f;
+    s->samples = 0;
+}
+
+static tsdb_series_t *get_series(const sensor_data_t *sensor)
+{
+    uint8_t slot = slot_of[sensor->id];
+    if (slot != TSDB_NO_SLOT) return &series[slot];
+    if (series_count >= CONFIG_MAX_SENSORS) return NULL;
+
+    tsdb_series_t *s = &series[series_count];
+    memset(s, 0, sizeof(*s));
+    s->sensor_id = sensor->id;
+    s->step = tsdb_step(sensor->type);
+    slot_of[sensor->id] = series_count++;
+    return s;
+}
+
+/* Finds the newest sector from the headers, then its append point */
+static void tsdb_recover(void)
+{
+    tsdb_sector_header_t header;
+    bool found = false;
+    bool torn;
+    uint8_t *unsealed = calloc(sector_count, 1);
+
+    for (uint16_t s = 0; s < sector_count; s++) {
+        index_reset(&sector_index[s]);
+        if (!read_sector_header(s, &header)) continue;
+
+        bool sealed = seal_valid(&header);
+        if (sealed) {
+            sector_index[s].t_min = header.t_min;
+            sector_index[s].t_max = header.t_max;
+            sector_index[s].id_mask[0] = header.id_mask[0];
+            sector_index[s].id_mask[1] = header.id_mask[1];
+        } else if (unsealed) {
+            unsealed[s] = 1;
+        }
+        if (!found || (int32_t)(header.sequence - sequence) > 0) {
+            found = true;
+            sequence = header.sequence;
+            active_sector = s;
+            active_sealed = sealed;
+        }
+    }
+
+    /* Besides the active sector, only sectors whose seal write failed */
+    for (uint16_t s = 0; unsealed && s < sector_count; s++) {
+        if (unsealed[s] && s != active_sector) scan_sector(s, &torn);
+    }
+    free(unsealed);
+
+    if (!found) {
+        ESP_LOGI(TAG, "No history found, formatting");
+        sequence = 0;
+        active_sector = sector_count - 1;
+        active_sealed = true;
+        write_offset = TSDB_SECTOR_SIZE;
+        return;
+    }
+
+    if (active_sealed) {
+        write_offset = TSDB_SECTOR_SIZE;
+    } else {
+        /* Bytes after a torn chunk are not erased; the sector takes no more */
+        uint32_t end = scan_sector(active_sector, &torn);
+        write_offset = torn ? TSDB_SECTOR_SIZE : end;
+        if (torn) ESP_LOGW(TAG, "Torn chunk in sector %d at %lu", active_sector, (unsigned long)end);
+    }
+
+    ESP_LOGI(TAG, "History recovered: sector %d, sequence %lu, offset %lu",
+             active_sector, (unsigned long)sequence, (unsigned long)write_offset);
+}
+
+esp_err_t tsdb_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TSDB_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No \"%s\" partition, sensor history disabled", TSDB_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_count = partition->size / TSDB_SECTOR_SIZE;
+    if (sector_count < 2) {
+        ESP_LOGE(TAG, "History partition too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    sector_index = calloc(sector_count, sizeof(tsdb_sector_index_t));
+    tsdb_mutex = xSemaphoreCreateMutex();
+    if (sector_index == NULL || tsdb_mutex == NULL) {
+        free(sector_index);
+        sector_index = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(slot_of, TSDB_NO_SLOT, sizeof(slot_of));
+    series_count = 0;
+    tsdb_recover();
+
+    initialized = true;
+    ESP_LOGI(TAG, "Sensor history initialized: %d sectors, %d s interval",
+             sector_count, CONFIG_TSDB_INTERVAL_S);
+    return ESP_OK;
+}
+
+esp_err_t tsdb_record(const sensor_data_t *sensors, uint8_t sensor_count, time_t now)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (now < TSDB_MIN_VALID_TIME) return ESP_OK;   /* no wall clock yet */
+
+    uint32_t bucket = (uint32_t)now / CONFIG_TSDB_INTERVAL_S;
+
+    xSemaphoreTake(tsdb_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < sensor_count; i++) {
+        if (!sensors[i].enabled || sensors[i].status != SENSOR_STATUS_OK) continue;
+
+        tsdb_series_t *s = get_series(&sensors[i]);
+        if (s == NULL) continue;
+        if (s->samples > 0 && s->bucket != bucket) close_interval(s);
+        s->bucket = bucket;
+        s->sum += sensors[i].value;
+        s->samples++;
+    }
+
+    for (int i = 0; i < series_count; i++) {
+        tsdb_series_t *s = &series[i];
+        /* Sensors that stopped reporting still close their last interval */
+        if (s->samples > 0 && s->bucket != bucket) close_interval(s);
+        if (s->count > 0 && (uint32_t)now - s->t_first >= CONFIG_TSDB_FLUSH_INTERVAL_MIN * 60u) {
+            write_chunk(s);
+        }
+    }
+
+    xSemaphoreGive(tsdb_mutex);
+    return ESP_OK;
+}
+
+esp_err_t tsdb_flush(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(tsdb_mutex, portMAX_DELAY);
+    for (int i = 0; i < series_count; i++) {
+        if (write_chunk(&series[i]) != ESP_OK) ret = ESP_FAIL;
+    }
+    xSemaphoreGive(tsdb_mutex);
+    return ret;
+}
+
+esp_err_t tsdb_query(uint8_t sensor_id, uint32_t from, uint32_t to, tsdb_visitor_t visitor, void *context)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    if (visitor == NULL || from > to) return ESP_ERR_INVALID_ARG;
+
+    tsdb_chunk_header_t header;
+    uint8_t payload[TSDB_CHUNK_BYTES];
+    bool more = true;
+
+    xSemaphoreTake(tsdb_mutex, portMAX_DELAY);
+
+    /* Oldest sector first; the index rules out most without a read */
+    for (uint16_t i = 1; i <= sector_count && more; i++) {
+        uint16_t sector = (active_sector + i) % sector_count;
+        if (!index_matches(&sector_index[sector], sensor_id, from, to)) continue;
+
+        uint32_t offset = TSDB_FIRST_CHUNK;
+        while (more && read_chunk(sector, offset, &header, NULL) > 0) {
+            if (header.sensor_id == sensor_id && header.t_first <= to && header.t_last >= from &&
+                read_chunk(sector, offset, &header, payload) > 0) {
+                more = decode_chunk(payload, header.length, header.count, header.t_first,
+                                    from, to, visitor, context);
+            }
+            offset += TSDB_CHUNK_SIZE(header.length);
+        }
+    }
+
+    /* Then what is still in RAM */
+    uint8_t slot = slot_of[sensor_id];
+    if (more && slot != TSDB_NO_SLOT && series[slot].count > 0) {
+        tsdb_series_t *s = &series[slot];
+        decode_chunk(s->data, (s->bits + 7) / 8, s->count, s->t_first, from, to, visitor, context);
+    }
+
+    xSemaphoreGive(tsdb_mutex);
+    return ESP_OK;
+}
+
+typedef struct {
+    tsdb_point_t *points;
+    size_t max;
+    size_t count;
+} points_context_t;
+
+static bool collect_point(const tsdb_point_t *point, void *context)
+{
+    points_context_t *ctx = context;
+    ctx->points[ctx->count++] = *point;
+    return ctx->count < ctx->max;
+}
+
+esp_err_t tsdb_query_points(uint8_t sensor_id, uint32_t from, uint32_t to,
+                            tsdb_point_t *points, size_t max_points, size_t *count)
+{
+    if (points == NULL || count == NULL || max_points == 0) return ESP_ERR_INVALID_ARG;
+
+    /* The earliest max_points in the range */
+    points_context_t ctx = { .points = points, .max = max_points, .count = 0 };
+    esp_err_t ret = tsdb_query(sensor_id, from, to, collect_point, &ctx);
+    *count = ctx.count;
+    return ret;
+}
+
+typedef struct {
+    tsdb_bucket_t *buckets;
+    size_t bucket_count;
+    uint32_t from;
+    uint32_t bucket_s;
+} buckets_context_t;
+
+static bool collect_bucket(const tsdb_point_t *point, void *context)
+{
+    buckets_context_t *ctx = context;
+    tsdb_bucket_t *b = &ctx->buckets[(point->timestamp - ctx->from) / ctx->bucket_s];
+
+    if (b->count == 0 || point->value < b->min) b->min = point->value;
+    if (b->count == 0 || point->value > b->max) b->max = point->value;
+    b->mean += point->value;    /* sum until the query ends */
+    b->count++;
+    return true;
+}
+
+esp_err_t tsdb_query_buckets(uint8_t sensor_id, uint32_t from, uint32_t bucket_s,
+                             tsdb_bucket_t *buckets, size_t bucket_count)
+{
+    if (buckets == NULL || bucket_count == 0 || bucket_s == 0) return ESP_ERR_INVALID_ARG;
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        buckets[i].start = from + i * bucket_s;
+        buckets[i].count = 0;
+        buckets[i].min = buckets[i].mean = buckets[i].max = 0.0f;
+    }
+
+    buckets_context_t ctx = { .buckets = buckets, .bucket_count = bucket_count, .from = from, .bucket_s = bucket_s };
+    esp_err_t ret = tsdb_query(sensor_id, from, from + bucket_count * bucket_s - 1, collect_bucket, &ctx);
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        if (buckets[i].count > 0) buckets[i].mean /= buckets[i].count;
+    }
+    return ret;
+}
+
+esp_err_t tsdb_erase(void)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(tsdb_mutex, portMAX_DELAY);
+    esp_err_t ret = esp_partition_erase_range(partition, 0, (size_t)sector_count * TSDB_SECTOR_SIZE);
+    stats.sector_erases += sector_count;
+    for (uint16_t s = 0; s < sector_count; s++) {
+        index_reset(&sector_index[s]);
+    }
+    for (int i = 0; i < series_count; i++) {
+        series[i].bits = 0;
+        series[i].count = 0;
+    }
+    active_sector = sector_count - 1;
+    active_sealed = true;
+    write_offset = TSDB_SECTOR_SIZE;
+    xSemaphoreGive(tsdb_mutex);
+
+    ESP_LOGI(TAG, "Sensor history erased");
+    return ret;
+}
+
+void tsdb_get_stats(tsdb_stats_t *out)
+{
+    *out = stats;
+    out->sector_count = sector_count;
+    out->sectors_used = 0;
+    out->oldest = UINT32_MAX;
+    out->newest = 0;
+    out->series = series_count;
+
+    if (!initialized) return;
+
+    xSemaphoreTake(tsdb_mutex, portMAX_DELAY);
+    for (uint16_t s = 0; s < sector_count; s++) {
+        const tsdb_sector_index_t *index = &sector_index[s];
+        if (index->t_min > index->t_max) continue;
+        out->sectors_used++;
+        if (index->t_min < out->oldest) out->oldest = index->t_min;
+        if (index->t_max > out->newest) out->newest = index->t_max;
+    }
+    xSemaphoreGive(tsdb_mutex);
+    if (out->sectors_used == 0) out->oldest = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef ADC_SWEEP_H
+#define ADC_SWEEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_adc/adc_oneshot.h>
+
+/*
+ * Shared ADC1 sweep. Every channel in use (gas, weight, actuator current
+ * sense) is registered once; adc_sweep_run() converts all of them back to back
+ * and caches the raw counts, so drivers read from the cache instead of issuing
+ * their own conversions.
+ *
+ * The module owns ADC1: a driver that needs fresh conversions between sweeps
+ * (the feeder scale's fast mode, tare and calibration) gets them from
+ * adc_sweep_read(), which shares the sweep's lock. Nothing else may call
+ * adc_oneshot_read() on adc1_handle.
+ */
+
+#define ADC_SWEEP_MAX_CHANNELS 8
+
+/* Call once after adc1_handle is created, before adding channels */
+esp_err_t adc_sweep_init(void);
+esp_err_t adc_sweep_add_channel(adc_channel_t channel);
+esp_err_t adc_sweep_run(void);
+/* count back-to-back conversions of a registered channel, outside the cache */
+esp_err_t adc_sweep_read(adc_channel_t channel, int *samples, int count);
+esp_err_t adc_sweep_get_raw(adc_channel_t channel, int *raw);
+uint32_t adc_sweep_get_timestamp(void);
+
+#endif
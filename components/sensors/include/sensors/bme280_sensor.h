@@ -6,6 +6,11 @@
 #include <esp_err.h>
 #include "sensors/sensor_manager.h"
 
+/* The BME280 bus; other devices on this port must use the same pins */
+#define BME280_I2C_PORT     0
+#define BME280_SDA_GPIO     16
+#define BME280_SCL_GPIO     17
+
 typedef struct {
     float temperature;
     float humidity;
@@ -0,0 +1,46 @@
+#ifndef HEAT_INDEX_H
+#define HEAT_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "sensors/sensor_manager.h"
+
+/*
+ * Temperature-humidity index for broilers,
+ *
+ *   THI = 0.85 * Tdb + 0.15 * Twb     (degC)
+ *
+ * with the wet-bulb temperature from Stull's approximation. The index is
+ * precomputed at init over HEAT_INDEX_T_MIN..HEAT_INDEX_T_MAX degC in 2 degC
+ * steps and 0..100 %RH in 10 % steps; heat_index_thi() interpolates that
+ * table bilinearly (within 0.02 degC of the formula for 15..40 degC and
+ * 20..95 %RH), so it is cheap enough to evaluate per zone every cycle.
+ *
+ * The sensor manager publishes the index of Temperature_1/Humidity_1 as the
+ * virtual sensor HEAT_INDEX_SENSOR_ID, so it is sampled, alarmed and
+ * published like any other sensor. Its alarm threshold is the alert stage.
+ */
+
+#define HEAT_INDEX_SENSOR_ID            50
+#define HEAT_INDEX_TEMP_SENSOR_ID       0
+#define HEAT_INDEX_HUMIDITY_SENSOR_ID   1
+
+#define HEAT_INDEX_T_MIN                -10.0f
+#define HEAT_INDEX_T_MAX                50.0f
+
+typedef enum {
+    HEAT_STAGE_NORMAL,
+    HEAT_STAGE_ALERT,
+    HEAT_STAGE_DANGER,
+    HEAT_STAGE_EMERGENCY
+} heat_stage_t;
+
+esp_err_t heat_index_init(void);
+float heat_index_thi(float temperature, float humidity);
+heat_stage_t heat_index_stage(float thi, heat_stage_t previous);
+void heat_index_describe(sensor_data_t *sensor);
+void heat_index_update(sensor_data_t *sensor, const sensor_data_t *sensors, uint8_t count);
+const char* heat_stage_to_string(heat_stage_t stage);
+
+#endif
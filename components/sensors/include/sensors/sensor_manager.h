@@ -5,9 +5,20 @@
 #include <stdbool.h>
 #include <esp_err.h>
 #include <esp_adc/adc_oneshot.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 extern adc_oneshot_unit_handle_t adc1_handle;
 
+/*
+ * Notification bits sent to subscribed tasks (eSetBits) each time a sample
+ * set is published. URGENT is added when a sensor with alarms enabled has
+ * just crossed one of its thresholds.
+ */
+#define SENSOR_NOTIFY_SAMPLE    (1UL << 0)
+#define SENSOR_NOTIFY_URGENT    (1UL << 1)
+#define SENSOR_MAX_SUBSCRIBERS  4
+
 typedef enum {
     SENSOR_TYPE_TEMPERATURE,
     SENSOR_TYPE_HUMIDITY,
@@ -21,7 +32,8 @@ typedef enum {
     SENSOR_TYPE_WATER_LEVEL,
     SENSOR_TYPE_WEIGHT,
     SENSOR_TYPE_MOTION,
-    SENSOR_TYPE_DOOR
+    SENSOR_TYPE_DOOR,
+    SENSOR_TYPE_HEAT_INDEX      /* virtual: computed from other sensors */
 } sensor_type_t;
 
 typedef enum {
@@ -56,6 +68,11 @@ typedef void (*sensor_callback_t)(uint8_t sensor_id, float value, sensor_status_
 
 esp_err_t sensor_manager_init(void);
 esp_err_t sensor_manager_deinit(void);
+esp_err_t sensor_manager_start(void);
+esp_err_t sensor_manager_stop(void);
+esp_err_t sensor_subscribe(TaskHandle_t task);
+esp_err_t sensor_unsubscribe(TaskHandle_t task);
+uint32_t sensor_get_sample_sequence(void);
 esp_err_t sensor_register(uint8_t id, const char *name, sensor_type_t type, 
                           float min_val, float max_val, float threshold_min, float threshold_max);
 esp_err_t sensor_unregister(uint8_t id);
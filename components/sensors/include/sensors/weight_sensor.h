@@ -19,4 +19,15 @@ sensor_data_t* get_weight_sensors(uint8_t *count);
 esp_err_t weight_sensor_tare(void);
 esp_err_t weight_sensor_calibrate(float known_weight);
 
+/*
+ * High-rate filtered sampling of the feeder scale (channel 1) for dispensing.
+ * While enabled, each weight_sensor_sample_fast() call takes a burst of
+ * conversions outside the sweep's cache (adc_sweep_read(), under the ADC1
+ * lock, so it may run from a timer callback), averages it with the
+ * extremes dropped and runs it through a first-order filter. The regular
+ * sample set reports the filtered value for Feeder_Weight in the meantime.
+ */
+esp_err_t weight_sensor_set_fast_mode(bool enable);
+esp_err_t weight_sensor_sample_fast(float *weight);
+
 #endif
@@ -0,0 +1,111 @@
+#include "sensors/adc_sweep.h"
+#include "sensors/sensor_manager.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+static const char *TAG = "ADC_SWEEP";
+
+static uint8_t channel_mask = 0;
+static int raw_values[ADC_SWEEP_MAX_CHANNELS];
+static volatile uint32_t sweep_time = 0;
+/* ADC1 is converted from the sensor task and from esp_timer callbacks */
+static SemaphoreHandle_t adc_mutex = NULL;
+
+esp_err_t adc_sweep_init(void)
+{
+    if (adc_mutex != NULL) return ESP_OK;
+
+    adc_mutex = xSemaphoreCreateMutex();
+    if (adc_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create ADC mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t adc_sweep_add_channel(adc_channel_t channel)
+{
+    if (channel >= ADC_SWEEP_MAX_CHANNELS) return ESP_ERR_INVALID_ARG;
+    if (adc_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(adc_mutex, portMAX_DELAY);
+    if (channel_mask & (1 << channel)) {
+        xSemaphoreGive(adc_mutex);
+        return ESP_OK;
+    }
+
+    adc_oneshot_chan_config_t config = {
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+        .atten = ADC_ATTEN_DB_12,
+    };
+    esp_err_t err = adc_oneshot_config_channel(adc1_handle, channel, &config);
+    if (err == ESP_OK) {
+        raw_values[channel] = 0;
+        channel_mask |= (uint8_t)(1 << channel);
+    }
+    xSemaphoreGive(adc_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure ADC1 channel %d: %s", channel, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t adc_sweep_run(void)
+{
+    if (adc_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t result = ESP_OK;
+
+    xSemaphoreTake(adc_mutex, portMAX_DELAY);
+    for (int ch = 0; ch < ADC_SWEEP_MAX_CHANNELS; ch++) {
+        if (!(channel_mask & (1 << ch))) continue;
+
+        int value = 0;
+        esp_err_t err = adc_oneshot_read(adc1_handle, (adc_channel_t)ch, &value);
+        if (err == ESP_OK) {
+            raw_values[ch] = value;
+        } else {
+            result = err;
+        }
+    }
+    xSemaphoreGive(adc_mutex);
+
+    sweep_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    return result;
+}
+
+esp_err_t adc_sweep_read(adc_channel_t channel, int *samples, int count)
+{
+    if (channel >= ADC_SWEEP_MAX_CHANNELS || !(channel_mask & (1 << channel))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (samples == NULL || count <= 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_OK;
+
+    /* A burst is short next to a sweep, so waiting here is bounded */
+    xSemaphoreTake(adc_mutex, portMAX_DELAY);
+    for (int i = 0; i < count && err == ESP_OK; i++) {
+        err = adc_oneshot_read(adc1_handle, channel, &samples[i]);
+    }
+    xSemaphoreGive(adc_mutex);
+
+    return err;
+}
+
+esp_err_t adc_sweep_get_raw(adc_channel_t channel, int *raw)
+{
+    if (channel >= ADC_SWEEP_MAX_CHANNELS || !(channel_mask & (1 << channel))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *raw = raw_values[channel];
+    return ESP_OK;
+}
+
+uint32_t adc_sweep_get_timestamp(void)
+{
+    return sweep_time;
+}
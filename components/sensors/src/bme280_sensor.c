@@ -3,13 +3,14 @@
 #include <driver/i2c.h>
 #include <esp_log.h>
 #include <string.h>
+#include "utils/metrics.h"
 
 static const char *TAG = "BME280";
 
-#define I2C_MASTER_SCL_GPIO 17
-#define I2C_MASTER_SDA_GPIO 16
+#define I2C_MASTER_SCL_GPIO BME280_SCL_GPIO
+#define I2C_MASTER_SDA_GPIO BME280_SDA_GPIO
 #define BME280_ADDR 0x76
-#define I2C_NUM I2C_NUM_0
+#define I2C_NUM BME280_I2C_PORT
 
 /* BME280 register addresses */
 #define BME280_REG_CHIP_ID      0xD0
@@ -47,6 +48,19 @@ static sensor_data_t bme280_sensors[3];
 static bool initialized = false;
 static bme280_calib_t calib = {0};
 static int32_t t_fine = 0;
+static metric_t i2c_timeouts;
+static metric_t i2c_errors;
+
+/* Counts failed bus transactions; timeouts usually mean a hung bus or a missing device */
+static esp_err_t bme280_count_result(esp_err_t err)
+{
+    if (err == ESP_ERR_TIMEOUT) {
+        metric_inc(&i2c_timeouts);
+    } else if (err != ESP_OK) {
+        metric_inc(&i2c_errors);
+    }
+    return err;
+}
 
 static esp_err_t bme280_write_reg(uint8_t reg, uint8_t value)
 {
@@ -58,7 +72,7 @@ static esp_err_t bme280_write_reg(uint8_t reg, uint8_t value)
     i2c_master_stop(cmd);
     esp_err_t err = i2c_master_cmd_begin(I2C_NUM, cmd, pdMS_TO_TICKS(100));
     i2c_cmd_link_delete(cmd);
-    return err;
+    return bme280_count_result(err);
 }
 
 static esp_err_t bme280_read_regs(uint8_t reg, uint8_t *data, size_t len)
@@ -76,7 +90,7 @@ static esp_err_t bme280_read_regs(uint8_t reg, uint8_t *data, size_t len)
     i2c_master_stop(cmd);
     esp_err_t err = i2c_master_cmd_begin(I2C_NUM, cmd, pdMS_TO_TICKS(100));
     i2c_cmd_link_delete(cmd);
-    return err;
+    return bme280_count_result(err);
 }
 
 static esp_err_t bme280_read_calibration(void)
@@ -155,6 +169,9 @@ esp_err_t bme280_init(void)
     
     ESP_LOGI(TAG, "Initializing BME280 sensor");
     
+    metric_register(&i2c_timeouts, "i2c_timeouts_total", "I2C transactions that timed out", METRIC_COUNTER);
+    metric_register(&i2c_errors, "i2c_errors_total", "I2C transactions that failed otherwise, e.g. NACK", METRIC_COUNTER);
+    
     i2c_config_t conf = {
         .mode = I2C_MODE_MASTER,
         .sda_io_num = I2C_MASTER_SDA_GPIO,
@@ -0,0 +1,138 @@
+#include "sensors/heat_index.h"
+#include <esp_log.h>
+#include <math.h>
+#include <string.h>
+#include "utils/config.h"
+
+static const char *TAG = "HEAT_INDEX";
+
+#define HEAT_INDEX_T_STEP       2.0f
+#define HEAT_INDEX_RH_STEP      10.0f
+#define HEAT_INDEX_T_POINTS     31      /* -10 .. 50 degC */
+#define HEAT_INDEX_RH_POINTS    11      /* 0 .. 100 %RH */
+
+/* A stage is left only once the index is this far below its threshold */
+#define HEAT_STAGE_HYSTERESIS   0.3f
+
+static float thi_table[HEAT_INDEX_T_POINTS][HEAT_INDEX_RH_POINTS];
+static bool initialized = false;
+
+/* Stull (2011) wet-bulb temperature, valid for 5..99 %RH; saturated air is at its dry-bulb temperature */
+static float heat_index_wet_bulb(float t, float rh)
+{
+    if (rh >= 100.0f) return t;
+    if (rh < 5.0f) rh = 5.0f;
+    return t * atanf(0.151977f * sqrtf(rh + 8.313659f)) + atanf(t + rh) - atanf(rh - 1.676331f) +
+           0.00391838f * powf(rh, 1.5f) * atanf(0.023101f * rh) - 4.686035f;
+}
+
+esp_err_t heat_index_init(void)
+{
+    if (initialized) return ESP_OK;
+
+    for (int i = 0; i < HEAT_INDEX_T_POINTS; i++) {
+        float t = HEAT_INDEX_T_MIN + i * HEAT_INDEX_T_STEP;
+        for (int j = 0; j < HEAT_INDEX_RH_POINTS; j++) {
+            float rh = j * HEAT_INDEX_RH_STEP;
+            thi_table[i][j] = 0.85f * t + 0.15f * heat_index_wet_bulb(t, rh);
+        }
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "THI table built: %d x %d points", HEAT_INDEX_T_POINTS, HEAT_INDEX_RH_POINTS);
+    return ESP_OK;
+}
+
+float heat_index_thi(float temperature, float humidity)
+{
+    if (!initialized || isnan(temperature) || isnan(humidity)) return NAN;
+
+    /* Clamp to the table; outside it the index is extrapolated flat */
+    float ft = (temperature - HEAT_INDEX_T_MIN) / HEAT_INDEX_T_STEP;
+    float fr = humidity / HEAT_INDEX_RH_STEP;
+    if (ft < 0.0f) ft = 0.0f;
+    if (ft > HEAT_INDEX_T_POINTS - 1) ft = HEAT_INDEX_T_POINTS - 1;
+    if (fr < 0.0f) fr = 0.0f;
+    if (fr > HEAT_INDEX_RH_POINTS - 1) fr = HEAT_INDEX_RH_POINTS - 1;
+
+    int i = (int)ft;
+    int j = (int)fr;
+    if (i > HEAT_INDEX_T_POINTS - 2) i = HEAT_INDEX_T_POINTS - 2;
+    if (j > HEAT_INDEX_RH_POINTS - 2) j = HEAT_INDEX_RH_POINTS - 2;
+    float dt = ft - i;
+    float dr = fr - j;
+
+    float low = thi_table[i][j] + (thi_table[i][j + 1] - thi_table[i][j]) * dr;
+    float high = thi_table[i + 1][j] + (thi_table[i + 1][j + 1] - thi_table[i + 1][j]) * dr;
+    return low + (high - low) * dt;
+}
+
+heat_stage_t heat_index_stage(float thi, heat_stage_t previous)
+{
+    if (isnan(thi)) return HEAT_STAGE_NORMAL;
+
+    const float limits[] = {
+        poultry_config.thi_alert,
+        poultry_config.thi_danger,
+        poultry_config.thi_emergency
+    };
+
+    heat_stage_t stage = HEAT_STAGE_NORMAL;
+    for (int s = 0; s < 3; s++) {
+        /* Stages at or below the previous one are held until the index drops through the hysteresis */
+        float limit = (heat_stage_t)(s + 1) <= previous ? limits[s] - HEAT_STAGE_HYSTERESIS : limits[s];
+        if (thi >= limit) stage = (heat_stage_t)(s + 1);
+    }
+    return stage;
+}
+
+void heat_index_describe(sensor_data_t *sensor)
+{
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->id = HEAT_INDEX_SENSOR_ID;
+    strncpy(sensor->name, "THI", sizeof(sensor->name) - 1);
+    sensor->type = SENSOR_TYPE_HEAT_INDEX;
+    sensor->status = SENSOR_STATUS_OFFLINE;
+    sensor->min_value = HEAT_INDEX_T_MIN;
+    sensor->max_value = HEAT_INDEX_T_MAX;
+    sensor->threshold_min = HEAT_INDEX_T_MIN;
+    sensor->threshold_max = poultry_config.thi_alert;
+    sensor->enabled = true;
+    sensor->alarm_enabled = true;
+}
+
+void heat_index_update(sensor_data_t *sensor, const sensor_data_t *sensors, uint8_t count)
+{
+    const sensor_data_t *temperature = NULL;
+    const sensor_data_t *humidity = NULL;
+
+    for (int i = 0; i < count; i++) {
+        if (sensors[i].id == HEAT_INDEX_TEMP_SENSOR_ID) {
+            temperature = &sensors[i];
+        } else if (sensors[i].id == HEAT_INDEX_HUMIDITY_SENSOR_ID) {
+            humidity = &sensors[i];
+        }
+    }
+
+    /* The index is only as good as both of its inputs */
+    if (temperature == NULL || humidity == NULL ||
+        temperature->status != SENSOR_STATUS_OK || humidity->status != SENSOR_STATUS_OK ||
+        !temperature->enabled || !humidity->enabled) {
+        sensor->status = SENSOR_STATUS_ERROR;
+        return;
+    }
+
+    sensor->value = heat_index_thi(temperature->value, humidity->value);
+    sensor->status = isnan(sensor->value) ? SENSOR_STATUS_ERROR : SENSOR_STATUS_OK;
+}
+
+const char* heat_stage_to_string(heat_stage_t stage)
+{
+    switch (stage) {
+        case HEAT_STAGE_NORMAL: return "Normal";
+        case HEAT_STAGE_ALERT: return "Alert";
+        case HEAT_STAGE_DANGER: return "Danger";
+        case HEAT_STAGE_EMERGENCY: return "Emergency";
+        default: return "Unknown";
+    }
+}
@@ -7,12 +7,16 @@
 #include <driver/gpio.h>
 #include <esp_adc/adc_oneshot.h>
 #include "sensors/sensor_manager.h"
+#include "sensors/adc_sweep.h"
 #include "sensors/dht22.h"
 #include "sensors/mq_sensor.h"
 #include "sensors/bme280_sensor.h"
 #include "sensors/weight_sensor.h"
 #include "sensors/water_level_sensor.h"
+#include "sensors/heat_index.h"
 #include "utils/config.h"
+#include "utils/task_timing.h"
+#include "utils/metrics.h"
 
 static const char *TAG = "SENSOR_MGR";
 
@@ -23,6 +27,15 @@ static volatile bool initialized = false;
 static SemaphoreHandle_t sensor_mutex = NULL;
 adc_oneshot_unit_handle_t adc1_handle;
 
+/* Sampling task and sample-set subscribers */
+static volatile bool running = false;
+static TaskHandle_t sensor_task_handle = NULL;
+static TaskHandle_t subscribers[SENSOR_MAX_SUBSCRIBERS];
+static uint8_t subscriber_count = 0;
+static uint32_t sample_sequence = 0;
+static bool out_of_range[CONFIG_MAX_SENSORS];
+static task_timing_t sensor_timing;
+
 /* Pointers to driver-level sensor arrays for data propagation */
 static sensor_data_t *driver_arrays[5] = {NULL};
 static uint8_t driver_counts[5] = {0};
@@ -32,6 +45,17 @@ static uint8_t driver_counts[5] = {0};
 #define DRIVER_WEIGHT  3
 #define DRIVER_WATER   4
 
+/* Indexed like driver_arrays */
+static esp_err_t (*const driver_read_all[5])(void) = {
+    dht22_read_all, mq_sensor_read_all, bme280_read_all, weight_sensor_read_all, water_level_sensor_read_all
+};
+static const char *const driver_metric_names[5] = {
+    "dht22_read_us", "mq_read_us", "bme280_read_us", "weight_read_us", "water_level_read_us"
+};
+static const uint32_t read_bounds_us[] = { 100, 300, 1000, 3000, 10000, 30000, 100000, 300000 };
+static metric_t driver_read_time[5];
+static metric_t adc_sweep_time;
+
 esp_err_t sensor_manager_init(void)
 {
     if (initialized) {
@@ -55,17 +79,14 @@ esp_err_t sensor_manager_init(void)
         .ulp_mode = ADC_ONESHOT_ULP_MODE_DISABLE,
     };
     ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config1, &adc1_handle));
+    ESP_ERROR_CHECK(adc_sweep_init());
 
-    adc_oneshot_chan_config_t config = {
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-        .atten = ADC_ATTEN_DB_12,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_0, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_3, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_4, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_5, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_6, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_7, &config));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_0));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_3));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_4));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_5));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_6));
+    ESP_ERROR_CHECK(adc_sweep_add_channel(ADC_CHANNEL_7));
     
     dht22_init();
     mq_sensor_init();
@@ -100,18 +121,118 @@ esp_err_t sensor_manager_init(void)
         sensors[sensor_count++] = driver_arrays[DRIVER_WATER][i];
     }
     
+    /* Virtual sensors follow the driver-backed ones, so propagation never overwrites them */
+    heat_index_init();
+    if (sensor_count < CONFIG_MAX_SENSORS) {
+        heat_index_describe(&sensors[sensor_count++]);
+    }
+    
     initialized = true;
     ESP_LOGI(TAG, "Sensor manager initialized with %d sensors", sensor_count);
     
     return ESP_OK;
 }
 
+static void sensor_task(void *parameter)
+{
+    ESP_LOGI(TAG, "Sensor task started");
+    
+    TickType_t last_wake = xTaskGetTickCount();
+    while (running) {
+        task_timing_begin(&sensor_timing);
+        sensor_trigger_read_all();
+        task_timing_end(&sensor_timing);
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_SENSOR_READ_INTERVAL_MS));
+    }
+    
+    ESP_LOGI(TAG, "Sensor task stopped");
+    vTaskDelete(NULL);
+}
+
+esp_err_t sensor_manager_start(void)
+{
+    if (!initialized || running) return ESP_ERR_INVALID_STATE;
+    
+    task_timing_register(&sensor_timing, "sensor_task", CONFIG_SENSOR_READ_INTERVAL_MS);
+    metric_register_histogram(&adc_sweep_time, "adc_sweep_us", "ADC pass over all analog channels",
+                              read_bounds_us, sizeof(read_bounds_us) / sizeof(read_bounds_us[0]));
+    for (int d = 0; d < 5; d++) {
+        metric_register_histogram(&driver_read_time[d], driver_metric_names[d], "Driver read of all its sensors",
+                                  read_bounds_us, sizeof(read_bounds_us) / sizeof(read_bounds_us[0]));
+    }
+    running = true;
+    xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 6, &sensor_task_handle);
+    
+    ESP_LOGI(TAG, "Sampling every %d ms", CONFIG_SENSOR_READ_INTERVAL_MS);
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_stop(void)
+{
+    if (!running) return ESP_ERR_INVALID_STATE;
+    
+    /* Signal task to stop, let it self-delete via vTaskDelete(NULL) */
+    running = false;
+    sensor_task_handle = NULL;
+    
+    return ESP_OK;
+}
+
+esp_err_t sensor_subscribe(TaskHandle_t task)
+{
+    if (!initialized || task == NULL) return ESP_ERR_INVALID_STATE;
+    
+    xSemaphoreTake(sensor_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < subscriber_count; i++) {
+        if (subscribers[i] == task) {
+            xSemaphoreGive(sensor_mutex);
+            return ESP_OK;
+        }
+    }
+    if (subscriber_count >= SENSOR_MAX_SUBSCRIBERS) {
+        xSemaphoreGive(sensor_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    subscribers[subscriber_count++] = task;
+    
+    xSemaphoreGive(sensor_mutex);
+    return ESP_OK;
+}
+
+esp_err_t sensor_unsubscribe(TaskHandle_t task)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    
+    xSemaphoreTake(sensor_mutex, portMAX_DELAY);
+    
+    for (int i = 0; i < subscriber_count; i++) {
+        if (subscribers[i] == task) {
+            for (int j = i; j < subscriber_count - 1; j++) {
+                subscribers[j] = subscribers[j + 1];
+            }
+            subscriber_count--;
+            xSemaphoreGive(sensor_mutex);
+            return ESP_OK;
+        }
+    }
+    
+    xSemaphoreGive(sensor_mutex);
+    return ESP_ERR_NOT_FOUND;
+}
+
+uint32_t sensor_get_sample_sequence(void)
+{
+    return sample_sequence;
+}
+
 esp_err_t sensor_manager_deinit(void)
 {
     if (!initialized) {
         return ESP_OK;
     }
     
+    sensor_manager_stop();
     initialized = false;
     sensor_count = 0;
     if (sensor_mutex) {
@@ -266,9 +387,20 @@ static void sensor_propagate_driver_data(void)
     }
 }
 
+/* Must be called with sensor_mutex held, after the driver data is propagated */
+static void sensor_update_virtual(void)
+{
+    for (int i = 0; i < sensor_count; i++) {
+        if (sensors[i].id == HEAT_INDEX_SENSOR_ID && sensors[i].type == SENSOR_TYPE_HEAT_INDEX) {
+            heat_index_update(&sensors[i], sensors, sensor_count);
+        }
+    }
+}
+
 esp_err_t sensor_trigger_read(uint8_t id)
 {
     /* Trigger a full read from all drivers and propagate */
+    adc_sweep_run();
     dht22_read_all();
     mq_sensor_read_all();
     bme280_read_all();
@@ -277,6 +409,7 @@ esp_err_t sensor_trigger_read(uint8_t id)
     
     xSemaphoreTake(sensor_mutex, portMAX_DELAY);
     sensor_propagate_driver_data();
+    sensor_update_virtual();
     
     for (int i = 0; i < sensor_count; i++) {
         if (sensors[i].id == id && sensors[i].enabled) {
@@ -296,27 +429,48 @@ esp_err_t sensor_trigger_read(uint8_t id)
 
 esp_err_t sensor_trigger_read_all(void)
 {
-    /* Read from all hardware drivers */
-    dht22_read_all();
-    mq_sensor_read_all();
-    bme280_read_all();
-    weight_sensor_read_all();
-    water_level_sensor_read_all();
+    /* One ADC pass for all analog channels, then the drivers */
+    uint32_t start = metric_timer_start();
+    adc_sweep_run();
+    metric_observe_since(&adc_sweep_time, start);
+    for (int d = 0; d < 5; d++) {
+        start = metric_timer_start();
+        driver_read_all[d]();
+        metric_observe_since(&driver_read_time[d], start);
+    }
     
     xSemaphoreTake(sensor_mutex, portMAX_DELAY);
     
     /* Propagate updated values from driver arrays to manager array */
     sensor_propagate_driver_data();
+    sensor_update_virtual();
     
     uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint32_t bits = SENSOR_NOTIFY_SAMPLE;
     for (int i = 0; i < sensor_count; i++) {
         sensors[i].last_read_time = current_time;
         
+        /* Urgent only on the transition into alarm, not while it persists */
+        bool outside = sensors[i].alarm_enabled && sensors[i].enabled &&
+                       (sensors[i].value < sensors[i].threshold_min ||
+                        sensors[i].value > sensors[i].threshold_max);
+        if (outside && !out_of_range[i]) {
+            bits |= SENSOR_NOTIFY_URGENT;
+            ESP_LOGD(TAG, "%s crossed threshold: %.2f", sensors[i].name, sensors[i].value);
+        }
+        out_of_range[i] = outside;
+        
         if (user_callback) {
             user_callback(sensors[i].id, sensors[i].value, sensors[i].status);
         }
     }
     
+    /* Publish the sample set */
+    sample_sequence++;
+    for (int i = 0; i < subscriber_count; i++) {
+        xTaskNotify(subscribers[i], bits, eSetBits);
+    }
+    
     xSemaphoreGive(sensor_mutex);
     
     return ESP_OK;
@@ -382,6 +536,7 @@ const char* sensor_type_to_string(sensor_type_t type)
         case SENSOR_TYPE_WEIGHT: return "Weight";
         case SENSOR_TYPE_MOTION: return "Motion";
         case SENSOR_TYPE_DOOR: return "Door";
+        case SENSOR_TYPE_HEAT_INDEX: return "Heat Index";
         default: return "Unknown";
     }
 }
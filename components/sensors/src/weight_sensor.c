@@ -1,5 +1,6 @@
 #include "sensors/weight_sensor.h"
 #include "sensors/sensor_manager.h"
+#include "sensors/adc_sweep.h"
 #include <esp_adc/adc_oneshot.h>
 #include <esp_log.h>
 #include <string.h>
@@ -13,6 +14,10 @@ static const char *TAG = "WEIGHT_SENSOR";
 #define ADC_VREF 3.3f
 #define ADC_MAX  4095.0f
 
+/* Fast mode: trimmed mean of a burst of conversions, then a first-order IIR */
+#define WEIGHT_FAST_OVERSAMPLE  8
+#define WEIGHT_FAST_ALPHA       0.3f
+
 static weight_data_t weight_data = {0};
 static sensor_data_t weight_sensors[2];
 static bool initialized = false;
@@ -20,11 +25,14 @@ static float tare_offset_1 = 0.0f;
 static float tare_offset_2 = 0.0f;
 static float calibration_factor_1 = 1.0f;
 static float calibration_factor_2 = 1.0f;
+static volatile bool fast_mode = false;
+static volatile bool fast_primed = false;
+static volatile float fast_filtered = 0.0f;
 
 static float read_weight_from_channel(adc_channel_t channel, float tare, float cal_factor)
 {
     int adc_value = 0;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, channel, &adc_value));
+    adc_sweep_get_raw(channel, &adc_value);
     float voltage = (float)adc_value / ADC_MAX * ADC_VREF;
     float weight = (voltage * cal_factor) - tare;
     if (weight < 0) weight = 0;
@@ -81,8 +89,12 @@ esp_err_t weight_sensor_read_all(void)
 {
     if (!initialized) return ESP_ERR_INVALID_STATE;
     
-    /* Read both sensors from their respective ADC channels */
-    weight_sensors[0].value = read_weight_from_channel(WEIGHT_ADC_CHANNEL_1, tare_offset_1, calibration_factor_1);
+    /* Read both sensors from their respective ADC channels; fast mode owns the feeder channel */
+    if (fast_mode && fast_primed) {
+        weight_sensors[0].value = fast_filtered;
+    } else {
+        weight_sensors[0].value = read_weight_from_channel(WEIGHT_ADC_CHANNEL_1, tare_offset_1, calibration_factor_1);
+    }
     weight_sensors[1].value = read_weight_from_channel(WEIGHT_ADC_CHANNEL_2, tare_offset_2, calibration_factor_2);
     
     weight_data.weight = weight_sensors[0].value;
@@ -94,6 +106,51 @@ esp_err_t weight_sensor_read_all(void)
     return ESP_OK;
 }
 
+esp_err_t weight_sensor_set_fast_mode(bool enable)
+{
+    if (!initialized) return ESP_ERR_INVALID_STATE;
+    
+    fast_primed = false;
+    fast_mode = enable;
+    ESP_LOGD(TAG, "Feeder weight fast sampling %s", enable ? "on" : "off");
+    return ESP_OK;
+}
+
+esp_err_t weight_sensor_sample_fast(float *weight)
+{
+    if (!initialized || !fast_mode) return ESP_ERR_INVALID_STATE;
+    if (weight == NULL) return ESP_ERR_INVALID_ARG;
+    
+    int samples[WEIGHT_FAST_OVERSAMPLE];
+    esp_err_t err = adc_sweep_read(WEIGHT_ADC_CHANNEL_1, samples, WEIGHT_FAST_OVERSAMPLE);
+    if (err != ESP_OK) return err;
+    
+    int sum = 0;
+    int lo = 0;
+    int hi = 0;
+    for (int i = 0; i < WEIGHT_FAST_OVERSAMPLE; i++) {
+        sum += samples[i];
+        if (samples[i] < samples[lo]) lo = i;
+        if (samples[i] > samples[hi]) hi = i;
+    }
+    /* Drop one min and one max to reject auger vibration spikes */
+    sum -= samples[lo] + samples[hi];
+    
+    float voltage = (float)sum / (WEIGHT_FAST_OVERSAMPLE - 2) / ADC_MAX * ADC_VREF;
+    float raw = (voltage * calibration_factor_1) - tare_offset_1;
+    if (raw < 0) raw = 0;
+    
+    if (!fast_primed) {
+        fast_filtered = raw;
+        fast_primed = true;
+    } else {
+        fast_filtered += WEIGHT_FAST_ALPHA * (raw - fast_filtered);
+    }
+    
+    *weight = fast_filtered;
+    return ESP_OK;
+}
+
 weight_data_t weight_sensor_get_data(void)
 {
     return weight_data;
@@ -108,11 +165,11 @@ sensor_data_t* get_weight_sensors(uint8_t *count)
 esp_err_t weight_sensor_tare(void)
 {
     int adc_value = 0;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, WEIGHT_ADC_CHANNEL_1, &adc_value));
+    ESP_ERROR_CHECK(adc_sweep_read(WEIGHT_ADC_CHANNEL_1, &adc_value, 1));
     float voltage = (float)adc_value / ADC_MAX * ADC_VREF;
     tare_offset_1 = voltage * calibration_factor_1;
     
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, WEIGHT_ADC_CHANNEL_2, &adc_value));
+    ESP_ERROR_CHECK(adc_sweep_read(WEIGHT_ADC_CHANNEL_2, &adc_value, 1));
     voltage = (float)adc_value / ADC_MAX * ADC_VREF;
     tare_offset_2 = voltage * calibration_factor_2;
     
@@ -123,13 +180,13 @@ esp_err_t weight_sensor_tare(void)
 esp_err_t weight_sensor_calibrate(float known_weight)
 {
     int adc_value = 0;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, WEIGHT_ADC_CHANNEL_1, &adc_value));
+    ESP_ERROR_CHECK(adc_sweep_read(WEIGHT_ADC_CHANNEL_1, &adc_value, 1));
     float voltage = (float)adc_value / ADC_MAX * ADC_VREF;
     if (voltage > 0.01f) {
         calibration_factor_1 = known_weight / voltage;
     }
     
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, WEIGHT_ADC_CHANNEL_2, &adc_value));
+    ESP_ERROR_CHECK(adc_sweep_read(WEIGHT_ADC_CHANNEL_2, &adc_value, 1));
     voltage = (float)adc_value / ADC_MAX * ADC_VREF;
     if (voltage > 0.01f) {
         calibration_factor_2 = known_weight / voltage;
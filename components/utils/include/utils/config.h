@@ -18,18 +18,134 @@
 #define CONFIG_MAX_ACTUATORS 32
 #endif
 
+#ifndef CONFIG_ACTUATOR_START_STAGGER_MS
+#define CONFIG_ACTUATOR_START_STAGGER_MS 1500
+#endif
+
+#ifndef CONFIG_ACTUATOR_FEEDBACK_PERIOD_MS
+#define CONFIG_ACTUATOR_FEEDBACK_PERIOD_MS 1000
+#endif
+
 #ifndef CONFIG_SENSOR_READ_INTERVAL_MS
-#define CONFIG_SENSOR_READ_INTERVAL_MS 5000
+#define CONFIG_SENSOR_READ_INTERVAL_MS 2000
 #endif
 
 #ifndef CONFIG_CONTROL_LOOP_INTERVAL_MS
 #define CONFIG_CONTROL_LOOP_INTERVAL_MS 2000
 #endif
 
+#ifndef CONFIG_CONTROL_PID_PERIOD_MS
+#define CONFIG_CONTROL_PID_PERIOD_MS 2000
+#endif
+
+#ifndef CONFIG_CONTROL_HEATER_WINDOW_MS
+#define CONFIG_CONTROL_HEATER_WINDOW_MS 300000
+#endif
+
+#ifndef CONFIG_CONTROL_FAN_MIN_RUN_S
+#define CONFIG_CONTROL_FAN_MIN_RUN_S 120
+#endif
+
+#ifndef CONFIG_CONTROL_FAN_MIN_OFF_S
+#define CONFIG_CONTROL_FAN_MIN_OFF_S 180
+#endif
+
+#ifndef CONFIG_CONTROL_ADAPTIVE_PERIOD_S
+#define CONFIG_CONTROL_ADAPTIVE_PERIOD_S 60
+#endif
+
+#ifndef CONFIG_CONTROL_OUTDOOR_SENSOR_ID
+#define CONFIG_CONTROL_OUTDOOR_SENSOR_ID 20
+#endif
+
+#ifndef CONFIG_FEED_DISPENSE_SAMPLE_MS
+#define CONFIG_FEED_DISPENSE_SAMPLE_MS 50
+#endif
+
+#ifndef CONFIG_FEED_DISPENSE_TIMEOUT_S
+#define CONFIG_FEED_DISPENSE_TIMEOUT_S 300
+#endif
+
+#ifndef CONFIG_FEED_DISPENSE_DEFAULT_G
+#define CONFIG_FEED_DISPENSE_DEFAULT_G 0
+#endif
+
 #ifndef CONFIG_MONITORING_INTERVAL_MS
 #define CONFIG_MONITORING_INTERVAL_MS 5000
 #endif
 
+#ifndef CONFIG_CHANGE_BASELINE_MIN
+#define CONFIG_CHANGE_BASELINE_MIN 240
+#endif
+
+#ifndef CONFIG_CHANGE_WARMUP_MIN
+#define CONFIG_CHANGE_WARMUP_MIN 30
+#endif
+
+#ifndef CONFIG_ALARM_ON_DELAY_MS
+#define CONFIG_ALARM_ON_DELAY_MS 10000
+#endif
+
+#ifndef CONFIG_ALARM_OFF_DELAY_MS
+#define CONFIG_ALARM_OFF_DELAY_MS 30000
+#endif
+
+#ifndef CONFIG_EVENT_LOG_SIZE
+#define CONFIG_EVENT_LOG_SIZE 16384
+#endif
+
+#ifndef CONFIG_EVENT_LOG_ECHO_SEVERITY
+#define CONFIG_EVENT_LOG_ECHO_SEVERITY 1
+#endif
+
+#ifndef CONFIG_JOURNAL_SEVERITY
+#define CONFIG_JOURNAL_SEVERITY 2
+#endif
+
+#ifndef CONFIG_JOURNAL_FLUSH_INTERVAL_MS
+#define CONFIG_JOURNAL_FLUSH_INTERVAL_MS 10000
+#endif
+
+#ifndef CONFIG_TSDB_INTERVAL_S
+#define CONFIG_TSDB_INTERVAL_S 60
+#endif
+
+#ifndef CONFIG_TSDB_FLUSH_INTERVAL_MIN
+#define CONFIG_TSDB_FLUSH_INTERVAL_MIN 240
+#endif
+
+#ifndef CONFIG_SENSOR_STATS_RECORDS
+#define CONFIG_SENSOR_STATS_RECORDS 128
+#endif
+
+#ifndef CONFIG_PROFILER_INTERVAL_MS
+#define CONFIG_PROFILER_INTERVAL_MS 10000
+#endif
+
+#ifndef CONFIG_PROFILER_STACK_WARN_BYTES
+#define CONFIG_PROFILER_STACK_WARN_BYTES 512
+#endif
+
+#ifndef CONFIG_HEAP_MONITOR_INTERVAL_MS
+#define CONFIG_HEAP_MONITOR_INTERVAL_MS 60000
+#endif
+
+#ifndef CONFIG_HEAP_LEAK_WINDOW_H
+#define CONFIG_HEAP_LEAK_WINDOW_H 24
+#endif
+
+#ifndef CONFIG_HEAP_LEAK_ALERT_BYTES_PER_H
+#define CONFIG_HEAP_LEAK_ALERT_BYTES_PER_H 512
+#endif
+
+#ifndef CONFIG_HEAP_FRAG_ALERT_PERCENT
+#define CONFIG_HEAP_FRAG_ALERT_PERCENT 70
+#endif
+
+#ifndef CONFIG_HEAP_LOW_BLOCK_BYTES
+#define CONFIG_HEAP_LOW_BLOCK_BYTES 16384
+#endif
+
 #define CONFIG_WIFI_RECONNECT_DELAY_MS 5000
 #define CONFIG_MQTT_PUBLISH_INTERVAL_MS 60000
 #define CONFIG_MESH_PUBLISH_INTERVAL_MS 30000
@@ -44,6 +160,9 @@ typedef struct {
     float ammonia_max;
     float co2_max;
     float co_max;
+    float thi_alert;            /* heat stress stages, temperature-humidity index in degC */
+    float thi_danger;
+    float thi_emergency;
     bool auto_control_enabled;
     bool notifications_enabled;
 } poultry_config_t;
@@ -86,6 +205,7 @@ void config_update(poultry_config_t *config);
 esp_err_t config_set_temperature_range(float min, float max, float optimal);
 esp_err_t config_set_humidity_range(float min, float max, float optimal);
 esp_err_t config_set_gas_limits(float ammonia, float co2, float co);
+esp_err_t config_set_thi_limits(float alert, float danger, float emergency);
 esp_err_t config_set_mesh_enabled(bool enabled);
 esp_err_t config_set_mesh_config(const char *ssid, const char *password, uint8_t max_layer);
 esp_err_t config_set_mesh_as_root(bool is_root);
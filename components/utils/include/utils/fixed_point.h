@@ -0,0 +1,61 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/*
+ * Q16.16 fixed-point helpers. Range is about +/-32768 with a resolution of
+ * 1/65536; multiplications go through 64 bits and saturate instead of
+ * wrapping.
+ */
+
+typedef int32_t fix16_t;
+
+#define FIX16_ONE        ((fix16_t)0x00010000)
+#define FIX16_MAX        ((fix16_t)0x7FFFFFFF)
+#define FIX16_MIN        ((fix16_t)0x80000000)
+
+#define FIX16_FROM_INT(x)    ((fix16_t)((x) * FIX16_ONE))
+#define FIX16_FROM_FLOAT(x)  ((fix16_t)((x) * 65536.0f + ((x) >= 0 ? 0.5f : -0.5f)))
+#define FIX16_TO_FLOAT(x)    ((float)(x) / 65536.0f)
+#define FIX16_TO_INT(x)      ((int32_t)(((x) + (FIX16_ONE >> 1)) >> 16))
+
+static inline fix16_t fix16_saturate(int64_t value)
+{
+    if (value > FIX16_MAX) return FIX16_MAX;
+    if (value < FIX16_MIN) return FIX16_MIN;
+    return (fix16_t)value;
+}
+
+static inline fix16_t fix16_add(fix16_t a, fix16_t b)
+{
+    return fix16_saturate((int64_t)a + b);
+}
+
+static inline fix16_t fix16_sub(fix16_t a, fix16_t b)
+{
+    return fix16_saturate((int64_t)a - b);
+}
+
+static inline fix16_t fix16_mul(fix16_t a, fix16_t b)
+{
+    int64_t product = (int64_t)a * b;
+    /* Round to nearest before dropping the fraction bits */
+    product += (product >= 0) ? (1 << 15) : -(1 << 15);
+    return fix16_saturate(product / FIX16_ONE);
+}
+
+static inline fix16_t fix16_div(fix16_t a, fix16_t b)
+{
+    if (b == 0) return a >= 0 ? FIX16_MAX : FIX16_MIN;
+    return fix16_saturate(((int64_t)a * FIX16_ONE) / b);
+}
+
+static inline fix16_t fix16_clamp(fix16_t value, fix16_t min, fix16_t max)
+{
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <esp_err.h>
+
+/*
+ * Runtime metrics: counters, gauges and fixed-bucket histograms.
+ *
+ * Each metric is a static metric_t owned by the code it instruments and
+ * registered once under a Prometheus-style name. Counters and histograms
+ * keep one shard per core; an update is a relaxed atomic add on the shard
+ * of the calling core, so it takes no lock and never contends with the
+ * other core. Readers sum the shards. Updates before registration are
+ * counted but not exported.
+ *
+ * Histogram bounds are inclusive upper limits in ascending order; values
+ * above the last bound land in an overflow bucket. Latencies are recorded
+ * in microseconds with metric_timer_start()/metric_observe_since().
+ *
+ * Modules with a variable set of series (one per task, say) register a
+ * collector instead; it appends its own samples after the metrics.
+ */
+
+#define METRICS_MAX             32
+#define METRICS_MAX_BUCKETS     10
+#define METRICS_SHARDS          2       /* one per core */
+#define METRICS_MAX_COLLECTORS  4
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} metric_type_t;
+
+typedef enum {
+    METRICS_FORMAT_PROMETHEUS,
+    METRICS_FORMAT_COMPACT      /* ,"key":value members of the JSON object */
+} metrics_format_t;
+
+/* Writes the collector's samples NUL-terminated; returns their length, or 0 if they do not fit */
+typedef size_t (*metrics_collector_t)(metrics_format_t format, char *buffer, size_t buffer_size);
+
+typedef struct {
+    _Atomic uint32_t count;             /* counter value or observations */
+    _Atomic uint32_t sum_low;           /* histogram sum, carried into sum_high */
+    _Atomic uint32_t sum_high;
+    _Atomic uint32_t buckets[METRICS_MAX_BUCKETS + 1];
+} metric_shard_t;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    metric_type_t type;
+    uint8_t bucket_count;
+    const uint32_t *bounds;
+    _Atomic uint32_t gauge;             /* float bits */
+    metric_shard_t shard[METRICS_SHARDS];
+} metric_t;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    metric_type_t type;
+    float value;                        /* gauge */
+    uint64_t count;                     /* counter value or observations */
+    uint64_t sum;
+    uint8_t bucket_count;
+    const uint32_t *bounds;
+    uint32_t buckets[METRICS_MAX_BUCKETS + 1];  /* per bucket, overflow last */
+} metric_snapshot_t;
+
+esp_err_t metric_register(metric_t *metric, const char *name, const char *help, metric_type_t type);
+esp_err_t metric_register_histogram(metric_t *metric, const char *name, const char *help,
+                                    const uint32_t *bounds, uint8_t bucket_count);
+esp_err_t metrics_register_collector(metrics_collector_t collector);
+
+void metric_inc(metric_t *metric);
+void metric_add(metric_t *metric, uint32_t amount);
+void metric_set(metric_t *metric, float value);
+void metric_observe(metric_t *metric, uint32_t value);
+uint32_t metric_timer_start(void);
+void metric_observe_since(metric_t *metric, uint32_t start_us);
+
+uint8_t metrics_get_count(void);
+esp_err_t metrics_get_snapshot(uint8_t index, metric_snapshot_t *snapshot);
+void metrics_reset(void);
+/* Whole metrics only; ESP_ERR_INVALID_SIZE when some did not fit */
+esp_err_t metrics_export_prometheus(char *buffer, size_t buffer_size, size_t *length);
+esp_err_t metrics_export_compact(char *buffer, size_t buffer_size, size_t *length);
+
+#endif
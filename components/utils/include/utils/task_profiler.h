@@ -0,0 +1,55 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Per-task CPU usage and stack headroom.
+ *
+ * A low-priority task samples the FreeRTOS run-time counters of every task
+ * each interval. A task's CPU figure is its run time over the interval as a
+ * percentage of one core, so the tasks of both cores add up to 200 %. Core
+ * load is 100 % minus the share of that core's idle task. The stack figure is
+ * the high-water mark: the least free stack the task has had since it was
+ * created, in bytes.
+ *
+ * The results are exported with the metrics (task_cpu_percent,
+ * task_stack_free_bytes, core_cpu_percent). A task whose free stack falls
+ * below CONFIG_PROFILER_STACK_WARN_BYTES is logged once.
+ *
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without them starting the
+ * profiler returns ESP_ERR_NOT_SUPPORTED.
+ */
+
+#define TASK_PROFILER_MAX_TASKS     24
+#define TASK_PROFILER_CORES         2
+#define TASK_PROFILER_NO_AFFINITY   (-1)
+
+typedef struct {
+    char name[16];
+    uint8_t priority;
+    int8_t core;                /* pinned core, or TASK_PROFILER_NO_AFFINITY */
+    float cpu_percent;          /* last interval, percent of one core */
+    uint32_t stack_free_min;    /* bytes, since the task was created */
+} task_profile_t;
+
+typedef struct {
+    uint32_t interval_us;       /* length of the last interval */
+    float core_load[TASK_PROFILER_CORES];
+    uint32_t samples;
+    uint8_t task_count;
+    uint8_t tasks_dropped;      /* beyond TASK_PROFILER_MAX_TASKS */
+} task_profiler_stats_t;
+
+esp_err_t task_profiler_start(uint32_t interval_ms);
+esp_err_t task_profiler_stop(void);
+esp_err_t task_profiler_sample(void);
+/* Busiest first */
+esp_err_t task_profiler_get_tasks(task_profile_t *tasks, uint8_t max_count, uint8_t *count);
+void task_profiler_get_stats(task_profiler_stats_t *stats);
+void task_profiler_log(void);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TASK_TIMING_H
+#define TASK_TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/*
+ * Timing statistics for periodic work.
+ *
+ * Each periodic task owns a task_timing_t, registers it once and brackets
+ * every cycle with task_timing_begin()/task_timing_end(). Start jitter is
+ * measured against an ideal schedule of start + n * period that does not
+ * drift with execution time. A cycle is an overrun when it ends after the
+ * next deadline or when deadlines were skipped entirely.
+ *
+ * Histogram bins are relative to the period: bin 0 counts values below
+ * period/64, each further bin doubles the limit, and the last bin counts
+ * values of a full period or more.
+ */
+
+#define TASK_TIMING_HIST_BINS   8
+#define TASK_TIMING_MAX_TASKS   8
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t cycles;
+    uint32_t overruns;
+    uint32_t exec_last_us;
+    uint32_t exec_min_us;
+    uint32_t exec_max_us;
+    uint64_t exec_total_us;
+    int32_t jitter_min_us;
+    int32_t jitter_max_us;
+    uint32_t exec_hist[TASK_TIMING_HIST_BINS];
+    uint32_t jitter_hist[TASK_TIMING_HIST_BINS];
+} task_timing_stats_t;
+
+typedef struct {
+    task_timing_stats_t stats;
+    int64_t deadline_us;        /* ideal start of the current cycle */
+    int64_t start_us;
+    bool started;
+} task_timing_t;
+
+esp_err_t task_timing_register(task_timing_t *timing, const char *name, uint32_t period_ms);
+void task_timing_begin(task_timing_t *timing);
+void task_timing_end(task_timing_t *timing);
+void task_timing_reset(task_timing_t *timing);
+esp_err_t task_timing_get_stats(const char *name, task_timing_stats_t *stats);
+uint8_t task_timing_get_count(void);
+esp_err_t task_timing_get_stats_by_index(uint8_t index, task_timing_stats_t *stats);
+void task_timing_log_all(void);
+
+#endif
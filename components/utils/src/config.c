@@ -17,6 +17,9 @@ poultry_config_t poultry_config = {
     .ammonia_max = 25.0f,
     .co2_max = 3000.0f,
     .co_max = 50.0f,
+    .thi_alert = 27.8f,
+    .thi_danger = 28.9f,
+    .thi_emergency = 30.0f,
     .auto_control_enabled = 1,
     .notifications_enabled = 1
 };
@@ -107,6 +110,9 @@ void config_load(void)
     get_float("ammonia_max", &poultry_config.ammonia_max);
     get_float("co2_max", &poultry_config.co2_max);
     get_float("co_max", &poultry_config.co_max);
+    get_float("thi_alert", &poultry_config.thi_alert);
+    get_float("thi_danger", &poultry_config.thi_danger);
+    get_float("thi_emergency", &poultry_config.thi_emergency);
     
     uint8_t auto_ctrl = 1;
     nvs_get_u8(s_nvs_handle, "auto_control", &auto_ctrl);
@@ -154,6 +160,9 @@ void config_save(void)
     save_float("ammonia_max", poultry_config.ammonia_max);
     save_float("co2_max", poultry_config.co2_max);
     save_float("co_max", poultry_config.co_max);
+    save_float("thi_alert", poultry_config.thi_alert);
+    save_float("thi_danger", poultry_config.thi_danger);
+    save_float("thi_emergency", poultry_config.thi_emergency);
     nvs_set_u8(s_nvs_handle, "auto_control", poultry_config.auto_control_enabled ? 1 : 0);
     nvs_set_u8(s_nvs_handle, "notifications", poultry_config.notifications_enabled ? 1 : 0);
     
@@ -218,6 +227,18 @@ esp_err_t config_set_gas_limits(float ammonia, float co2, float co)
     return ESP_OK;
 }
 
+esp_err_t config_set_thi_limits(float alert, float danger, float emergency)
+{
+    if (alert >= danger || danger >= emergency) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    poultry_config.thi_alert = alert;
+    poultry_config.thi_danger = danger;
+    poultry_config.thi_emergency = emergency;
+    config_save();
+    return ESP_OK;
+}
+
 esp_err_t config_set_mesh_enabled(bool enabled)
 {
     mesh_config.mesh_enabled = enabled;
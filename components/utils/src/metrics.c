@@ -0,0 +1,366 @@
+#include "utils/metrics.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+static const char *TAG = "METRICS";
+
+static metric_t *registry[METRICS_MAX];
+static uint8_t registry_count = 0;
+static metrics_collector_t collectors[METRICS_MAX_COLLECTORS];
+static uint8_t collector_count = 0;
+static SemaphoreHandle_t metrics_mutex = NULL;
+
+/* The shard of the calling core; a task moved in between still adds atomically */
+static metric_shard_t *local_shard(metric_t *metric)
+{
+    return &metric->shard[xPortGetCoreID() % METRICS_SHARDS];
+}
+
+static esp_err_t create_mutex(void)
+{
+    if (metrics_mutex == NULL) {
+        metrics_mutex = xSemaphoreCreateMutex();
+        if (metrics_mutex == NULL) return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t registry_add(metric_t *metric)
+{
+    if (create_mutex() != ESP_OK) return ESP_ERR_NO_MEM;
+
+    xSemaphoreTake(metrics_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < registry_count; i++) {
+        if (registry[i] == metric) {
+            xSemaphoreGive(metrics_mutex);
+            return ESP_OK;
+        }
+    }
+    if (registry_count >= METRICS_MAX) {
+        xSemaphoreGive(metrics_mutex);
+        ESP_LOGW(TAG, "Registry full, %s not exported", metric->name);
+        return ESP_ERR_NO_MEM;
+    }
+    registry[registry_count++] = metric;
+
+    xSemaphoreGive(metrics_mutex);
+    return ESP_OK;
+}
+
+esp_err_t metric_register(metric_t *metric, const char *name, const char *help, metric_type_t type)
+{
+    if (metric == NULL || name == NULL || type == METRIC_HISTOGRAM) return ESP_ERR_INVALID_ARG;
+
+    metric->name = name;
+    metric->help = help;
+    metric->type = type;
+    return registry_add(metric);
+}
+
+esp_err_t metric_register_histogram(metric_t *metric, const char *name, const char *help,
+                                    const uint32_t *bounds, uint8_t bucket_count)
+{
+    if (metric == NULL || name == NULL || bounds == NULL) return ESP_ERR_INVALID_ARG;
+    if (bucket_count == 0 || bucket_count > METRICS_MAX_BUCKETS) return ESP_ERR_INVALID_ARG;
+    for (int i = 1; i < bucket_count; i++) {
+        if (bounds[i] <= bounds[i - 1]) return ESP_ERR_INVALID_ARG;
+    }
+
+    metric->name = name;
+    metric->help = help;
+    metric->type = METRIC_HISTOGRAM;
+    metric->bounds = bounds;
+    metric->bucket_count = bucket_count;
+    return registry_add(metric);
+}
+
+esp_err_t metrics_register_collector(metrics_collector_t collector)
+{
+    if (collector == NULL) return ESP_ERR_INVALID_ARG;
+    if (create_mutex() != ESP_OK) return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(metrics_mutex, portMAX_DELAY);
+    for (int i = 0; i < collector_count; i++) {
+        if (collectors[i] == collector) {
+            xSemaphoreGive(metrics_mutex);
+            return ESP_OK;
+        }
+    }
+    if (collector_count < METRICS_MAX_COLLECTORS) {
+        collectors[collector_count++] = collector;
+    } else {
+        ret = ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(metrics_mutex);
+    return ret;
+}
+
+void metric_inc(metric_t *metric)
+{
+    atomic_fetch_add_explicit(&local_shard(metric)->count, 1, memory_order_relaxed);
+}
+
+void metric_add(metric_t *metric, uint32_t amount)
+{
+    atomic_fetch_add_explicit(&local_shard(metric)->count, amount, memory_order_relaxed);
+}
+
+void metric_set(metric_t *metric, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    atomic_store_explicit(&metric->gauge, bits, memory_order_relaxed);
+}
+
+void metric_observe(metric_t *metric, uint32_t value)
+{
+    /* Bounds are not known before registration; everything lands in bucket 0 */
+    uint8_t bucket = 0;
+    while (bucket < metric->bucket_count && value > metric->bounds[bucket]) bucket++;
+
+    metric_shard_t *shard = local_shard(metric);
+    atomic_fetch_add_explicit(&shard->buckets[bucket], 1, memory_order_relaxed);
+    uint32_t low = atomic_fetch_add_explicit(&shard->sum_low, value, memory_order_relaxed);
+    if (low + value < low) atomic_fetch_add_explicit(&shard->sum_high, 1, memory_order_relaxed);
+}
+
+uint32_t metric_timer_start(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+void metric_observe_since(metric_t *metric, uint32_t start_us)
+{
+    metric_observe(metric, (uint32_t)esp_timer_get_time() - start_us);
+}
+
+uint8_t metrics_get_count(void)
+{
+    return registry_count;
+}
+
+static uint64_t shard_sum(metric_shard_t *shard)
+{
+    /* Re-read if a carry went into the high word in between */
+    uint32_t high, low;
+    do {
+        high = atomic_load_explicit(&shard->sum_high, memory_order_relaxed);
+        low = atomic_load_explicit(&shard->sum_low, memory_order_relaxed);
+    } while (high != atomic_load_explicit(&shard->sum_high, memory_order_relaxed));
+    return ((uint64_t)high << 32) | low;
+}
+
+static void take_snapshot(metric_t *metric, metric_snapshot_t *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->name = metric->name;
+    snapshot->help = metric->help;
+    snapshot->type = metric->type;
+    snapshot->bucket_count = metric->bucket_count;
+    snapshot->bounds = metric->bounds;
+
+    uint32_t bits = atomic_load_explicit(&metric->gauge, memory_order_relaxed);
+    memcpy(&snapshot->value, &bits, sizeof(bits));
+
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        metric_shard_t *shard = &metric->shard[s];
+        if (metric->type != METRIC_HISTOGRAM) {
+            snapshot->count += atomic_load_explicit(&shard->count, memory_order_relaxed);
+            continue;
+        }
+        /* The count is the sum of the buckets, so the two always agree */
+        for (int b = 0; b <= metric->bucket_count; b++) {
+            uint32_t n = atomic_load_explicit(&shard->buckets[b], memory_order_relaxed);
+            snapshot->buckets[b] += n;
+            snapshot->count += n;
+        }
+        snapshot->sum += shard_sum(shard);
+    }
+}
+
+esp_err_t metrics_get_snapshot(uint8_t index, metric_snapshot_t *snapshot)
+{
+    if (snapshot == NULL) return ESP_ERR_INVALID_ARG;
+    if (metrics_mutex == NULL || index >= registry_count) return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(metrics_mutex, portMAX_DELAY);
+    take_snapshot(registry[index], snapshot);
+    xSemaphoreGive(metrics_mutex);
+    return ESP_OK;
+}
+
+void metrics_reset(void)
+{
+    if (metrics_mutex == NULL) return;
+
+    xSemaphoreTake(metrics_mutex, portMAX_DELAY);
+    for (int i = 0; i < registry_count; i++) {
+        for (int s = 0; s < METRICS_SHARDS; s++) {
+            metric_shard_t *shard = &registry[i]->shard[s];
+            atomic_store_explicit(&shard->count, 0, memory_order_relaxed);
+            atomic_store_explicit(&shard->sum_low, 0, memory_order_relaxed);
+            atomic_store_explicit(&shard->sum_high, 0, memory_order_relaxed);
+            for (int b = 0; b <= METRICS_MAX_BUCKETS; b++) {
+                atomic_store_explicit(&shard->buckets[b], 0, memory_order_relaxed);
+            }
+        }
+    }
+    xSemaphoreGive(metrics_mutex);
+    ESP_LOGI(TAG, "Metrics reset");
+}
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+    bool overflow;
+} text_t;
+
+static void append(text_t *text, const char *format, ...)
+{
+    if (text->overflow) return;
+
+    va_list args;
+    va_start(args, format);
+    size_t room = text->size - text->used;
+    int n = vsnprintf(text->buffer + text->used, room, format, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= room) {
+        text->overflow = true;
+        return;
+    }
+    text->used += n;
+}
+
+/* Appends one metric, or nothing if it does not fit whole */
+static bool append_metric(text_t *text, void (*format)(text_t *, const metric_snapshot_t *),
+                          const metric_snapshot_t *snapshot)
+{
+    size_t mark = text->used;
+    format(text, snapshot);
+    if (!text->overflow) return true;
+
+    text->used = mark;
+    text->buffer[mark] = '\0';
+    text->overflow = false;
+    return false;
+}
+
+static void append_float(text_t *text, float value)
+{
+    if (isnan(value)) {
+        append(text, "NaN");
+    } else if (isinf(value)) {
+        append(text, value > 0 ? "+Inf" : "-Inf");
+    } else {
+        append(text, "%.6g", value);
+    }
+}
+
+static void format_prometheus(text_t *text, const metric_snapshot_t *m)
+{
+    static const char *const type_names[] = { "counter", "gauge", "histogram" };
+
+    if (m->help) append(text, "# HELP %s %s\n", m->name, m->help);
+    append(text, "# TYPE %s %s\n", m->name, type_names[m->type]);
+
+    if (m->type == METRIC_COUNTER) {
+        append(text, "%s %llu\n", m->name, (unsigned long long)m->count);
+    } else if (m->type == METRIC_GAUGE) {
+        append(text, "%s ", m->name);
+        append_float(text, m->value);
+        append(text, "\n");
+    } else {
+        /* Prometheus buckets are cumulative */
+        uint64_t cumulative = 0;
+        for (int b = 0; b < m->bucket_count; b++) {
+            cumulative += m->buckets[b];
+            append(text, "%s_bucket{le=\"%lu\"} %llu\n", m->name,
+                   (unsigned long)m->bounds[b], (unsigned long long)cumulative);
+        }
+        append(text, "%s_bucket{le=\"+Inf\"} %llu\n", m->name, (unsigned long long)m->count);
+        append(text, "%s_sum %llu\n", m->name, (unsigned long long)m->sum);
+        append(text, "%s_count %llu\n", m->name, (unsigned long long)m->count);
+    }
+}
+
+/* "name":value, or "name":[count,sum,bucket...] with the buckets not cumulative */
+static void format_compact(text_t *text, const metric_snapshot_t *m)
+{
+    append(text, ",\"%s\":", m->name);
+
+    if (m->type == METRIC_COUNTER) {
+        append(text, "%llu", (unsigned long long)m->count);
+    } else if (m->type == METRIC_GAUGE) {
+        if (isfinite(m->value)) {
+            append(text, "%.6g", m->value);
+        } else {
+            append(text, "null");
+        }
+    } else {
+        append(text, "[%llu,%llu", (unsigned long long)m->count, (unsigned long long)m->sum);
+        for (int b = 0; b <= m->bucket_count; b++) {
+            append(text, ",%lu", (unsigned long)m->buckets[b]);
+        }
+        append(text, "]");
+    }
+}
+
+static esp_err_t export_all(text_t *text, metrics_format_t type, void (*format)(text_t *, const metric_snapshot_t *))
+{
+    metric_snapshot_t snapshot;
+    esp_err_t ret = ESP_OK;
+
+    if (metrics_mutex == NULL) return ESP_OK;
+
+    xSemaphoreTake(metrics_mutex, portMAX_DELAY);
+    for (int i = 0; i < registry_count; i++) {
+        take_snapshot(registry[i], &snapshot);
+        if (!append_metric(text, format, &snapshot)) ret = ESP_ERR_INVALID_SIZE;
+    }
+    for (int i = 0; i < collector_count; i++) {
+        size_t n = collectors[i](type, text->buffer + text->used, text->size - text->used);
+        if (n == 0) {
+            text->buffer[text->used] = '\0';
+            ret = ESP_ERR_INVALID_SIZE;
+        }
+        text->used += n;
+    }
+    xSemaphoreGive(metrics_mutex);
+    return ret;
+}
+
+esp_err_t metrics_export_prometheus(char *buffer, size_t buffer_size, size_t *length)
+{
+    if (buffer == NULL || buffer_size == 0) return ESP_ERR_INVALID_ARG;
+
+    text_t text = { .buffer = buffer, .size = buffer_size };
+    buffer[0] = '\0';
+    esp_err_t ret = export_all(&text, METRICS_FORMAT_PROMETHEUS, format_prometheus);
+    if (length) *length = text.used;
+    return ret;
+}
+
+esp_err_t metrics_export_compact(char *buffer, size_t buffer_size, size_t *length)
+{
+    if (buffer == NULL || buffer_size < 32) return ESP_ERR_INVALID_ARG;
+
+    /* Keep room for the closing brace */
+    text_t text = { .buffer = buffer, .size = buffer_size - 1 };
+    append(&text, "{\"uptime_s\":%lu", (unsigned long)(esp_timer_get_time() / 1000000));
+    esp_err_t ret = export_all(&text, METRICS_FORMAT_COMPACT, format_compact);
+    buffer[text.used++] = '}';
+    buffer[text.used] = '\0';
+    if (length) *length = text.used;
+    return ret;
+}
@@ -0,0 +1,314 @@
+#include "utils/task_profiler.h"
+#include "utils/metrics.h"
+#include "utils/config.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+static const char *TAG = "PROFILER";
+
+#if defined(CONFIG_FREERTOS_USE_TRACE_FACILITY) && defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+#define PROFILER_SUPPORTED      1
+#else
+#define PROFILER_SUPPORTED      0
+#endif
+
+typedef struct {
+    task_profile_t profile;
+    UBaseType_t number;         /* xTaskNumber, unique for the life of the system */
+    uint32_t last_runtime;
+    bool seen;
+    bool warned;
+} task_slot_t;
+
+static task_slot_t slots[TASK_PROFILER_MAX_TASKS];
+static uint8_t slot_count = 0;
+static task_profiler_stats_t stats = {0};
+static uint32_t last_total = 0;
+
+static SemaphoreHandle_t profiler_mutex = NULL;
+static TaskHandle_t profiler_task_handle = NULL;
+static volatile bool running = false;
+static uint32_t profiler_interval_ms = 0;
+
+#if PROFILER_SUPPORTED
+
+static task_slot_t *find_slot(UBaseType_t number)
+{
+    for (int i = 0; i < slot_count; i++) {
+        if (slots[i].number == number) return &slots[i];
+    }
+    if (slot_count >= TASK_PROFILER_MAX_TASKS) return NULL;
+
+    /* Its whole run time falls into this interval */
+    task_slot_t *slot = &slots[slot_count++];
+    memset(slot, 0, sizeof(*slot));
+    slot->number = number;
+    return slot;
+}
+
+static void update_slot(task_slot_t *slot, const TaskStatus_t *status, uint32_t elapsed)
+{
+    task_profile_t *profile = &slot->profile;
+    uint32_t delta = status->ulRunTimeCounter - slot->last_runtime;
+
+    strncpy(profile->name, status->pcTaskName, sizeof(profile->name) - 1);
+    profile->priority = status->uxCurrentPriority;
+    BaseType_t affinity = xTaskGetAffinity(status->xHandle);
+    profile->core = affinity == tskNO_AFFINITY ? TASK_PROFILER_NO_AFFINITY : affinity;
+    profile->cpu_percent = elapsed > 0 ? 100.0f * delta / elapsed : 0;
+    /* The ESP-IDF port counts stack in bytes */
+    profile->stack_free_min = status->usStackHighWaterMark;
+    slot->last_runtime = status->ulRunTimeCounter;
+    slot->seen = true;
+
+    if (!slot->warned && profile->stack_free_min < CONFIG_PROFILER_STACK_WARN_BYTES) {
+        ESP_LOGW(TAG, "%s has used all but %lu bytes of its stack",
+                 profile->name, (unsigned long)profile->stack_free_min);
+        slot->warned = true;
+    }
+}
+
+#endif
+
+esp_err_t task_profiler_sample(void)
+{
+#if !PROFILER_SUPPORTED
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (profiler_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    /* Sized per sample like vTaskGetRunTimeStats(); room for tasks created meanwhile */
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *status = malloc(capacity * sizeof(TaskStatus_t));
+    if (status == NULL) return ESP_ERR_NO_MEM;
+
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, capacity, &total);
+    if (count == 0) {
+        free(status);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    TaskHandle_t idle[TASK_PROFILER_CORES];
+    for (int c = 0; c < TASK_PROFILER_CORES; c++) idle[c] = xTaskGetIdleTaskHandleForCPU(c);
+
+    xSemaphoreTake(profiler_mutex, portMAX_DELAY);
+
+    /* The first sample only sets the baseline */
+    uint32_t elapsed = stats.samples > 0 ? total - last_total : 0;
+    uint8_t dropped = 0;
+
+    for (int i = 0; i < slot_count; i++) slots[i].seen = false;
+    for (UBaseType_t i = 0; i < count; i++) {
+        task_slot_t *slot = find_slot(status[i].xTaskNumber);
+        if (slot == NULL) {
+            dropped++;
+            continue;
+        }
+        update_slot(slot, &status[i], elapsed);
+
+        for (int c = 0; c < TASK_PROFILER_CORES; c++) {
+            if (status[i].xHandle != idle[c]) continue;
+            float load = 100.0f - slot->profile.cpu_percent;
+            stats.core_load[c] = elapsed == 0 ? 0 : load < 0 ? 0 : load;
+        }
+    }
+
+    /* Deleted tasks drop out */
+    uint8_t kept = 0;
+    for (int i = 0; i < slot_count; i++) {
+        if (slots[i].seen) slots[kept++] = slots[i];
+    }
+    slot_count = kept;
+
+    last_total = total;
+    stats.interval_us = elapsed;
+    stats.samples++;
+    stats.task_count = slot_count;
+    stats.tasks_dropped = dropped;
+
+    xSemaphoreGive(profiler_mutex);
+    free(status);
+    return ESP_OK;
+#endif
+}
+
+#if PROFILER_SUPPORTED
+
+static void profiler_task(void *parameter)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (running) {
+        task_profiler_sample();
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(profiler_interval_ms));
+    }
+
+    profiler_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+    bool overflow;
+} text_t;
+
+static void append(text_t *text, const char *format, ...)
+{
+    if (text->overflow) return;
+
+    va_list args;
+    va_start(args, format);
+    size_t room = text->size - text->used;
+    int n = vsnprintf(text->buffer + text->used, room, format, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= room) {
+        text->overflow = true;
+        return;
+    }
+    text->used += n;
+}
+
+static size_t profiler_collector(metrics_format_t format, char *buffer, size_t buffer_size)
+{
+    text_t text = { .buffer = buffer, .size = buffer_size };
+
+    if (buffer_size == 0 || stats.samples < 2) return 0;
+
+    xSemaphoreTake(profiler_mutex, portMAX_DELAY);
+    if (format == METRICS_FORMAT_PROMETHEUS) {
+        append(&text, "# HELP task_cpu_percent CPU time over the last profiler interval, percent of one core\n"
+                      "# TYPE task_cpu_percent gauge\n");
+        for (int i = 0; i < slot_count; i++) {
+            append(&text, "task_cpu_percent{task=\"%s\"} %.2f\n", slots[i].profile.name, slots[i].profile.cpu_percent);
+        }
+        append(&text, "# HELP task_stack_free_bytes Least free stack since the task was created\n"
+                      "# TYPE task_stack_free_bytes gauge\n");
+        for (int i = 0; i < slot_count; i++) {
+            append(&text, "task_stack_free_bytes{task=\"%s\"} %lu\n", slots[i].profile.name,
+                   (unsigned long)slots[i].profile.stack_free_min);
+        }
+        append(&text, "# HELP core_cpu_percent Busy time over the last profiler interval\n"
+                      "# TYPE core_cpu_percent gauge\n");
+        for (int c = 0; c < TASK_PROFILER_CORES; c++) {
+            append(&text, "core_cpu_percent{core=\"%d\"} %.2f\n", c, stats.core_load[c]);
+        }
+    } else {
+        /* "tasks":{"name":[cpu percent, stack free bytes], ...} */
+        append(&text, ",\"core_cpu_percent\":[%.1f,%.1f],\"tasks\":{", stats.core_load[0], stats.core_load[1]);
+        for (int i = 0; i < slot_count; i++) {
+            append(&text, "%s\"%s\":[%.1f,%lu]", i > 0 ? "," : "", slots[i].profile.name,
+                   slots[i].profile.cpu_percent, (unsigned long)slots[i].profile.stack_free_min);
+        }
+        append(&text, "}");
+    }
+    xSemaphoreGive(profiler_mutex);
+
+    return text.overflow ? 0 : text.used;
+}
+
+#endif
+
+esp_err_t task_profiler_start(uint32_t interval_ms)
+{
+#if !PROFILER_SUPPORTED
+    ESP_LOGW(TAG, "FreeRTOS run-time stats are disabled, profiler not started");
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (interval_ms == 0) return ESP_ERR_INVALID_ARG;
+    if (running) return ESP_ERR_INVALID_STATE;
+
+    if (profiler_mutex == NULL) {
+        profiler_mutex = xSemaphoreCreateMutex();
+        if (profiler_mutex == NULL) return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(profiler_mutex, portMAX_DELAY);
+    slot_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    xSemaphoreGive(profiler_mutex);
+
+    metrics_register_collector(profiler_collector);
+
+    profiler_interval_ms = interval_ms;
+    running = true;
+    if (xTaskCreate(profiler_task, "profiler_task", 2560, NULL, 1, &profiler_task_handle) != pdPASS) {
+        running = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Profiling tasks every %lu ms", (unsigned long)interval_ms);
+    return ESP_OK;
+#endif
+}
+
+esp_err_t task_profiler_stop(void)
+{
+    if (!running) return ESP_ERR_INVALID_STATE;
+
+    /* The task deletes itself after its current interval */
+    running = false;
+    return ESP_OK;
+}
+
+esp_err_t task_profiler_get_tasks(task_profile_t *tasks, uint8_t max_count, uint8_t *count)
+{
+    if (tasks == NULL || count == NULL) return ESP_ERR_INVALID_ARG;
+    if (profiler_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    uint8_t n = 0;
+    xSemaphoreTake(profiler_mutex, portMAX_DELAY);
+    for (int i = 0; i < slot_count; i++) {
+        /* Insertion by CPU share; the busiest max_count are kept */
+        const task_profile_t *profile = &slots[i].profile;
+        int at = n;
+        while (at > 0 && tasks[at - 1].cpu_percent < profile->cpu_percent) at--;
+        if (at >= max_count) continue;
+        int last = n < max_count ? n : max_count - 1;
+        memmove(&tasks[at + 1], &tasks[at], (last - at) * sizeof(*tasks));
+        tasks[at] = *profile;
+        if (n < max_count) n++;
+    }
+    xSemaphoreGive(profiler_mutex);
+
+    *count = n;
+    return ESP_OK;
+}
+
+void task_profiler_get_stats(task_profiler_stats_t *out)
+{
+    if (profiler_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(profiler_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(profiler_mutex);
+}
+
+void task_profiler_log(void)
+{
+    task_profile_t tasks[TASK_PROFILER_MAX_TASKS];
+    task_profiler_stats_t current;
+    uint8_t count = 0;
+
+    if (task_profiler_get_tasks(tasks, TASK_PROFILER_MAX_TASKS, &count) != ESP_OK) return;
+    task_profiler_get_stats(&current);
+
+    ESP_LOGI(TAG, "Core load %.1f%% / %.1f%% over %lu ms", current.core_load[0], current.core_load[1],
+             (unsigned long)(current.interval_us / 1000));
+    for (int i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "%-16s %5.1f%%  core %2d  prio %2u  stack free %lu",
+                 tasks[i].name, tasks[i].cpu_percent, tasks[i].core, tasks[i].priority,
+                 (unsigned long)tasks[i].stack_free_min);
+    }
+}
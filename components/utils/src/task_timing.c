@@ -0,0 +1,185 @@
+#include "utils/task_timing.h"
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+static const char *TAG = "TASK_TIMING";
+
+static task_timing_t *registry[TASK_TIMING_MAX_TASKS];
+static uint8_t registry_count = 0;
+static SemaphoreHandle_t timing_mutex = NULL;
+
+static uint8_t timing_bin(uint32_t value_us, uint32_t period_us)
+{
+    uint32_t limit = period_us >> (TASK_TIMING_HIST_BINS - 2);
+    for (uint8_t bin = 0; bin < TASK_TIMING_HIST_BINS - 1; bin++) {
+        if (value_us < limit) return bin;
+        limit <<= 1;
+    }
+    return TASK_TIMING_HIST_BINS - 1;
+}
+
+static void timing_clear(task_timing_t *timing)
+{
+    const char *name = timing->stats.name;
+    uint32_t period_us = timing->stats.period_us;
+
+    memset(&timing->stats, 0, sizeof(timing->stats));
+    timing->stats.name = name;
+    timing->stats.period_us = period_us;
+    timing->stats.exec_min_us = UINT32_MAX;
+    timing->stats.jitter_min_us = INT32_MAX;
+    timing->stats.jitter_max_us = INT32_MIN;
+    timing->started = false;
+}
+
+esp_err_t task_timing_register(task_timing_t *timing, const char *name, uint32_t period_ms)
+{
+    if (timing == NULL || name == NULL || period_ms == 0) return ESP_ERR_INVALID_ARG;
+
+    if (timing_mutex == NULL) {
+        timing_mutex = xSemaphoreCreateMutex();
+        if (timing_mutex == NULL) return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+
+    timing->stats.name = name;
+    timing->stats.period_us = period_ms * 1000;
+    timing_clear(timing);
+
+    for (int i = 0; i < registry_count; i++) {
+        if (registry[i] == timing) {
+            xSemaphoreGive(timing_mutex);
+            return ESP_OK;
+        }
+    }
+    if (registry_count >= TASK_TIMING_MAX_TASKS) {
+        xSemaphoreGive(timing_mutex);
+        ESP_LOGW(TAG, "Registry full, %s not tracked", name);
+        return ESP_ERR_NO_MEM;
+    }
+    registry[registry_count++] = timing;
+
+    xSemaphoreGive(timing_mutex);
+    return ESP_OK;
+}
+
+void task_timing_begin(task_timing_t *timing)
+{
+    if (timing_mutex == NULL) return;
+
+    int64_t now = esp_timer_get_time();
+    task_timing_stats_t *stats = &timing->stats;
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+
+    timing->start_us = now;
+    if (!timing->started) {
+        /* First cycle defines the schedule */
+        timing->deadline_us = now;
+        timing->started = true;
+    } else {
+        timing->deadline_us += stats->period_us;
+
+        /* Whole periods missed: count them and move the schedule forward */
+        if (now - timing->deadline_us >= (int64_t)stats->period_us) {
+            int64_t missed = (now - timing->deadline_us) / stats->period_us;
+            stats->overruns += (uint32_t)missed;
+            timing->deadline_us += missed * stats->period_us;
+        }
+    }
+
+    int32_t jitter = (int32_t)(now - timing->deadline_us);
+    if (jitter < stats->jitter_min_us) stats->jitter_min_us = jitter;
+    if (jitter > stats->jitter_max_us) stats->jitter_max_us = jitter;
+    stats->jitter_hist[timing_bin(jitter < 0 ? (uint32_t)-jitter : (uint32_t)jitter, stats->period_us)]++;
+
+    xSemaphoreGive(timing_mutex);
+}
+
+void task_timing_end(task_timing_t *timing)
+{
+    if (timing_mutex == NULL || !timing->started) return;
+
+    int64_t now = esp_timer_get_time();
+    task_timing_stats_t *stats = &timing->stats;
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+
+    uint32_t exec = (uint32_t)(now - timing->start_us);
+    stats->cycles++;
+    stats->exec_last_us = exec;
+    stats->exec_total_us += exec;
+    if (exec < stats->exec_min_us) stats->exec_min_us = exec;
+    if (exec > stats->exec_max_us) stats->exec_max_us = exec;
+    stats->exec_hist[timing_bin(exec, stats->period_us)]++;
+
+    if (now > timing->deadline_us + stats->period_us) {
+        stats->overruns++;
+    }
+
+    xSemaphoreGive(timing_mutex);
+}
+
+void task_timing_reset(task_timing_t *timing)
+{
+    if (timing_mutex == NULL) return;
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+    timing_clear(timing);
+    xSemaphoreGive(timing_mutex);
+}
+
+esp_err_t task_timing_get_stats(const char *name, task_timing_stats_t *stats)
+{
+    if (name == NULL || stats == NULL) return ESP_ERR_INVALID_ARG;
+    if (timing_mutex == NULL) return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+    for (int i = 0; i < registry_count; i++) {
+        if (strcmp(registry[i]->stats.name, name) == 0) {
+            *stats = registry[i]->stats;
+            xSemaphoreGive(timing_mutex);
+            return ESP_OK;
+        }
+    }
+    xSemaphoreGive(timing_mutex);
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+uint8_t task_timing_get_count(void)
+{
+    return registry_count;
+}
+
+esp_err_t task_timing_get_stats_by_index(uint8_t index, task_timing_stats_t *stats)
+{
+    if (stats == NULL) return ESP_ERR_INVALID_ARG;
+    if (timing_mutex == NULL || index >= registry_count) return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(timing_mutex, portMAX_DELAY);
+    *stats = registry[index]->stats;
+    xSemaphoreGive(timing_mutex);
+
+    return ESP_OK;
+}
+
+void task_timing_log_all(void)
+{
+    for (uint8_t i = 0; i < registry_count; i++) {
+        task_timing_stats_t stats;
+        if (task_timing_get_stats_by_index(i, &stats) != ESP_OK || stats.cycles == 0) continue;
+
+        ESP_LOGI(TAG, "%s: %lu cycles, exec %lu/%lu/%lu us (min/avg/max), jitter %ld..%ld us, %lu overruns",
+                 stats.name, (unsigned long)stats.cycles,
+                 (unsigned long)stats.exec_min_us,
+                 (unsigned long)(stats.exec_total_us / stats.cycles),
+                 (unsigned long)stats.exec_max_us,
+                 (long)stats.jitter_min_us, (long)stats.jitter_max_us,
+                 (unsigned long)stats.overruns);
+    }
+}
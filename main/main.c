@@ -36,15 +36,19 @@ void app_main(void)
     monitoring_init();
     communication_init();
 
+    sensor_manager_start();
     control_system_start();
     monitoring_start();
     communication_start();
 
     ESP_LOGI(TAG, "All systems initialized successfully");
-    ESP_LOGI(TAG, "Free heap size: %lu bytes", esp_get_free_heap_size());
+    heap_monitor_sample(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    heap_monitor_log();
     ESP_LOGI(TAG, "CPU cores: %d", portNUM_PROCESSORS);
 
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(1000));
+        /* Hourly and daily statistics go out as soon as their period closes */
+        communication_publish_sensor_stats();
     }
 }
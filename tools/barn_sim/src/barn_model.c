@@ -0,0 +1,179 @@
+#include "barn_model.h"
+#include <math.h>
+#include <string.h>
+
+#define AIR_DENSITY         1.2f        /* kg/m3 */
+#define AIR_CP              1005.0f     /* J/(kg K) */
+#define LATENT_HEAT         2.45e6f     /* J/kg */
+#define ATMOSPHERE_PA       101325.0f
+#define OUTDOOR_CO2_PPM     415.0f
+
+/* Direct-fired propane heater, per kW of output */
+#define HEATER_CO2_M3_S_PER_KW      (0.13f / 3600.0f)
+#define HEATER_WATER_KG_S_PER_KW    (0.127f / 3600.0f)
+#define HEATER_CO_SHARE             0.002f
+
+/* Litter ammonia per bird at 20 degC, 60 %RH */
+#define NH3_M3_S_PER_BIRD           4.5e-9f
+
+typedef struct {
+    float temp_mean;
+    float temp_swing;               /* half the daily range */
+    float rh_mean;
+    float rh_swing;
+} weather_t;
+
+static const weather_t weather_table[] = {
+    [WEATHER_MILD]     = { 20.0f, 6.0f, 65.0f, 15.0f },
+    [WEATHER_HOT]      = { 30.0f, 6.0f, 55.0f, 20.0f },
+    [WEATHER_COLD]     = {  4.0f, 4.0f, 80.0f, 10.0f },
+    [WEATHER_HEATWAVE] = { 34.0f, 5.0f, 50.0f, 20.0f },
+};
+
+static barn_params_t params;
+static barn_state_t state;
+static float humidity_ratio;        /* kg water per kg dry air, indoor */
+
+static float saturation_pa(float t)
+{
+    return 610.94f * expf(17.625f * t / (t + 243.04f));
+}
+
+static float ratio_from_rh(float t, float rh)
+{
+    float pv = rh / 100.0f * saturation_pa(t);
+    return 0.622f * pv / (ATMOSPHERE_PA - pv);
+}
+
+static float rh_from_ratio(float t, float w)
+{
+    float pv = w * ATMOSPHERE_PA / (0.622f + w);
+    return 100.0f * pv / saturation_pa(t);
+}
+
+/* Daily cycle with the warmest, driest air at 15:00 */
+static void weather_at(float hour, float *temp, float *rh)
+{
+    const weather_t *w = &weather_table[params.weather];
+    float phase = cosf(2.0f * (float)M_PI * (hour - 15.0f) / 24.0f);
+    *temp = w->temp_mean + params.weather_offset_c + w->temp_swing * phase;
+    *rh = w->rh_mean - w->rh_swing * phase;
+    if (*rh < 10.0f) *rh = 10.0f;
+    if (*rh > 100.0f) *rh = 100.0f;
+}
+
+void barn_default_params(barn_params_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->birds = 1000;
+    p->bird_weight_kg = 1.5f;
+    p->volume_m3 = 600.0f;
+    p->thermal_mass_kj_per_k = 5000.0f;
+    p->envelope_ua_w_per_k = 400.0f;
+    p->infiltration_m3_s = 0.3f;
+    p->fan_capacity_m3_s = 2.5f;
+    p->fan_power_w = 550.0f;
+    p->heater_power_w = 5000.0f;
+    p->weather = WEATHER_MILD;
+    p->weather_offset_c = 0.0f;
+}
+
+void barn_init(const barn_params_t *p, float hour_of_day)
+{
+    params = *p;
+    memset(&state, 0, sizeof(state));
+    weather_at(hour_of_day, &state.outdoor_temp, &state.outdoor_rh);
+    state.indoor_temp = 24.0f;
+    state.indoor_rh = 60.0f;
+    state.ammonia_ppm = 10.0f;
+    state.co2_ppm = 1500.0f;
+    state.co_ppm = 0.0f;
+    humidity_ratio = ratio_from_rh(state.indoor_temp, state.indoor_rh);
+}
+
+void barn_step(float dt, float hour_of_day, const float *fan_duty, uint8_t fans,
+               const bool *heater_on, uint8_t heaters)
+{
+    weather_at(hour_of_day, &state.outdoor_temp, &state.outdoor_rh);
+    float t = state.indoor_temp;
+    float t_out = state.outdoor_temp;
+
+    /* Ventilation and fan power */
+    float airflow = params.infiltration_m3_s;
+    float fan_w = 0.0f;
+    for (int i = 0; i < fans; i++) {
+        float duty = fan_duty[i];
+        airflow += duty * params.fan_capacity_m3_s;
+        fan_w += params.fan_power_w * duty * duty * duty;
+    }
+    float heater_w = 0.0f;
+    for (int i = 0; i < heaters; i++) {
+        if (heater_on[i]) heater_w += params.heater_power_w;
+    }
+
+    /* Flock heat, split into sensible and latent */
+    float bird_total_w = params.birds * 10.62f * powf(params.bird_weight_kg, 0.75f);
+    float sensible_share = 0.8f - 1.85e-7f * powf(t + 10.0f, 4.0f);
+    if (sensible_share < 0.2f) sensible_share = 0.2f;
+    if (sensible_share > 0.8f) sensible_share = 0.8f;
+    float bird_sensible_w = bird_total_w * sensible_share;
+    float bird_water_kg_s = bird_total_w * (1.0f - sensible_share) / LATENT_HEAT;
+
+    /* Heat balance */
+    float capacity = params.thermal_mass_kj_per_k * 1000.0f;
+    float loss = (params.envelope_ua_w_per_k + AIR_DENSITY * AIR_CP * airflow) * (t - t_out);
+    state.indoor_temp = t + dt * (bird_sensible_w + heater_w - loss) / capacity;
+
+    /* Water vapour; anything above saturation condenses */
+    float air_kg = AIR_DENSITY * params.volume_m3;
+    float water_kg_s = bird_water_kg_s + heater_w / 1000.0f * HEATER_WATER_KG_S_PER_KW;
+    float w_out = ratio_from_rh(t_out, state.outdoor_rh);
+    humidity_ratio += dt * (water_kg_s - AIR_DENSITY * airflow * (humidity_ratio - w_out)) / air_kg;
+    float w_sat = ratio_from_rh(state.indoor_temp, 100.0f);
+    if (humidity_ratio > w_sat) humidity_ratio = w_sat;
+    state.indoor_rh = rh_from_ratio(state.indoor_temp, humidity_ratio);
+
+    /* Gases, in ppm of the air volume */
+    float exchange = airflow / params.volume_m3;
+    float co2_m3_s = bird_total_w / 1000.0f * 0.185f / 3600.0f +
+                     heater_w / 1000.0f * HEATER_CO2_M3_S_PER_KW;
+    float co_m3_s = heater_w / 1000.0f * HEATER_CO2_M3_S_PER_KW * HEATER_CO_SHARE;
+    float nh3_factor = expf(0.06f * (t - 20.0f)) * (1.0f + 0.02f * (state.indoor_rh - 60.0f));
+    if (nh3_factor < 0.3f) nh3_factor = 0.3f;
+    float nh3_m3_s = params.birds * NH3_M3_S_PER_BIRD * nh3_factor;
+
+    state.co2_ppm += dt * (co2_m3_s * 1e6f / params.volume_m3 - exchange * (state.co2_ppm - OUTDOOR_CO2_PPM));
+    state.co_ppm += dt * (co_m3_s * 1e6f / params.volume_m3 - exchange * state.co_ppm);
+    state.ammonia_ppm += dt * (nh3_m3_s * 1e6f / params.volume_m3 - exchange * state.ammonia_ppm);
+
+    state.airflow_m3_s = airflow;
+    state.heater_w = heater_w;
+    state.fan_w = fan_w;
+}
+
+const barn_state_t *barn_get_state(void)
+{
+    return &state;
+}
+
+const char *weather_profile_to_string(weather_profile_t profile)
+{
+    switch (profile) {
+        case WEATHER_MILD: return "mild";
+        case WEATHER_HOT: return "hot";
+        case WEATHER_COLD: return "cold";
+        case WEATHER_HEATWAVE: return "heatwave";
+        default: return "unknown";
+    }
+}
+
+bool weather_profile_from_string(const char *name, weather_profile_t *profile)
+{
+    for (int p = WEATHER_MILD; p <= WEATHER_HEATWAVE; p++) {
+        if (strcmp(name, weather_profile_to_string((weather_profile_t)p)) == 0) {
+            *profile = (weather_profile_t)p;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+#ifndef BARN_MODEL_H
+#define BARN_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Lumped barn plant: one well-mixed air volume with a thermal mass.
+ *
+ * Heat balance: bird sensible heat (CIGR 10.62 * m^0.75 W total, sensible
+ * share falling with temperature), heater output, envelope loss UA and
+ * ventilation loss rho*cp*Q*(Tin - Tout). Water vapour, CO2, NH3 and CO are
+ * mass balances over the same air volume with the ventilation rate Q =
+ * infiltration + sum of fan duty * fan capacity. Birds emit the latent share
+ * of their heat as moisture and CO2 in proportion to total heat; litter
+ * ammonia rises with temperature and humidity; heaters are direct-fired and
+ * emit CO and CO2.
+ */
+
+#define BARN_MAX_FANS       4
+#define BARN_MAX_HEATERS    2
+
+typedef enum {
+    WEATHER_MILD,
+    WEATHER_HOT,
+    WEATHER_COLD,
+    WEATHER_HEATWAVE
+} weather_profile_t;
+
+typedef struct {
+    /* Flock */
+    uint32_t birds;
+    float bird_weight_kg;
+    /* Building */
+    float volume_m3;
+    float thermal_mass_kj_per_k;    /* air, structure, litter and birds */
+    float envelope_ua_w_per_k;
+    float infiltration_m3_s;
+    /* Equipment */
+    float fan_capacity_m3_s;        /* per fan at 100 % duty */
+    float fan_power_w;              /* per fan at 100 % duty, scales with duty cubed */
+    float heater_power_w;           /* per heater */
+    /* Weather */
+    weather_profile_t weather;
+    float weather_offset_c;         /* shifts the whole profile */
+} barn_params_t;
+
+typedef struct {
+    float indoor_temp;
+    float indoor_rh;
+    float outdoor_temp;
+    float outdoor_rh;
+    float ammonia_ppm;
+    float co2_ppm;
+    float co_ppm;
+    float airflow_m3_s;
+    float heater_w;
+    float fan_w;
+} barn_state_t;
+
+void barn_default_params(barn_params_t *params);
+void barn_init(const barn_params_t *params, float hour_of_day);
+void barn_step(float dt_s, float hour_of_day, const float *fan_duty, uint8_t fans,
+               const bool *heater_on, uint8_t heaters);
+const barn_state_t *barn_get_state(void);
+const char *weather_profile_to_string(weather_profile_t profile);
+bool weather_profile_from_string(const char *name, weather_profile_t *profile);
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * barn_sim - closed-loop host simulation of the poultry house controller.
+ *
+ * The control, sensor manager and actuator manager components are compiled
+ * unchanged against the mocked HAL in sim_hal.c and driven by the simulated
+ * clock in sim_os.c. Each simulated second the barn model is stepped with the
+ * outputs the firmware is currently driving; every sensor period the sample set
+ * is refreshed and control_system_update() runs, exactly as the control task
+ * would on the target. At the end a summary of comfort, gas exposure, energy
+ * and actuator switching is printed, and optional limits turn it into a
+ * pass/fail check.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "barn_model.h"
+#include "sim_hal.h"
+#include "sim_os.h"
+#include "sensors/sensor_manager.h"
+#include "sensors/heat_index.h"
+#include "actuators/actuator_manager.h"
+#include "control/control_system.h"
+#include "utils/config.h"
+
+#define SIM_EPOCH           1717200000  /* 2024-06-01 00:00:00 UTC */
+#define SIM_START_HOUR      0.0f
+#define SIM_SHORT_CYCLE_S   60          /* a run shorter than this is a short cycle */
+#define SIM_TRACKED         6           /* fans 0-3, heaters 4-5 */
+#define SIM_FEED_RATE_KG_S  0.05f
+#define SIM_FEED_INTAKE_KG_DAY_PER_BIRD 0.12f
+
+typedef struct {
+    uint8_t pin;
+    char name[64];
+    uint32_t starts;
+    uint32_t hour_starts;
+    uint32_t max_hour_starts;
+    uint32_t short_cycles;
+    int64_t on_since_us;
+    int64_t on_time_us;
+} tracked_output_t;
+
+typedef struct {
+    uint64_t seconds;
+    uint64_t in_band_s;
+    double temp_min;
+    double temp_max;
+    double sq_error;
+    uint64_t stage_s[4];
+    double ammonia_max;
+    double co2_max;
+    double co_max;
+    uint64_t ammonia_over_s;
+    uint64_t co2_over_s;
+    uint64_t co_over_s;
+    double heater_j;
+    double fan_j;
+    uint64_t updates;
+    double update_us_total;
+    double update_us_max;
+} sim_metrics_t;
+
+static tracked_output_t tracked[SIM_TRACKED];
+static sim_metrics_t metrics;
+
+static void output_hook(uint8_t channel, uint8_t old_duty, uint8_t new_duty)
+{
+    int64_t now = sim_clock_now_us();
+    for (int i = 0; i < SIM_TRACKED; i++) {
+        tracked_output_t *out = &tracked[i];
+        if (out->pin != channel) continue;
+        if (old_duty == 0 && new_duty > 0) {
+            out->starts++;
+            out->hour_starts++;
+            out->on_since_us = now;
+        } else if (old_duty > 0 && new_duty == 0) {
+            int64_t run = now - out->on_since_us;
+            out->on_time_us += run;
+            if (run < SIM_SHORT_CYCLE_S * 1000000LL) out->short_cycles++;
+        }
+    }
+}
+
+static void track_outputs(void)
+{
+    actuator_data_t *actuators = NULL;
+    uint8_t count = 0;
+    actuator_get_all(&actuators, &count);
+    for (int i = 0; i < SIM_TRACKED && i < count; i++) {
+        tracked[i].pin = actuators[i].pin;
+        snprintf(tracked[i].name, sizeof(tracked[i].name), "%s", actuators[i].name);
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --days N                  simulated days (default 3)\n"
+        "  --weather PROFILE         mild | hot | cold | heatwave (default mild)\n"
+        "  --weather-offset C        shift the weather profile by C degC\n"
+        "  --mode MODE               auto | adaptive | scheduled (default auto)\n"
+        "  --birds N                 flock size (default 1000)\n"
+        "  --weight KG               mean bird weight (default 1.5)\n"
+        "  --seed N                  sensor noise seed (default 1)\n"
+        "  --csv FILE                write a per-minute trace\n"
+        "  --max-switches-per-hour N fail if any fan or heater starts more often\n"
+        "  --min-in-band PCT         fail if less time than this is inside the temperature band\n"
+        "  -v, -vv                   show firmware log at INFO, DEBUG\n",
+        argv0);
+}
+
+int main(int argc, char **argv)
+{
+    barn_params_t params;
+    barn_default_params(&params);
+    double days = 3.0;
+    control_mode_t mode = CONTROL_MODE_AUTO;
+    uint32_t seed = 1;
+    const char *csv_path = NULL;
+    long max_switches = -1;
+    double min_in_band = -1.0;
+
+    static const struct option options[] = {
+        { "days", required_argument, NULL, 'd' },
+        { "weather", required_argument, NULL, 'w' },
+        { "weather-offset", required_argument, NULL, 'o' },
+        { "mode", required_argument, NULL, 'm' },
+        { "birds", required_argument, NULL, 'b' },
+        { "weight", required_argument, NULL, 'k' },
+        { "seed", required_argument, NULL, 's' },
+        { "csv", required_argument, NULL, 'c' },
+        { "max-switches-per-hour", required_argument, NULL, 'x' },
+        { "min-in-band", required_argument, NULL, 'i' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "vh", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': days = atof(optarg); break;
+            case 'w':
+                if (!weather_profile_from_string(optarg, &params.weather)) {
+                    fprintf(stderr, "unknown weather profile: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o': params.weather_offset_c = (float)atof(optarg); break;
+            case 'm':
+                if (strcmp(optarg, "auto") == 0) mode = CONTROL_MODE_AUTO;
+                else if (strcmp(optarg, "adaptive") == 0) mode = CONTROL_MODE_ADAPTIVE;
+                else if (strcmp(optarg, "scheduled") == 0) mode = CONTROL_MODE_SCHEDULED;
+                else {
+                    fprintf(stderr, "unknown mode: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'b': params.birds = (uint32_t)atol(optarg); break;
+            case 'k': params.bird_weight_kg = (float)atof(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'c': csv_path = optarg; break;
+            case 'x': max_switches = atol(optarg); break;
+            case 'i': min_in_band = atof(optarg); break;
+            case 'v': sim_log_level = sim_log_level < ESP_LOG_INFO ? ESP_LOG_INFO : ESP_LOG_DEBUG; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (days <= 0.0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *csv = NULL;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) {
+            perror(csv_path);
+            return 2;
+        }
+        fprintf(csv, "minute,hour,outdoor_temp,indoor_temp,indoor_rh,thi,ammonia,co2,co,airflow,"
+                     "fan1,fan2,fan3,fan4,heater1,heater2\n");
+    }
+
+    /* Firmware start-up, as app_main does it, on a UTC wall clock */
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    sim_clock_init(SIM_EPOCH);
+    sim_hal_seed(seed);
+    barn_init(&params, SIM_START_HOUR);
+
+    const barn_state_t *barn = barn_get_state();
+    sim_plant_readings_t readings = {
+        .indoor_temp = barn->indoor_temp, .indoor_rh = barn->indoor_rh,
+        .outdoor_temp = barn->outdoor_temp, .outdoor_rh = barn->outdoor_rh,
+        .pressure_hpa = 1013.0f, .ammonia_ppm = barn->ammonia_ppm,
+        .co2_ppm = barn->co2_ppm, .co_ppm = barn->co_ppm,
+        .feeder_kg = 10.0f, .bird_kg = params.bird_weight_kg, .water_pct = 80.0f,
+    };
+    sim_hal_set_plant(&readings);
+
+    config_init();
+    sensor_manager_init();
+    actuator_manager_init();
+    track_outputs();
+    sim_hal_set_output_hook(output_hook);
+    control_system_init();
+    control_system_set_mode(mode);
+    sensor_trigger_read_all();
+
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.temp_min = INFINITY;
+    metrics.temp_max = -INFINITY;
+    heat_stage_t stage = HEAT_STAGE_NORMAL;
+
+    const uint64_t total_s = (uint64_t)(days * 86400.0);
+    const uint32_t read_every_s = CONFIG_SENSOR_READ_INTERVAL_MS / 1000 ? CONFIG_SENSOR_READ_INTERVAL_MS / 1000 : 1;
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    for (uint64_t t = 0; t < total_s; t++) {
+        float hour = fmodf(SIM_START_HOUR + t / 3600.0f, 24.0f);
+
+        /* Plant sees whatever the outputs are driving right now */
+        float fan_duty[BARN_MAX_FANS];
+        bool heater_on[BARN_MAX_HEATERS];
+        for (int i = 0; i < BARN_MAX_FANS; i++) {
+            fan_duty[i] = sim_hal_get_output(tracked[i].pin) / 100.0f;
+        }
+        for (int i = 0; i < BARN_MAX_HEATERS; i++) {
+            heater_on[i] = sim_hal_get_output(tracked[BARN_MAX_FANS + i].pin) > 0;
+        }
+        barn_step(1.0f, hour, fan_duty, BARN_MAX_FANS, heater_on, BARN_MAX_HEATERS);
+
+        /* Feeder hopper: augers fill it, the flock eats from it */
+        bool feeding = false;
+        actuator_data_t *actuators = NULL;
+        uint8_t actuator_count = 0;
+        actuator_get_all(&actuators, &actuator_count);
+        for (int i = 0; i < actuator_count; i++) {
+            if (actuators[i].type == ACTUATOR_TYPE_FEEDER && sim_hal_get_output(actuators[i].pin) > 0) {
+                feeding = true;
+            }
+        }
+        readings.feeder_kg += feeding ? SIM_FEED_RATE_KG_S : 0.0f;
+        readings.feeder_kg -= params.birds * SIM_FEED_INTAKE_KG_DAY_PER_BIRD / 86400.0f;
+        if (readings.feeder_kg < 0.0f) readings.feeder_kg = 0.0f;
+        if (readings.feeder_kg > 50.0f) readings.feeder_kg = 50.0f;
+
+        readings.indoor_temp = barn->indoor_temp;
+        readings.indoor_rh = barn->indoor_rh;
+        readings.outdoor_temp = barn->outdoor_temp;
+        readings.outdoor_rh = barn->outdoor_rh;
+        readings.ammonia_ppm = barn->ammonia_ppm;
+        readings.co2_ppm = barn->co2_ppm;
+        readings.co_ppm = barn->co_ppm;
+        sim_hal_set_plant(&readings);
+
+        /* Timers (PID, heater window, sequencer, adaptive planner) fire on the way */
+        sim_clock_advance((int64_t)(t + 1) * 1000000LL);
+
+        if ((t + 1) % read_every_s == 0) {
+            sensor_trigger_read_all();
+            struct timespec a, b;
+            clock_gettime(CLOCK_MONOTONIC, &a);
+            control_system_update();
+            clock_gettime(CLOCK_MONOTONIC, &b);
+            double us = (b.tv_sec - a.tv_sec) * 1e6 + (b.tv_nsec - a.tv_nsec) / 1e3;
+            metrics.updates++;
+            metrics.update_us_total += us;
+            if (us > metrics.update_us_max) metrics.update_us_max = us;
+        }
+
+        /* Metrics on the true plant state, not the noisy readings */
+        double temp = barn->indoor_temp;
+        metrics.seconds++;
+        if (temp >= poultry_config.temp_min && temp <= poultry_config.temp_max) metrics.in_band_s++;
+        if (temp < metrics.temp_min) metrics.temp_min = temp;
+        if (temp > metrics.temp_max) metrics.temp_max = temp;
+        metrics.sq_error += (temp - poultry_config.temp_optimal) * (temp - poultry_config.temp_optimal);
+        float thi = heat_index_thi(barn->indoor_temp, barn->indoor_rh);
+        stage = heat_index_stage(thi, stage);
+        metrics.stage_s[stage]++;
+        if (barn->ammonia_ppm > metrics.ammonia_max) metrics.ammonia_max = barn->ammonia_ppm;
+        if (barn->co2_ppm > metrics.co2_max) metrics.co2_max = barn->co2_ppm;
+        if (barn->co_ppm > metrics.co_max) metrics.co_max = barn->co_ppm;
+        if (barn->ammonia_ppm > poultry_config.ammonia_max) metrics.ammonia_over_s++;
+        if (barn->co2_ppm > poultry_config.co2_max) metrics.co2_over_s++;
+        if (barn->co_ppm > poultry_config.co_max) metrics.co_over_s++;
+        metrics.heater_j += barn->heater_w;
+        metrics.fan_j += barn->fan_w;
+
+        if ((t + 1) % 3600 == 0) {
+            for (int i = 0; i < SIM_TRACKED; i++) {
+                if (tracked[i].hour_starts > tracked[i].max_hour_starts) {
+                    tracked[i].max_hour_starts = tracked[i].hour_starts;
+                }
+                tracked[i].hour_starts = 0;
+            }
+        }
+
+        if (csv && t % 60 == 0) {
+            fprintf(csv, "%llu,%.3f,%.2f,%.2f,%.1f,%.2f,%.1f,%.0f,%.2f,%.2f",
+                    (unsigned long long)(t / 60), hour, barn->outdoor_temp, barn->indoor_temp,
+                    barn->indoor_rh, thi, barn->ammonia_ppm, barn->co2_ppm, barn->co_ppm, barn->airflow_m3_s);
+            for (int i = 0; i < SIM_TRACKED; i++) {
+                fprintf(csv, ",%u", sim_hal_get_output(tracked[i].pin));
+            }
+            fputc('\n', csv);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    if (csv) fclose(csv);
+
+    /* Close any run and partial hour still in progress */
+    for (int i = 0; i < SIM_TRACKED; i++) {
+        if (tracked[i].hour_starts > tracked[i].max_hour_starts) {
+            tracked[i].max_hour_starts = tracked[i].hour_starts;
+        }
+        if (sim_hal_get_output(tracked[i].pin) > 0) {
+            tracked[i].on_time_us += sim_clock_now_us() - tracked[i].on_since_us;
+        }
+    }
+
+    double sim_days = metrics.seconds / 86400.0;
+    double in_band_pct = 100.0 * metrics.in_band_s / metrics.seconds;
+    printf("barn_sim: %.2f days, weather %s%+.1f, mode %s, %u birds x %.2f kg, seed %u\n",
+           sim_days, weather_profile_to_string(params.weather), params.weather_offset_c,
+           mode == CONTROL_MODE_ADAPTIVE ? "adaptive" : mode == CONTROL_MODE_SCHEDULED ? "scheduled" : "auto",
+           params.birds, params.bird_weight_kg, seed);
+    printf("  wall time        %.2f s (%.0fx real time)\n", wall_s, metrics.seconds / (wall_s > 0 ? wall_s : 1e-9));
+    printf("  temperature      in band %.1f %%  min %.2f  max %.2f  rms error %.2f degC\n",
+           in_band_pct, metrics.temp_min, metrics.temp_max, sqrt(metrics.sq_error / metrics.seconds));
+    printf("  heat stress      normal %.1f h  alert %.1f h  danger %.1f h  emergency %.1f h\n",
+           metrics.stage_s[0] / 3600.0, metrics.stage_s[1] / 3600.0,
+           metrics.stage_s[2] / 3600.0, metrics.stage_s[3] / 3600.0);
+    printf("  gases            NH3 max %.1f ppm (%.1f h over)  CO2 max %.0f ppm (%.1f h over)  CO max %.1f ppm (%.1f h over)\n",
+           metrics.ammonia_max, metrics.ammonia_over_s / 3600.0, metrics.co2_max, metrics.co2_over_s / 3600.0,
+           metrics.co_max, metrics.co_over_s / 3600.0);
+    printf("  energy           heaters %.1f kWh  fans %.1f kWh\n",
+           metrics.heater_j / 3.6e6, metrics.fan_j / 3.6e6);
+    printf("  control update   %llu calls, mean %.1f us, max %.1f us (host)\n",
+           (unsigned long long)metrics.updates,
+           metrics.updates ? metrics.update_us_total / metrics.updates : 0.0, metrics.update_us_max);
+    printf("  %-14s %10s %10s %10s %10s\n", "output", "starts/day", "max/hour", "short", "on %");
+    uint32_t worst_hour = 0;
+    for (int i = 0; i < SIM_TRACKED; i++) {
+        printf("  %-14s %10.1f %10u %10u %10.1f\n", tracked[i].name,
+               tracked[i].starts / sim_days, tracked[i].max_hour_starts, tracked[i].short_cycles,
+               100.0 * tracked[i].on_time_us / (metrics.seconds * 1e6));
+        if (tracked[i].max_hour_starts > worst_hour) worst_hour = tracked[i].max_hour_starts;
+    }
+
+    int status = 0;
+    if (max_switches >= 0 && worst_hour > (uint32_t)max_switches) {
+        printf("FAIL: %u starts in one hour exceeds --max-switches-per-hour %ld\n", worst_hour, max_switches);
+        status = 1;
+    }
+    if (min_in_band >= 0.0 && in_band_pct < min_in_band) {
+        printf("FAIL: %.1f %% in band is below --min-in-band %.1f\n", in_band_pct, min_in_band);
+        status = 1;
+    }
+    return status;
+}
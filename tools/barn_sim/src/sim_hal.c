@@ -0,0 +1,369 @@
+#include "sim_hal.h"
+#include <string.h>
+#include <esp_log.h>
+#include "sensors/sensor_manager.h"
+#include "sensors/adc_sweep.h"
+#include "sensors/dht22.h"
+#include "sensors/mq_sensor.h"
+#include "sensors/bme280_sensor.h"
+#include "sensors/weight_sensor.h"
+#include "sensors/water_level_sensor.h"
+#include "actuators/actuator_output.h"
+#include "actuators/actuator_feedback.h"
+
+#define SIM_OUTPUT_CHANNELS 40
+
+static sim_plant_readings_t plant;
+static uint32_t noise_state = 1;
+static sim_output_hook_t output_hook = NULL;
+static uint8_t output_duty[SIM_OUTPUT_CHANNELS];
+
+static sensor_data_t dht22_sensors[2];
+static sensor_data_t mq_sensors[4];
+static sensor_data_t bme280_sensors[3];
+static sensor_data_t weight_sensors[2];
+static sensor_data_t water_sensors[2];
+static bool fast_mode = false;
+
+/* ---- Deterministic noise ---- */
+
+void sim_hal_seed(uint32_t seed)
+{
+    noise_state = seed ? seed : 1;
+}
+
+/* Roughly normal, zero mean, unit spread: sum of four xorshift uniforms */
+static float noise(void)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        noise_state ^= noise_state << 13;
+        noise_state ^= noise_state >> 17;
+        noise_state ^= noise_state << 5;
+        sum += (float)noise_state / 4294967296.0f;
+    }
+    return (sum - 2.0f) * 1.732f;
+}
+
+static float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void sim_hal_set_plant(const sim_plant_readings_t *readings)
+{
+    plant = *readings;
+}
+
+void sim_hal_set_output_hook(sim_output_hook_t hook)
+{
+    output_hook = hook;
+}
+
+uint8_t sim_hal_get_output(uint8_t channel)
+{
+    return channel < SIM_OUTPUT_CHANNELS ? output_duty[channel] : 0;
+}
+
+static void describe(sensor_data_t *s, uint8_t id, const char *name, sensor_type_t type,
+                     float min, float max, float threshold_min, float threshold_max)
+{
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    strncpy(s->name, name, sizeof(s->name) - 1);
+    s->type = type;
+    s->status = SENSOR_STATUS_OK;
+    s->min_value = min;
+    s->max_value = max;
+    s->threshold_min = threshold_min;
+    s->threshold_max = threshold_max;
+    s->enabled = true;
+    s->alarm_enabled = true;
+}
+
+/* ---- ADC ---- */
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_config_t *config, adc_oneshot_unit_handle_t *out_handle)
+{
+    (void)config;
+    *out_handle = NULL;
+    return ESP_OK;
+}
+
+esp_err_t adc_sweep_init(void) { return ESP_OK; }
+esp_err_t adc_sweep_add_channel(adc_channel_t channel) { (void)channel; return ESP_OK; }
+esp_err_t adc_sweep_run(void) { return ESP_OK; }
+esp_err_t adc_sweep_read(adc_channel_t channel, int *samples, int count)
+{
+    (void)channel;
+    for (int i = 0; i < count; i++) samples[i] = 0;
+    return ESP_OK;
+}
+esp_err_t adc_sweep_get_raw(adc_channel_t channel, int *raw) { (void)channel; *raw = 0; return ESP_OK; }
+uint32_t adc_sweep_get_timestamp(void) { return xTaskGetTickCount(); }
+
+/* ---- DHT22: indoor temperature and humidity, 0.1 resolution ---- */
+
+esp_err_t dht22_init(void)
+{
+    describe(&dht22_sensors[0], 0, "Temperature_1", SENSOR_TYPE_TEMPERATURE, -40.0f, 80.0f, 18.0f, 30.0f);
+    describe(&dht22_sensors[1], 1, "Humidity_1", SENSOR_TYPE_HUMIDITY, 0.0f, 100.0f, 40.0f, 80.0f);
+    return ESP_OK;
+}
+
+esp_err_t dht22_read(float *temperature, float *humidity)
+{
+    *temperature = (int)((plant.indoor_temp + 0.1f * noise()) * 10.0f) / 10.0f;
+    *humidity = clampf((int)((plant.indoor_rh + 1.0f * noise()) * 10.0f) / 10.0f, 0.0f, 100.0f);
+    return ESP_OK;
+}
+
+esp_err_t dht22_read_all(void)
+{
+    return dht22_read(&dht22_sensors[0].value, &dht22_sensors[1].value);
+}
+
+dht22_data_t dht22_get_data(void)
+{
+    return (dht22_data_t){ dht22_sensors[0].value, dht22_sensors[1].value, true };
+}
+
+sensor_data_t* get_dht22_sensors(uint8_t *count)
+{
+    *count = 2;
+    return dht22_sensors;
+}
+
+/* ---- MQ gas sensors ---- */
+
+esp_err_t mq_sensor_init(void)
+{
+    describe(&mq_sensors[0], 10, "Ammonia_Sensor", SENSOR_TYPE_AMMONIA, 0.0f, 500.0f, 0.0f, 25.0f);
+    describe(&mq_sensors[1], 11, "CO2_Sensor", SENSOR_TYPE_CO2, 0.0f, 10000.0f, 0.0f, 3000.0f);
+    describe(&mq_sensors[2], 12, "CO_Sensor", SENSOR_TYPE_CO, 0.0f, 500.0f, 0.0f, 50.0f);
+    describe(&mq_sensors[3], 13, "Methane_Sensor", SENSOR_TYPE_METHANE, 0.0f, 100.0f, 0.0f, 20.0f);
+    return ESP_OK;
+}
+
+esp_err_t mq_sensor_read(float *ammonia, float *co2, float *co)
+{
+    *ammonia = clampf(plant.ammonia_ppm * (1.0f + 0.03f * noise()), 0.0f, 500.0f);
+    *co2 = clampf(plant.co2_ppm * (1.0f + 0.02f * noise()), 0.0f, 10000.0f);
+    *co = clampf(plant.co_ppm + 0.2f * noise(), 0.0f, 500.0f);
+    return ESP_OK;
+}
+
+esp_err_t mq_sensor_read_all(void)
+{
+    mq_sensor_read(&mq_sensors[0].value, &mq_sensors[1].value, &mq_sensors[2].value);
+    mq_sensors[3].value = 0.5f;
+    return ESP_OK;
+}
+
+mq_sensor_data_t mq_sensor_get_data(void)
+{
+    return (mq_sensor_data_t){ mq_sensors[0].value, mq_sensors[1].value, mq_sensors[2].value,
+                               mq_sensors[3].value, 0.0f, true };
+}
+
+sensor_data_t* get_mq_sensors(uint8_t *count)
+{
+    *count = 4;
+    return mq_sensors;
+}
+
+esp_err_t mq_sensor_calibrate(mq_sensor_type_t type, float clean_air_r0)
+{
+    (void)type;
+    (void)clean_air_r0;
+    return ESP_OK;
+}
+
+/* ---- BME280: mounted outside, feeds the adaptive model's outdoor input ---- */
+
+esp_err_t bme280_init(void)
+{
+    describe(&bme280_sensors[0], 20, "Temperature_2", SENSOR_TYPE_TEMPERATURE, -40.0f, 85.0f, 18.0f, 30.0f);
+    describe(&bme280_sensors[1], 21, "Humidity_2", SENSOR_TYPE_HUMIDITY, 0.0f, 100.0f, 40.0f, 80.0f);
+    describe(&bme280_sensors[2], 22, "Pressure", SENSOR_TYPE_PRESSURE, 870.0f, 1084.0f, 950.0f, 1050.0f);
+    return ESP_OK;
+}
+
+esp_err_t bme280_read(float *temperature, float *humidity, float *pressure)
+{
+    *temperature = plant.outdoor_temp + 0.05f * noise();
+    *humidity = clampf(plant.outdoor_rh + 0.5f * noise(), 0.0f, 100.0f);
+    *pressure = plant.pressure_hpa + 0.1f * noise();
+    return ESP_OK;
+}
+
+esp_err_t bme280_read_all(void)
+{
+    return bme280_read(&bme280_sensors[0].value, &bme280_sensors[1].value, &bme280_sensors[2].value);
+}
+
+bme280_data_t bme280_get_data(void)
+{
+    return (bme280_data_t){ bme280_sensors[0].value, bme280_sensors[1].value, bme280_sensors[2].value, true };
+}
+
+sensor_data_t* get_bme280_sensors(uint8_t *count)
+{
+    *count = 3;
+    return bme280_sensors;
+}
+
+/* ---- Load cells ---- */
+
+esp_err_t weight_sensor_init(void)
+{
+    describe(&weight_sensors[0], 30, "Feeder_Weight", SENSOR_TYPE_WEIGHT, 0.0f, 50.0f, 0.0f, 20.0f);
+    describe(&weight_sensors[1], 31, "Bird_Weight", SENSOR_TYPE_WEIGHT, 0.0f, 10.0f, 0.5f, 5.0f);
+    return ESP_OK;
+}
+
+esp_err_t weight_sensor_read(float *weight)
+{
+    *weight = clampf(plant.feeder_kg + 0.01f * noise(), 0.0f, 50.0f);
+    return ESP_OK;
+}
+
+esp_err_t weight_sensor_read_all(void)
+{
+    weight_sensor_read(&weight_sensors[0].value);
+    weight_sensors[1].value = plant.bird_kg + 0.02f * noise();
+    return ESP_OK;
+}
+
+weight_data_t weight_sensor_get_data(void)
+{
+    return (weight_data_t){ weight_sensors[0].value, true };
+}
+
+sensor_data_t* get_weight_sensors(uint8_t *count)
+{
+    *count = 2;
+    return weight_sensors;
+}
+
+esp_err_t weight_sensor_tare(void) { return ESP_OK; }
+esp_err_t weight_sensor_calibrate(float known_weight) { (void)known_weight; return ESP_OK; }
+
+esp_err_t weight_sensor_set_fast_mode(bool enable)
+{
+    fast_mode = enable;
+    return ESP_OK;
+}
+
+esp_err_t weight_sensor_sample_fast(float *weight)
+{
+    if (!fast_mode) return ESP_ERR_INVALID_STATE;
+    return weight_sensor_read(weight);
+}
+
+/* ---- Water level ---- */
+
+esp_err_t water_level_sensor_init(void)
+{
+    describe(&water_sensors[0], 40, "Water_Level_1", SENSOR_TYPE_WATER_LEVEL, 0.0f, 100.0f, 20.0f, 100.0f);
+    describe(&water_sensors[1], 41, "Water_Level_2", SENSOR_TYPE_WATER_LEVEL, 0.0f, 100.0f, 20.0f, 100.0f);
+    return ESP_OK;
+}
+
+esp_err_t water_level_sensor_read(float *level, float *percentage)
+{
+    *percentage = plant.water_pct;
+    *level = plant.water_pct / 100.0f * 10.0f;
+    return ESP_OK;
+}
+
+esp_err_t water_level_sensor_read_all(void)
+{
+    water_sensors[0].value = plant.water_pct;
+    water_sensors[1].value = plant.water_pct;
+    return ESP_OK;
+}
+
+water_level_data_t water_level_sensor_get_data(void)
+{
+    return (water_level_data_t){ plant.water_pct / 10.0f, plant.water_pct, true };
+}
+
+sensor_data_t* get_water_level_sensors(uint8_t *count)
+{
+    *count = 2;
+    return water_sensors;
+}
+
+/* ---- Actuator outputs: every bus is latched the same way ---- */
+
+esp_err_t actuator_output_init(void)
+{
+    memset(output_duty, 0, sizeof(output_duty));
+    return ESP_OK;
+}
+
+esp_err_t actuator_output_configure(actuator_output_bus_t bus, uint8_t channel)
+{
+    (void)bus;
+    return channel < SIM_OUTPUT_CHANNELS ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t actuator_output_set_duty(actuator_output_bus_t bus, uint8_t channel, uint8_t duty_percent)
+{
+    (void)bus;
+    if (channel >= SIM_OUTPUT_CHANNELS) return ESP_ERR_INVALID_ARG;
+    if (duty_percent > 100) duty_percent = 100;
+
+    uint8_t old = output_duty[channel];
+    output_duty[channel] = duty_percent;
+    if (output_hook && old != duty_percent) {
+        output_hook(channel, old, duty_percent);
+    }
+    return ESP_OK;
+}
+
+esp_err_t actuator_output_set(actuator_output_bus_t bus, uint8_t channel, bool level)
+{
+    return actuator_output_set_duty(bus, channel, level ? 100 : 0);
+}
+
+esp_err_t actuator_output_begin_batch(void) { return ESP_OK; }
+esp_err_t actuator_output_end_batch(void) { return ESP_OK; }
+esp_err_t actuator_output_flush(void) { return ESP_OK; }
+
+uint16_t actuator_output_channel_count(actuator_output_bus_t bus)
+{
+    return bus == ACTUATOR_OUTPUT_GPIO ? SIM_OUTPUT_CHANNELS : 0;
+}
+
+const char* actuator_output_bus_to_string(actuator_output_bus_t bus)
+{
+    switch (bus) {
+        case ACTUATOR_OUTPUT_GPIO: return "GPIO";
+        case ACTUATOR_OUTPUT_HC595: return "74HC595";
+        case ACTUATOR_OUTPUT_MCP23017: return "MCP23017";
+        default: return "Unknown";
+    }
+}
+
+/* ---- Output feedback: simulated outputs always follow the command ---- */
+
+esp_err_t actuator_feedback_init(void) { return ESP_OK; }
+esp_err_t actuator_feedback_deinit(void) { return ESP_OK; }
+
+esp_err_t actuator_feedback_configure(uint8_t actuator_id, const actuator_feedback_config_t *config)
+{
+    (void)actuator_id;
+    (void)config;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t actuator_feedback_remove(uint8_t actuator_id) { (void)actuator_id; return ESP_ERR_NOT_FOUND; }
+esp_err_t actuator_feedback_get_measured(uint8_t actuator_id, bool *running)
+{
+    (void)actuator_id;
+    (void)running;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t actuator_feedback_clear_fault(uint8_t actuator_id) { (void)actuator_id; return ESP_ERR_NOT_FOUND; }
@@ -0,0 +1,39 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Mocked hardware layer for the host build.
+ *
+ * The sensor drivers (DHT22, MQ, BME280, load cells, water level) and the
+ * actuator output backends are replaced at their public API, so the sensor
+ * manager, actuator manager, sequencer and all of the control component run
+ * unchanged on top. Readings come from sim_hal_set_plant() with a small
+ * deterministic noise; output writes are latched per channel and reported to
+ * an optional hook so the driver program can count switching.
+ */
+
+typedef struct {
+    float indoor_temp;
+    float indoor_rh;
+    float outdoor_temp;
+    float outdoor_rh;
+    float pressure_hpa;
+    float ammonia_ppm;
+    float co2_ppm;
+    float co_ppm;
+    float feeder_kg;
+    float bird_kg;
+    float water_pct;
+} sim_plant_readings_t;
+
+typedef void (*sim_output_hook_t)(uint8_t channel, uint8_t old_duty, uint8_t new_duty);
+
+void sim_hal_seed(uint32_t seed);
+void sim_hal_set_plant(const sim_plant_readings_t *readings);
+void sim_hal_set_output_hook(sim_output_hook_t hook);
+uint8_t sim_hal_get_output(uint8_t channel);
+
+#endif
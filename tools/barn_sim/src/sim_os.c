@@ -0,0 +1,377 @@
+#include "sim_os.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#define SIM_MAX_TIMERS      32
+#define SIM_NVS_MAX_ENTRIES 64
+#define SIM_NVS_MAX_BLOB    4096
+
+esp_log_level_t sim_log_level = ESP_LOG_ERROR;
+
+static int64_t now_us = 0;
+static time_t epoch = 0;
+
+/* ---- Clock and esp_timer ---- */
+
+struct sim_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t due_us;
+    uint64_t period_us;         /* 0 = one-shot */
+    bool active;
+    bool used;
+};
+
+static struct sim_timer timers[SIM_MAX_TIMERS];
+
+void sim_clock_init(time_t start)
+{
+    epoch = start;
+    now_us = 0;
+}
+
+int64_t sim_clock_now_us(void)
+{
+    return now_us;
+}
+
+time_t sim_clock_epoch(void)
+{
+    return epoch;
+}
+
+void sim_clock_advance(int64_t to_us)
+{
+    for (;;) {
+        struct sim_timer *next = NULL;
+        for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+            struct sim_timer *timer = &timers[i];
+            if (timer->used && timer->active && timer->due_us <= to_us &&
+                (next == NULL || timer->due_us < next->due_us)) {
+                next = timer;
+            }
+        }
+        if (next == NULL) break;
+
+        now_us = next->due_us;
+        if (next->period_us > 0) {
+            next->due_us += next->period_us;
+        } else {
+            next->active = false;
+        }
+        next->callback(next->arg);
+    }
+    now_us = to_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (!timers[i].used) {
+            memset(&timers[i], 0, sizeof(timers[i]));
+            timers[i].used = true;
+            timers[i].callback = args->callback;
+            timers[i].arg = args->arg;
+            timers[i].name = args->name;
+            *out_handle = &timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->due_us = now_us + (int64_t)timeout_us;
+    timer->period_us = 0;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->due_us = now_us + (int64_t)period_us;
+    timer->period_us = period_us;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    timer->used = false;
+    timer->active = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+/* The firmware's wall-clock reads, redirected at link time (--wrap) */
+time_t __wrap_time(time_t *out)
+{
+    time_t t = epoch + (time_t)(now_us / 1000000);
+    if (out) *out = t;
+    return t;
+}
+
+int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+    (void)tz;
+    tv->tv_sec = epoch + (time_t)(now_us / 1000000);
+    tv->tv_usec = (suseconds_t)(now_us % 1000000);
+    return 0;
+}
+
+/* ---- FreeRTOS ---- */
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(now_us / 1000);
+}
+
+/* Tasks are not started: the simulator calls the work functions on its own schedule */
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *out_handle)
+{
+    (void)code; (void)stack; (void)arg; (void)priority;
+    sim_log(ESP_LOG_DEBUG, "SIM", "Task %s not started in simulation", name);
+    if (out_handle) *out_handle = NULL;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) { (void)task; }
+void vTaskDelay(TickType_t ticks) { (void)ticks; }
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t period) { *previous_wake += period; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static int main_task;
+    return &main_task;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    (void)task; (void)value; (void)action;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t timeout)
+{
+    (void)clear_on_entry; (void)clear_on_exit; (void)timeout;
+    if (value) *value = 0;
+    return pdFALSE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    static int mutex;
+    return &mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout)
+{
+    (void)semaphore; (void)timeout;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    (void)semaphore;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { (void)semaphore; }
+
+/* ---- Logging and errors ---- */
+
+void sim_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > sim_log_level) return;
+
+    int64_t s = now_us / 1000000;
+    fprintf(stderr, "%c [%3lldd %02lld:%02lld:%02lld] %s: ", letters[level],
+            (long long)(s / 86400), (long long)(s / 3600 % 24), (long long)(s / 60 % 60),
+            (long long)(s % 60), tag);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default: return "ESP_ERR_UNKNOWN";
+    }
+}
+
+/* ---- NVS: namespaces are handles, values are byte strings ---- */
+
+typedef struct {
+    nvs_handle_t ns;
+    char key[16];
+    uint8_t data[SIM_NVS_MAX_BLOB];
+    size_t length;
+    bool used;
+} nvs_entry_t;
+
+static nvs_entry_t *nvs_entries;
+static char nvs_namespaces[16][16];
+static uint32_t nvs_namespace_count = 0;
+
+static nvs_entry_t *nvs_find(nvs_handle_t ns, const char *key, bool create)
+{
+    if (nvs_entries == NULL) {
+        nvs_entries = calloc(SIM_NVS_MAX_ENTRIES, sizeof(nvs_entry_t));
+        if (nvs_entries == NULL) return NULL;
+    }
+    nvs_entry_t *free_entry = NULL;
+    for (int i = 0; i < SIM_NVS_MAX_ENTRIES; i++) {
+        if (nvs_entries[i].used && nvs_entries[i].ns == ns && strcmp(nvs_entries[i].key, key) == 0) {
+            return &nvs_entries[i];
+        }
+        if (!nvs_entries[i].used && free_entry == NULL) free_entry = &nvs_entries[i];
+    }
+    if (!create || free_entry == NULL) return NULL;
+    memset(free_entry, 0, sizeof(*free_entry));
+    free_entry->used = true;
+    free_entry->ns = ns;
+    strncpy(free_entry->key, key, sizeof(free_entry->key) - 1);
+    return free_entry;
+}
+
+static esp_err_t nvs_put(nvs_handle_t ns, const char *key, const void *value, size_t length)
+{
+    if (length > SIM_NVS_MAX_BLOB) return ESP_ERR_INVALID_SIZE;
+    nvs_entry_t *entry = nvs_find(ns, key, true);
+    if (entry == NULL) return ESP_ERR_NO_MEM;
+    memcpy(entry->data, value, length);
+    entry->length = length;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_fetch(nvs_handle_t ns, const char *key, void *out, size_t length)
+{
+    nvs_entry_t *entry = nvs_find(ns, key, false);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (entry->length != length) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, entry->data, length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out_handle)
+{
+    for (uint32_t i = 0; i < nvs_namespace_count; i++) {
+        if (strcmp(nvs_namespaces[i], name) == 0) {
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    if (mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+    if (nvs_namespace_count >= 16) return ESP_ERR_NO_MEM;
+    strncpy(nvs_namespaces[nvs_namespace_count], name, 15);
+    *out_handle = ++nvs_namespace_count;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) { (void)handle; }
+esp_err_t nvs_commit(nvs_handle_t handle) { (void)handle; return ESP_OK; }
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length)
+{
+    nvs_entry_t *entry = nvs_find(handle, key, false);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, entry->data, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_put(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    nvs_entry_t *entry = nvs_find(handle, key, false);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, entry->data, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return nvs_put(handle, key, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out) { return nvs_fetch(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t v) { return nvs_put(h, key, &v, sizeof(v)); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char *key, uint16_t *out) { return nvs_fetch(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char *key, uint16_t v) { return nvs_put(h, key, &v, sizeof(v)); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out) { return nvs_fetch(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t v) { return nvs_put(h, key, &v, sizeof(v)); }
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    nvs_entry_t *entry = nvs_find(handle, key, false);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    entry->used = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    for (int i = 0; nvs_entries != NULL && i < SIM_NVS_MAX_ENTRIES; i++) {
+        if (nvs_entries[i].ns == handle) nvs_entries[i].used = false;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,25 @@
+#ifndef SIM_OS_H
+#define SIM_OS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <esp_log.h>
+
+/*
+ * Simulated clock for the host build.
+ *
+ * Everything that reads time on the target - esp_timer_get_time(), FreeRTOS
+ * ticks, time() and gettimeofday() - reads this clock instead. It only moves
+ * in sim_clock_advance(), which fires every esp_timer that falls due on the
+ * way in deadline order, so days of barn time run as fast as the control code
+ * executes and every run with the same seed is identical.
+ */
+
+extern esp_log_level_t sim_log_level;
+
+void sim_clock_init(time_t epoch);
+int64_t sim_clock_now_us(void);
+void sim_clock_advance(int64_t to_us);
+time_t sim_clock_epoch(void);
+
+#endif
@@ -0,0 +1,18 @@
+/* Host stand-in: GPIO numbers only; pins are never driven in the simulation */
+#pragma once
+#include <esp_err.h>
+
+typedef int gpio_num_t;
+
+#define GPIO_NUM_2  2
+#define GPIO_NUM_4  4
+#define GPIO_NUM_5  5
+#define GPIO_NUM_14 14
+#define GPIO_NUM_18 18
+#define GPIO_NUM_19 19
+#define GPIO_NUM_21 21
+#define GPIO_NUM_22 22
+#define GPIO_NUM_23 23
+#define GPIO_NUM_25 25
+#define GPIO_NUM_26 26
+#define GPIO_NUM_27 27
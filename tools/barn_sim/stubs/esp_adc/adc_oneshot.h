@@ -0,0 +1,31 @@
+/* Host stand-in: the ADC is replaced by the simulated sensor drivers */
+#pragma once
+#include <esp_err.h>
+
+typedef struct sim_adc_unit *adc_oneshot_unit_handle_t;
+
+typedef enum {
+    ADC_UNIT_1
+} adc_unit_t;
+
+typedef enum {
+    ADC_CHANNEL_0,
+    ADC_CHANNEL_1,
+    ADC_CHANNEL_2,
+    ADC_CHANNEL_3,
+    ADC_CHANNEL_4,
+    ADC_CHANNEL_5,
+    ADC_CHANNEL_6,
+    ADC_CHANNEL_7
+} adc_channel_t;
+
+typedef enum {
+    ADC_ONESHOT_ULP_MODE_DISABLE
+} adc_ulp_mode_t;
+
+typedef struct {
+    adc_unit_t unit_id;
+    adc_ulp_mode_t ulp_mode;
+} adc_oneshot_unit_init_config_t;
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_config_t *config, adc_oneshot_unit_handle_t *out_handle);
@@ -0,0 +1,19 @@
+/* Host stand-in for FreeRTOS: one simulated thread, 1 ms ticks */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       0xffffffffu
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+
+/* Everything runs on the one simulated core */
+static inline BaseType_t xPortGetCoreID(void) { return 0; }